@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Sensor 2 output on core0 (SPLIT_CORES)
+ */
+
+#include "core0-output.h"
+
+#include "hardware/irq.h"
+#include "hardware/structs/systick.h"
+#include "hardware/timer.h"
+
+volatile uint32_t core0_isr_busy_cycles = 0;
+
+static absolute_time_t next_edge_time;
+static bool running = false;
+
+// arms alarm for next edge, outputs late edges right away
+// out: false if sensor is stopped
+static bool __not_in_flash_func(schedule_next_edge)() {
+    while(max_cycle_count2 != 0) {
+        next_edge_time = delayed_by_us(next_edge_time, max_cycle_count2);
+        if(!hardware_alarm_set_target(CORE0_OUTPUT_ALARM, next_edge_time)) {
+            return true;
+        }
+        OUTPUT_EDGE_2
+    }
+    return false;
+}
+
+static void __not_in_flash_func(on_alarm)(uint alarm_num) {
+    ISR_LOAD_START
+    OUTPUT_EDGE_2
+    running = schedule_next_edge();
+    ISR_LOAD_END(core0_isr_busy_cycles)
+}
+
+void core0_output_init() {
+    start_load_measurement();
+    hardware_alarm_claim(CORE0_OUTPUT_ALARM);
+    // interrupt of alarm goes to the core setting its callback
+    hardware_alarm_set_callback(CORE0_OUTPUT_ALARM, on_alarm);
+    irq_set_priority(TIMER_IRQ_0 + CORE0_OUTPUT_ALARM, PICO_HIGHEST_IRQ_PRIORITY);
+}
+
+void core0_output_set_channel_params(const channel_params_t* p_params) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    SET_REVERSE_2(p_params->reverse)
+    max_cycle_count2 = apply_target(2, p_params) ? p_params->max_count : 0;
+    if(max_cycle_count2 != 0 && !running) {
+        next_edge_time = get_absolute_time();
+        running = schedule_next_edge();
+    } else if(max_cycle_count2 == 0 && running) {
+        hardware_alarm_cancel(CORE0_OUTPUT_ALARM);
+        running = false;
+    }
+    restore_interrupts(interrupts);
+}
@@ -0,0 +1,22 @@
+#ifndef CORE0_OUTPUT_H
+#define CORE0_OUTPUT_H
+
+#include "output-backend.h"
+
+// when SPLIT_CORES is set, sensor 2 is generated on core0
+// by a hardware alarm interrupt scheduled on each edge
+// so its latency does not depend on sensor 1 (which stays on core1)
+
+// hardware alarm of core0 sensor 2 output
+// (alarm 3 is used by default alarm pool and 2 by timer backend)
+#define CORE0_OUTPUT_ALARM 1
+
+// system clock cycles spent in core0 output interrupt (wraps around)
+extern volatile uint32_t core0_isr_busy_cycles;
+
+// to be called from core0 before any parameter is applied
+void core0_output_init();
+// applies new parameters of sensor 2 (its mailbox is core0 itself)
+void core0_output_set_channel_params(const channel_params_t* p_params);
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Benchmark and accuracy suite of output backends (output-backend.h), on the host
+ *
+ * The whole firmware runs on the host (pico-host), in simulated time. On each backend in
+ * turn (command b{n}), frequencies from 10 Hz to MAX_FREQUENCY are typed on its console
+ * (sensor 2 at another frequency, so that both sensors interleave), and sensor 1 edges are
+ * time stamped and followed by a reference quadrature decoder (quadrature-decoder.c).
+ * Reported per backend and frequency:
+ *  - measured frequency and its error to the one typed (periods are rounded to µs)
+ *  - jitter: max and rms of edge intervals minus the period the engine was given
+ *  - core1 interrupts per second, host time per interrupt and host load (share of host
+ *    time spent in interrupts of core1 per simulated second)
+ * then max frequency of each backend: highest frequency typed within MAX_ERROR_PERCENT,
+ * with jitter under MAX_JITTER_PERCENT of edge interval (bounded by MAX_FREQUENCY, which
+ * the firmware does not go past)
+ * Simulated time only shows jitter from interrupts held back (masked, or behind the other
+ * sensor) and from quantization of the engine (µs, VR samples), not from target cycles:
+ * target load is measured by command b on the board
+ * Exit status is 1 if an edge is lost, or if mean edge interval differs from engine period
+ * (by more than MAX_PERIOD_ERROR)
+ *
+ * Build: cc -O2 -I.. -Ipico-host -o backend-bench backend-bench.c quadrature-decoder.c pico-host/pico-host.c ../core0-output.c ../float_equality_ulp.c ../journal.c ../out-gpios.c ../output-backend.c ../pwm-managed.c ../sequence-store.c ../session.c ../session-log.c ../speed-sensor.c ../speed-sensor-util.c ../standstill.c ../state-snapshot.c ../sweep.c ../sync.c ../sync-pll.c ../telemetry.c ../timeline.c ../timer-managed.c ../train-model.c ../trigger.c ../vr-managed.c ../vr-wave.c -lm
+ * Usage: backend-bench [-t {measure ms per frequency}]
+ */
+
+#define PICO_HOST_TOOL
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico-host.h"
+#include "quadrature-decoder.h"
+
+#include "output-backend.h"
+#include "speed-sensor-util.h"
+
+#define SAMPLE_US 1000
+#define BACKEND_SWITCH_US 1500000
+// typed values reach the engine within a scheduler tick
+#define SETTLE_US 300000
+#define MIN_MEASURE_EDGES 100
+#define MAX_ERROR_PERCENT 1.0
+// of edge interval
+#define MAX_JITTER_PERCENT 10.0
+// sensor 2 runs at that ratio of sensor 1 frequency
+#define SENSOR2_RATIO 0.7
+// mean edge interval may differ from engine period by that much (relative): VR phase
+// step is rounded
+#define MAX_PERIOD_ERROR 1e-4
+
+static const double frequencies[] = {10, 100, 1000, 2000, 3000, 4000, 5000, 6000, 7000, MAX_FREQUENCY};
+#define NB_FREQUENCIES (sizeof(frequencies) / sizeof(frequencies[0]))
+
+static quadrature_decoder_t decoder;
+// sensor 1 edges while measuring: intervals minus engine period
+static bool measuring = false;
+static uint64_t last_edge_us;
+static uint64_t nb_intervals;
+static double sum_intervals, sum_squared_jitter, max_jitter;
+static unsigned long nb_errors = 0;
+
+static void on_gpios(uint32_t gpios) {
+    const uint8_t state = (gpios >> FIRST_OUT_PULSE & 1) << 1 | (gpios >> SECOND_OUT_PULSE & 1);
+    const uint64_t now_us = pico_host_time_us();
+    double jitter;
+    if(state == decoder.state) {
+        return;
+    }
+    quadrature_decoder_feed(&decoder, state >> 1, state & 1);
+    if(measuring && last_edge_us != 0) {
+        jitter = (double)(now_us - last_edge_us) - max_cycle_count1;
+        nb_intervals++;
+        sum_intervals += now_us - last_edge_us;
+        sum_squared_jitter += jitter * jitter;
+        if(fabs(jitter) > max_jitter) {
+            max_jitter = fabs(jitter);
+        }
+    }
+    last_edge_us = now_us;
+}
+
+// console output is not looked at
+static void discard(const char* buf, int length) {
+}
+
+static void error(const char* message, uint8_t backend, double frequency) {
+    fprintf(stderr, "%s at %.0f Hz: %s\n", get_backend_name(backend), frequency, message);
+    nb_errors++;
+}
+
+// types a command once previous one was read
+static void type(const char* command) {
+    while(!pico_host_input_consumed()) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    pico_host_input(command);
+    pico_host_input("\r\n");
+}
+
+// out: true if frequency is within MAX_ERROR_PERCENT and jitter under MAX_JITTER_PERCENT
+static bool measure(uint8_t backend, double frequency, uint64_t measure_us) {
+    char command[32];
+    uint64_t start_us, nb_interrupts, host_ns, end_interrupts, end_ns;
+    double seconds, measured, error_percent, rms_jitter, engine_period;
+    uint32_t period;
+
+    snprintf(command, sizeof(command), "%.1f:%.1f", frequency, frequency * SENSOR2_RATIO);
+    type(command);
+    pico_host_run_for(SETTLE_US);
+    period = max_cycle_count1;
+    // enough edges at low frequencies
+    if(measure_us < (uint64_t)MIN_MEASURE_EDGES * period) {
+        measure_us = (uint64_t)MIN_MEASURE_EDGES * period;
+    }
+    nb_intervals = 0;
+    sum_intervals = sum_squared_jitter = max_jitter = 0.0;
+    last_edge_us = 0;
+    decoder.nb_illegal = 0;
+    pico_host_get_interrupt_stats(1, &nb_interrupts, &host_ns);
+    start_us = pico_host_time_us();
+    measuring = true;
+    pico_host_run_for(measure_us);
+    measuring = false;
+    pico_host_get_interrupt_stats(1, &end_interrupts, &end_ns);
+    seconds = (pico_host_time_us() - start_us) / 1e6;
+    nb_interrupts = end_interrupts - nb_interrupts;
+    host_ns = end_ns - host_ns;
+
+    if(nb_intervals == 0 || period == 0) {
+        error("no edge", backend, frequency);
+        return false;
+    }
+    if(decoder.nb_illegal != 0) {
+        error("lost edge", backend, frequency);
+    }
+    engine_period = sum_intervals / nb_intervals;
+    if(fabs(engine_period - period) > MAX_PERIOD_ERROR * period || max_cycle_count1 != period) {
+        error("mean edge interval differs from engine period", backend, frequency);
+    }
+    // 4 edges per cycle
+    measured = 250000.0 / engine_period;
+    error_percent = 100.0 * (measured - frequency) / frequency;
+    rms_jitter = sqrt(sum_squared_jitter / nb_intervals);
+    printf("%-6s %7.0f Hz %10.2f Hz %+7.3f %% %6.2f µs %6.2f µs %9.0f /s %6.1f ns %6.2f %%\n",
+           get_backend_name(backend), frequency, measured, error_percent, max_jitter, rms_jitter,
+           nb_interrupts / seconds, nb_interrupts == 0 ? 0.0 : (double)host_ns / nb_interrupts,
+           host_ns / seconds / 1e7);
+    return fabs(error_percent) <= MAX_ERROR_PERCENT && max_jitter <= MAX_JITTER_PERCENT * period / 100.0;
+}
+
+int main(int argc, char* argv[]) {
+    char command[32];
+    double max_frequencies[e_nb_backends];
+    uint64_t measure_us = 1000000;
+    uint8_t backend, i;
+    int argi = 1;
+
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-t") == 0) {
+            measure_us = strtoull(argv[argi + 1], NULL, 10) * 1000;
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+
+    quadrature_decoder_init(&decoder, 0, 0);
+    pico_host_set_output(discard);
+    pico_host_set_gpio_hook(on_gpios);
+    pico_host_boot(firmware_main);
+    pico_host_run_for(PICO_HOST_USB_CONNECT_US + 100000);
+    pico_host_set_interrupt_timing(true);
+    printf("backend   typed     measured     error max jitter rms jitter interrupts  host/irq host load\n");
+    for(backend = 0; backend < e_nb_backends; backend++) {
+        // switched at standstill
+        type("0");
+        snprintf(command, sizeof(command), "b%hu", backend);
+        type(command);
+        pico_host_run_for(BACKEND_SWITCH_US);
+        max_frequencies[backend] = 0.0;
+        for(i = 0; i < NB_FREQUENCIES; i++) {
+            if(measure(backend, frequencies[i], measure_us)) {
+                max_frequencies[backend] = frequencies[i];
+            }
+        }
+    }
+    for(backend = 0; backend < e_nb_backends; backend++) {
+        printf("%s: max frequency %.0f Hz\n", get_backend_name(backend), max_frequencies[backend]);
+    }
+    fprintf(stderr, "%u backend(s), %lu error(s)\n", (unsigned)e_nb_backends, nb_errors);
+    return nb_errors != 0;
+}
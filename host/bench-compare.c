@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Compares results of speed_sensor_bench (speed-sensor-bench.c) with a baseline:
+ * both are JSON captured from the USB console of the board (anything around the
+ * JSON object, like console noise, is ignored)
+ * Each benchmark of the baseline is looked up in current results and its cycles per
+ * iteration compared: a regression is a rise above threshold (percent)
+ * With -k, compares another key of results (min_cycles by default: best batch,
+ * least disturbed)
+ * Exit status is 1 if any benchmark regressed, 2 on bad usage or unreadable files
+ *
+ * Capture: cat /dev/ttyACM0 > current.json (board running speed_sensor_bench)
+ * Build: cc -O2 -o bench-compare bench-compare.c
+ * Usage: bench-compare [-t {percent}] [-k {key}] {baseline.json} {current.json}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RESULTS 64
+#define MAX_NAME 32
+#define MAX_FILE_SIZE (64 * 1024)
+#define DEFAULT_THRESHOLD 5.0
+
+typedef struct {
+    char name[MAX_NAME];
+    double value;
+} result_t;
+
+typedef struct {
+    result_t results[MAX_RESULTS];
+    int count;
+} results_t;
+
+// reads results of a capture: objects with a name and the compared key
+// out: 0 if unreadable or without results
+static int read_results(const char* path, const char* key, results_t* p_results) {
+    static char text[MAX_FILE_SIZE + 1];
+    char pattern[MAX_NAME + 4];
+    const char* p;
+    const char* end;
+    const char* p_value;
+    size_t size, length;
+    FILE* f = fopen(path, "rb");
+    if(f == NULL) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 0;
+    }
+    size = fread(text, 1, MAX_FILE_SIZE, f);
+    fclose(f);
+    text[size] = '\0';
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    p_results->count = 0;
+    for(p = strstr(text, "\"name\":\""); p != NULL && p_results->count < MAX_RESULTS;
+        p = strstr(end, "\"name\":\"")) {
+        p += strlen("\"name\":\"");
+        end = strchr(p, '}');
+        if(end == NULL) {
+            break;
+        }
+        length = strcspn(p, "\"");
+        p_value = strstr(p, pattern);
+        if(length >= MAX_NAME || p_value == NULL || p_value > end) {
+            continue;
+        }
+        memcpy(p_results->results[p_results->count].name, p, length);
+        p_results->results[p_results->count].name[length] = '\0';
+        p_results->results[p_results->count].value = atof(p_value + strlen(pattern));
+        p_results->count++;
+    }
+    if(p_results->count == 0) {
+        fprintf(stderr, "no \"%s\" result in %s\n", key, path);
+    }
+    return p_results->count;
+}
+
+static const result_t* find_result(const results_t* p_results, const char* name) {
+    int i;
+    for(i = 0; i < p_results->count; i++) {
+        if(strcmp(p_results->results[i].name, name) == 0) {
+            return &p_results->results[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    static results_t baseline, current;
+    const char* key = "min_cycles";
+    const result_t* p_current;
+    double threshold = DEFAULT_THRESHOLD, change;
+    int i, nb_regressions = 0, argi = 1;
+
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-t") == 0) {
+            threshold = atof(argv[argi + 1]);
+        } else if(strcmp(argv[argi], "-k") == 0) {
+            key = argv[argi + 1];
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+    if(argc - argi != 2 || strlen(key) > MAX_NAME) {
+        fprintf(stderr, "Usage: bench-compare [-t {percent}] [-k {key}] {baseline.json} {current.json}\n");
+        return 2;
+    }
+    if(!read_results(argv[argi], key, &baseline) || !read_results(argv[argi + 1], key, &current)) {
+        return 2;
+    }
+    printf("%-20s %12s %12s %8s\n", "benchmark", "baseline", "current", "change");
+    for(i = 0; i < baseline.count; i++) {
+        p_current = find_result(&current, baseline.results[i].name);
+        if(p_current == NULL) {
+            printf("%-20s %12.1f %12s %8s  missing\n", baseline.results[i].name, baseline.results[i].value, "-", "-");
+            continue;
+        }
+        change = baseline.results[i].value > 0.0 ?
+                 (p_current->value - baseline.results[i].value) * 100.0 / baseline.results[i].value : 0.0;
+        printf("%-20s %12.1f %12.1f %+7.1f%%%s\n", baseline.results[i].name, baseline.results[i].value,
+               p_current->value, change, change > threshold ? "  REGRESSION" : "");
+        if(change > threshold) {
+            nb_regressions++;
+        }
+    }
+    for(i = 0; i < current.count; i++) {
+        if(find_result(&baseline, current.results[i].name) == NULL) {
+            printf("%-20s %12s %12.1f %8s  new\n", current.results[i].name, "-", current.results[i].value, "-");
+        }
+    }
+    printf("%d regression(s) above %.1f%% (%s)\n", nb_regressions, threshold, key);
+    return nb_regressions != 0;
+}
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Runs the benchmarks of speed_sensor_bench (speed-sensor-bench.c) on the host
+ *
+ * The bench firmware runs on the host (pico-host) as it does on target, with a SysTick
+ * counting host time in system clock cycles (pico_host_set_systick_counting): its JSON
+ * results are written to stdout, as captured from the board, for host/bench-compare.c.
+ * Host cycles only compare with other host runs (e.g. before and after a change, or
+ * between benchmarks of a run, such as specialized and generic output interrupts, whose
+ * delta is printed), not with target ones
+ * Exit status is 1 if no results came out
+ *
+ * Build: cc -O2 -I.. -Ipico-host -o bench-host bench-host.c pico-host/pico-host.c ../float_equality_ulp.c ../journal.c ../out-gpios.c ../output-backend.c ../pwm-managed.c ../sequence-store.c ../speed-sensor-bench.c ../speed-sensor-util.c ../standstill.c ../sweep.c ../timeline.c ../timer-managed.c ../vr-managed.c ../vr-wave.c -lm
+ * Usage: bench-host > current.json
+ */
+
+#define PICO_HOST_TOOL
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico-host.h"
+
+#define SAMPLE_US 100000
+#define TIMEOUT_US 60000000
+// end of results (speed-sensor-bench.c)
+#define RESULTS_END "]}"
+
+static bool results_ended = false;
+static char tail[sizeof(RESULTS_END)];
+
+static void out_chars(const char* buf, int length) {
+    const size_t tail_length = sizeof(tail) - 1;
+    int i;
+    fwrite(buf, 1, length, stdout);
+    for(i = 0; i < length; i++) {
+        memmove(tail, tail + 1, tail_length - 1);
+        tail[tail_length - 1] = buf[i];
+    }
+    if(strcmp(tail, RESULTS_END) == 0) {
+        results_ended = true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    pico_host_set_output(out_chars);
+    pico_host_set_systick_counting(true);
+    pico_host_boot(firmware_main);
+    while(!results_ended && pico_host_time_us() < TIMEOUT_US) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    fflush(stdout);
+    if(!results_ended) {
+        fprintf(stderr, "no results\n");
+    }
+    return !results_ended;
+}
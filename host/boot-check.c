@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks output state snapshots of the firmware (state-snapshot.c) across reboots
+ *
+ * The whole firmware runs on the host (pico-host), in simulated time. Each boot runs in
+ * its own process, flash content being handed over from one boot to the next:
+ *  - first boot (erased flash): a speed definition and running values are typed, left
+ *    stable well over SNAPSHOT_DELAY_MS: flash must not be written and output edges must
+ *    not pause; values are then stopped (saved by themselves once stable), and other
+ *    running values are saved with command k
+ *  - next boot: restored values must drive outputs (speed and direction of each sensor)
+ *    within one 1/4 period plus BOOT_BUDGET_US of boot, and not be saved again
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -Ipico-host -o boot-check boot-check.c quadrature-decoder.c pico-host/pico-host.c ../core0-output.c ../float_equality_ulp.c ../journal.c ../out-gpios.c ../output-backend.c ../pwm-managed.c ../sequence-store.c ../session.c ../session-log.c ../speed-sensor.c ../speed-sensor-util.c ../standstill.c ../state-snapshot.c ../sweep.c ../sync.c ../sync-pll.c ../telemetry.c ../timeline.c ../timer-managed.c ../train-model.c ../trigger.c ../vr-managed.c ../vr-wave.c -lm
+ * Usage: boot-check
+ */
+
+#define PICO_HOST_TOOL
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pico-host.h"
+#include "quadrature-decoder.h"
+
+#include "hardware/flash.h"
+#include "output-backend.h"
+#include "speed-sensor-util.h"
+#include "state-snapshot.h"
+
+#define NB_SENSORS 2
+#define SAMPLE_US 100
+// 20 teeth, 600 mm wheels: about 2.9 Hz per km/h
+#define SPEED_DEFINITION "20,600"
+// left running, then saved by command k (sensor 1 reversed)
+#define RUNNING_VALUES "50"
+#define SAVED_VALUES "60:40-+"
+static const float saved_speeds[NB_SENSORS] = {-60.0f, 40.0f};
+// time boot may take on top of 1/4 period of restored values until first edge
+#define BOOT_BUDGET_US 1000
+// edges checked after boot
+#define NB_BOOT_EDGES 16
+#define SETTLE_US 500000
+
+static quadrature_decoder_t decoders[NB_SENSORS];
+// time of last edge and longest interval between edges of each sensor
+static uint64_t last_edges_us[NB_SENSORS], max_intervals_us[NB_SENSORS];
+static unsigned long nb_errors = 0;
+
+static void discard(const char* buf, int length) {
+}
+
+static void on_gpios(uint32_t gpios) {
+    const uint8_t states[NB_SENSORS] = {
+        (gpios >> FIRST_OUT_PULSE & 1) << 1 | (gpios >> SECOND_OUT_PULSE & 1),
+        (gpios >> THIRD_OUT_PULSE & 1) << 1 | (gpios >> FOURTH_OUT_PULSE & 1)
+    };
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        if(states[i] == decoders[i].state) {
+            continue;
+        }
+        quadrature_decoder_feed(&decoders[i], states[i] >> 1, states[i] & 1);
+        if(last_edges_us[i] != 0 && pico_host_time_us() - last_edges_us[i] > max_intervals_us[i]) {
+            max_intervals_us[i] = pico_host_time_us() - last_edges_us[i];
+        }
+        last_edges_us[i] = pico_host_time_us();
+    }
+}
+
+static void error(const char* message, uint8_t sensor) {
+    fprintf(stderr, "%.4f s, sensor %hu: %s\n", pico_host_time_us() / 1e6, sensor, message);
+    nb_errors++;
+}
+
+static void reset_edges() {
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        last_edges_us[i] = max_intervals_us[i] = 0;
+    }
+}
+
+// types a command once previous one was read, and lets it run
+static void type(const char* command, uint64_t duration_us) {
+    while(!pico_host_input_consumed()) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    pico_host_input(command);
+    pico_host_input("\r\n");
+    pico_host_run_for(duration_us);
+}
+
+static void start(const uint8_t* p_flash) {
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        quadrature_decoder_init(&decoders[i], 0, 0);
+    }
+    reset_edges();
+    pico_host_set_output(discard);
+    pico_host_set_gpio_hook(on_gpios);
+    if(p_flash != NULL) {
+        pico_host_load_flash(p_flash);
+    }
+    pico_host_boot(firmware_main);
+}
+
+// first boot on erased flash, leaves flash content in p_flash
+static void first_boot(uint8_t* p_flash) {
+    static uint8_t before[PICO_FLASH_SIZE_BYTES];
+    uint64_t quarter_period_us;
+    start(NULL);
+    pico_host_run_for(PICO_HOST_USB_CONNECT_US + SETTLE_US);
+    type(SPEED_DEFINITION, SETTLE_US);
+    quarter_period_us = get_period(get_frequency(1, strtof(RUNNING_VALUES, NULL)));
+    type(RUNNING_VALUES, SETTLE_US);
+    memcpy(before, pico_host_flash, PICO_FLASH_SIZE_BYTES);
+    reset_edges();
+    pico_host_run_for(3 * SNAPSHOT_DELAY_MS * 1000);
+    if(memcmp(before, pico_host_flash, PICO_FLASH_SIZE_BYTES) != 0) {
+        error("running values saved by themselves", 0);
+    }
+    // an edge is late by less than an interrupt period
+    if(max_intervals_us[0] > quarter_period_us + 1 || max_intervals_us[1] > quarter_period_us + 1) {
+        error("running outputs paused", 0);
+    }
+    fprintf(stderr, "running: longest edge interval %llu us (1/4 period %llu us)\n",
+            (unsigned long long)max_intervals_us[0], (unsigned long long)quarter_period_us);
+    type("0", 2 * SNAPSHOT_DELAY_MS * 1000);
+    if(memcmp(before, pico_host_flash, PICO_FLASH_SIZE_BYTES) == 0) {
+        error("standstill not saved by itself", 0);
+    }
+    type(SAVED_VALUES, SETTLE_US);
+    memcpy(before, pico_host_flash, PICO_FLASH_SIZE_BYTES);
+    type("k", SETTLE_US);
+    if(memcmp(before, pico_host_flash, PICO_FLASH_SIZE_BYTES) == 0) {
+        error("running values not saved by command k", 0);
+    }
+    memcpy(p_flash, pico_host_flash, PICO_FLASH_SIZE_BYTES);
+}
+
+// boot on saved state: outputs resume before anything else
+static void next_boot(uint8_t* p_flash) {
+    uint64_t first_edges_us[NB_SENSORS] = {0, 0}, quarter_period_us;
+    uint8_t i;
+    start(p_flash);
+    while(pico_host_time_us() < SETTLE_US &&
+          (decoders[0].nb_edges < NB_BOOT_EDGES || decoders[1].nb_edges < NB_BOOT_EDGES)) {
+        pico_host_run_for(1);
+        for(i = 0; i < NB_SENSORS; i++) {
+            if(first_edges_us[i] == 0 && decoders[i].nb_edges != 0) {
+                first_edges_us[i] = pico_host_time_us();
+            }
+        }
+    }
+    for(i = 0; i < NB_SENSORS; i++) {
+        quarter_period_us = get_period(get_frequency(i + 1, fabsf(saved_speeds[i])));
+        fprintf(stderr, "boot: sensor %hu, first edge at %llu us (1/4 period %llu us, console at %llu us)\n",
+                i + 1, (unsigned long long)first_edges_us[i], (unsigned long long)quarter_period_us,
+                (unsigned long long)(pico_host_get_stdio_init_time() + PICO_HOST_USB_CONNECT_US));
+        if(first_edges_us[i] == 0 || first_edges_us[i] > quarter_period_us + BOOT_BUDGET_US) {
+            error("outputs not resumed in time", i + 1);
+        }
+        if(decoders[i].nb_edges < NB_BOOT_EDGES || decoders[i].nb_illegal != 0 ||
+           decoders[i].position != (saved_speeds[i] < 0.0f ? -1 : 1) * (int64_t)decoders[i].nb_edges) {
+            error("direction not restored", i + 1);
+        }
+        if(max_intervals_us[i] > quarter_period_us + 1) {
+            error("speed not restored", i + 1);
+        }
+    }
+    // restored values run at the prompt: not saved again
+    pico_host_run_for(PICO_HOST_USB_CONNECT_US + 3 * SNAPSHOT_DELAY_MS * 1000);
+    if(memcmp(p_flash, pico_host_flash, PICO_FLASH_SIZE_BYTES) != 0) {
+        error("restored values saved again", 0);
+    }
+}
+
+// runs a boot in its own process, errors are added to those of this one
+static void run_boot(void (*boot)(uint8_t* p_flash), uint8_t* p_flash) {
+    int status;
+    const pid_t pid = fork();
+    if(pid == 0) {
+        boot(p_flash);
+        exit(nb_errors > 255 ? 255 : nb_errors);
+    }
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        error("boot process failed", 0);
+        return;
+    }
+    nb_errors += WEXITSTATUS(status);
+}
+
+int main(int argc, char* argv[]) {
+    // flash handed over between boots
+    uint8_t* const p_flash = mmap(NULL, PICO_FLASH_SIZE_BYTES, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(p_flash == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    run_boot(first_boot, p_flash);
+    run_boot(next_boot, p_flash);
+    fprintf(stderr, "%lu error(s)\n", nb_errors);
+    return nb_errors != 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks speed conversions of the firmware per sensor against the baseline formulas
+ *
+ * Random speed definitions within range are typed for each sensor (command {sensor}#{teeth},
+ * {diameter},{ratio}, through process_input of speed-sensor-util.c), or one for both, then
+ * conversions of each sensor are compared with the formulas they are cached from, computed
+ * in double from the definition of that sensor only:
+ *  - hz_per_kmh: ratio * teeth / (pi * diameter * 3.6), diameter in m
+ *  - get_frequency (either direction), and the period output for it (get_period): a same
+ *    speed gives each sensor the frequency of its own wheel
+ *  - get_value (back from frequency) and get_distance: diameter * pi / (4 * teeth * ratio)
+ *    per edge, up to 2^53 edges
+ * Relative errors must stay within MAX_RELATIVE_ERROR (float factor), periods within
+ * rounding, and the largest errors are reported. Now and then, the definition of one
+ * sensor is cancelled ({sensor}#0,0), which must bring values back to frequencies
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -Ipico-host -o conversion-check conversion-check.c pico-host/pico-host.c ../core0-output.c ../float_equality_ulp.c ../journal.c ../out-gpios.c ../output-backend.c ../pwm-managed.c ../sequence-store.c ../session.c ../session-log.c ../speed-sensor.c ../speed-sensor-util.c ../standstill.c ../state-snapshot.c ../sweep.c ../sync.c ../sync-pll.c ../telemetry.c ../timeline.c ../timer-managed.c ../train-model.c ../trigger.c ../vr-managed.c ../vr-wave.c -lm
+ * Usage: conversion-check [-n {definitions}] [-s {seed}]
+ */
+
+#define PICO_HOST_TOOL
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico-host.h"
+
+#include "speed-sensor-util.h"
+
+#define NB_SENSORS NB_SPEED_DEFINITIONS
+#define NB_SPEEDS 1000
+#define MAX_SPEED 400.0
+// a few float roundings: cached factor, product
+#define MAX_RELATIVE_ERROR 1e-6
+#define PI_DOUBLE 3.14159265358979323846
+
+typedef struct {
+    int n_teeth;
+    int diameter_mm;
+    float gear_ratio; // as parsed
+} definition_t;
+
+// largest relative errors seen, per conversion
+typedef enum {
+    e_conversion_factor,
+    e_conversion_frequency,
+    e_conversion_value,
+    e_conversion_distance,
+    e_nb_conversions
+} conversion_e;
+
+static const char* const conversion_names[e_nb_conversions] = {"hz_per_kmh", "get_frequency", "get_value", "get_distance"};
+
+static double max_errors[e_nb_conversions];
+static unsigned long nb_errors = 0;
+
+static void error(const char* message, unsigned long definition, uint8_t sensor, double value) {
+    fprintf(stderr, "definition %lu, sensor %hu: %s (%g)\n", definition, sensor, message, value);
+    nb_errors++;
+}
+
+static void check_relative(conversion_e conversion, double actual, double expected, unsigned long definition,
+                           uint8_t sensor) {
+    const double relative = expected == 0.0 ? fabs(actual) : fabs(actual - expected) / fabs(expected);
+    if(relative > max_errors[conversion]) {
+        max_errors[conversion] = relative;
+    }
+    if(!(relative <= MAX_RELATIVE_ERROR)) {
+        char message[64];
+        snprintf(message, sizeof(message), "%s differs from baseline", conversion_names[conversion]);
+        error(message, definition, sensor, actual);
+    }
+}
+
+// baseline: frequency of one sensor at 1 km/h, from its own definition
+static double get_baseline_hz_per_kmh(const definition_t* p_definition) {
+    return (double)p_definition->gear_ratio * p_definition->n_teeth /
+           (PI_DOUBLE * p_definition->diameter_mm / 1000.0 * 3.6);
+}
+
+// baseline: meters per edge, one sensor cycle (four edges) per tooth
+static double get_baseline_distance(const definition_t* p_definition) {
+    return PI_DOUBLE * p_definition->diameter_mm / 1000.0 /
+           (4.0 * p_definition->n_teeth * p_definition->gear_ratio);
+}
+
+static void random_definition(definition_t* p_definition) {
+    char ratio[16];
+    p_definition->n_teeth = MIN_N_TEETH + rand() % (MAX_N_TEETH - MIN_N_TEETH + 1);
+    p_definition->diameter_mm = MIN_DIA_MM + rand() % (MAX_DIA_MM - MIN_DIA_MM + 1);
+    // typed with 3 decimals, parsed as the firmware does
+    snprintf(ratio, sizeof(ratio), "%.3f", MIN_RATIO + (MAX_RATIO - MIN_RATIO) * rand() / RAND_MAX);
+    p_definition->gear_ratio = strtof(ratio, NULL);
+}
+
+// types definitions of both sensors: one command each, or a common one when equal
+static void type_definitions(const definition_t definitions[NB_SENSORS], bool common, unsigned long definition) {
+    char command[48];
+    uint8_t i;
+    if(common) {
+        snprintf(command, sizeof(command), "%d,%d,%.3f", definitions[0].n_teeth, definitions[0].diameter_mm,
+                 definitions[0].gear_ratio);
+        if(process_input(command) != e_new_speed_definition) {
+            error("definition refused", definition, 0, 0.0);
+        }
+        return;
+    }
+    for(i = 0; i < NB_SENSORS; i++) {
+        snprintf(command, sizeof(command), "%hu#%d,%d,%.3f", i + 1, definitions[i].n_teeth,
+                 definitions[i].diameter_mm, definitions[i].gear_ratio);
+        if(process_input(command) != e_new_sensor_speed_definition) {
+            error("sensor definition refused", definition, i + 1, 0.0);
+        }
+    }
+}
+
+// cancels definition of one sensor: values are frequencies again
+static void cancel_definition(unsigned long definition, uint8_t sensor) {
+    char command[16];
+    snprintf(command, sizeof(command), "%hu#0,0", sensor);
+    if(process_input(command) != e_new_sensor_speed_definition) {
+        error("cancel refused", definition, sensor, 0.0);
+    }
+    if(speed_definitions[sensor - 1].hz_per_kmh != 0.0f || value_is_speed()) {
+        error("definition not cancelled", definition, sensor, speed_definitions[sensor - 1].hz_per_kmh);
+    }
+}
+
+static void check_sensor(const definition_t* p_definition, unsigned long definition, uint8_t sensor) {
+    const double hz_per_kmh = get_baseline_hz_per_kmh(p_definition);
+    const double meters_per_edge = get_baseline_distance(p_definition);
+    double speed, frequency, expected_period;
+    int64_t edges;
+    uint32_t period, i;
+
+    check_relative(e_conversion_factor, speed_definitions[sensor - 1].hz_per_kmh, hz_per_kmh, definition, sensor);
+    for(i = 0; i < NB_SPEEDS; i++) {
+        // tenths of km/h as typed, either direction
+        speed = (float)(rand() % (int)(MAX_SPEED * 10)) / 10.0f;
+        if(rand() % 2) {
+            speed = -speed;
+        }
+        frequency = get_frequency(sensor, (float)speed);
+        check_relative(e_conversion_frequency, frequency, fabs(speed) * hz_per_kmh, definition, sensor);
+        if(speed != 0.0) {
+            check_relative(e_conversion_value, get_value(sensor, (float)frequency), fabs(speed), definition, sensor);
+        }
+        // period output for that speed: the one of the baseline frequency, but on a rounding tie
+        expected_period = fabs(speed) * hz_per_kmh;
+        if(expected_period != 0.0) {
+            expected_period = 250000.0 / fmin(fmax(expected_period, MIN_FREQUENCY), MAX_FREQUENCY);
+            period = get_period((float)frequency);
+            if(fabs(period - expected_period) > 0.5 + expected_period * MAX_RELATIVE_ERROR) {
+                error("period differs from baseline", definition, sensor, period);
+            }
+        }
+        // edge counts of any magnitude, up to where a double holds them
+        edges = (int64_t)(((uint64_t)rand() << 31 ^ (uint64_t)rand()) >> rand() % 62) >> (rand() % 2 ? 0 : 9);
+        if(rand() % 2) {
+            edges = -edges;
+        }
+        check_relative(e_conversion_distance, get_distance(sensor, edges), edges * meters_per_edge, definition, sensor);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    definition_t definitions[NB_SENSORS];
+    unsigned long nb_definitions = 10000, definition;
+    bool common;
+    uint8_t i;
+    int argi = 1;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            nb_definitions = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+
+    // firmware is not booted: conversions only
+    for(definition = 0; definition < nb_definitions; definition++) {
+        common = rand() % 4 == 0;
+        for(i = 0; i < NB_SENSORS; i++) {
+            random_definition(&definitions[i]);
+            if(common) {
+                definitions[i] = definitions[0];
+            }
+        }
+        type_definitions(definitions, common, definition);
+        if(!value_is_speed()) {
+            error("values not speeds once defined", definition, 0, 0.0);
+        }
+        for(i = 0; i < NB_SENSORS; i++) {
+            check_sensor(&definitions[i], definition, i + 1);
+        }
+        if(rand() % 8 == 0) {
+            cancel_definition(definition, 1 + rand() % NB_SENSORS);
+        }
+    }
+    for(i = 0; i < e_nb_conversions; i++) {
+        fprintf(stderr, "%s: max relative error %.2e\n", conversion_names[i], max_errors[i]);
+    }
+    fprintf(stderr, "%lu definition(s), %lu error(s)\n", nb_definitions, nb_errors);
+    return nb_errors != 0;
+}
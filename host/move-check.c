@@ -0,0 +1,288 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks move sequence items of the firmware (@{distance}[e][,{decel}]): edge counts travelled
+ *
+ * The whole firmware runs on the host (pico-host), in simulated time, through sequences typed
+ * on its console: a ramp to random speeds and directions, then a move of a random number of
+ * edges or of a random distance (with its own random wheel per sensor), on each output
+ * backend in turn. A reference quadrature decoder (quadrature-decoder.c) follows outputs edge
+ * by edge, from the edge count the output interrupt is given as target. Checks, per sensor:
+ *  - edges travelled equal those typed, or the distance typed over the distance of one edge
+ *    (get_distance), rounded: exactly, whatever the count (a last move goes past 2^24 edges,
+ *    where a float no longer holds every count)
+ *  - outputs never go past the target, and stop on it
+ *  - moves which are not finite numbers, or longer than MAX_MOVE_EDGES (in edges or once
+ *    converted to edges of a sensor), are refused (process_input)
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -Ipico-host -o move-check move-check.c quadrature-decoder.c pico-host/pico-host.c ../core0-output.c ../float_equality_ulp.c ../journal.c ../out-gpios.c ../output-backend.c ../pwm-managed.c ../sequence-store.c ../session.c ../session-log.c ../speed-sensor.c ../speed-sensor-util.c ../standstill.c ../state-snapshot.c ../sweep.c ../sync.c ../sync-pll.c ../telemetry.c ../timeline.c ../timer-managed.c ../train-model.c ../trigger.c ../vr-managed.c ../vr-wave.c -lm
+ * Usage: move-check [-n {moves per backend}] [-s {seed}] [-l {edges of last move, 0 for none}]
+ */
+
+#define PICO_HOST_TOOL
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico-host.h"
+#include "quadrature-decoder.h"
+
+#include "output-backend.h"
+#include "speed-sensor-util.h"
+
+#define NB_SENSORS 2
+#define SAMPLE_US 1000
+#define MAX_SPEED 150
+#define MAX_EDGES 5000
+#define MAX_DISTANCE_CM 2000
+#define MAX_DECELERATION 4
+#define BACKEND_SWITCH_US 1500000
+// a stopped sensor must not move on
+#define SETTLE_US 300000
+#define MOVE_TIMEOUT_US 1200000000ULL
+// first edge count a float does not hold
+#define LAST_MOVE_EDGES 16777217LL
+// smallest wheels with most teeth, for the last move: about 6.7 kHz
+#define LAST_MOVE_DEFINITION "1908,300"
+#define LAST_MOVE_SPEED 12
+
+static quadrature_decoder_t decoders[NB_SENSORS];
+// target of move in progress as output interrupt got it, and decoder position it was armed on
+static bool armed[NB_SENSORS];
+static int64_t targets[NB_SENSORS], starts[NB_SENSORS];
+static bool overshoots[NB_SENSORS];
+static unsigned long nb_errors = 0;
+
+static int64_t get_target_edge(uint8_t i) {
+    return i == 0 ? target_edge1 : target_edge2;
+}
+
+static void on_gpios(uint32_t gpios) {
+    const uint8_t states[NB_SENSORS] = {
+        (gpios >> FIRST_OUT_PULSE & 1) << 1 | (gpios >> SECOND_OUT_PULSE & 1),
+        (gpios >> THIRD_OUT_PULSE & 1) << 1 | (gpios >> FOURTH_OUT_PULSE & 1)
+    };
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        if(states[i] == decoders[i].state) {
+            continue;
+        }
+        // target is computed and armed between two edges: from the count of the last one
+        if(!armed[i] && get_target_edge(i) != TARGET_NONE) {
+            armed[i] = true;
+            targets[i] = get_target_edge(i);
+            starts[i] = decoders[i].position;
+        }
+        quadrature_decoder_feed(&decoders[i], states[i] >> 1, states[i] & 1);
+        if(armed[i] && (targets[i] >= starts[i] ? decoders[i].position > targets[i] :
+                                                  decoders[i].position < targets[i])) {
+            overshoots[i] = true;
+        }
+    }
+}
+
+// console output is not looked at
+static void discard(const char* buf, int length) {
+}
+
+static void error(const char* message, uint8_t sensor) {
+    fprintf(stderr, "%.4f s, sensor %hu: %s\n", pico_host_time_us() / 1e6, sensor, message);
+    nb_errors++;
+}
+
+// types a command once previous one was read
+static void type(const char* command) {
+    while(!pico_host_input_consumed()) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    pico_host_input(command);
+    pico_host_input("\r\n");
+}
+
+static bool is_stopped() {
+    return max_cycle_count1 == 0 && max_cycle_count2 == 0 &&
+           target_edge1 == TARGET_NONE && target_edge2 == TARGET_NONE;
+}
+
+// runs a sequence of a ramp to speeds (km/h, negative when reversed) then a move,
+// checks edges travelled against those expected, returns edges travelled by sensor 1
+static int64_t check_move(const float speeds[NB_SENSORS], const char* move, const int64_t nb_edges[NB_SENSORS]) {
+    static const char* const rev_defs[] = {"+", "-+", "+-", "-"};
+    char command[64];
+    int64_t position;
+    const uint64_t start_us = pico_host_time_us();
+    uint8_t i;
+
+    for(i = 0; i < NB_SENSORS; i++) {
+        armed[i] = overshoots[i] = false;
+    }
+    type("(");
+    snprintf(command, sizeof(command), "1\">%.1f:%.1f%s", fabsf(speeds[0]), fabsf(speeds[1]),
+             rev_defs[(speeds[0] < 0.0f) | (speeds[1] < 0.0f) << 1]);
+    type(command);
+    type(move);
+    type(")");
+    type("!");
+    do {
+        pico_host_run_for(SAMPLE_US);
+    } while(!(armed[0] && armed[1] && is_stopped()) && pico_host_time_us() - start_us < MOVE_TIMEOUT_US);
+    pico_host_run_for(SETTLE_US);
+    for(i = 0; i < NB_SENSORS; i++) {
+        position = decoders[i].position;
+        if(!armed[i]) {
+            error("move not armed", i + 1);
+            continue;
+        }
+        if((speeds[i] < 0.0f ? starts[i] - position : position - starts[i]) != nb_edges[i]) {
+            fprintf(stderr, "%s at %.1f km/h: %lld edges expected, %lld travelled\n", move, speeds[i],
+                    (long long)nb_edges[i], (long long)(position - starts[i]));
+            error("edges travelled differ from target", i + 1);
+        }
+        if(overshoots[i]) {
+            error("outputs went past target", i + 1);
+        }
+        if(position != targets[i]) {
+            error("outputs not stopped on target", i + 1);
+        }
+        if(get_edge_count(i + 1) != position) {
+            error("edge count differs from decoder position", i + 1);
+        }
+        if(decoders[i].nb_illegal != 0) {
+            error("lost edge", i + 1);
+            decoders[i].nb_illegal = 0;
+        }
+    }
+    return decoders[0].position - starts[0];
+}
+
+// not finite, or count plus target could overflow
+static void check_refused_moves() {
+    static const char* const moves[] = {
+        "@nan", "@inf", "@-inf", "@nane", "@10,nan", "@10,inf", "@10e,nan", "@9007199254740993e",
+        "@99999999999999999999e", "@1e300", "@100000000000000"
+    };
+    uint8_t i;
+    // smallest wheels with most teeth: most edges per meter
+    process_input(LAST_MOVE_DEFINITION);
+    for(i = 0; i < sizeof(moves) / sizeof(moves[0]); i++) {
+        if(process_input(moves[i]) == e_new_record) {
+            fprintf(stderr, "%s not refused\n", moves[i]);
+            error("move out of range accepted", 0);
+        }
+    }
+    if(process_input("@9007199254740992e") != e_new_record) {
+        error("longest move refused", 0);
+    }
+    process_input("0,0");
+}
+
+static float random_speed() {
+    // tenths, as typed
+    const float speed = (float)(50 + rand() % ((MAX_SPEED - 5) * 10)) / 10.0f;
+    return rand() % 3 == 0 ? -speed : speed;
+}
+
+// random wheel per sensor, so that one distance is a different edge count on each
+static void define_wheels() {
+    char command[32];
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        snprintf(command, sizeof(command), "%hu#%d,%d", i + 1, MIN_N_TEETH + rand() % 200,
+                 MIN_DIA_MM + rand() % (MAX_DIA_MM - MIN_DIA_MM));
+        type(command);
+    }
+    // definitions in use before distances are converted
+    while(!pico_host_input_consumed()) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    pico_host_run_for(SAMPLE_US);
+}
+
+static void random_move(int64_t* p_nb_edges) {
+    char move[64], deceleration[8] = "";
+    float speeds[NB_SENSORS];
+    int64_t nb_edges[NB_SENSORS];
+    double distance;
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        speeds[i] = random_speed();
+    }
+    if(rand() % 2 == 0) {
+        snprintf(deceleration, sizeof(deceleration), ",%d", 1 + rand() % MAX_DECELERATION);
+    }
+    if(rand() % 2 == 0) {
+        nb_edges[0] = nb_edges[1] = 1 + rand() % MAX_EDGES;
+        snprintf(move, sizeof(move), "@%llde%s", (long long)nb_edges[0], deceleration);
+    } else {
+        snprintf(move, sizeof(move), "@%d.%02d%s", 1 + rand() % (MAX_DISTANCE_CM / 100), rand() % 100, deceleration);
+        // same distance on both sensors, as many edges of each as it is closest to
+        distance = strtod(move + 1, NULL);
+        for(i = 0; i < NB_SENSORS; i++) {
+            nb_edges[i] = llround(distance / get_distance(i + 1, 1));
+        }
+    }
+    *p_nb_edges += check_move(speeds, move, nb_edges);
+}
+
+int main(int argc, char* argv[]) {
+    char command[32];
+    const float last_speeds[NB_SENSORS] = {LAST_MOVE_SPEED, -LAST_MOVE_SPEED};
+    int64_t last_edges = LAST_MOVE_EDGES;
+    int64_t last_nb_edges[NB_SENSORS];
+    int64_t nb_edges;
+    unsigned long nb_moves = 6, move;
+    uint8_t backend, i;
+    int argi = 1;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            nb_moves = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else if(strcmp(argv[argi], "-l") == 0) {
+            last_edges = strtoll(argv[argi + 1], NULL, 10);
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+
+    for(i = 0; i < NB_SENSORS; i++) {
+        quadrature_decoder_init(&decoders[i], 0, 0);
+    }
+    pico_host_set_output(discard);
+    pico_host_set_gpio_hook(on_gpios);
+    pico_host_boot(firmware_main);
+    pico_host_run_for(PICO_HOST_USB_CONNECT_US + 100000);
+    check_refused_moves();
+    for(backend = 0; backend < e_nb_backends; backend++) {
+        snprintf(command, sizeof(command), "b%hu", backend);
+        type(command);
+        // load of new backend measured over a second
+        pico_host_run_for(BACKEND_SWITCH_US);
+        nb_edges = 0;
+        for(move = 0; move < nb_moves; move++) {
+            define_wheels();
+            random_move(&nb_edges);
+        }
+        fprintf(stderr, "%s: %lu move(s), %lld edges travelled by sensor 1\n", get_backend_name(backend),
+                nb_moves, (long long)nb_edges);
+    }
+    if(last_edges > 0) {
+        // edges generated one by one: the fastest backend to simulate, without PWM interrupts
+        type("b1");
+        pico_host_run_for(BACKEND_SWITCH_US);
+        pico_host_set_pwm_irq(false);
+        type(LAST_MOVE_DEFINITION);
+        snprintf(command, sizeof(command), "@%llde", (long long)last_edges);
+        last_nb_edges[0] = last_nb_edges[1] = last_edges;
+        check_move(last_speeds, command, last_nb_edges);
+        fprintf(stderr, "%s: last move, %lld edges\n", get_backend_name(1), (long long)last_edges);
+    }
+    fprintf(stderr, "%lu move(s) per backend, %lu error(s)\n", nb_moves, nb_errors);
+    return nb_errors != 0;
+}
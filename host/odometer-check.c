@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks odometer of the firmware: edge counts and distances displayed by command d
+ *
+ * The whole firmware runs on the host (pico-host), in simulated time, through random
+ * immediate values typed on its console: speeds and directions of both sensors, on
+ * each output backend in turn (switched at standstill). A reference quadrature decoder
+ * (quadrature-decoder.c) follows outputs edge by edge, and output engine parameters are
+ * sampled every SAMPLE_US: a typed value counts as commanded from the sample its
+ * period and direction reach the engine on. Checks:
+ *  - edge count of each sensor equals decoder position, with no lost edge
+ *  - distance of edge count (get_distance) equals integral of commanded speeds, within
+ *    one edge per change of values (edge in progress) and rounding of periods to µs
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -Ipico-host -o odometer-check odometer-check.c quadrature-decoder.c pico-host/pico-host.c ../core0-output.c ../float_equality_ulp.c ../journal.c ../out-gpios.c ../output-backend.c ../pwm-managed.c ../sequence-store.c ../session.c ../session-log.c ../speed-sensor.c ../speed-sensor-util.c ../standstill.c ../state-snapshot.c ../sweep.c ../sync.c ../sync-pll.c ../telemetry.c ../timeline.c ../timer-managed.c ../train-model.c ../trigger.c ../vr-managed.c ../vr-wave.c -lm
+ * Usage: odometer-check [-n {changes per backend}] [-s {seed}]
+ */
+
+#define PICO_HOST_TOOL
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico-host.h"
+#include "quadrature-decoder.h"
+
+#include "output-backend.h"
+#include "speed-sensor-util.h"
+
+#define NB_SENSORS 2
+#define SAMPLE_US 100
+// 20 teeth, 600 mm wheels: about 2.9 Hz per km/h
+#define SPEED_DEFINITION "20,600"
+#define MAX_SPEED 150
+#define MIN_HOLD_US 300000
+#define MAX_HOLD_US 2000000
+#define BACKEND_SWITCH_US 1500000
+
+typedef struct {
+    float speeds[NB_SENSORS]; // km/h, negative when reversed
+} values_t;
+
+// indexed by reverse of sensor 1 | reverse of sensor 2 << 1
+static const char* const rev_defs[] = {"+", "-+", "+-", "-"};
+
+static quadrature_decoder_t decoders[NB_SENSORS];
+// commanded values: applied to engine, typed and waiting to be
+static values_t applied, pending;
+static bool is_pending = false;
+// integral of commanded speeds (m), and edges it misses due to rounding of periods
+static double distances[NB_SENSORS], roundings[NB_SENSORS];
+static unsigned long nb_applied = 0;
+static unsigned long nb_errors = 0;
+
+static void on_gpios(uint32_t gpios) {
+    quadrature_decoder_feed(&decoders[0], (gpios >> FIRST_OUT_PULSE) & 1, (gpios >> SECOND_OUT_PULSE) & 1);
+    quadrature_decoder_feed(&decoders[1], (gpios >> THIRD_OUT_PULSE) & 1, (gpios >> FOURTH_OUT_PULSE) & 1);
+}
+
+// console output is not looked at
+static void discard(const char* buf, int length) {
+}
+
+static void error(const char* message, uint8_t sensor) {
+    fprintf(stderr, "%.4f s, sensor %hu: %s\n", pico_host_time_us() / 1e6, sensor, message);
+    nb_errors++;
+}
+
+// period (µs, 1/4 of cycle) the firmware gives engine for a speed
+static uint32_t get_engine_period(uint8_t sensor, float speed) {
+    return speed == 0.0f ? 0 : get_period(get_frequency(sensor, fabsf(speed)));
+}
+
+static bool is_applied(const values_t* p_values) {
+    return max_cycle_count1 == get_engine_period(1, p_values->speeds[0]) &&
+           max_cycle_count2 == get_engine_period(2, p_values->speeds[1]) &&
+           (p_values->speeds[0] == 0.0f || reverse1 == (p_values->speeds[0] < 0.0f)) &&
+           (p_values->speeds[1] == 0.0f || reverse2 == (p_values->speeds[1] < 0.0f));
+}
+
+// adds one sample period of commanded values to integrals
+static void integrate() {
+    const uint32_t periods[NB_SENSORS] = {max_cycle_count1, max_cycle_count2};
+    uint8_t i;
+    if(is_pending && is_applied(&pending)) {
+        applied = pending;
+        is_pending = false;
+        nb_applied++;
+    } else if(!is_applied(&applied)) {
+        error("engine runs values not commanded", 0);
+    }
+    for(i = 0; i < NB_SENSORS; i++) {
+        if(periods[i] == 0) {
+            continue;
+        }
+        distances[i] += applied.speeds[i] / 3.6 * SAMPLE_US / 1e6;
+        // period is rounded to µs: edges of engine frequency minus edges of commanded one
+        roundings[i] += (applied.speeds[i] < 0.0f ? -4.0 : 4.0) *
+                        (250000.0 / periods[i] - get_frequency(i + 1, fabsf(applied.speeds[i]))) * SAMPLE_US / 1e6;
+    }
+}
+
+static void check_counts() {
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        if(get_edge_count(i + 1) != decoders[i].position) {
+            error("edge count differs from decoder position", i + 1);
+            // once per difference
+            decoders[i].position = get_edge_count(i + 1);
+        }
+        if(decoders[i].nb_illegal != 0) {
+            error("lost edge", i + 1);
+            decoders[i].nb_illegal = 0;
+        }
+    }
+}
+
+// runs firmware for duration, sampling engine
+static void run(uint64_t duration_us) {
+    const uint64_t end = pico_host_time_us() + duration_us;
+    while(pico_host_time_us() < end) {
+        pico_host_run_for(SAMPLE_US);
+        integrate();
+        check_counts();
+    }
+}
+
+// types a command once previous one was read
+static void type(const char* command) {
+    while(!pico_host_input_consumed()) {
+        run(SAMPLE_US);
+    }
+    pico_host_input(command);
+    pico_host_input("\r\n");
+}
+
+static void command_values(const values_t* p_values) {
+    char command[64];
+    const uint8_t rev_def = (p_values->speeds[0] < 0.0f) | (p_values->speeds[1] < 0.0f) << 1;
+    snprintf(command, sizeof(command), "%.1f:%.1f%s", fabsf(p_values->speeds[0]),
+             fabsf(p_values->speeds[1]), rev_defs[rev_def]);
+    pending = *p_values;
+    is_pending = true;
+    type(command);
+}
+
+static float random_speed() {
+    float speed;
+    if(rand() % 8 == 0) {
+        return 0.0f;
+    }
+    // tenths, as typed
+    speed = (float)(50 + rand() % ((MAX_SPEED - 5) * 10)) / 10.0f;
+    return rand() % 3 == 0 ? -speed : speed;
+}
+
+static void check_distances(const char* backend) {
+    double deviation;
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        // in edges, rounding of periods taken out: at most the edge in progress at each change
+        deviation = (get_distance(i + 1, get_edge_count(i + 1)) - distances[i]) / get_distance(i + 1, 1) - roundings[i];
+        fprintf(stderr, "%s: sensor %hu, %lld edges, %.3f m, commanded %.3f m, rounding %+.2f edges, "
+                "deviation %+.2f edges over %lu change(s)\n", backend, i + 1, (long long)get_edge_count(i + 1),
+                get_distance(i + 1, get_edge_count(i + 1)), distances[i], roundings[i], deviation, nb_applied);
+        if(fabs(deviation) > nb_applied + 1) {
+            error("distance differs from integral of commanded speed", i + 1);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const values_t stop = {{0.0f, 0.0f}};
+    values_t values;
+    char command[8];
+    unsigned long nb_changes = 40, change;
+    uint8_t backend, i;
+    int argi = 1;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            nb_changes = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+
+    for(i = 0; i < NB_SENSORS; i++) {
+        quadrature_decoder_init(&decoders[i], 0, 0);
+    }
+    pico_host_set_output(discard);
+    pico_host_set_gpio_hook(on_gpios);
+    pico_host_boot(firmware_main);
+    pico_host_run_for(PICO_HOST_USB_CONNECT_US + 100000);
+    type(SPEED_DEFINITION);
+    run(MIN_HOLD_US);
+    for(backend = 0; backend < e_nb_backends; backend++) {
+        snprintf(command, sizeof(command), "b%hu", backend);
+        type(command);
+        // load of new backend measured over a second
+        run(BACKEND_SWITCH_US);
+        for(change = 0; change < nb_changes; change++) {
+            for(i = 0; i < NB_SENSORS; i++) {
+                values.speeds[i] = random_speed();
+            }
+            command_values(&values);
+            run(MIN_HOLD_US + rand() % (MAX_HOLD_US - MIN_HOLD_US));
+        }
+        command_values(&stop);
+        run(MIN_HOLD_US);
+        if(is_pending) {
+            error("values not applied", 0);
+        }
+        check_distances(get_backend_name(backend));
+    }
+    fprintf(stderr, "%lu change(s) per backend, %lu error(s)\n", nb_changes, nb_errors);
+    return nb_errors != 0;
+}
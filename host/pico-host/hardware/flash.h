@@ -0,0 +1,18 @@
+#ifndef PICO_HOST_FLASH_H
+#define PICO_HOST_FLASH_H
+
+#include "pico/stdlib.h"
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+// flash is an array of host memory, read through XIP_BASE as on target
+extern uint8_t pico_host_flash[];
+#define XIP_BASE ((uintptr_t)pico_host_flash)
+
+// take their typical duration of simulated time
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count);
+
+#endif
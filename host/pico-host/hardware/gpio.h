@@ -0,0 +1,7 @@
+#ifndef PICO_HOST_GPIO_H
+#define PICO_HOST_GPIO_H
+
+// GPIO functions are declared by pico/stdlib.h
+#include "pico/stdlib.h"
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef PICO_HOST_IRQ_H
+#define PICO_HOST_IRQ_H
+
+#include "pico/stdlib.h"
+
+enum irq_num_rp2040 {
+    TIMER_IRQ_0 = 0, TIMER_IRQ_1 = 1, TIMER_IRQ_2 = 2, TIMER_IRQ_3 = 3, PWM_IRQ_WRAP = 4,
+    IO_IRQ_BANK0 = 13, UART1_IRQ = 21
+};
+
+#define PICO_HIGHEST_IRQ_PRIORITY 0x00
+#define PICO_DEFAULT_IRQ_PRIORITY 0x80
+
+// interrupt is serviced by the core setting its handler
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_remove_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+void irq_set_priority(uint num, uint8_t hardware_priority);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PICO_HOST_PWM_H
+#define PICO_HOST_PWM_H
+
+#include "pico/stdlib.h"
+
+// wrap interrupt of slices is simulated, levels are not
+typedef struct {
+    float clkdiv;
+    uint16_t top;
+} pwm_config;
+
+enum pwm_chan {
+    PWM_CHAN_A = 0,
+    PWM_CHAN_B = 1
+};
+
+static inline pwm_config pwm_get_default_config(void) {
+    pwm_config config = {1.0f, 0xFFFF};
+    return config;
+}
+static inline void pwm_config_set_clkdiv(pwm_config* c, float div) {
+    c->clkdiv = div;
+}
+static inline void pwm_config_set_wrap(pwm_config* c, uint16_t wrap) {
+    c->top = wrap;
+}
+void pwm_init(uint slice_num, pwm_config* c, bool start);
+void pwm_set_wrap(uint slice_num, uint16_t wrap);
+void pwm_set_enabled(uint slice_num, bool enabled);
+void pwm_set_irq_enabled(uint slice_num, bool enabled);
+void pwm_clear_irq(uint slice_num);
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level);
+void pwm_set_both_levels(uint slice_num, uint16_t level_a, uint16_t level_b);
+
+#endif
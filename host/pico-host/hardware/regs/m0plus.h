@@ -0,0 +1,7 @@
+#ifndef PICO_HOST_M0PLUS_H
+#define PICO_HOST_M0PLUS_H
+
+#define M0PLUS_SYST_CSR_CLKSOURCE_BITS 0x00000004
+#define M0PLUS_SYST_CSR_ENABLE_BITS 0x00000001
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef PICO_HOST_SYSTICK_H
+#define PICO_HOST_SYSTICK_H
+
+#include <stdint.h>
+
+// SysTick of host simulation stands still (interrupt loads are measured as 0), unless
+// host tool makes it count host time (pico_host_set_systick_counting): each access
+// through systick_hw reads the host clock
+typedef struct {
+    volatile uint32_t csr;
+    volatile uint32_t rvr;
+    volatile uint32_t cvr;
+    volatile uint32_t calib;
+} systick_hw_t;
+
+systick_hw_t* pico_host_get_systick(void);
+#define systick_hw (pico_host_get_systick())
+
+#endif
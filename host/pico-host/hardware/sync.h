@@ -0,0 +1,10 @@
+#ifndef PICO_HOST_SYNC_H
+#define PICO_HOST_SYNC_H
+
+#include "pico/stdlib.h"
+
+static inline void __dmb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef PICO_HOST_TIMER_H
+#define PICO_HOST_TIMER_H
+
+#include "pico/stdlib.h"
+
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
+
+void hardware_alarm_claim(uint alarm_num);
+// alarm interrupt is serviced by the core setting its callback
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback);
+// out: true if target is already missed (alarm not armed)
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t);
+void hardware_alarm_cancel(uint alarm_num);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef PICO_HOST_UART_H
+#define PICO_HOST_UART_H
+
+#include "pico/stdlib.h"
+
+// sync link is not simulated: nothing is ever received, frames sent are dropped
+typedef struct uart_inst uart_inst_t;
+extern uart_inst_t* const uart1;
+
+uint uart_init(uart_inst_t* uart, uint baudrate);
+void uart_deinit(uart_inst_t* uart);
+bool uart_is_readable(uart_inst_t* uart);
+char uart_getc(uart_inst_t* uart);
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef OUTPUT_CONFIG_H
+#define OUTPUT_CONFIG_H
+
+// host build: CMake defaults of output-config.h.in
+// output interrupts are specialized at compile time against those definitions
+
+// output backend used at startup (see backend_e in output-backend.h)
+#define OUTPUT_BACKEND 0
+
+// when not zero, sensor 2 is generated by core0 (see core0-output.h)
+// and core1 backends only deal with sensor 1
+#define SPLIT_CORES 0
+
+// number of sensors actually generated (1 or 2)
+#define OUTPUT_NB_SENSORS 2
+
+// GPIO numbers for sensor 1, channels A and B and sensor 2, channels A and B
+#define FIRST_OUT_PULSE  1
+#define SECOND_OUT_PULSE 0
+#define THIRD_OUT_PULSE  4
+#define FOURTH_OUT_PULSE 3
+
+// GPIO numbers of VR sine of sensors 1 and 2, both channels of a PWM slice (see vr-managed.h)
+#define VR1_GPIO 8
+#define VR2_GPIO 9
+
+// features of output interrupts (0 or 1)
+// edge counters: odometer and telemetry edge counts
+#define OUTPUT_EDGE_COUNTERS 1
+// stop on target edge count: moves (requires edge counters)
+#define OUTPUT_TARGETS 1
+// time stamp of first edge after an external trigger: trigger latency
+#define OUTPUT_EDGE_PROBE 1
+// frequency sweep computed edge by edge: sweep command (see sweep.h)
+#define OUTPUT_SWEEP 1
+// stopped sensors chatter and creep: standstill command (see standstill.h)
+#define OUTPUT_STANDSTILL 1
+
+// GPIO number of sweep decade markers
+#define SWEEP_MARKER_GPIO 10
+
+// GPIO number of external trigger input (see trigger.h)
+#define TRIGGER_GPIO 6
+
+// GPIO numbers of leader/follower sync pulse and frames (see sync.h)
+#define SYNC_GPIO 7
+#define SYNC_TX_GPIO 20
+#define SYNC_RX_GPIO 21
+
+#endif
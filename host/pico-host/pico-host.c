@@ -0,0 +1,1012 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Host simulation of the pico SDK subset used by the firmware (see pico-host.h)
+ */
+
+#define PICO_HOST_TOOL
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/structs/systick.h"
+#include "hardware/timer.h"
+#include "hardware/uart.h"
+#include "pico/multicore.h"
+#include "pico/stdio_usb.h"
+#include "pico/stdlib.h"
+#include "pico/util/queue.h"
+
+#include "pico-host.h"
+
+#define NB_ALARMS 4
+#define NB_GPIOS 30
+#define NB_DRIVERS 4
+#define CORE_STACK_SIZE (1024 * 1024)
+// a core polling that many times without waiting is idle until next event
+#define MAX_POLLS 64
+// idle core wakes up that late if nothing at all is scheduled
+#define IDLE_FALLBACK_US 1000
+#define NEVER UINT64_MAX
+
+uint8_t pico_host_flash[PICO_FLASH_SIZE_BYTES];
+
+// heap of target, as seen by sbrk: SRAM up to __StackLimit (set by linker script on target)
+// is left to malloc (see sequence_store_init)
+#define STR_(x) #x
+#define STR(x) STR_(x)
+static char heap[PICO_HOST_HEAP_SIZE];
+__asm__(".globl __StackLimit\n.set __StackLimit, heap + " STR(PICO_HOST_HEAP_SIZE));
+
+void* sbrk(intptr_t increment) {
+    return heap;
+}
+
+static uint64_t get_host_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static systick_hw_t systick;
+static bool systick_counting = false;
+
+systick_hw_t* pico_host_get_systick() {
+    if(systick_counting) {
+        // counts down at system clock, 24-bit
+        systick.cvr = (uint32_t)(0 - get_host_ns() * (PICO_HOST_CLOCK_HZ / 1000000) / 1000) & 0x00FFFFFF;
+    }
+    return &systick;
+}
+
+void pico_host_set_systick_counting(bool counting) {
+    systick_counting = counting;
+}
+
+struct uart_inst {
+    bool enabled;
+};
+static struct uart_inst uart1_inst;
+uart_inst_t* const uart1 = &uart1_inst;
+
+static uint64_t now_us = 0;
+
+// cores: coroutines of bench (host tool) context
+typedef struct {
+    ucontext_t context;
+    void* stack;
+    bool started;
+    bool finished;
+    // runnable from then on
+    uint64_t wake_us;
+    // or once queue has data (space if wait_space)
+    queue_t* wait_queue;
+    bool wait_space;
+    // interrupts of this core disabled
+    bool masked;
+    uint16_t polls;
+    // interrupts serviced, host time spent in them (while timed)
+    uint64_t nb_interrupts;
+    uint64_t interrupt_ns;
+} core_t;
+
+static ucontext_t bench_context;
+static core_t cores[2];
+static int (*core0_entry)();
+static void (*core1_entry)(void);
+// core running foreground code, -1 for bench (and interrupts it services)
+static int running_core = -1;
+// what get_core_num returns
+static uint8_t current_core = 0;
+static bool in_interrupt = false;
+static bool interrupts_timed = false;
+static uint64_t interrupt_entry_ns;
+static bool core1_locked_out = false;
+// flash content set (erased at boot otherwise)
+static bool flash_loaded = false;
+
+struct alarm_pool {
+    uint8_t core;
+};
+static alarm_pool_t default_pool = {0};
+static repeating_timer_t* timers = NULL;
+
+typedef struct {
+    hardware_alarm_callback_t callback;
+    uint64_t target_us;
+    bool armed;
+    uint8_t core;
+} alarm_t;
+static alarm_t alarms[NB_ALARMS];
+
+// PWM wrap interrupt: one slice is used at a time (output backends)
+static struct {
+    irq_handler_t handler;
+    uint8_t core;
+    bool irq_enabled; // NVIC
+    bool slice_irq_enabled;
+    bool running;
+    uint8_t slice;
+    uint16_t wrap;
+    float clkdiv;
+    uint64_t period_us;
+    uint64_t next_us;
+} pwm = {NULL, 0, false, false, false, 0, 0xFFFF, 1.0f, 0, NEVER};
+static bool pwm_simulated = true;
+
+static uint32_t gpio_outputs = 0;
+static void (*gpio_hook)(uint32_t gpios) = NULL;
+static struct {
+    gpio_irq_callback_t callback;
+    irq_handler_t raw_handlers[NB_GPIOS];
+    uint32_t enabled_events[NB_GPIOS];
+    uint32_t pending_events[NB_GPIOS];
+    uint8_t core;
+} gpio_irq;
+
+// console
+static char* input = NULL;
+static size_t input_size = 0;
+static size_t input_read = 0;
+static size_t input_length = 0;
+static void (*output)(const char* buf, int length) = NULL;
+static stdio_driver_t* drivers[NB_DRIVERS];
+static uint8_t nb_drivers = 0;
+static uint64_t stdio_init_time_us = NEVER;
+static uint64_t usb_connect_delay_us = PICO_HOST_USB_CONNECT_US;
+
+static int usb_in_chars(char* buf, int length);
+static void usb_out_chars(const char* buf, int length);
+
+stdio_driver_t stdio_usb = {
+    .out_chars = usb_out_chars,
+    .in_chars = usb_in_chars,
+    .crlf_enabled = PICO_STDIO_DEFAULT_CRLF
+};
+
+// cores
+
+static void core0_start() {
+    core0_entry();
+    cores[0].finished = true;
+}
+
+static void core1_start() {
+    core1_entry();
+    cores[1].finished = true;
+}
+
+static void start_core(uint8_t core, void (*start)()) {
+    core_t* const p_core = &cores[core];
+    if(p_core->stack == NULL) {
+        p_core->stack = malloc(CORE_STACK_SIZE);
+    }
+    getcontext(&p_core->context);
+    p_core->context.uc_stack.ss_sp = p_core->stack;
+    p_core->context.uc_stack.ss_size = CORE_STACK_SIZE;
+    p_core->context.uc_link = &bench_context;
+    makecontext(&p_core->context, start, 0);
+    p_core->started = true;
+    p_core->finished = false;
+    p_core->wake_us = now_us;
+    p_core->wait_queue = NULL;
+}
+
+static bool is_runnable(const core_t* p_core) {
+    if(!p_core->started || p_core->finished) {
+        return false;
+    }
+    if(p_core->wait_queue != NULL) {
+        return p_core->wait_space ? !queue_is_full(p_core->wait_queue) : !queue_is_empty(p_core->wait_queue);
+    }
+    return p_core->wake_us <= now_us;
+}
+
+static void resume(uint8_t core) {
+    running_core = core;
+    current_core = core;
+    cores[core].wait_queue = NULL;
+    swapcontext(&bench_context, &cores[core].context);
+    running_core = -1;
+    current_core = 0;
+}
+
+// suspends running core, bench carries on
+static void yield() {
+    core_t* const p_core = &cores[running_core];
+    p_core->polls = 0;
+    swapcontext(&p_core->context, &bench_context);
+}
+
+static bool is_masked(uint8_t core) {
+    return cores[core].masked || (core == 1 && core1_locked_out);
+}
+
+static uint64_t next_pwm_wrap() {
+    return pwm_simulated && pwm.handler != NULL && pwm.irq_enabled && pwm.slice_irq_enabled && pwm.running &&
+           !is_masked(pwm.core) ? pwm.next_us : NEVER;
+}
+
+// time of next interrupt serviced (NEVER if none)
+static uint64_t next_event() {
+    const repeating_timer_t* p_timer;
+    uint64_t next = next_pwm_wrap();
+    uint8_t i;
+    for(p_timer = timers; p_timer != NULL; p_timer = p_timer->next) {
+        if(p_timer->target_us < next && !is_masked(p_timer->pool->core)) {
+            next = p_timer->target_us;
+        }
+    }
+    for(i = 0; i < NB_ALARMS; i++) {
+        if(alarms[i].armed && alarms[i].target_us < next && !is_masked(alarms[i].core)) {
+            next = alarms[i].target_us;
+        }
+    }
+    return next;
+}
+
+// running core (or bench) waits until time
+static void wait_until(uint64_t time_us) {
+    if(running_core < 0) {
+        if(!in_interrupt) {
+            pico_host_run_until(time_us);
+        }
+        return;
+    }
+    cores[running_core].wake_us = time_us;
+    yield();
+}
+
+// running core waits for anything to happen
+static void idle() {
+    uint64_t next = next_event();
+    if(next == NEVER || next <= now_us) {
+        next = now_us + (next == NEVER ? IDLE_FALLBACK_US : 1);
+    }
+    wait_until(next);
+}
+
+// firmware checking something which only an event can change
+static void poll() {
+    if(running_core >= 0 && ++cores[running_core].polls >= MAX_POLLS) {
+        idle();
+    }
+}
+
+// interrupts
+
+static void enter_interrupt(uint8_t core, uint8_t* p_saved_core) {
+    *p_saved_core = current_core;
+    current_core = core;
+    in_interrupt = true;
+    cores[core].nb_interrupts++;
+    if(interrupts_timed) {
+        interrupt_entry_ns = get_host_ns();
+    }
+}
+
+static void exit_interrupt(uint8_t saved_core) {
+    if(interrupts_timed) {
+        cores[current_core].interrupt_ns += get_host_ns() - interrupt_entry_ns;
+    }
+    current_core = saved_core;
+    in_interrupt = false;
+}
+
+static void fire_timer(repeating_timer_t* p_timer) {
+    repeating_timer_t** pp;
+    uint8_t saved_core;
+    bool repeat;
+    enter_interrupt(p_timer->pool->core, &saved_core);
+    repeat = p_timer->callback(p_timer);
+    exit_interrupt(saved_core);
+    // callback may have cancelled it
+    for(pp = &timers; *pp != NULL && *pp != p_timer; pp = &(*pp)->next);
+    if(*pp == NULL) {
+        return;
+    }
+    if(!repeat || p_timer->delay_us == 0) {
+        *pp = p_timer->next;
+        return;
+    }
+    if(p_timer->delay_us < 0) {
+        p_timer->target_us += -p_timer->delay_us;
+    } else {
+        p_timer->target_us = now_us + p_timer->delay_us;
+    }
+}
+
+// services interrupts due (one at a time, in time order)
+// out: false if none is due
+static bool service_interrupt() {
+    repeating_timer_t* p_timer;
+    repeating_timer_t* p_due_timer = NULL;
+    uint64_t due = next_event();
+    uint8_t i, saved_core;
+    if(due > now_us) {
+        return false;
+    }
+    if(next_pwm_wrap() == due) {
+        // flag stays set while interrupt is held back: wraps missed meanwhile are lost
+        while(pwm.next_us <= now_us) {
+            pwm.next_us += pwm.period_us;
+        }
+        enter_interrupt(pwm.core, &saved_core);
+        pwm.handler();
+        exit_interrupt(saved_core);
+        return true;
+    }
+    for(i = 0; i < NB_ALARMS; i++) {
+        if(alarms[i].armed && alarms[i].target_us == due && !is_masked(alarms[i].core)) {
+            alarms[i].armed = false;
+            enter_interrupt(alarms[i].core, &saved_core);
+            alarms[i].callback(i);
+            exit_interrupt(saved_core);
+            return true;
+        }
+    }
+    for(p_timer = timers; p_timer != NULL; p_timer = p_timer->next) {
+        if(p_timer->target_us == due && !is_masked(p_timer->pool->core)) {
+            p_due_timer = p_timer;
+            break;
+        }
+    }
+    fire_timer(p_due_timer);
+    return true;
+}
+
+// simulation
+
+void pico_host_boot(int (*entry)()) {
+    core0_entry = entry;
+    start_core(0, core0_start);
+    if(!flash_loaded) {
+        memset(pico_host_flash, 0xFF, PICO_FLASH_SIZE_BYTES);
+        flash_loaded = true;
+    }
+}
+
+void pico_host_load_flash(const uint8_t* content) {
+    memcpy(pico_host_flash, content, PICO_FLASH_SIZE_BYTES);
+    flash_loaded = true;
+}
+
+uint64_t pico_host_time_us() {
+    return now_us;
+}
+
+void pico_host_run_until(uint64_t time_us) {
+    uint64_t next;
+    while(true) {
+        if(service_interrupt()) {
+            continue;
+        }
+        if(is_runnable(&cores[1])) {
+            resume(1);
+            continue;
+        }
+        if(is_runnable(&cores[0])) {
+            resume(0);
+            continue;
+        }
+        next = next_event();
+        if(cores[0].started && !cores[0].finished && cores[0].wait_queue == NULL && cores[0].wake_us < next) {
+            next = cores[0].wake_us;
+        }
+        if(cores[1].started && !cores[1].finished && cores[1].wait_queue == NULL && cores[1].wake_us < next) {
+            next = cores[1].wake_us;
+        }
+        if(next > time_us) {
+            if(time_us > now_us) {
+                now_us = time_us;
+            }
+            return;
+        }
+        now_us = next;
+    }
+}
+
+void pico_host_run_for(uint64_t duration_us) {
+    pico_host_run_until(now_us + duration_us);
+}
+
+void pico_host_input(const char* chars) {
+    const size_t length = strlen(chars);
+    if(input_length + length > input_size) {
+        input_size = (input_length + length) * 2;
+        input = realloc(input, input_size);
+    }
+    memcpy(input + input_length, chars, length);
+    input_length += length;
+}
+
+bool pico_host_input_consumed() {
+    return input_read == input_length;
+}
+
+void pico_host_set_output(void (*out_chars)(const char* buf, int length)) {
+    output = out_chars;
+}
+
+void pico_host_set_usb_connect_delay(uint64_t duration_us) {
+    usb_connect_delay_us = duration_us;
+}
+
+uint64_t pico_host_get_stdio_init_time() {
+    return stdio_init_time_us;
+}
+
+uint32_t pico_host_get_gpios() {
+    return gpio_outputs;
+}
+
+void pico_host_set_gpio_hook(void (*hook)(uint32_t gpios)) {
+    gpio_hook = hook;
+}
+
+void pico_host_gpio_edge(unsigned gpio, bool rising) {
+    const uint32_t event = rising ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    uint8_t saved_core;
+    if(gpio >= NB_GPIOS || !(gpio_irq.enabled_events[gpio] & event)) {
+        return;
+    }
+    gpio_irq.pending_events[gpio] |= event;
+    enter_interrupt(gpio_irq.core, &saved_core);
+    if(gpio_irq.raw_handlers[gpio] != NULL) {
+        gpio_irq.raw_handlers[gpio]();
+    } else if(gpio_irq.callback != NULL) {
+        gpio_irq.pending_events[gpio] &= ~event;
+        gpio_irq.callback(gpio, event);
+    }
+    exit_interrupt(saved_core);
+}
+
+void pico_host_set_interrupt_timing(bool timed) {
+    interrupts_timed = timed;
+}
+
+void pico_host_get_interrupt_stats(uint8_t core, uint64_t* p_count, uint64_t* p_host_ns) {
+    *p_count = cores[core].nb_interrupts;
+    *p_host_ns = cores[core].interrupt_ns;
+}
+
+void pico_host_set_pwm_irq(bool simulated) {
+    pwm_simulated = simulated;
+    if(simulated && pwm.next_us < now_us) {
+        pwm.next_us = now_us + pwm.period_us;
+    }
+}
+
+// time
+
+absolute_time_t get_absolute_time(void) {
+    poll();
+    return now_us;
+}
+
+uint32_t time_us_32(void) {
+    poll();
+    return (uint32_t)now_us;
+}
+
+uint64_t time_us_64(void) {
+    poll();
+    return now_us;
+}
+
+void sleep_us(uint64_t us) {
+    wait_until(now_us + us);
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us(ms * 1000ull);
+}
+
+void tight_loop_contents(void) {
+    idle();
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    return PICO_HOST_CLOCK_HZ;
+}
+
+// repeating timers
+
+alarm_pool_t* alarm_pool_create(uint hardware_alarm_num, uint max_timers) {
+    alarm_pool_t* p_pool = malloc(sizeof(alarm_pool_t));
+    p_pool->core = current_core;
+    return p_pool;
+}
+
+void alarm_pool_destroy(alarm_pool_t* pool) {
+    repeating_timer_t** pp = &timers;
+    while(*pp != NULL) {
+        if((*pp)->pool == pool) {
+            *pp = (*pp)->next;
+        } else {
+            pp = &(*pp)->next;
+        }
+    }
+    free(pool);
+}
+
+bool alarm_pool_add_repeating_timer_us(alarm_pool_t* pool, int64_t delay_us, repeating_timer_callback_t callback,
+                                       void* user_data, repeating_timer_t* out) {
+    out->delay_us = delay_us;
+    out->pool = pool;
+    out->callback = callback;
+    out->user_data = user_data;
+    out->target_us = now_us + (delay_us < 0 ? -delay_us : delay_us);
+    out->next = timers;
+    timers = out;
+    return true;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void* user_data,
+                            repeating_timer_t* out) {
+    // default pool interrupt goes to core0
+    return alarm_pool_add_repeating_timer_us(&default_pool, delay_us, callback, user_data, out);
+}
+
+bool cancel_repeating_timer(repeating_timer_t* timer) {
+    repeating_timer_t** pp;
+    for(pp = &timers; *pp != NULL; pp = &(*pp)->next) {
+        if(*pp == timer) {
+            *pp = timer->next;
+            return true;
+        }
+    }
+    return false;
+}
+
+// hardware alarms
+
+void hardware_alarm_claim(uint alarm_num) {
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback) {
+    alarms[alarm_num].callback = callback;
+    alarms[alarm_num].core = current_core;
+    alarms[alarm_num].armed = false;
+}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t) {
+    if(t <= now_us) {
+        alarms[alarm_num].armed = false;
+        return true;
+    }
+    alarms[alarm_num].target_us = t;
+    alarms[alarm_num].armed = true;
+    return false;
+}
+
+void hardware_alarm_cancel(uint alarm_num) {
+    alarms[alarm_num].armed = false;
+}
+
+// GPIO
+
+void gpio_init(uint gpio) {
+    gpio_put(gpio, false);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+}
+
+void gpio_pull_down(uint gpio) {
+}
+
+void gpio_pull_up(uint gpio) {
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value) {
+    const uint32_t outputs = (gpio_outputs & ~mask) | (value & mask);
+    if(outputs == gpio_outputs) {
+        return;
+    }
+    gpio_outputs = outputs;
+    if(gpio_hook != NULL) {
+        gpio_hook(outputs);
+    }
+}
+
+void gpio_put(uint gpio, bool value) {
+    gpio_put_masked(1u << gpio, value ? 1u << gpio : 0);
+}
+
+bool gpio_get(uint gpio) {
+    return (gpio_outputs >> gpio) & 1;
+}
+
+uint32_t gpio_get_all(void) {
+    return gpio_outputs;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    if(enabled) {
+        gpio_irq.enabled_events[gpio] |= event_mask;
+    } else {
+        gpio_irq.enabled_events[gpio] &= ~event_mask;
+    }
+    gpio_irq.core = current_core;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback) {
+    gpio_irq.callback = callback;
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+}
+
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler) {
+    gpio_irq.raw_handlers[gpio] = handler;
+}
+
+void gpio_remove_raw_irq_handler(uint gpio, irq_handler_t handler) {
+    gpio_irq.raw_handlers[gpio] = NULL;
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+    return gpio_irq.pending_events[gpio];
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask) {
+    gpio_irq.pending_events[gpio] &= ~event_mask;
+}
+
+// IRQ and PWM
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    if(num == PWM_IRQ_WRAP) {
+        pwm.handler = handler;
+        pwm.core = current_core;
+    }
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler) {
+    if(num == PWM_IRQ_WRAP && pwm.handler == handler) {
+        pwm.handler = NULL;
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    if(num == PWM_IRQ_WRAP) {
+        pwm.irq_enabled = enabled;
+    }
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority) {
+}
+
+static void update_pwm_period() {
+    // system clock cycles of a PWM period, at least 1 µs
+    pwm.period_us = (uint64_t)((pwm.wrap + 1) * pwm.clkdiv / (PICO_HOST_CLOCK_HZ / 1000000) + 0.5f);
+    if(pwm.period_us == 0) {
+        pwm.period_us = 1;
+    }
+    pwm.next_us = now_us + pwm.period_us;
+}
+
+void pwm_init(uint slice_num, pwm_config* c, bool start) {
+    pwm.slice = slice_num;
+    pwm.wrap = c->top;
+    pwm.clkdiv = c->clkdiv;
+    pwm.running = start;
+    update_pwm_period();
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap) {
+    pwm.wrap = wrap;
+    update_pwm_period();
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled) {
+    if(enabled && !pwm.running) {
+        update_pwm_period();
+    }
+    pwm.running = enabled;
+}
+
+void pwm_set_irq_enabled(uint slice_num, bool enabled) {
+    pwm.slice_irq_enabled = enabled;
+}
+
+void pwm_clear_irq(uint slice_num) {
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level) {
+}
+
+void pwm_set_both_levels(uint slice_num, uint16_t level_a, uint16_t level_b) {
+}
+
+// cores, interrupts and queues
+
+uint get_core_num(void) {
+    return current_core;
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    const bool masked = cores[current_core].masked;
+    cores[current_core].masked = true;
+    return masked;
+}
+
+void restore_interrupts(uint32_t status) {
+    cores[current_core].masked = status != 0;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    core1_entry = entry;
+    start_core(1, core1_start);
+    // core1 starts right away
+    wait_until(now_us);
+}
+
+void multicore_lockout_victim_init(void) {
+}
+
+void multicore_lockout_start_blocking(void) {
+    core1_locked_out = true;
+}
+
+void multicore_lockout_end_blocking(void) {
+    core1_locked_out = false;
+}
+
+void queue_init(queue_t* q, uint element_size, uint element_count) {
+    q->data = malloc(element_size * element_count);
+    q->element_size = element_size;
+    q->element_count = element_count;
+    q->rd_ptr = 0;
+    q->level = 0;
+}
+
+bool queue_try_add(queue_t* q, const void* data) {
+    if(queue_is_full(q)) {
+        return false;
+    }
+    memcpy(q->data + ((q->rd_ptr + q->level) % q->element_count) * q->element_size, data, q->element_size);
+    q->level++;
+    return true;
+}
+
+bool queue_try_remove(queue_t* q, void* data) {
+    if(queue_is_empty(q)) {
+        return false;
+    }
+    memcpy(data, q->data + q->rd_ptr * q->element_size, q->element_size);
+    q->rd_ptr = (q->rd_ptr + 1) % q->element_count;
+    q->level--;
+    return true;
+}
+
+// running core waits for queue (data or space)
+static void wait_queue(queue_t* q, bool space) {
+    if(running_core < 0) {
+        fprintf(stderr, "pico-host: queue would block bench\n");
+        exit(2);
+    }
+    cores[running_core].wait_queue = q;
+    cores[running_core].wait_space = space;
+    yield();
+}
+
+void queue_add_blocking(queue_t* q, const void* data) {
+    while(!queue_try_add(q, data)) {
+        wait_queue(q, true);
+    }
+    // other core gets data as soon as this one does anything
+    if(running_core >= 0) {
+        wait_until(now_us);
+    }
+}
+
+void queue_remove_blocking(queue_t* q, void* data) {
+    while(!queue_try_remove(q, data)) {
+        wait_queue(q, false);
+    }
+}
+
+// flash
+
+static void flash_busy(uint64_t duration_us) {
+    // core running it cannot do anything else, nor its interrupts
+    wait_until(now_us + duration_us);
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    memset(pico_host_flash + flash_offs, 0xFF, count);
+    flash_busy(PICO_HOST_FLASH_ERASE_US * (count / FLASH_SECTOR_SIZE));
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count) {
+    size_t i;
+    for(i = 0; i < count; i++) {
+        pico_host_flash[flash_offs + i] &= data[i];
+    }
+    flash_busy(PICO_HOST_FLASH_PROGRAM_US * (count / FLASH_PAGE_SIZE));
+}
+
+// UART (sync link not simulated)
+
+uint uart_init(uart_inst_t* uart, uint baudrate) {
+    uart->enabled = true;
+    return baudrate;
+}
+
+void uart_deinit(uart_inst_t* uart) {
+    uart->enabled = false;
+}
+
+bool uart_is_readable(uart_inst_t* uart) {
+    poll();
+    return false;
+}
+
+char uart_getc(uart_inst_t* uart) {
+    return 0;
+}
+
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len) {
+}
+
+// stdio
+
+static int usb_in_chars(char* buf, int length) {
+    int nb_chars = 0;
+    while(nb_chars < length && input_read < input_length) {
+        buf[nb_chars++] = input[input_read++];
+    }
+    return nb_chars > 0 ? nb_chars : PICO_ERROR_NO_DATA;
+}
+
+static void usb_out_chars(const char* buf, int length) {
+    if(output != NULL) {
+        output(buf, length);
+    } else {
+        fwrite(buf, 1, length, stdout);
+    }
+}
+
+bool stdio_usb_connected(void) {
+    poll();
+    return stdio_init_time_us != NEVER && now_us >= stdio_init_time_us + usb_connect_delay_us;
+}
+
+void stdio_set_driver_enabled(stdio_driver_t* driver, bool enabled) {
+    uint8_t i;
+    for(i = 0; i < nb_drivers && drivers[i] != driver; i++);
+    if(enabled && i == nb_drivers && nb_drivers < NB_DRIVERS) {
+        drivers[nb_drivers++] = driver;
+    } else if(!enabled && i < nb_drivers) {
+        memmove(&drivers[i], &drivers[i + 1], (nb_drivers - i - 1) * sizeof(stdio_driver_t*));
+        nb_drivers--;
+    }
+}
+
+bool stdio_init_all(void) {
+    stdio_init_time_us = now_us;
+    stdio_set_driver_enabled(&stdio_usb, true);
+    return true;
+}
+
+// cr is inserted before lf (unless already there) by drivers supporting it
+static void out_chars(const char* buf, int length, bool crlf) {
+    stdio_driver_t* p_driver;
+    int i, start;
+    uint8_t d;
+    for(d = 0; d < nb_drivers; d++) {
+        p_driver = drivers[d];
+        if(!crlf || !p_driver->crlf_enabled) {
+            p_driver->out_chars(buf, length);
+            continue;
+        }
+        for(start = i = 0; i < length; i++) {
+            if(buf[i] == '\n' && !(i > 0 ? buf[i - 1] == '\r' : p_driver->last_ended_with_cr)) {
+                if(i > start) {
+                    p_driver->out_chars(buf + start, i - start);
+                }
+                p_driver->out_chars("\r", 1);
+                start = i;
+            }
+        }
+        if(length > start) {
+            p_driver->out_chars(buf + start, length - start);
+        }
+        if(length > 0) {
+            p_driver->last_ended_with_cr = buf[length - 1] == '\r';
+        }
+    }
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    const uint64_t end_us = now_us + timeout_us;
+    char c;
+    uint8_t d;
+    while(true) {
+        for(d = 0; d < nb_drivers; d++) {
+            if(drivers[d]->in_chars != NULL && drivers[d]->in_chars(&c, 1) > 0) {
+                return (uint8_t)c;
+            }
+        }
+        if(now_us >= end_us) {
+            poll();
+            return PICO_ERROR_TIMEOUT;
+        }
+        idle();
+    }
+}
+
+int putchar_raw(int c) {
+    const char ch = (char)c;
+    out_chars(&ch, 1, false);
+    return c;
+}
+
+int pico_host_putchar(int c) {
+    const char ch = (char)c;
+    out_chars(&ch, 1, true);
+    return c;
+}
+
+int pico_host_puts(const char* s) {
+    out_chars(s, strlen(s), true);
+    out_chars("\n", 1, true);
+    return 1;
+}
+
+// long is 32-bit on target, host format drops l of %lu and the like (%llu is kept)
+static void get_host_format(const char* format, char* host_format, size_t size) {
+    size_t i = 0;
+    while(*format != '\0' && i < size - 1) {
+        host_format[i++] = *format;
+        if(*format++ != '%') {
+            continue;
+        }
+        while(*format != '\0' && strchr("-+ #0123456789.*", *format) != NULL && i < size - 1) {
+            host_format[i++] = *format++;
+        }
+        if(*format == '%') { // %%
+            host_format[i++] = *format++;
+        } else if(format[0] == 'l' && format[1] != 'l') {
+            format++;
+        }
+    }
+    host_format[i] = '\0';
+}
+
+int pico_host_printf(const char* format, ...) {
+    // host format is never longer than format
+    char host_format[strlen(format) + 1], buffer[1024];
+    char* p_buffer = buffer;
+    va_list args;
+    int length;
+    get_host_format(format, host_format, sizeof(host_format));
+    va_start(args, format);
+    length = vsnprintf(buffer, sizeof(buffer), host_format, args);
+    va_end(args);
+    if(length >= (int)sizeof(buffer)) {
+        p_buffer = malloc(length + 1);
+        va_start(args, format);
+        vsnprintf(p_buffer, length + 1, host_format, args);
+        va_end(args);
+    }
+    if(length > 0) {
+        out_chars(p_buffer, length, true);
+    }
+    if(p_buffer != buffer) {
+        free(p_buffer);
+    }
+    return length;
+}
@@ -0,0 +1,88 @@
+#ifndef PICO_HOST_H
+#define PICO_HOST_H
+
+// host build of the firmware: pico SDK subset it uses, simulated on the host so that
+// host tools can run firmware code (output interrupts, both cores, console) in
+// simulated time, as fast as the host goes
+//
+// headers of this directory stand in for the SDK ones (cc -I../host/pico-host ...),
+// output-config.h is the one CMake generates with default options
+//
+// simulation model:
+//  - time is a µs counter which only advances when both cores wait (sleep, empty queue,
+//    tight_loop_contents, polling without anything happening), up to next event
+//  - events are repeating timers, hardware alarms, PWM wrap interrupts (every
+//    (wrap + 1) system clock cycles), GPIO edges and console input fed by the host tool,
+//    each serviced by the core which set its handler, as an interrupt of that core:
+//    held back while that core disables interrupts (or is locked out, for core1)
+//  - core0 (firmware_main) and core1 run as coroutines between those events,
+//    flash erase and program take their typical duration (50 ms, 1 ms)
+//  - console is a stdio driver standing in for USB, printf and friends go through
+//    enabled drivers (long is 32-bit on target: %lu and the like print 32-bit values)
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// system clock of target
+#define PICO_HOST_CLOCK_HZ 125000000
+// USB console connects that long after stdio_init_all (default of pico_host_set_usb_connect_delay)
+#define PICO_HOST_USB_CONNECT_US 300000
+// free heap of target firmware (sbrk to __StackLimit)
+#define PICO_HOST_HEAP_SIZE (160 * 1024)
+#define PICO_HOST_FLASH_ERASE_US 50000
+#define PICO_HOST_FLASH_PROGRAM_US 1000
+
+// firmware main (speed-sensor.c), renamed by pico/stdlib.h
+int firmware_main();
+
+// starts core0 on entry (firmware_main), it runs from the next pico_host_run_until on
+void pico_host_boot(int (*entry)());
+
+// simulated time since boot (µs)
+uint64_t pico_host_time_us();
+// runs cores and services events until time_us (no-op if already reached)
+// to be called by host tool only, not from firmware code
+// firmware functions called directly by host tool run as core0 foreground
+// (they may call pico_host_run_until themselves by sleeping)
+void pico_host_run_until(uint64_t time_us);
+void pico_host_run_for(uint64_t duration_us);
+
+// console input, available to firmware at once
+void pico_host_input(const char* chars);
+// tells if firmware read all console input
+bool pico_host_input_consumed();
+// console output of firmware (through stdio_usb), default writes to stdout
+void pico_host_set_output(void (*out_chars)(const char* buf, int length));
+// USB console connects duration_us after stdio_init_all
+void pico_host_set_usb_connect_delay(uint64_t duration_us);
+// time stdio_init_all was called, UINT64_MAX if not yet
+uint64_t pico_host_get_stdio_init_time();
+
+// GPIO outputs, hook called on each change of any of them, from the core changing them
+uint32_t pico_host_get_gpios();
+void pico_host_set_gpio_hook(void (*hook)(uint32_t gpios));
+// edge on an input GPIO, serviced at once as its interrupt
+void pico_host_gpio_edge(unsigned gpio, bool rising);
+
+// PWM wrap interrupts (one per µs for PWM backend) can be left out when edges are not
+// looked at, so that long runs go faster
+void pico_host_set_pwm_irq(bool simulated);
+
+// interrupts serviced by a core (0 or 1) since boot, and host time spent in them (ns),
+// timed only while enabled (it takes two reads of host clock per interrupt): lets host
+// tools compare the interrupt load of backends (SysTick stands still by default)
+void pico_host_set_interrupt_timing(bool timed);
+void pico_host_get_interrupt_stats(uint8_t core, uint64_t* p_count, uint64_t* p_host_ns);
+
+// SysTick counts host time, in system clock cycles (PICO_HOST_CLOCK_HZ), instead of
+// standing still: cycle counts of firmware benchmarks (speed-sensor-bench.c) are then
+// host time, only to be compared with other host runs
+void pico_host_set_systick_counting(bool counting);
+
+// flash content (PICO_FLASH_SIZE_BYTES), erased at boot (0xFF) unless loaded before
+extern uint8_t pico_host_flash[];
+// sets flash content before boot, e.g. as left by a previous run (a process boots once:
+// a host tool rebooting the firmware runs each boot in its own process)
+void pico_host_load_flash(const uint8_t* content);
+
+#endif
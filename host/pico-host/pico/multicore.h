@@ -0,0 +1,13 @@
+#ifndef PICO_HOST_MULTICORE_H
+#define PICO_HOST_MULTICORE_H
+
+#include "pico/stdlib.h"
+
+// core1 runs as a coroutine of simulated time (see pico-host.h)
+void multicore_launch_core1(void (*entry)(void));
+void multicore_lockout_victim_init(void);
+// while core1 is locked out, its interrupts are held back
+void multicore_lockout_start_blocking(void);
+void multicore_lockout_end_blocking(void);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef PICO_HOST_STDIO_DRIVER_H
+#define PICO_HOST_STDIO_DRIVER_H
+
+#include <stdbool.h>
+
+#define PICO_STDIO_ENABLE_CRLF_SUPPORT 1
+#define PICO_STDIO_DEFAULT_CRLF 1
+#define PICO_ERROR_NO_DATA (-3)
+
+typedef struct stdio_driver stdio_driver_t;
+
+struct stdio_driver {
+    void (*out_chars)(const char* buf, int len);
+    void (*out_flush)(void);
+    int (*in_chars)(char* buf, int len);
+    void (*set_chars_available_callback)(void (*fn)(void*), void* param);
+    stdio_driver_t* next;
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    bool last_ended_with_cr;
+    bool crlf_enabled;
+#endif
+};
+
+void stdio_set_driver_enabled(stdio_driver_t* driver, bool enabled);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef PICO_HOST_STDIO_USB_H
+#define PICO_HOST_STDIO_USB_H
+
+#include "pico/stdio/driver.h"
+
+// console of host simulation (see pico_host_input and pico_host_set_output)
+extern stdio_driver_t stdio_usb;
+
+bool stdio_usb_connected(void);
+
+#endif
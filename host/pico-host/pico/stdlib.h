@@ -0,0 +1,113 @@
+#ifndef PICO_HOST_STDLIB_H
+#define PICO_HOST_STDLIB_H
+
+// host build of the firmware: pico SDK subset it uses, simulated by pico-host.c
+// (see pico-host.h), same prototypes as the SDK
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// firmware main (speed-sensor.c) is started by host tools as firmware_main, and
+// console output of firmware goes through enabled stdio drivers
+// (host tools define PICO_HOST_TOOL before including anything)
+#ifndef PICO_HOST_TOOL
+#define main firmware_main
+#define printf pico_host_printf
+#define puts pico_host_puts
+#define putchar pico_host_putchar
+#endif
+int pico_host_printf(const char* format, ...);
+int pico_host_puts(const char* s);
+int pico_host_putchar(int c);
+
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __uninitialized_ram(name) name
+#define __packed __attribute__((packed))
+
+#define PICO_DEFAULT_LED_PIN 25
+#define PICO_ERROR_TIMEOUT (-1)
+
+// time
+typedef uint64_t absolute_time_t;
+absolute_time_t get_absolute_time(void);
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) {
+    return t + us;
+}
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+// on host: idles until next simulated event
+void tight_loop_contents(void);
+
+// repeating timers (negative delay: from previous target rather than from callback end)
+typedef struct alarm_pool alarm_pool_t;
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t* rt);
+struct repeating_timer {
+    int64_t delay_us;
+    alarm_pool_t* pool;
+    repeating_timer_callback_t callback;
+    void* user_data;
+    // host simulation
+    uint64_t target_us;
+    repeating_timer_t* next;
+};
+alarm_pool_t* alarm_pool_create(uint hardware_alarm_num, uint max_timers);
+void alarm_pool_destroy(alarm_pool_t* pool);
+bool alarm_pool_add_repeating_timer_us(alarm_pool_t* pool, int64_t delay_us, repeating_timer_callback_t callback,
+                                       void* user_data, repeating_timer_t* out);
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void* user_data,
+                            repeating_timer_t* out);
+static inline bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void* user_data,
+                                          repeating_timer_t* out) {
+    return add_repeating_timer_us(delay_ms * (int64_t)1000, callback, user_data, out);
+}
+bool cancel_repeating_timer(repeating_timer_t* timer);
+
+// GPIO
+enum gpio_function {
+    GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2, GPIO_FUNC_I2C = 3, GPIO_FUNC_PWM = 4, GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_NULL = 0x1f
+};
+#define GPIO_OUT 1
+#define GPIO_IN 0
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW = 0x1, GPIO_IRQ_LEVEL_HIGH = 0x2, GPIO_IRQ_EDGE_FALL = 0x4, GPIO_IRQ_EDGE_RISE = 0x8
+};
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+typedef void (*irq_handler_t)(void);
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_pull_down(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_put(uint gpio, bool value);
+void gpio_put_masked(uint32_t mask, uint32_t value);
+bool gpio_get(uint gpio);
+uint32_t gpio_get_all(void);
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback);
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler);
+void gpio_remove_raw_irq_handler(uint gpio, irq_handler_t handler);
+uint32_t gpio_get_irq_event_mask(uint gpio);
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask);
+
+// cores and interrupts
+uint get_core_num(void);
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+// stdio (see pico/stdio/driver.h)
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+int putchar_raw(int c);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef PICO_HOST_QUEUE_H
+#define PICO_HOST_QUEUE_H
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    uint8_t* data;
+    uint element_size;
+    uint element_count;
+    uint rd_ptr;
+    uint level;
+} queue_t;
+
+void queue_init(queue_t* q, uint element_size, uint element_count);
+// blocking calls let other core run until they can proceed
+void queue_add_blocking(queue_t* q, const void* data);
+void queue_remove_blocking(queue_t* q, void* data);
+bool queue_try_add(queue_t* q, const void* data);
+bool queue_try_remove(queue_t* q, void* data);
+static inline uint queue_get_level(queue_t* q) {
+    return q->level;
+}
+static inline bool queue_is_full(queue_t* q) {
+    return q->level == q->element_count;
+}
+static inline bool queue_is_empty(queue_t* q) {
+    return q->level == 0;
+}
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Decodes a capture of the four sensor outputs with the reference
+ * quadrature decoder and checks it against commanded positions
+ *
+ * Input: CSV lines "time_s,A1,B1,A2,B2" with channels as 0 or 1
+ *  (as exported by logic analyzers), lines not starting with a digit are skipped
+ *  sensor 1 A and B are GPIO FIRST_OUT_PULSE and SECOND_OUT_PULSE,
+ *  sensor 2 A and B are GPIO THIRD_OUT_PULSE and FOURTH_OUT_PULSE
+ * Exit status is 1 if any edge was lost or expected positions do not match
+ *
+ * Build: cc -O2 -I.. -o quadrature-check quadrature-check.c quadrature-decoder.c
+ * Usage: quadrature-check [-e {edges1},{edges2}] [capture_file]
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "quadrature-decoder.h"
+
+#define NB_SENSORS 2
+
+int main(int argc, char* argv[]) {
+    FILE* in = stdin;
+    char line[256];
+    quadrature_decoder_t decoders[NB_SENSORS];
+    long long expected[NB_SENSORS];
+    int check_expected = 0, started = 0, failed = 0, i, arg;
+    unsigned a1, b1, a2, b2;
+    double t, first_t = 0.0, last_t = 0.0;
+    unsigned long nb_samples = 0;
+
+    for(arg = 1; arg < argc; arg++) {
+        if(strcmp(argv[arg], "-e") == 0 && arg + 1 < argc) {
+            if(sscanf(argv[++arg], "%lld,%lld", expected, expected + 1) != 2) {
+                fprintf(stderr, "bad expected positions: %s\n", argv[arg]);
+                return 2;
+            }
+            check_expected = 1;
+        } else if((in = fopen(argv[arg], "r")) == NULL) {
+            perror(argv[arg]);
+            return 2;
+        }
+    }
+    while(fgets(line, sizeof(line), in) != NULL) {
+        if(!isdigit((unsigned char)line[0]) ||
+           sscanf(line, "%lf,%u,%u,%u,%u", &t, &a1, &b1, &a2, &b2) != 5) {
+            continue;
+        }
+        if(!started) {
+            quadrature_decoder_init(decoders, a1 & 1, b1 & 1);
+            quadrature_decoder_init(decoders + 1, a2 & 1, b2 & 1);
+            first_t = t;
+            started = 1;
+        } else {
+            quadrature_decoder_feed(decoders, a1 & 1, b1 & 1);
+            quadrature_decoder_feed(decoders + 1, a2 & 1, b2 & 1);
+        }
+        last_t = t;
+        nb_samples++;
+    }
+    if(in != stdin) {
+        fclose(in);
+    }
+    if(!started) {
+        fprintf(stderr, "no sample found\n");
+        return 2;
+    }
+    printf("%lu samples over %.6f s\n", nb_samples, last_t - first_t);
+    for(i = 0; i < NB_SENSORS; i++) {
+        const quadrature_decoder_t* p = decoders + i;
+        printf("Sensor %d: position %" PRId64 " edges, %" PRIu64 " edges, %" PRIu64
+               " reversal(s), %" PRIu64 " lost, last direction %s",
+               i + 1, p->position, p->nb_edges, p->nb_reversals, p->nb_illegal,
+               p->direction > 0 ? "forward" : p->direction < 0 ? "reverse" : "none");
+        if(p->nb_illegal != 0) {
+            failed = 1;
+        }
+        if(check_expected) {
+            if(p->position != expected[i]) {
+                printf(" - MISMATCH, expected %lld", expected[i]);
+                failed = 1;
+            } else {
+                printf(" - OK");
+            }
+        }
+        printf("\n");
+    }
+    return failed;
+}
@@ -0,0 +1,25 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Table driven reference quadrature decoder
+ */
+
+#include "quadrature-decoder.h"
+
+#include <string.h>
+
+#define I QUADRATURE_ILLEGAL
+
+// states as (A << 1) | B, forward order is 0 > 2 > 3 > 1 > 0
+const int8_t quadrature_steps[16] = {
+ // to:  0   1   2   3
+         0, -1, +1,  I, // from 0
+        +1,  0,  I, -1, // from 1
+        -1,  I,  0, +1, // from 2
+         I, +1, -1,  0  // from 3
+};
+
+void quadrature_decoder_init(quadrature_decoder_t* p_decoder, uint8_t a, uint8_t b) {
+    memset(p_decoder, 0, sizeof(quadrature_decoder_t));
+    p_decoder->state = (uint8_t)((a << 1) | b);
+}
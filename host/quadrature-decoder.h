@@ -0,0 +1,50 @@
+#ifndef QUADRATURE_DECODER_H
+#define QUADRATURE_DECODER_H
+
+#include <stdint.h>
+
+// reference quadrature decoder of one sensor (channels A and B)
+// as output by pulse_out_sequence1/2 (see out-gpios.c):
+// forward is A=0,B=0 > A=1,B=0 > A=1,B=1 > A=0,B=1 > A=0,B=0
+
+typedef struct {
+    uint8_t state; // (A << 1) | B
+    int8_t direction; // of last step: +1, -1 or 0 if none yet
+    int64_t position; // in edges
+    uint64_t nb_edges; // valid steps whatever their direction
+    uint64_t nb_reversals; // direction changes
+    uint64_t nb_illegal; // both channels changed at once: lost edge(s)
+} quadrature_decoder_t;
+
+// initializes decoder with first sampled state of channels
+void quadrature_decoder_init(quadrature_decoder_t* p_decoder, uint8_t a, uint8_t b);
+
+// table of steps indexed by (previous state << 2) | new state
+// QUADRATURE_ILLEGAL for transitions skipping a state
+#define QUADRATURE_ILLEGAL 2
+extern const int8_t quadrature_steps[16];
+
+// feeds a new sample of channels, returns step (+1, -1, 0) or QUADRATURE_ILLEGAL
+static inline int8_t quadrature_decoder_feed(quadrature_decoder_t* p_decoder, uint8_t a, uint8_t b) {
+    const uint8_t state = (uint8_t)((a << 1) | b);
+    const int8_t step = quadrature_steps[(p_decoder->state << 2) | state];
+    p_decoder->state = state;
+    if(step == 0) {
+        return 0;
+    }
+    if(step == QUADRATURE_ILLEGAL) {
+        p_decoder->nb_illegal++;
+        return step;
+    }
+    if(step != p_decoder->direction) {
+        if(p_decoder->direction != 0) {
+            p_decoder->nb_reversals++;
+        }
+        p_decoder->direction = step;
+    }
+    p_decoder->position += step;
+    p_decoder->nb_edges++;
+    return step;
+}
+
+#endif
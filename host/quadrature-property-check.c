@@ -0,0 +1,230 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Property-based check of firmware output edges against the reference quadrature decoder
+ *
+ * Random profiles (random speeds of either sign, ramps through standstill, jumps reversing
+ * at once) are generated for both sensors, in simulated time. Each edge they command is
+ * output by the edge logic of firmware output interrupts (OUTPUT_EDGE_1/2 of output-backend.h,
+ * SET_REVERSE_1/2 of out-gpios.h, as backends apply a direction), called directly on the host
+ * (pico-host GPIOs), and fed to a reference quadrature decoder (quadrature-decoder.c).
+ * Properties checked after every edge, per sensor:
+ *  - decoded position equals the sum of commanded edges, and equals firmware edge count
+ *  - decoded direction is the commanded one: a reversal is seen on the very edge commanded
+ *  - no illegal transition (lost edge), and as many reversals decoded as commanded
+ * Throughput of the whole chain (generator, firmware edge logic, decoder) and of the decoder
+ * alone (replaying captured states) are reported, both must exceed MIN_EDGES_PER_SECOND
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -Ipico-host -o quadrature-property-check quadrature-property-check.c quadrature-decoder.c pico-host/pico-host.c ../core0-output.c ../float_equality_ulp.c ../journal.c ../out-gpios.c ../output-backend.c ../pwm-managed.c ../sequence-store.c ../session.c ../session-log.c ../speed-sensor.c ../speed-sensor-util.c ../standstill.c ../state-snapshot.c ../sweep.c ../sync.c ../sync-pll.c ../telemetry.c ../timeline.c ../timer-managed.c ../train-model.c ../trigger.c ../vr-managed.c ../vr-wave.c -lm
+ * Usage: quadrature-property-check [-n {millions of edges}] [-s {seed}]
+ */
+
+#define PICO_HOST_TOOL
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico-host.h"
+#include "quadrature-decoder.h"
+
+#include "output-backend.h"
+#include "speed-sensor.h"
+
+#define NB_SENSORS 2
+// longest ramp of a profile segment
+#define MAX_RAMP_US 2000000
+// stopped sensor looks at its profile again that much later
+#define STOPPED_STEP_US 1000
+// captured states replayed through decoder alone
+#define NB_CAPTURED (1 << 24)
+#define NB_REPLAYS 8
+#define MIN_EDGES_PER_SECOND 1e6
+
+// commanded profile of a sensor: linear ramp of signed frequency (Hz, negative when reversed)
+typedef struct {
+    double from, to;
+    double start_us, end_us;
+    double next_us; // time of next edge (or of next look at profile when stopped)
+    int8_t direction; // of last edge commanded, 0 if none yet
+    int64_t position; // sum of edges commanded
+    uint64_t nb_reversals;
+} profile_t;
+
+static quadrature_decoder_t decoders[NB_SENSORS];
+static profile_t profiles[NB_SENSORS];
+static uint8_t captured[NB_CAPTURED];
+static uint32_t nb_captured = 0;
+static unsigned long nb_errors = 0;
+
+static void on_gpios(uint32_t gpios) {
+    const uint8_t states[NB_SENSORS] = {
+        (gpios >> FIRST_OUT_PULSE & 1) << 1 | (gpios >> SECOND_OUT_PULSE & 1),
+        (gpios >> THIRD_OUT_PULSE & 1) << 1 | (gpios >> FOURTH_OUT_PULSE & 1)
+    };
+    uint8_t i;
+    for(i = 0; i < NB_SENSORS; i++) {
+        if(states[i] == decoders[i].state) {
+            continue;
+        }
+        quadrature_decoder_feed(&decoders[i], states[i] >> 1, states[i] & 1);
+        if(i == 0 && nb_captured < NB_CAPTURED) {
+            captured[nb_captured++] = states[i];
+        }
+    }
+}
+
+static void error(const char* message, uint8_t sensor, double time_us) {
+    fprintf(stderr, "%.6f s, sensor %hu: %s\n", time_us / 1e6, sensor, message);
+    nb_errors++;
+}
+
+static double get_profile_frequency(const profile_t* p_profile, double time_us) {
+    if(time_us >= p_profile->end_us) {
+        return p_profile->to;
+    }
+    return p_profile->from + (p_profile->to - p_profile->from) *
+                             (time_us - p_profile->start_us) / (p_profile->end_us - p_profile->start_us);
+}
+
+static double random_frequency() {
+    double f;
+    if(rand() % 8 == 0) {
+        return 0.0;
+    }
+    // as many slow speeds as fast ones
+    f = MIN_FREQUENCY * pow(MAX_FREQUENCY / MIN_FREQUENCY, (double)rand() / RAND_MAX);
+    return rand() % 2 ? -f : f;
+}
+
+// next segment from where profile stands: ramp (through standstill when sign changes) or jump
+static void next_segment(profile_t* p_profile, double time_us) {
+    p_profile->from = get_profile_frequency(p_profile, time_us);
+    p_profile->to = random_frequency();
+    if(rand() % 4 == 0) {
+        p_profile->from = p_profile->to;
+    }
+    p_profile->start_us = time_us;
+    p_profile->end_us = time_us + 1 + rand() % MAX_RAMP_US;
+}
+
+// one edge of sensor (or none when stopped) at time of profile, through firmware edge logic
+static void output_edge(uint8_t i) {
+    profile_t* const p_profile = &profiles[i];
+    const double time_us = p_profile->next_us;
+    const double f = get_profile_frequency(p_profile, time_us);
+    const int8_t direction = f < 0.0 ? -1 : 1;
+    if(fabs(f) < MIN_FREQUENCY) {
+        p_profile->next_us = time_us + STOPPED_STEP_US;
+        return;
+    }
+    if(i == 0) {
+        SET_REVERSE_1(direction < 0)
+        OUTPUT_EDGE_1
+    } else {
+        SET_REVERSE_2(direction < 0)
+        OUTPUT_EDGE_2
+    }
+    if(p_profile->direction != 0 && direction != p_profile->direction) {
+        p_profile->nb_reversals++;
+    }
+    p_profile->direction = direction;
+    p_profile->position += direction;
+    // 4 edges per cycle
+    p_profile->next_us = time_us + 250000.0 / fabs(f);
+    if(decoders[i].position != p_profile->position || get_edge_count(i + 1) != p_profile->position) {
+        error("decoded position differs from commanded one", i + 1, time_us);
+        decoders[i].position = p_profile->position;
+    }
+    if(decoders[i].direction != direction) {
+        error("decoded direction differs from commanded one", i + 1, time_us);
+    }
+    if(decoders[i].nb_illegal != 0) {
+        error("lost edge", i + 1, time_us);
+        decoders[i].nb_illegal = 0;
+    }
+}
+
+static double get_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// decoder alone on states captured from sensor 1, returns edges per second
+static double replay_captured() {
+    quadrature_decoder_t decoder;
+    const double start = get_seconds();
+    uint32_t i, replay;
+    uint64_t nb_edges = 0;
+    for(replay = 0; replay < NB_REPLAYS; replay++) {
+        quadrature_decoder_init(&decoder, 0, 0);
+        for(i = 0; i < nb_captured; i++) {
+            quadrature_decoder_feed(&decoder, captured[i] >> 1, captured[i] & 1);
+        }
+        if(decoder.position != decoders[0].position && nb_captured < NB_CAPTURED) {
+            error("replayed position differs", 1, 0.0);
+        }
+        nb_edges += decoder.nb_edges;
+    }
+    return nb_edges / (get_seconds() - start);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long nb_millions = 20;
+    uint64_t nb_edges = 0, nb_target;
+    double start, chain_rate, decoder_rate;
+    uint8_t i;
+    int argi = 1;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            nb_millions = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+    nb_target = (uint64_t)nb_millions * 1000000;
+
+    // outputs start low, forward (out-gpios.c), firmware is not booted: edge logic only
+    init_out_gpios();
+    for(i = 0; i < NB_SENSORS; i++) {
+        quadrature_decoder_init(&decoders[i], 0, 0);
+        memset(&profiles[i], 0, sizeof(profile_t));
+        next_segment(&profiles[i], 0.0);
+    }
+    pico_host_set_gpio_hook(on_gpios);
+    start = get_seconds();
+    while(nb_edges < nb_target) {
+        i = profiles[0].next_us <= profiles[1].next_us ? 0 : 1;
+        if(profiles[i].next_us >= profiles[i].end_us) {
+            next_segment(&profiles[i], profiles[i].next_us);
+        }
+        output_edge(i);
+        nb_edges = decoders[0].nb_edges + decoders[1].nb_edges;
+    }
+    chain_rate = nb_edges / (get_seconds() - start);
+    for(i = 0; i < NB_SENSORS; i++) {
+        fprintf(stderr, "sensor %hu: %llu edges, position %lld, %llu reversal(s) over %.0f s\n", i + 1,
+                (unsigned long long)decoders[i].nb_edges, (long long)decoders[i].position,
+                (unsigned long long)decoders[i].nb_reversals, profiles[i].next_us / 1e6);
+        if(decoders[i].nb_reversals != profiles[i].nb_reversals) {
+            error("decoded reversals differ from commanded ones", i + 1, profiles[i].next_us);
+        }
+    }
+    decoder_rate = replay_captured();
+    fprintf(stderr, "throughput: %.1f M edges/s generated, output and decoded, %.1f M edges/s decoded\n",
+            chain_rate / 1e6, decoder_rate / 1e6);
+    if(chain_rate < MIN_EDGES_PER_SECOND || decoder_rate < MIN_EDGES_PER_SECOND) {
+        error("too slow to check millions of edges per second", 0, 0.0);
+    }
+    fprintf(stderr, "%llu edges, %lu error(s)\n", (unsigned long long)nb_edges, nb_errors);
+    return nb_errors != 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks pre-flight analysis of sequences of the firmware (sequence-store.c)
+ *
+ * Random sequences of ramps, jumps (no delay), direction changes and moves are
+ * recorded step by step, while other sequences play from the active slot. Each
+ * analysis kept by the store (updated on append) is compared with a brute force
+ * one computed from steps decoded back by a cursor:
+ *  - after each step appended (live recording)
+ *  - once swapped, for the active slot
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -o sequence-preflight-check sequence-preflight-check.c ../sequence-store.c -lm
+ * Usage: sequence-preflight-check [-n {sequences}] [-s {seed}]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequence-store.h"
+
+#define ARENA_SIZE 4096
+#define MAX_STEPS 64
+#define MAX_VALUE 300
+#define MAX_DELAY 6
+// aggregates are summed in float by store, in double here
+#define TOLERANCE 1e-4
+
+// not used: arena is given by sequence_store_init_arena
+char __StackLimit;
+
+static unsigned long nb_errors = 0;
+
+static void error(const char* message, unsigned long sequence, uint32_t step) {
+    fprintf(stderr, "sequence %lu, step %u: %s\n", sequence, (unsigned)step, message);
+    nb_errors++;
+}
+
+static float random_value() {
+    // some steps at standstill, so that min values skip them
+    if(rand() % 6 == 0) {
+        return 0.0f;
+    }
+    return (float)(rand() % (MAX_VALUE * SEQUENCE_STORE_QUANTA)) / SEQUENCE_STORE_QUANTA;
+}
+
+static void make_step(sequence_values_t* p_step) {
+    memset(p_step, 0, sizeof(sequence_values_t));
+    if(rand() % 10 == 0) {
+        p_step->type = rand() % 2 ? e_step_move_distance : e_step_move_edges;
+        if(p_step->type == e_step_move_edges) {
+            p_step->target_edges = rand() % 100000;
+        } else {
+            p_step->target_distance = (double)(rand() % 100000) / SEQUENCE_STORE_QUANTA;
+        }
+        p_step->firstValue = random_value();
+        p_step->deceleration = rand() % 3;
+    } else {
+        p_step->type = e_step_ramp;
+        p_step->firstValue = random_value();
+        p_step->secondValue = rand() % 2 ? p_step->firstValue : random_value();
+        p_step->delay = rand() % 4 == 0 ? 0 : 1 + rand() % MAX_DELAY;
+    }
+    p_step->firstReverse = rand() % 4 == 0;
+    p_step->secondReverse = rand() % 4 == 0;
+}
+
+// analysis of a whole slot from its decoded steps, one step after the other
+static void brute_force(uint8_t slot, uint32_t count, sequence_preflight_t* p_preflight) {
+    sequence_cursor_t cursor;
+    sequence_values_t step;
+    double areas[2] = {0.0, 0.0}, distance = 0.0, acceleration;
+    int64_t edges = 0;
+    float values[2];
+    bool reverses[2] = {false, false}, step_reverses[2];
+    uint32_t i, index;
+    memset(p_preflight, 0, sizeof(sequence_preflight_t));
+    // a cursor on any slot, as if it was active
+    sequence_cursor_start(&cursor);
+    cursor.slot = slot;
+    for(index = 1; index <= count && sequence_cursor_next(&cursor, &step); index++) {
+        step_reverses[0] = step.firstReverse;
+        step_reverses[1] = step.secondReverse;
+        if(step.type != e_step_ramp) {
+            p_preflight->nb_moves++;
+            if(step.type == e_step_move_edges) {
+                edges += step.target_edges;
+            } else {
+                distance += step.target_distance;
+            }
+            p_preflight->end_values[0] = p_preflight->end_values[1] = 0.0f;
+            reverses[0] = step_reverses[0];
+            reverses[1] = step_reverses[1];
+            continue;
+        }
+        values[0] = step.firstValue;
+        values[1] = step.secondValue;
+        if(step.delay == 0 && (values[0] != p_preflight->end_values[0] || values[1] != p_preflight->end_values[1])) {
+            p_preflight->nb_jumps++;
+        }
+        p_preflight->duration += step.delay;
+        for(i = 0; i < 2; i++) {
+            if(step.delay != 0) {
+                areas[i] += ((double)p_preflight->end_values[i] + values[i]) / 2.0 * step.delay;
+                acceleration = fabs((double)values[i] - p_preflight->end_values[i]) / step.delay;
+                if(acceleration > p_preflight->peak_accelerations[i] + TOLERANCE) {
+                    p_preflight->peak_accelerations[i] = acceleration;
+                    p_preflight->peak_steps[i] = index;
+                }
+            }
+            if(step_reverses[i] != reverses[i] && values[i] != 0.0f) {
+                p_preflight->nb_reversals++;
+            }
+            if(values[i] != 0.0f && (p_preflight->min_steps[i] == 0 || values[i] < p_preflight->min_values[i])) {
+                p_preflight->min_values[i] = values[i];
+                p_preflight->min_steps[i] = index;
+            }
+            if(p_preflight->max_steps[i] == 0 || values[i] > p_preflight->max_values[i]) {
+                p_preflight->max_values[i] = values[i];
+                p_preflight->max_steps[i] = index;
+            }
+            p_preflight->end_values[i] = values[i];
+            reverses[i] = step_reverses[i];
+        }
+    }
+    p_preflight->areas[0] = areas[0];
+    p_preflight->areas[1] = areas[1];
+    p_preflight->move_distance = distance;
+    p_preflight->move_edges = edges;
+}
+
+static bool is_close(double value, double expected) {
+    return fabs(value - expected) <= TOLERANCE * fmax(1.0, fabs(expected));
+}
+
+static void compare(const sequence_preflight_t* p_stored, const sequence_preflight_t* p_expected,
+                    unsigned long sequence, uint32_t step) {
+    uint8_t i;
+    if(p_stored->nb_moves != p_expected->nb_moves || p_stored->nb_jumps != p_expected->nb_jumps ||
+       p_stored->nb_reversals != p_expected->nb_reversals || p_stored->duration != p_expected->duration) {
+        error("counts mismatch", sequence, step);
+    }
+    if(!is_close(p_stored->move_distance, p_expected->move_distance) ||
+       p_stored->move_edges != p_expected->move_edges) {
+        error("moves mismatch", sequence, step);
+    }
+    for(i = 0; i < 2; i++) {
+        if(!is_close(p_stored->areas[i], p_expected->areas[i])) {
+            error("distance mismatch", sequence, step);
+        }
+        // steepest ramp: ties within tolerance may pick either step
+        if(!is_close(p_stored->peak_accelerations[i], p_expected->peak_accelerations[i])) {
+            error("peak acceleration mismatch", sequence, step);
+        }
+        if(p_stored->min_steps[i] != p_expected->min_steps[i] || p_stored->max_steps[i] != p_expected->max_steps[i] ||
+           p_stored->min_values[i] != p_expected->min_values[i] || p_stored->max_values[i] != p_expected->max_values[i] ||
+           p_stored->end_values[i] != p_expected->end_values[i]) {
+            error("min or max mismatch", sequence, step);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    static uint8_t arena[ARENA_SIZE];
+    sequence_preflight_t expected;
+    sequence_values_t step;
+    sequence_cursor_t cursor;
+    unsigned long sequence, nb_sequences = 2000;
+    uint32_t i, count;
+    int argi = 1;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            nb_sequences = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+
+    sequence_store_init_arena(arena, sizeof(arena));
+    for(sequence = 0; sequence < nb_sequences; sequence++) {
+        sequence_store_record();
+        count = 1 + rand() % MAX_STEPS;
+        for(i = 1; i <= count; i++) {
+            make_step(&step);
+            if(!sequence_store_append(&step)) {
+                fprintf(stderr, "arena too small\n");
+                return 1;
+            }
+            // active sequence keeps playing meanwhile
+            sequence_cursor_start(&cursor);
+            sequence_cursor_next(&cursor, &step);
+            // slot being recorded is the one not active
+            brute_force(1 - cursor.slot, i, &expected);
+            compare(sequence_store_get_recorded_preflight(), &expected, sequence, i);
+        }
+        sequence_store_swap();
+        sequence_cursor_start(&cursor);
+        brute_force(cursor.slot, sequence_store_count(), &expected);
+        compare(sequence_store_get_preflight(), &expected, sequence, count);
+        if(sequence_store_recorded_count() != 0 || sequence_store_get_recorded_preflight()->nb_moves != 0 ||
+           sequence_store_get_recorded_preflight()->duration != 0) {
+            error("recording slot not emptied by swap", sequence, count);
+        }
+    }
+    fprintf(stderr, "%lu sequence(s), %lu error(s)\n", nb_sequences, nb_errors);
+    return nb_errors != 0;
+}
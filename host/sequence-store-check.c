@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks encoding of sequence steps by the firmware (sequence-store.c): round trip and capacity
+ *
+ * Arenas of random sizes are filled with random steps until the store refuses one, then
+ * steps are decoded back by a cursor. Moves get targets over the whole range: edge counts
+ * up to 2^63 - 1, distances of random magnitude and mantissa, and round ones. Checks:
+ *  - each step decoded equals the one appended: move targets and decelerations bit for
+ *    bit (not quantized, even those below 1/SEQUENCE_STORE_QUANTA), values and delays as
+ *    quantized to 1/SEQUENCE_STORE_QUANTA
+ *  - the store refuses a step only when less than the longest encoded step is left, and
+ *    never writes past its arena
+ *  - round distances encode in a few bytes
+ * Bytes per step are reported for ramps and for each kind of move
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -o sequence-store-check sequence-store-check.c ../sequence-store.c -lm
+ * Usage: sequence-store-check [-n {arenas}] [-s {seed}]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequence-store.h"
+
+#define MAX_ARENA_SIZE 8192
+// bytes written past arena end to catch overflows
+#define GUARD_SIZE 64
+#define GUARD_BYTE 0xA5
+// longest encoded step (sequence-store.c): header, direction, 3 bytes delay,
+// 3 varints of 5 bytes (values, deceleration bits) and a 64-bit one of 10 bytes (target)
+#define MAX_STEP_SIZE (1 + 1 + 3 + 3 * 5 + 10)
+// target of a round distance (sign, exponent and a few mantissa bits)
+#define MAX_ROUND_TARGET_SIZE 4
+#define MAX_VALUE 7300
+#define MAX_DELAY 3600
+
+// not used: arena is given by sequence_store_init_arena
+char __StackLimit;
+
+typedef enum {
+    e_kind_ramp,
+    e_kind_edges,
+    e_kind_distance,
+    e_kind_round_distance,
+    e_nb_kinds
+} step_kind_e;
+
+static const char* const kind_names[e_nb_kinds] = {"ramps", "moves in edges", "moves in meters", "moves in round meters"};
+
+static unsigned long nb_errors = 0;
+
+static void error(const char* message, unsigned long arena, uint32_t step) {
+    fprintf(stderr, "arena %lu, step %u: %s\n", arena, (unsigned)step, message);
+    nb_errors++;
+}
+
+static uint64_t random64() {
+    return (uint64_t)rand() << 62 ^ (uint64_t)rand() << 31 ^ (uint64_t)rand();
+}
+
+static float random_value() {
+    return (float)(rand() % (MAX_VALUE * SEQUENCE_STORE_QUANTA)) / SEQUENCE_STORE_QUANTA;
+}
+
+// value as the store gives it back
+static float quantized(float value) {
+    return (float)lroundf(value * SEQUENCE_STORE_QUANTA) / SEQUENCE_STORE_QUANTA;
+}
+
+static step_kind_e make_step(sequence_values_t* p_step) {
+    const step_kind_e kind = rand() % e_nb_kinds;
+    memset(p_step, 0, sizeof(sequence_values_t));
+    p_step->firstReverse = rand() % 4 == 0;
+    p_step->secondReverse = rand() % 4 == 0;
+    p_step->firstValue = random_value();
+    p_step->secondValue = rand() % 2 ? p_step->firstValue : random_value();
+    p_step->delay = rand() % MAX_DELAY;
+    switch(kind) {
+        case e_kind_ramp:
+            p_step->type = e_step_ramp;
+            return kind;
+        case e_kind_edges:
+            p_step->type = e_step_move_edges;
+            // any magnitude, from a few edges to 2^63 - 1
+            p_step->target_edges = (int64_t)(random64() >> (1 + rand() % 63));
+            break;
+        case e_kind_distance:
+            p_step->type = e_step_move_distance;
+            // random mantissa, from mm to thousands of km
+            p_step->target_distance = ldexp((double)random64() / 18446744073709551616.0, rand() % 32 - 10);
+            break;
+        default:
+            p_step->type = e_step_move_distance;
+            p_step->target_distance = (double)(1 + rand() % 1000);
+            break;
+    }
+    if(rand() % 4 == 0) {
+        // below 1/SEQUENCE_STORE_QUANTA, such as @10,0.004: not quantized to default
+        p_step->deceleration = (float)(1 + rand() % 9) / (10 * SEQUENCE_STORE_QUANTA);
+    } else if(rand() % 2) {
+        p_step->deceleration = (float)(1 + rand() % 1000) / SEQUENCE_STORE_QUANTA;
+    }
+    return kind;
+}
+
+static bool is_round_trip(const sequence_values_t* p_step, const sequence_values_t* p_decoded) {
+    if(p_decoded->type != p_step->type || p_decoded->firstReverse != p_step->firstReverse ||
+       p_decoded->secondReverse != p_step->secondReverse ||
+       p_decoded->firstValue != quantized(p_step->firstValue) ||
+       p_decoded->secondValue != quantized(p_step->secondValue)) {
+        return false;
+    }
+    if(p_step->type == e_step_ramp) {
+        return p_decoded->delay == p_step->delay;
+    }
+    // targets and deceleration exact, bit for bit
+    return p_decoded->target_edges == p_step->target_edges &&
+           memcmp(&p_decoded->target_distance, &p_step->target_distance, sizeof(double)) == 0 &&
+           memcmp(&p_decoded->deceleration, &p_step->deceleration, sizeof(float)) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    static uint8_t arena[MAX_ARENA_SIZE + GUARD_SIZE];
+    static sequence_values_t steps[MAX_ARENA_SIZE];
+    static step_kind_e kinds[MAX_ARENA_SIZE];
+    unsigned long bytes[e_nb_kinds] = {0}, counts[e_nb_kinds] = {0};
+    sequence_values_t decoded;
+    sequence_cursor_t cursor;
+    unsigned long nb_arenas = 1000, arena_index, nb_steps = 0;
+    uint32_t size, count, offset, step_size, i;
+    int argi = 1;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            nb_arenas = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+
+    for(arena_index = 0; arena_index < nb_arenas; arena_index++) {
+        size = MAX_STEP_SIZE + rand() % (MAX_ARENA_SIZE - MAX_STEP_SIZE);
+        memset(arena, GUARD_BYTE, sizeof(arena));
+        sequence_store_init_arena(arena, size);
+        // fills recording slot, which is the whole arena while active one is empty
+        for(count = 0; ; count++) {
+            kinds[count] = make_step(&steps[count]);
+            if(!sequence_store_append(&steps[count])) {
+                break;
+            }
+        }
+        sequence_store_swap();
+        if(size - sequence_store_used() >= MAX_STEP_SIZE) {
+            error("step refused while arena has room", arena_index, count + 1);
+        }
+        for(i = 0; i < GUARD_SIZE; i++) {
+            if(arena[size + i] != GUARD_BYTE) {
+                error("store wrote past its arena", arena_index, count);
+                break;
+            }
+        }
+        sequence_cursor_start(&cursor);
+        for(i = 0; i < count; i++) {
+            offset = cursor.offset;
+            if(!sequence_cursor_next(&cursor, &decoded)) {
+                break;
+            }
+            if(!is_round_trip(&steps[i], &decoded)) {
+                error("step decoded differs from step appended", arena_index, i + 1);
+            }
+            // encoded step is what cursor went over
+            step_size = cursor.offset - offset;
+            if(step_size > MAX_STEP_SIZE) {
+                error("step longer than longest encoded one", arena_index, i + 1);
+            }
+            if(kinds[i] == e_kind_round_distance && step_size > MAX_STEP_SIZE - 10 + MAX_ROUND_TARGET_SIZE) {
+                error("round distance not encoded short", arena_index, i + 1);
+            }
+            bytes[kinds[i]] += step_size;
+            counts[kinds[i]]++;
+        }
+        if(i != count || sequence_cursor_next(&cursor, &decoded)) {
+            error("step count differs", arena_index, i);
+        }
+        nb_steps += count;
+    }
+    for(i = 0; i < e_nb_kinds; i++) {
+        fprintf(stderr, "%s: %.1f bytes per step\n", kind_names[i], counts[i] == 0 ? 0.0 : (double)bytes[i] / counts[i]);
+    }
+    fprintf(stderr, "%lu arena(s), %lu step(s), %lu error(s)\n", nb_arenas, nb_steps, nb_errors);
+    return nb_errors != 0;
+}
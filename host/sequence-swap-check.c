@@ -0,0 +1,194 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks hot swap of sequences of the firmware (sequence-store.c)
+ *
+ * Random sequences are played in loop like the firmware does (one value every
+ * 1 / STEPS_PER_SECOND s, linear ramps), a next sequence is recorded in the other
+ * slot of a small arena while one plays, then swapped at next step or at end
+ * of sequence. Checks:
+ *  - playing sequence is not altered while next one is recorded
+ *  - swap occurs at requested boundary, next sequence starting from its first step
+ *  - output has no gap or spike: every tick, value moves from previous one by at
+ *    most the increment of the ramp in progress, towards its final value
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -o sequence-swap-check sequence-swap-check.c ../sequence-store.c -lm
+ * Usage: sequence-swap-check [-n {swaps}] [-s {seed}]
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequence-store.h"
+
+// small enough for slots to be placed in each part of arena in turn
+#define ARENA_SIZE 1024
+#define MAX_STEPS 24
+#define MAX_VALUE 300
+#define MAX_DELAY 4
+// values are quantized by store
+#define EPSILON (1.0f / SEQUENCE_STORE_QUANTA)
+
+// not used: arena is given by sequence_store_init_arena
+char __StackLimit;
+
+typedef struct {
+    sequence_values_t steps[MAX_STEPS];
+    uint32_t count;
+} sequence_t;
+
+static unsigned long nb_errors = 0;
+
+static void error(const char* message, unsigned long swap, uint32_t tick) {
+    fprintf(stderr, "swap %lu, tick %" PRIu32 ": %s\n", swap, tick, message);
+    nb_errors++;
+}
+
+static void make_sequence(sequence_t* p_sequence) {
+    sequence_values_t* p;
+    uint32_t i;
+    p_sequence->count = 1 + rand() % MAX_STEPS;
+    for(i = 0; i < p_sequence->count; i++) {
+        p = &p_sequence->steps[i];
+        memset(p, 0, sizeof(sequence_values_t));
+        p->type = e_step_ramp;
+        p->firstValue = (float)(rand() % (MAX_VALUE * SEQUENCE_STORE_QUANTA)) / SEQUENCE_STORE_QUANTA;
+        p->secondValue = rand() % 2 ? p->firstValue : (float)(rand() % (MAX_VALUE * SEQUENCE_STORE_QUANTA)) / SEQUENCE_STORE_QUANTA;
+        p->delay = 1 + rand() % MAX_DELAY;
+    }
+}
+
+static void record_sequence(const sequence_t* p_sequence) {
+    uint32_t i;
+    sequence_store_record();
+    for(i = 0; i < p_sequence->count; i++) {
+        if(!sequence_store_append(&p_sequence->steps[i])) {
+            fprintf(stderr, "arena too small\n");
+            exit(1);
+        }
+    }
+}
+
+static int is_step_equal(const sequence_values_t* p_stored, const sequence_values_t* p_expected) {
+    return fabsf(p_stored->firstValue - p_expected->firstValue) < EPSILON &&
+           fabsf(p_stored->secondValue - p_expected->secondValue) < EPSILON &&
+           p_stored->delay == p_expected->delay;
+}
+
+// checks value of one tick against ramp from start to end in nb_ticks
+static int is_tick_continuous(float previous, float value, float start, float end, uint32_t nb_ticks) {
+    const float increment = fabsf(end - start) / nb_ticks + EPSILON;
+    const float low = fminf(start, end) - EPSILON, high = fmaxf(start, end) + EPSILON;
+    return fabsf(value - previous) <= increment && value >= low && value <= high;
+}
+
+// plays active sequence in loop for nb_steps_before_swap steps, then requests
+// a swap to next one (played for two steps) and checks transition
+static void play_and_swap(unsigned long swap, const sequence_t* p_active, const sequence_t* p_next,
+                          uint32_t nb_steps_before_swap, sequence_swap_e when, float* p_first, float* p_second) {
+    sequence_cursor_t cursor;
+    sequence_values_t step;
+    const sequence_t* p_playing = p_active;
+    uint32_t played = 0, played_after_swap = 0, tick = 0, i, nb_ticks, expected_index;
+    int swapped = 0;
+    float start1, start2, value1, value2;
+
+    // at step: just after request, at loop: once last step of sequence is played
+    const uint32_t expected_swap = when == e_swap_at_step ? nb_steps_before_swap :
+        (nb_steps_before_swap == 0 ? 1 : (nb_steps_before_swap + p_active->count - 1) / p_active->count) * p_active->count;
+
+    sequence_cursor_start(&cursor);
+    while(1) {
+        if(played == nb_steps_before_swap) {
+            if(!sequence_store_request_swap(when)) {
+                error("swap refused", swap, tick);
+                return;
+            }
+        }
+        if(!sequence_cursor_next(&cursor, &step)) {
+            sequence_cursor_start(&cursor); // loop
+            continue;
+        }
+        if(cursor.swapped) {
+            if(swapped || played != expected_swap) {
+                error("swap at wrong boundary", swap, tick);
+            }
+            swapped = 1;
+            p_playing = p_next;
+        }
+        expected_index = cursor.index - 1;
+        if(!is_step_equal(&step, &p_playing->steps[expected_index])) {
+            error(swapped ? "next sequence step mismatch" : "playing sequence altered", swap, tick);
+        }
+        // ramp as in firmware: one value per tick, last one lands on step values
+        nb_ticks = STEPS_PER_SECOND * step.delay;
+        start1 = *p_first;
+        start2 = *p_second;
+        for(i = 1; i <= nb_ticks; i++, tick++) {
+            value1 = i == nb_ticks ? step.firstValue : start1 + (step.firstValue - start1) * i / nb_ticks;
+            value2 = i == nb_ticks ? step.secondValue : start2 + (step.secondValue - start2) * i / nb_ticks;
+            if(!is_tick_continuous(*p_first, value1, start1, step.firstValue, nb_ticks) ||
+               !is_tick_continuous(*p_second, value2, start2, step.secondValue, nb_ticks)) {
+                error("gap or spike in output", swap, tick);
+            }
+            *p_first = value1;
+            *p_second = value2;
+        }
+        played++;
+        if(swapped && ++played_after_swap == 2) {
+            break;
+        }
+        if(played > expected_swap + 2) {
+            error("swap never occurred", swap, tick);
+            break;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    static uint8_t arena[ARENA_SIZE];
+    sequence_t sequences[2];
+    sequence_t* p_active = &sequences[0];
+    sequence_t* p_next = &sequences[1];
+    sequence_t* p;
+    unsigned long swap, nb_swaps = 10000;
+    sequence_swap_e when;
+    float first = 0.0f, second = 0.0f;
+    int argi = 1;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            nb_swaps = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+
+    sequence_store_init_arena(arena, sizeof(arena));
+    make_sequence(p_active);
+    record_sequence(p_active);
+    sequence_store_swap();
+    for(swap = 0; swap < nb_swaps; swap++) {
+        make_sequence(p_next);
+        // recorded while active one is in use
+        record_sequence(p_next);
+        when = rand() % 2 ? e_swap_at_step : e_swap_at_loop;
+        play_and_swap(swap, p_active, p_next, rand() % (2 * p_active->count), when, &first, &second);
+        if(sequence_store_get_pending_swap() != e_swap_none || sequence_store_count() != p_next->count) {
+            error("swap not completed", swap, 0);
+        }
+        p = p_active;
+        p_active = p_next;
+        p_next = p;
+    }
+    fprintf(stderr, "%lu swap(s), %lu error(s)\n", nb_swaps, nb_errors);
+    return nb_errors != 0;
+}
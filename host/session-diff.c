@@ -0,0 +1,307 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Compares console sessions recorded and replayed by speed sensor simulator
+ * (commands r+, r!, r>, see session.h)
+ * Reads raw bytes captured from the USB serial link (files or stdin), in which
+ * logs are found in dump order: recorded then replayed, for as many sessions as captured
+ *
+ * For each session, checks replay against recording:
+ *  - same console input
+ *  - same console output lines, in order (lines containing an ignored text are skipped,
+ *    e.g. measured interrupt loads)
+ *  - same output engine parameters (edge periods, directions), given on the same tick
+ *    relative to last console input, within a tolerance
+ * With -v, prints every difference instead of the first ones
+ * Exit status is 1 if any session differs
+ *
+ * Build: cc -O2 -I.. -o session-diff session-diff.c ../session-log.c
+ * Usage: session-diff [-i {text}]... [-t {ticks}] [-v] [capture_file]...
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "session-log.h"
+
+#define MAX_IGNORED 16
+#define MAX_LINE 256
+#define MAX_REPORTED 5
+
+typedef struct {
+    uint32_t tick; // relative to last input
+    char text[MAX_LINE];
+} line_t;
+
+typedef struct {
+    uint32_t tick; // relative to last input
+    uint32_t max_count1;
+    uint32_t max_count2;
+    uint8_t flags;
+} edges_t;
+
+// session log turned into what is compared
+typedef struct {
+    char* input;
+    uint32_t input_length;
+    line_t* lines;
+    uint32_t nb_lines;
+    edges_t* edges;
+    uint32_t nb_edges;
+    uint32_t nb_ticks;
+} session_t;
+
+static const char* ignored[MAX_IGNORED];
+static int nb_ignored = 0;
+static uint32_t tolerance = 1;
+static int verbose = 0;
+
+static int is_ignored(const char* text) {
+    int i;
+    for(i = 0; i < nb_ignored; i++) {
+        if(strstr(text, ignored[i]) != NULL) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void* grow(void* array, uint32_t count, size_t element_size) {
+    // doubles on powers of 2
+    if(count != 0 && (count & (count - 1)) != 0) {
+        return array;
+    }
+    array = realloc(array, (count == 0 ? 1 : 2 * count) * element_size);
+    if(array == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    return array;
+}
+
+static void end_line(session_t* p_session, line_t* p_line, uint32_t* p_length) {
+    p_line->text[*p_length] = '\0';
+    *p_length = 0;
+    if(is_ignored(p_line->text)) {
+        return;
+    }
+    p_session->lines = grow(p_session->lines, p_session->nb_lines, sizeof(line_t));
+    p_session->lines[p_session->nb_lines++] = *p_line;
+}
+
+static void parse_session(const uint8_t* log, uint32_t size, session_t* p_session) {
+    session_record_t record;
+    uint32_t offset = 0, next, tick = 0, input_tick = 0, line_length = 0, i;
+    line_t line;
+    char c;
+    memset(p_session, 0, sizeof(session_t));
+    while((next = session_log_get(log, size, offset, &record)) != 0) {
+        offset = next;
+        tick += record.ticks;
+        switch(record.type) {
+            case e_session_input:
+            case e_session_prompt_input:
+                input_tick = tick;
+                for(i = 0; i < record.length; i++) {
+                    p_session->input = grow(p_session->input, p_session->input_length, 1);
+                    p_session->input[p_session->input_length++] = record.data[i];
+                }
+                break;
+            case e_session_output:
+                for(i = 0; i < record.length; i++) {
+                    c = record.data[i];
+                    if(c == '\r') {
+                        continue;
+                    }
+                    if(line_length == 0) {
+                        line.tick = tick - input_tick;
+                    }
+                    if(c == '\n') {
+                        end_line(p_session, &line, &line_length);
+                    } else if(line_length < MAX_LINE - 1) {
+                        line.text[line_length++] = c;
+                    }
+                }
+                break;
+            case e_session_edges:
+                p_session->edges = grow(p_session->edges, p_session->nb_edges, sizeof(edges_t));
+                p_session->edges[p_session->nb_edges].tick = tick - input_tick;
+                p_session->edges[p_session->nb_edges].max_count1 = record.max_count1;
+                p_session->edges[p_session->nb_edges].max_count2 = record.max_count2;
+                p_session->edges[p_session->nb_edges].flags = record.flags;
+                p_session->nb_edges++;
+                break;
+            default:
+                break;
+        }
+    }
+    if(line_length != 0) {
+        end_line(p_session, &line, &line_length);
+    }
+    if(offset != size) {
+        printf("  log truncated at byte %" PRIu32 " of %" PRIu32 "\n", offset, size);
+    }
+    p_session->nb_ticks = tick;
+}
+
+static void free_session(session_t* p_session) {
+    free(p_session->input);
+    free(p_session->lines);
+    free(p_session->edges);
+}
+
+static int report(uint32_t* p_count) {
+    return ++*p_count <= MAX_REPORTED || verbose;
+}
+
+// out: number of differences
+static uint32_t compare_sessions(const session_t* p_recorded, const session_t* p_replayed) {
+    uint32_t i, nb_lines, nb_edges, deviation, max_deviation = 0, errors = 0;
+    uint32_t line_errors = 0, edge_errors = 0;
+    const edges_t* e1;
+    const edges_t* e2;
+
+    if(p_recorded->input_length != p_replayed->input_length ||
+       memcmp(p_recorded->input, p_replayed->input, p_recorded->input_length) != 0) {
+        printf("  input differs: %" PRIu32 " characters recorded, %" PRIu32 " replayed\n",
+               p_recorded->input_length, p_replayed->input_length);
+        errors++;
+    }
+    nb_lines = p_recorded->nb_lines < p_replayed->nb_lines ? p_recorded->nb_lines : p_replayed->nb_lines;
+    for(i = 0; i < nb_lines; i++) {
+        if(strcmp(p_recorded->lines[i].text, p_replayed->lines[i].text) != 0 && report(&line_errors)) {
+            printf("  line %" PRIu32 ":\n  < %s\n  > %s\n", i + 1, p_recorded->lines[i].text, p_replayed->lines[i].text);
+        }
+    }
+    if(p_recorded->nb_lines != p_replayed->nb_lines) {
+        printf("  %" PRIu32 " output lines recorded, %" PRIu32 " replayed\n", p_recorded->nb_lines, p_replayed->nb_lines);
+        line_errors++;
+    }
+    nb_edges = p_recorded->nb_edges < p_replayed->nb_edges ? p_recorded->nb_edges : p_replayed->nb_edges;
+    for(i = 0; i < nb_edges; i++) {
+        e1 = &p_recorded->edges[i];
+        e2 = &p_replayed->edges[i];
+        deviation = e1->tick > e2->tick ? e1->tick - e2->tick : e2->tick - e1->tick;
+        if(deviation > max_deviation) {
+            max_deviation = deviation;
+        }
+        if((e1->max_count1 != e2->max_count1 || e1->max_count2 != e2->max_count2 ||
+            e1->flags != e2->flags || deviation > tolerance) && report(&edge_errors)) {
+            printf("  edges %" PRIu32 ": %" PRIu32 " %" PRIu32 " us %02X at +%" PRIu32
+                   " ticks recorded, %" PRIu32 " %" PRIu32 " us %02X at +%" PRIu32 " replayed\n",
+                   i + 1, e1->max_count1, e1->max_count2, e1->flags, e1->tick,
+                   e2->max_count1, e2->max_count2, e2->flags, e2->tick);
+        }
+    }
+    if(p_recorded->nb_edges != p_replayed->nb_edges) {
+        printf("  %" PRIu32 " output changes recorded, %" PRIu32 " replayed\n", p_recorded->nb_edges, p_replayed->nb_edges);
+        edge_errors++;
+    }
+    printf("  %" PRIu32 " input characters, %" PRIu32 " output lines, %" PRIu32 " output changes over %" PRIu32
+           " ticks: %" PRIu32 " line(s) and %" PRIu32 " output change(s) differ, timing deviation up to %" PRIu32 " tick(s)\n",
+           p_recorded->input_length, p_recorded->nb_lines, p_recorded->nb_edges, p_recorded->nb_ticks,
+           line_errors, edge_errors, max_deviation);
+    return errors + line_errors + edge_errors;
+}
+
+// appends capture file (NULL for stdin) to buffer
+static uint8_t* read_capture(const char* name, uint8_t* buffer, size_t* p_size) {
+    FILE* in = stdin;
+    size_t n;
+    if(name != NULL && strcmp(name, "-") != 0 && (in = fopen(name, "rb")) == NULL) {
+        perror(name);
+        exit(2);
+    }
+    do {
+        buffer = realloc(buffer, *p_size + 65536);
+        if(buffer == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+        n = fread(buffer + *p_size, 1, 65536, in);
+        *p_size += n;
+    } while(n != 0);
+    if(in != stdin) {
+        fclose(in);
+    }
+    return buffer;
+}
+
+// finds next dumped log from offset
+// out: offset of log, 0 if none
+static size_t find_log(const uint8_t* capture, size_t size, size_t offset, uint32_t* p_log_size) {
+    uint32_t log_size, i;
+    uint8_t sum;
+    for(; offset + 8 <= size; offset++) {
+        if(capture[offset] != SESSION_SYNC1 || capture[offset + 1] != SESSION_SYNC2 ||
+           capture[offset + 2] != SESSION_VERSION) {
+            continue;
+        }
+        log_size = capture[offset + 3] | capture[offset + 4] << 8 | capture[offset + 5] << 16 |
+                   (uint32_t)capture[offset + 6] << 24;
+        if(log_size > size - offset - 8) {
+            continue;
+        }
+        sum = 0;
+        for(i = 0; i < 5 + log_size + 1; i++) {
+            sum += capture[offset + 2 + i];
+        }
+        if(sum == 0) {
+            *p_log_size = log_size;
+            return offset + 7;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    uint8_t* capture = NULL;
+    size_t size = 0, offset = 0, recorded, replayed;
+    uint32_t recorded_size, replayed_size, nb_sessions = 0, nb_differing = 0;
+    session_t recorded_session, replayed_session;
+    int argi = 1;
+
+    while(argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0') {
+        if(strcmp(argv[argi], "-i") == 0 && argi + 1 < argc && nb_ignored < MAX_IGNORED) {
+            ignored[nb_ignored++] = argv[++argi];
+        } else if(strcmp(argv[argi], "-t") == 0 && argi + 1 < argc) {
+            tolerance = strtoul(argv[++argi], NULL, 10);
+        } else if(strcmp(argv[argi], "-v") == 0) {
+            verbose = 1;
+        } else {
+            fprintf(stderr, "Usage: session-diff [-i {text}]... [-t {ticks}] [-v] [capture_file]...\n");
+            return 2;
+        }
+        argi++;
+    }
+    if(argi == argc) {
+        capture = read_capture(NULL, capture, &size);
+    }
+    for(; argi < argc; argi++) {
+        capture = read_capture(argv[argi], capture, &size);
+    }
+
+    while((recorded = find_log(capture, size, offset, &recorded_size)) != 0) {
+        replayed = find_log(capture, size, recorded + recorded_size + 1, &replayed_size);
+        if(replayed == 0) {
+            printf("session %" PRIu32 ": no replayed log\n", nb_sessions + 1);
+            nb_differing++;
+            break;
+        }
+        nb_sessions++;
+        printf("session %" PRIu32 ":\n", nb_sessions);
+        parse_session(capture + recorded, recorded_size, &recorded_session);
+        parse_session(capture + replayed, replayed_size, &replayed_session);
+        if(compare_sessions(&recorded_session, &replayed_session) != 0) {
+            nb_differing++;
+        }
+        free_session(&recorded_session);
+        free_session(&replayed_session);
+        offset = replayed + replayed_size + 1;
+    }
+    free(capture);
+    printf("%" PRIu32 " session(s), %" PRIu32 " differ\n", nb_sessions, nb_differing);
+    return nb_sessions == 0 || nb_differing != 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Replays console sessions recorded by speed sensor simulator (command r+, see session.h)
+ * against the current firmware, on the host
+ *
+ * The whole firmware runs on the host (pico-host), in simulated time: each recorded log
+ * found in captures (raw bytes of the USB serial link, as read by session-diff) is loaded
+ * (session_load_recorded) and replayed by command r!1. Time scale is 1, so that replayed
+ * ticks are those of the recording, and time still goes as fast as the host does, with
+ * no bound such as SESSION_MAX_TIME_SCALE on target. Both logs are then dumped by command
+ * r> on console, which is written to stdout for session-diff to compare:
+ *   session-replay capture.bin | session-diff -i "load"
+ * Simulated and host time of replays are reported on stderr
+ * With -f, PWM wrap interrupts are not simulated (sessions run faster, but edges of the
+ * PWM backend are no longer output: moves, which stop on edge counts, would not end)
+ * Exit status is 1 if a log cannot be replayed
+ *
+ * Build: cc -O2 -I.. -Ipico-host -o session-replay session-replay.c pico-host/pico-host.c ../core0-output.c ../float_equality_ulp.c ../journal.c ../out-gpios.c ../output-backend.c ../pwm-managed.c ../sequence-store.c ../session.c ../session-log.c ../speed-sensor.c ../speed-sensor-util.c ../standstill.c ../state-snapshot.c ../sweep.c ../sync.c ../sync-pll.c ../telemetry.c ../timeline.c ../timer-managed.c ../train-model.c ../trigger.c ../vr-managed.c ../vr-wave.c -lm
+ * Usage: session-replay [-f] [capture_file]...
+ */
+
+#define PICO_HOST_TOOL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico-host.h"
+
+#include "session.h"
+#include "session-log.h"
+#include "sync-pll.h"
+
+#define SAMPLE_US 10000
+#define SETTLE_US 500000
+// replay may last longer than recording (e.g. a sequence running past last input)
+#define REPLAY_MARGIN_US 60000000
+
+static void out_chars(const char* buf, int length) {
+    fwrite(buf, 1, length, stdout);
+}
+
+static double get_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// appends capture file (NULL for stdin) to buffer
+static uint8_t* read_capture(const char* name, uint8_t* buffer, size_t* p_size) {
+    FILE* in = stdin;
+    size_t n;
+    if(name != NULL && strcmp(name, "-") != 0 && (in = fopen(name, "rb")) == NULL) {
+        perror(name);
+        exit(2);
+    }
+    do {
+        buffer = realloc(buffer, *p_size + 65536);
+        if(buffer == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+        n = fread(buffer + *p_size, 1, 65536, in);
+        *p_size += n;
+    } while(n != 0);
+    if(in != stdin) {
+        fclose(in);
+    }
+    return buffer;
+}
+
+// finds next dumped log from offset (see session-log.h)
+// out: offset of log, 0 if none
+static size_t find_log(const uint8_t* capture, size_t size, size_t offset, uint32_t* p_log_size) {
+    uint32_t log_size, i;
+    uint8_t sum;
+    for(; offset + 8 <= size; offset++) {
+        if(capture[offset] != SESSION_SYNC1 || capture[offset + 1] != SESSION_SYNC2 ||
+           capture[offset + 2] != SESSION_VERSION) {
+            continue;
+        }
+        log_size = capture[offset + 3] | capture[offset + 4] << 8 | capture[offset + 5] << 16 |
+                   (uint32_t)capture[offset + 6] << 24;
+        if(log_size > size - offset - 8) {
+            continue;
+        }
+        sum = 0;
+        for(i = 0; i < 5 + log_size + 1; i++) {
+            sum += capture[offset + 2 + i];
+        }
+        if(sum == 0) {
+            *p_log_size = log_size;
+            return offset + 7;
+        }
+    }
+    return 0;
+}
+
+// simulated time covered by a log
+static uint64_t get_log_duration_us(const uint8_t* log, uint32_t size) {
+    session_record_t record;
+    uint32_t offset = 0, next;
+    uint64_t nb_ticks = 0;
+    while((next = session_log_get(log, size, offset, &record)) != 0) {
+        offset = next;
+        nb_ticks += record.ticks;
+    }
+    return nb_ticks * SYNC_PLL_NOMINAL_PERIOD_US;
+}
+
+// types a command once previous one was read
+static void type(const char* command) {
+    while(!pico_host_input_consumed()) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    pico_host_input(command);
+    pico_host_input("\r\n");
+}
+
+// out: false if log could not be replayed
+static bool replay(const uint8_t* log, uint32_t size, uint64_t* p_simulated_us) {
+    const uint64_t start_us = pico_host_time_us();
+    const uint64_t end_us = start_us + get_log_duration_us(log, size) + REPLAY_MARGIN_US;
+    if(!session_load_recorded(log, size)) {
+        return false;
+    }
+    // no line feed after command: anything typed during replay ends it
+    while(!pico_host_input_consumed()) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    pico_host_input("r!1\r");
+    while(session_get_mode() != e_session_replaying && pico_host_time_us() < end_us) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    while(session_get_mode() == e_session_replaying && pico_host_time_us() < end_us) {
+        pico_host_run_for(SAMPLE_US);
+    }
+    if(session_get_mode() != e_session_idle) {
+        return false;
+    }
+    *p_simulated_us += pico_host_time_us() - start_us;
+    type("r>");
+    pico_host_run_for(SETTLE_US);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    uint8_t* capture = NULL;
+    size_t size = 0, offset = 0, recorded, replayed;
+    uint32_t recorded_size, replayed_size, nb_sessions = 0, nb_failed = 0;
+    uint64_t simulated_us = 0;
+    double start;
+    bool pwm_irq = true;
+    int argi = 1;
+
+    while(argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0') {
+        if(strcmp(argv[argi], "-f") == 0) {
+            pwm_irq = false;
+        } else {
+            fprintf(stderr, "Usage: session-replay [-f] [capture_file]...\n");
+            return 2;
+        }
+        argi++;
+    }
+    if(argi == argc) {
+        capture = read_capture(NULL, capture, &size);
+    }
+    for(; argi < argc; argi++) {
+        capture = read_capture(argv[argi], capture, &size);
+    }
+
+    start = get_seconds();
+    pico_host_set_output(out_chars);
+    pico_host_boot(firmware_main);
+    pico_host_run_for(PICO_HOST_USB_CONNECT_US + SETTLE_US);
+    pico_host_set_pwm_irq(pwm_irq);
+    // logs come in dump order: recorded, then replayed (left aside, replayed again here)
+    while((recorded = find_log(capture, size, offset, &recorded_size)) != 0) {
+        nb_sessions++;
+        if(!replay(capture + recorded, recorded_size, &simulated_us)) {
+            fprintf(stderr, "session %u: not replayed\n", (unsigned)nb_sessions);
+            nb_failed++;
+        }
+        offset = recorded + recorded_size + 1;
+        replayed = find_log(capture, size, offset, &replayed_size);
+        if(replayed != 0) {
+            offset = replayed + replayed_size + 1;
+        }
+    }
+    fflush(stdout);
+    fprintf(stderr, "%u session(s) replayed, %u failed: %.1f s simulated in %.1f s\n", (unsigned)nb_sessions,
+            (unsigned)nb_failed, simulated_us / 1e6, get_seconds() - start);
+    free(capture);
+    return nb_sessions == 0 || nb_failed != 0;
+}
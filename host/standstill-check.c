@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Runs standstill models of the firmware (standstill.c) edge by edge, as output interrupt
+ * does, and checks the walk of edges:
+ *  - position never strays more than amplitude from rest point (two more edges
+ *    when creeping), so that net displacement is bounded without creep
+ *  - position follows creep on average, creep speed below MIN_FREQUENCY is reached
+ *  - direction toggles, both ways, and intervals between edges stay within params
+ * Without model given, runs built-in models (with and without creep, several seeds)
+ * With -t, prints trace of edges: time (µs), position (edges), rest point (edges)
+ * Exit status is 1 if any model breaks these bounds
+ *
+ * Build: cc -O2 -I.. -o standstill-check standstill-check.c ../standstill.c -lm
+ * Usage: standstill-check [-t] [{amplitude} {max_ms} [{creep_hz} [{hours}]]]
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "standstill.h"
+
+// as firmware (see speed-sensor.h)
+#define MIN_FREQUENCY 0.1
+#define DEFAULT_HOURS 24.0
+#define NB_SEEDS 4
+
+typedef struct {
+    uint8_t amplitude;
+    uint16_t max_interval_ms;
+    double creep_frequency;
+    double hours;
+} standstill_case_t;
+
+static const standstill_case_t default_cases[] = {
+    {1, 1, 0.0, 1.0},
+    {2, 100, 0.0, DEFAULT_HOURS},
+    {STANDSTILL_MAX_AMPLITUDE, 20, 0.0, DEFAULT_HOURS},
+    {4, 1000, 0.0, DEFAULT_HOURS},
+    {3, 50, 0.05, DEFAULT_HOURS},
+    {2, 10, -0.099, DEFAULT_HOURS},
+    {STANDSTILL_MAX_AMPLITUDE, 1000, 0.001, DEFAULT_HOURS},
+};
+
+static int trace = 0;
+
+// out: number of failed checks
+static uint32_t check_standstill(const standstill_case_t* p_case, uint32_t seed) {
+    const double duration_us = p_case->hours * 3600e6;
+    standstill_params_t params;
+    standstill_t standstill;
+    uint64_t t = 0, nb_edges = 0, nb_turns = 0;
+    uint32_t interval, max_interval = 0, min_interval = UINT32_MAX, errors = 0;
+    int8_t direction = 1, next_direction;
+    int32_t min_position = 0, max_position = 0;
+    double rest, deviation, max_deviation = 0.0, expected, drift;
+
+    standstill_init_params(&params, p_case->amplitude, p_case->max_interval_ms, p_case->creep_frequency);
+    interval = standstill_start(&standstill, &params, seed);
+    while(t < duration_us) {
+        t += interval;
+        nb_edges++;
+        if(interval < min_interval) {
+            min_interval = interval;
+        }
+        if(interval > max_interval) {
+            max_interval = interval;
+        }
+        next_direction = standstill_next_edge(&standstill, direction, interval, &interval);
+        if(next_direction != direction) {
+            nb_turns++;
+        }
+        direction = next_direction;
+        // rest point in edges, exact (not Q40 of model)
+        rest = p_case->creep_frequency * 4.0 * t / 1e6;
+        deviation = standstill.position - rest;
+        if(fabs(deviation) > fabs(max_deviation)) {
+            max_deviation = deviation;
+        }
+        if(standstill.position < min_position) {
+            min_position = standstill.position;
+        }
+        if(standstill.position > max_position) {
+            max_position = standstill.position;
+        }
+        if(trace) {
+            printf("%" PRIu64 ",%" PRId32 ",%.3f\n", t, standstill.position, rest);
+        }
+    }
+    expected = p_case->creep_frequency * 4.0 * t / 1e6;
+    drift = standstill.position - expected;
+    printf("amplitude %hu, %hu ms, creep %g Hz, %g h, seed %08" PRIx32 ": %" PRIu64 " edges, %" PRIu64
+           " turns, positions [%" PRId32 ", %" PRId32 "], deviation up to %+.2f edges, end %+.2f edges from creep: ",
+           p_case->amplitude, p_case->max_interval_ms, p_case->creep_frequency, p_case->hours, seed,
+           nb_edges, nb_turns, min_position, max_position, max_deviation, drift);
+    // creeping: rest point of model is truncated to whole edges, moves on between edges
+    // (one more edge) and its creep is rounded (Q40)
+    if(fabs(max_deviation) > p_case->amplitude + (p_case->creep_frequency != 0.0 ? 2.0 + 1e-6 * fabs(expected) : 0.0)) {
+        printf("\n  position strays from rest point");
+        errors++;
+    }
+    if(p_case->creep_frequency == 0.0 && (max_position - min_position > 2 * p_case->amplitude)) {
+        printf("\n  net displacement beyond amplitude");
+        errors++;
+    }
+    if(min_interval < params.min_interval_us || max_interval > params.min_interval_us + params.interval_span_us) {
+        printf("\n  interval out of [%" PRIu32 ", %" PRIu32 "] us", min_interval, max_interval);
+        errors++;
+    }
+    // a fair walk turns about every other edge (more often at bounds)
+    if(nb_edges > 100 && (nb_turns < nb_edges / 4 || nb_turns == nb_edges)) {
+        printf("\n  direction toggles on %" PRIu64 " edges of %" PRIu64, nb_turns, nb_edges);
+        errors++;
+    }
+    printf("%s\n", errors == 0 ? "ok" : "\nFAILED");
+    return errors;
+}
+
+int main(int argc, char* argv[]) {
+    standstill_case_t standstill_case;
+    uint32_t i, j, nb_failed = 0;
+    int argi = 1;
+
+    if(argi < argc && strcmp(argv[argi], "-t") == 0) {
+        trace = 1;
+        argi++;
+    }
+    if(argi == argc) {
+        for(i = 0; i < sizeof(default_cases) / sizeof(default_cases[0]); i++) {
+            for(j = 0; j < NB_SEEDS; j++) {
+                if(check_standstill(&default_cases[i], 0x12345678 * (j + 1)) != 0) {
+                    nb_failed++;
+                }
+            }
+        }
+        return nb_failed != 0;
+    }
+    if(argc - argi < 2 || argc - argi > 4) {
+        fprintf(stderr, "Usage: standstill-check [-t] [{amplitude} {max_ms} [{creep_hz} [{hours}]]]\n");
+        return 2;
+    }
+    standstill_case.amplitude = atoi(argv[argi]);
+    standstill_case.max_interval_ms = atoi(argv[argi + 1]);
+    standstill_case.creep_frequency = argc - argi >= 3 ? atof(argv[argi + 2]) : 0.0;
+    standstill_case.hours = argc - argi == 4 ? atof(argv[argi + 3]) : DEFAULT_HOURS;
+    if(atoi(argv[argi]) < 1 || atoi(argv[argi]) > STANDSTILL_MAX_AMPLITUDE ||
+       atoi(argv[argi + 1]) < STANDSTILL_MIN_INTERVAL_MS || atoi(argv[argi + 1]) > STANDSTILL_MAX_INTERVAL_MS ||
+       fabs(standstill_case.creep_frequency) >= MIN_FREQUENCY || standstill_case.hours <= 0.0) {
+        fprintf(stderr, "standstill model out of range\n");
+        return 2;
+    }
+    return check_standstill(&standstill_case, 0x12345678) != 0;
+}
@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Runs frequency sweeps of the firmware (sweep.c) edge by edge, as output interrupt does,
+ * and checks the trace of edges against sweep law:
+ *  - quarter period of each edge is that of law frequency at edge start, within 1 µs
+ *    (whole µs, fraction carried over) and exp2 interpolation error
+ *  - sweep is over (end frequency reached, or its dwell time elapsed if stepped)
+ *    at requested duration, end frequency is then held
+ *  - a decade marker is raised on first edge past each decade (or next edges
+ *    when an edge crosses several decades)
+ * Law: linear f(t) = f1 + (f2 - f1) t / s, logarithmic f(t) = f1 (f2 / f1)^(t / s),
+ * stepped: n log spaced steps per decade, each held s / (steps + 1)
+ * Without sweep given, runs built-in sweeps (up and down, full frequency range)
+ * With -t, prints trace of edges: time (µs), quarter period (µs), marker
+ * Exit status is 1 if any edge breaks sweep law
+ *
+ * Build: cc -O2 -I.. -o sweep-check sweep-check.c ../sweep.c -lm
+ * Usage: sweep-check [-t] [{lin|log|step} {f1} {f2} {s} [{n}]]
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sweep.h"
+
+// as firmware (see speed-sensor.h)
+#define MIN_FREQUENCY 0.1
+#define MAX_FREQUENCY 7300.0
+// edges checked after sweep is over
+#define HELD_EDGES 100
+#define MAX_REPORTED 5
+
+typedef struct {
+    sweep_mode_e mode;
+    double f1, f2, duration;
+    uint16_t steps_per_decade;
+} sweep_case_t;
+
+static const sweep_case_t default_cases[] = {
+    {e_sweep_log, 0.1, 7300.0, 60.0, 0},
+    {e_sweep_log, 7300.0, 0.1, 60.0, 0},
+    {e_sweep_log, 1.0, 1000.0, 3.0, 0},
+    {e_sweep_linear, 0.1, 7300.0, 60.0, 0},
+    {e_sweep_linear, 5000.0, 20.0, 10.0, 0},
+    {e_sweep_stepped, 0.1, 7300.0, 120.0, 10},
+    {e_sweep_stepped, 2000.0, 3.0, 30.0, 3},
+};
+
+static const char* mode_names[e_nb_sweep_modes] = {"lin", "log", "step"};
+
+static int trace = 0;
+
+static uint32_t get_nb_steps(const sweep_case_t* p_case) {
+    // as sweep_init
+    const uint32_t nb_steps = (uint32_t)ceil(fabs(log10(p_case->f2 / p_case->f1)) * p_case->steps_per_decade);
+    return nb_steps == 0 ? 1 : nb_steps;
+}
+
+// law frequency at t (µs), given step (stepped sweep)
+static double get_law_frequency(const sweep_case_t* p_case, double t, int64_t step) {
+    const double x = t / (p_case->duration * 1e6);
+    switch(p_case->mode) {
+        case e_sweep_linear:
+            return x >= 1.0 ? p_case->f2 : p_case->f1 + (p_case->f2 - p_case->f1) * x;
+        case e_sweep_log:
+            return x >= 1.0 ? p_case->f2 : p_case->f1 * pow(p_case->f2 / p_case->f1, x);
+        default:
+            return p_case->f1 * pow(p_case->f2 / p_case->f1, (double)step / get_nb_steps(p_case));
+    }
+}
+
+// frequency is past decade, in sweep direction
+static int is_past(const sweep_case_t* p_case, double f, double decade) {
+    return p_case->f2 > p_case->f1 ? f >= decade * (1 - 1e-9) : f <= decade * (1 + 1e-9);
+}
+
+// out: number of failed checks
+static uint32_t check_sweep(const sweep_case_t* p_case) {
+    const uint32_t nb_steps = get_nb_steps(p_case);
+    const double dwell = p_case->duration * 1e6 / (nb_steps + 1);
+    sweep_t sweep;
+    uint64_t t = 0, t_done = 0;
+    uint32_t period, last_period, nb_edges = 0, held = 0, errors = 0, period_errors = 0, marker_errors = 0;
+    uint32_t nb_markers = 0, nb_expected_markers = 0;
+    int64_t step, steps[3];
+    uint32_t nb_law_markers = 0;
+    int nb_candidates, i;
+    double done_tolerance = 0.0, law_period, error, tolerance, max_error = 0.0, decade, expected_decade, duration_error;
+
+    sweep_init(&sweep, p_case->mode, p_case->f1, p_case->f2, p_case->duration, p_case->steps_per_decade);
+    expected_decade = p_case->f2 > p_case->f1 ? pow(10.0, floor(log10(p_case->f1)) + 1)
+                                              : pow(10.0, ceil(log10(p_case->f1)) - 1);
+    decade = expected_decade;
+    period = sweep_get_first_period(&sweep);
+    while(held < HELD_EDGES) {
+        // steps edge may belong to, when it starts on a step boundary
+        // (dwell time is whole µs)
+        nb_candidates = 1;
+        steps[0] = 0;
+        if(p_case->mode == e_sweep_stepped) {
+            step = (int64_t)floor(t / dwell);
+            steps[0] = step;
+            if(t - step * dwell < nb_steps + 2 && step > 0) {
+                steps[nb_candidates++] = step - 1;
+            }
+            if((step + 1) * dwell - t < nb_steps + 2) {
+                steps[nb_candidates++] = step + 1;
+            }
+            for(i = 0; i < nb_candidates; i++) {
+                if(steps[i] > (int64_t)nb_steps) {
+                    steps[i] = nb_steps;
+                }
+            }
+        }
+        error = INFINITY;
+        for(i = 0; i < nb_candidates; i++) {
+            law_period = 250000.0 / get_law_frequency(p_case, t, steps[i]);
+            if(fabs(period - law_period) < fabs(error)) {
+                error = period - law_period;
+            }
+        }
+        // whole µs, and interpolation of 2^x (relative error below 1e-6)
+        tolerance = 1.0 + 3e-6 * law_period;
+        if(fabs(error) > fabs(max_error)) {
+            max_error = error;
+        }
+        if(fabs(error) > tolerance && ++period_errors <= MAX_REPORTED) {
+            printf("  edge %" PRIu32 " at %" PRIu64 " us: %" PRIu32 " us, law %.2f us\n",
+                   nb_edges, t, period, law_period);
+        }
+        if(trace) {
+            printf("%" PRIu64 ",%" PRIu32 ",%d\n", t, period, sweep.marker_edge);
+        }
+        t += period;
+        nb_edges++;
+        if(sweep.done) {
+            held++;
+        }
+        last_period = period;
+        period = sweep_next_edge(&sweep, period);
+        if(sweep.done && t_done == 0) {
+            t_done = t;
+            // edge in progress at requested duration
+            done_tolerance = last_period + 1e-5 * p_case->duration * 1e6 + 2;
+        }
+        // law marker: decade passed at edge start, at most one per edge
+        if(p_case->mode != e_sweep_stepped && is_past(p_case, p_case->f2, expected_decade) &&
+           is_past(p_case, get_law_frequency(p_case, t, 0), expected_decade)) {
+            nb_law_markers++;
+            expected_decade = p_case->f2 > p_case->f1 ? expected_decade * 10 : expected_decade / 10;
+        }
+        if(sweep.marker_edge) {
+            nb_markers++;
+            // marked edge is past decade (within 1 µs), continuous sweeps: on law marker edge
+            // (or next one, law frequency being rounded)
+            if(!is_past(p_case, 250000.0 / (p_case->f2 > p_case->f1 ? period - 1 : period + 1), decade) ||
+               (p_case->mode != e_sweep_stepped && nb_law_markers != nb_markers && nb_law_markers + 1 != nb_markers)) {
+                if(++marker_errors <= MAX_REPORTED) {
+                    printf("  marker of %g Hz at %" PRIu64 " us on a %.3f Hz edge\n", decade, t, 250000.0 / period);
+                }
+            }
+            decade = p_case->f2 > p_case->f1 ? decade * 10 : decade / 10;
+        }
+    }
+    for(decade = p_case->f2 > p_case->f1 ? pow(10.0, floor(log10(p_case->f1)) + 1)
+                                         : pow(10.0, ceil(log10(p_case->f1)) - 1);
+        is_past(p_case, p_case->f2, decade);
+        decade = p_case->f2 > p_case->f1 ? decade * 10 : decade / 10) {
+        nb_expected_markers++;
+    }
+    if(nb_markers != nb_expected_markers) {
+        printf("  %" PRIu32 " markers, %" PRIu32 " decades crossed\n", nb_markers, nb_expected_markers);
+        marker_errors++;
+    }
+    // over on first edge from requested duration on
+    duration_error = (double)t_done - p_case->duration * 1e6;
+    if(duration_error < -(1e-5 * p_case->duration * 1e6 + nb_steps + 2) ||
+       duration_error > done_tolerance) {
+        printf("  over at %" PRIu64 " us\n", t_done);
+        errors++;
+    }
+    printf("%s %g Hz to %g Hz in %g s", mode_names[p_case->mode], p_case->f1, p_case->f2, p_case->duration);
+    if(p_case->mode == e_sweep_stepped) {
+        printf(" (%hu steps per decade)", p_case->steps_per_decade);
+    }
+    printf(": %" PRIu32 " edges, period error up to %.3f us, over %+.0f us from duration, %" PRIu32 " markers: %s\n",
+           nb_edges, max_error, duration_error, nb_markers,
+           errors + period_errors + marker_errors == 0 ? "ok" : "FAILED");
+    return errors + period_errors + marker_errors;
+}
+
+int main(int argc, char* argv[]) {
+    sweep_case_t sweep_case;
+    uint32_t i, nb_failed = 0;
+    int argi = 1;
+
+    if(argi < argc && strcmp(argv[argi], "-t") == 0) {
+        trace = 1;
+        argi++;
+    }
+    if(argi == argc) {
+        for(i = 0; i < sizeof(default_cases) / sizeof(default_cases[0]); i++) {
+            if(check_sweep(&default_cases[i]) != 0) {
+                nb_failed++;
+            }
+        }
+        return nb_failed != 0;
+    }
+    if(argc - argi < 4 || argc - argi > 5) {
+        fprintf(stderr, "Usage: sweep-check [-t] [{lin|log|step} {f1} {f2} {s} [{n}]]\n");
+        return 2;
+    }
+    for(i = 0; i < e_nb_sweep_modes && strcmp(argv[argi], mode_names[i]) != 0; i++);
+    sweep_case.mode = i;
+    sweep_case.f1 = atof(argv[argi + 1]);
+    sweep_case.f2 = atof(argv[argi + 2]);
+    sweep_case.duration = atof(argv[argi + 3]);
+    sweep_case.steps_per_decade = argc - argi == 5 ? atoi(argv[argi + 4]) : SWEEP_DEFAULT_STEPS_PER_DECADE;
+    if(i == e_nb_sweep_modes || sweep_case.f1 < MIN_FREQUENCY || sweep_case.f1 > MAX_FREQUENCY ||
+       sweep_case.f2 < MIN_FREQUENCY || sweep_case.f2 > MAX_FREQUENCY || sweep_case.f1 == sweep_case.f2 ||
+       sweep_case.duration < SWEEP_MIN_DURATION || sweep_case.duration > SWEEP_MAX_DURATION ||
+       sweep_case.steps_per_decade < 1 || sweep_case.steps_per_decade > SWEEP_MAX_STEPS_PER_DECADE) {
+        fprintf(stderr, "sweep out of range\n");
+        return 2;
+    }
+    return check_sweep(&sweep_case) != 0;
+}
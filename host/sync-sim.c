@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Runs several boards with skewed crystals, one leader and followers
+ * disciplined by the software PLL of the firmware (sync-pll.c), and measures
+ * inter-board skew: spread of times at which boards fire each scheduler tick
+ *
+ * Each board free runs on its own clock (random offset up to +/- {ppm}, slowly
+ * wandering like a crystal warming up) and starts at a random phase. Leader sync
+ * pulses reach followers after a fixed delay, time stamped with random interrupt
+ * latency, and are fed to PLL with sync frame once received
+ * Skew is checked after a settling time, and compared with free running boards
+ * Exit status is 1 if skew exceeds bound, or if a follower did not lock
+ *
+ * Build: cc -O2 -I.. -o sync-sim sync-sim.c ../sync-pll.c -lm
+ * Usage: sync-sim [-b {boards}] [-d {duration_s}] [-p {ppm}] [-s {seed}]
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sync-pll.h"
+
+#define MAX_BOARDS 16
+// as firmware: a sync pulse every second (see sync.h)
+#define SYNC_PERIOD_TICKS 10
+#define LINK_DELAY_US 0.5
+#define MAX_IRQ_LATENCY_US 3.0
+// sync frame received after pulse (UART frame)
+#define FRAME_DELAY_US 1000.0
+#define SETTLING_S 60.0
+#define WANDER_PPM_PER_S 0.02
+#define MAX_SKEW_US 50.0
+
+typedef struct {
+    double ppm;
+    double offset_us; // local clock at global time 0
+    double rate;
+    sync_pll_t pll;
+    double next_tick_time; // global µs
+    // pulse to feed once frame is received
+    int feed_pending;
+    double feed_time; // global µs
+    uint64_t pulse_time; // local µs
+    uint32_t pulse_tick;
+    double* tick_times; // global µs, by tick number
+} board_t;
+
+static double uniform(double min, double max) {
+    return min + (max - min) * rand() / RAND_MAX;
+}
+
+// local clock of board at global time (µs)
+static uint64_t get_local_time(const board_t* p_board, double global_us) {
+    return (uint64_t)floor(p_board->offset_us + p_board->rate * global_us);
+}
+
+// global time of next tick of board (alarm fires at whole local µs)
+static void schedule_next_tick(board_t* p_board) {
+    p_board->next_tick_time = ((double)(p_board->pll.next_time >> 16) - p_board->offset_us) / p_board->rate;
+}
+
+int main(int argc, char* argv[]) {
+    static board_t boards[MAX_BOARDS];
+    int nb_boards = 4, argi = 1, b, next_b, locked;
+    double duration_s = 3600.0, max_ppm = 50.0, now = 0.0, t, min_t, max_t;
+    double skew, max_skew = 0.0, sum_square_skew = 0.0, min_ppm, max_ppm_seen;
+    uint32_t nb_ticks, tick, first_tick, nb_skews = 0;
+    board_t* p;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-b") == 0) {
+            nb_boards = atoi(argv[argi + 1]);
+        } else if(strcmp(argv[argi], "-d") == 0) {
+            duration_s = atof(argv[argi + 1]);
+        } else if(strcmp(argv[argi], "-p") == 0) {
+            max_ppm = atof(argv[argi + 1]);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+    if(nb_boards < 2 || nb_boards > MAX_BOARDS) {
+        fprintf(stderr, "2 to %d boards\n", MAX_BOARDS);
+        return 1;
+    }
+    nb_ticks = (uint32_t)(duration_s * 1e6 / SYNC_PLL_NOMINAL_PERIOD_US) + 2 * SYNC_PERIOD_TICKS;
+
+    for(b = 0; b < nb_boards; b++) {
+        p = &boards[b];
+        p->ppm = uniform(-max_ppm, max_ppm);
+        p->rate = 1.0 + p->ppm * 1e-6;
+        p->offset_us = uniform(0.0, 1e9);
+        // boards powered up at random phases, within the first tick
+        sync_pll_init(&p->pll, get_local_time(p, uniform(0.0, SYNC_PLL_NOMINAL_PERIOD_US)));
+        schedule_next_tick(p);
+        p->tick_times = calloc(nb_ticks, sizeof(double));
+    }
+
+    // events in time order: next tick of a board, or sync frame received by a follower
+    while(now < duration_s * 1e6) {
+        next_b = 0;
+        for(b = 1; b < nb_boards; b++) {
+            if(boards[b].next_tick_time < boards[next_b].next_tick_time) {
+                next_b = b;
+            }
+        }
+        for(b = 1; b < nb_boards; b++) {
+            p = &boards[b];
+            if(p->feed_pending && p->feed_time < boards[next_b].next_tick_time) {
+                now = p->feed_time;
+                sync_pll_feed(&p->pll, p->pulse_time, p->pulse_tick);
+                p->feed_pending = 0;
+            }
+        }
+        p = &boards[next_b];
+        now = p->next_tick_time;
+        sync_pll_tick(&p->pll);
+        tick = sync_pll_get_tick(&p->pll);
+        if(tick < nb_ticks) {
+            p->tick_times[tick] = now;
+        }
+        // crystals wander, local clock is continuous
+        t = p->offset_us + p->rate * now;
+        p->ppm += uniform(-1.0, 1.0) * WANDER_PPM_PER_S * sqrt(3.0 * SYNC_PLL_NOMINAL_PERIOD_US * 1e-6);
+        p->rate = 1.0 + p->ppm * 1e-6;
+        p->offset_us = t - p->rate * now;
+        schedule_next_tick(p);
+        if(next_b == 0 && tick % SYNC_PERIOD_TICKS == 0) {
+            for(b = 1; b < nb_boards; b++) {
+                t = now + LINK_DELAY_US + uniform(0.0, MAX_IRQ_LATENCY_US);
+                boards[b].pulse_time = get_local_time(&boards[b], t);
+                boards[b].pulse_tick = tick;
+                boards[b].feed_time = t + FRAME_DELAY_US;
+                boards[b].feed_pending = 1;
+            }
+        }
+    }
+
+    // skew of each tick fired by all boards once settled
+    first_tick = (uint32_t)(SETTLING_S * 1e6 / SYNC_PLL_NOMINAL_PERIOD_US);
+    for(tick = first_tick; tick < nb_ticks; tick++) {
+        min_t = max_t = boards[0].tick_times[tick];
+        for(b = 1; b < nb_boards; b++) {
+            t = boards[b].tick_times[tick];
+            min_t = fmin(min_t, t);
+            max_t = fmax(max_t, t);
+        }
+        if(min_t == 0.0) { // not fired by all boards before end
+            continue;
+        }
+        skew = max_t - min_t;
+        max_skew = fmax(max_skew, skew);
+        sum_square_skew += skew * skew;
+        nb_skews++;
+    }
+
+    locked = 1;
+    min_ppm = max_ppm_seen = boards[0].ppm;
+    for(b = 0; b < nb_boards; b++) {
+        p = &boards[b];
+        min_ppm = fmin(min_ppm, p->ppm);
+        max_ppm_seen = fmax(max_ppm_seen, p->ppm);
+        if(b == 0) {
+            printf("board 0 (leader): %+.2f ppm\n", p->ppm);
+            continue;
+        }
+        printf("board %d: %+.2f ppm, %slocked, leader at %+" PRId32 " ppm (actual %+.2f), "
+               "phase error last %" PRId32 " us, max %" PRId32 " us, rms %" PRIu32 " us, %" PRIu32 " acquisition(s)\n",
+               b, p->ppm, sync_pll_is_locked(&p->pll) ? "" : "not ",
+               sync_pll_get_ppm(&p->pll), (boards[0].ppm - p->ppm) / (1.0 + p->ppm * 1e-6),
+               p->pll.last_error, p->pll.max_error, sync_pll_get_rms_error(&p->pll), p->pll.nb_acquisitions);
+        locked &= sync_pll_is_locked(&p->pll);
+    }
+    printf("%.0f s, %d boards: inter-board skew max %.1f us, rms %.1f us over %" PRIu32 " ticks\n",
+           duration_s, nb_boards, max_skew, nb_skews ? sqrt(sum_square_skew / nb_skews) : 0.0, nb_skews);
+    printf("free running boards would drift apart by up to %.0f us\n", (max_ppm_seen - min_ppm) * duration_s);
+    for(b = 0; b < nb_boards; b++) {
+        free(boards[b].tick_times);
+    }
+    if(!locked || nb_skews == 0 || max_skew > MAX_SKEW_US) {
+        fprintf(stderr, "skew over %.0f us or follower not locked\n", MAX_SKEW_US);
+        return 1;
+    }
+    return 0;
+}
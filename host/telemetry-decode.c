@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Host decoder of speed sensor simulator binary telemetry
+ * Reads raw bytes captured from the USB serial link (file or stdin)
+ * and writes one CSV line per valid frame on stdout
+ *
+ * When a speed definition is given, edge counts are also converted to distances
+ *
+ * Build: cc -O2 -I.. -o telemetry-decode telemetry-decode.c
+ * Usage: telemetry-decode [capture_file [n_teeth dia_mm [ratio]]] > telemetry.csv
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+static double period_to_frequency(uint32_t period) {
+    return period == 0 ? 0.0 : (1000000.0 / 4.0) / period;
+}
+
+#define PI 3.141592653589793
+
+// meters per edge, 0 if no speed definition
+static double edge_length = 0.0;
+
+static int is_frame_valid(const telemetry_frame_t* p_frame) {
+    const uint8_t* p_byte = (const uint8_t*)p_frame;
+    uint8_t sum = 0;
+    size_t i;
+    if(p_frame->version != TELEMETRY_VERSION) {
+        return 0;
+    }
+    for(i = 0; i < sizeof(telemetry_frame_t); i++) {
+        sum += p_byte[i];
+    }
+    return sum == 0;
+}
+
+int main(int argc, char* argv[]) {
+    FILE* in = stdin;
+    uint8_t window[sizeof(telemetry_frame_t)];
+    size_t filled = 0;
+    int ch;
+    telemetry_frame_t frame;
+    uint64_t time_high = 0;
+    uint32_t last_timestamp = 0;
+    unsigned expected_sequence = 0;
+    unsigned long nb_frames = 0, nb_lost = 0, nb_skipped_bytes = 0;
+
+    if(argc > 1 && strcmp(argv[1], "-") != 0 && (in = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    if(argc > 3) {
+        const double ratio = argc > 4 ? atof(argv[4]) : 1.0;
+        // one sensor cycle (four edges) per tooth
+        edge_length = PI * atof(argv[3]) / 1000.0 / (4.0 * atof(argv[2]) * ratio);
+    }
+    printf("timestamp_us,sequence,period1_us,frequency1_hz,reverse1,edges1,"
+           "period2_us,frequency2_hz,reverse2,edges2,core1_load_percent,core0_load_percent,lost_frames%s\n",
+           edge_length != 0.0 ? ",distance1_m,distance2_m" : "");
+    while((ch = fgetc(in)) != EOF) {
+        window[filled++] = (uint8_t)ch;
+        // resync on sync bytes: anything else is console text
+        if(window[0] != TELEMETRY_SYNC1 || (filled > 1 && window[1] != TELEMETRY_SYNC2)) {
+            memmove(window, window + 1, --filled);
+            nb_skipped_bytes++;
+            continue;
+        }
+        if(filled < sizeof(window)) {
+            continue;
+        }
+        memcpy(&frame, window, sizeof(frame));
+        if(!is_frame_valid(&frame)) {
+            memmove(window, window + 1, --filled);
+            nb_skipped_bytes++;
+            continue;
+        }
+        filled = 0;
+        if(nb_frames != 0 && frame.timestamp_us < last_timestamp) {
+            time_high += 1ULL << 32; // 32-bit µs counter wrapped
+        }
+        last_timestamp = frame.timestamp_us;
+        unsigned lost = nb_frames == 0 ? 0 : (uint8_t)(frame.sequence - expected_sequence);
+        expected_sequence = (uint8_t)(frame.sequence + 1);
+        nb_lost += lost;
+        nb_frames++;
+        printf("%llu,%u,%u,%.4f,%d,%" PRId64 ",%u,%.4f,%d,%" PRId64 ",%.2f,%.2f,%u",
+               (unsigned long long)(time_high + frame.timestamp_us), frame.sequence,
+               frame.period1, period_to_frequency(frame.period1),
+               (frame.flags & TELEMETRY_FLAG_REVERSE1) != 0, frame.edges1,
+               frame.period2, period_to_frequency(frame.period2),
+               (frame.flags & TELEMETRY_FLAG_REVERSE2) != 0, frame.edges2,
+               frame.isr_load / 100.0, frame.core0_isr_load / 100.0, lost);
+        if(edge_length != 0.0) {
+            printf(",%.3f,%.3f", frame.edges1 * edge_length, frame.edges2 * edge_length);
+        }
+        printf("\n");
+    }
+    fprintf(stderr, "%lu frame(s) decoded, %lu lost, %lu byte(s) of text skipped\n",
+            nb_frames, nb_lost, nb_skipped_bytes);
+    if(in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}
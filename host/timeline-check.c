@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks per-channel sequence timelines of the firmware (timeline.c)
+ *
+ * Timelines with mismatched step lengths (built-in pair of sensors, then random
+ * runs of up to MAX_CHANNELS channels, once or in loop) are played tick by tick
+ * through the event queue like the firmware does, and every channel is compared
+ * on every tick with its own timeline played alone. Checks:
+ *  - value and direction of each channel follow its own steps only, whatever
+ *    step boundaries of other channels (no drift, no lockstep)
+ *  - event queue stays a heap, holds at most one event per channel and processes
+ *    exactly one event per step started (plus one per timeline over)
+ *  - skip ends steps in progress on all channels at once
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -o timeline-check timeline-check.c ../timeline.c
+ * Usage: timeline-check [-n {runs}] [-s {seed}]
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timeline.h"
+
+#define MAX_CHANNELS 64
+#define MAX_STEPS 12
+#define MAX_TICKS 40
+#define MAX_VALUE 300
+#define RUN_TICKS 2000
+
+static timeline_channel_t channels[MAX_CHANNELS];
+static timeline_event_t events[MAX_CHANNELS];
+static timelines_t timelines;
+
+static unsigned long nb_errors = 0;
+
+static void error(const char* message, unsigned long run, uint32_t tick, uint8_t channel) {
+    fprintf(stderr, "run %lu, tick %" PRIu32 ", channel %hu: %s\n", run, tick, channel, message);
+    nb_errors++;
+}
+
+// value and direction of a channel on tick, played alone from start values
+// out: number of steps started up to tick
+static uint32_t get_expected(const timeline_channel_t* p_channel, bool loop, uint32_t tick,
+                             float start_value, bool start_reverse, float* p_value, bool* p_reverse) {
+    const timeline_step_t* p_step;
+    uint32_t time = 0, duration = 0, nb_started = 0;
+    uint16_t i;
+    float value = start_value;
+    *p_reverse = start_reverse;
+    for(i = 0; i < p_channel->count; i++) {
+        duration += p_channel->steps[i].ticks;
+    }
+    loop = loop && duration != 0;
+    for(i = 0; p_channel->count != 0; ) {
+        p_step = &p_channel->steps[i];
+        nb_started++;
+        *p_reverse = p_step->reverse;
+        if(tick < time + p_step->ticks) {
+            *p_value = value + (p_step->value - value) * (tick - time) / p_step->ticks;
+            return nb_started;
+        }
+        value = p_step->value;
+        time += p_step->ticks;
+        if(++i == p_channel->count) {
+            if(!loop) {
+                break;
+            }
+            i = 0;
+        }
+    }
+    *p_value = value;
+    return nb_started;
+}
+
+static void make_timeline(uint8_t channel, uint32_t max_ticks) {
+    const uint16_t count = rand() % (MAX_STEPS + 1);
+    uint16_t i;
+    timeline_clear(&timelines, channel);
+    for(i = 0; i < count; i++) {
+        // some steps last no tick (values applied at once)
+        timeline_append(&timelines, channel, (float)(rand() % (MAX_VALUE * 100)) / 100,
+                        rand() % 4 == 0, rand() % 8 == 0 ? 0 : 1 + rand() % max_ticks);
+    }
+}
+
+static int is_heap() {
+    uint8_t i;
+    const timeline_event_t* p_parent;
+    const timeline_event_t* p_child;
+    for(i = 1; i < timelines.nb_events; i++) {
+        p_parent = &timelines.events[(i - 1) / 2];
+        p_child = &timelines.events[i];
+        if((int32_t)(p_child->deadline - p_parent->deadline) < 0 ||
+           (p_child->deadline == p_parent->deadline && p_child->channel < p_parent->channel)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// plays timelines from tick 0, skipping steps on skip_tick (none if 0)
+// and checks each channel on each tick against its own timeline
+static void play(unsigned long run, uint8_t nb_channels, bool loop, uint32_t skip_tick) {
+    float start_values[MAX_CHANNELS], value, expected;
+    bool start_reverses[MAX_CHANNELS], expected_reverse, running = true;
+    uint32_t tick, nb_expected_events, nb_started;
+    uint8_t i;
+
+    for(i = 0; i < nb_channels; i++) {
+        start_values[i] = (float)(rand() % MAX_VALUE);
+        start_reverses[i] = rand() % 2;
+    }
+    timeline_start(&timelines, 0, start_values, start_reverses, loop);
+    for(tick = 0; tick < RUN_TICKS && running; tick++) {
+        running = timeline_poll(&timelines, tick);
+        if(!is_heap() || timelines.nb_events > nb_channels) {
+            error("event queue broken", run, tick, 0);
+        }
+        if(tick == skip_tick && skip_tick != 0) {
+            timeline_skip(&timelines, tick);
+            for(i = 0; i < timelines.nb_events; i++) {
+                if(timeline_get_value(&timelines, timelines.events[i].channel, tick) !=
+                   timelines.channels[timelines.events[i].channel].end_value) {
+                    error("skip did not end step", run, tick, timelines.events[i].channel);
+                }
+            }
+            // channels are no longer comparable with their timeline played alone
+            running = timeline_poll(&timelines, tick);
+            continue;
+        }
+        if(skip_tick != 0 && tick > skip_tick) {
+            continue;
+        }
+        nb_expected_events = 0;
+        for(i = 0; i < nb_channels; i++) {
+            value = timeline_get_value(&timelines, i, tick);
+            nb_started = get_expected(&timelines.channels[i], loop, tick, start_values[i], start_reverses[i],
+                                      &expected, &expected_reverse);
+            // one event per step started, one more once over
+            nb_expected_events += nb_started;
+            if(timelines.channels[i].count != 0 && !timelines.channels[i].loop &&
+               nb_started == timelines.channels[i].count &&
+               tick >= timeline_get_duration(&timelines, i)) {
+                nb_expected_events++;
+            }
+            if(fabsf(value - expected) > 1e-3f || timeline_get_reverse(&timelines, i) != expected_reverse) {
+                error("value or direction off its own timeline", run, tick, i);
+            }
+        }
+        if(timelines.nb_processed != nb_expected_events) {
+            error("events processed do not match steps started", run, tick, 0);
+        }
+    }
+    if(!loop && running) {
+        error("timelines not over", run, tick, 0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long run, nb_runs = 2000;
+    uint8_t nb_channels, i;
+    int argi = 1;
+
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            nb_runs = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+
+    // two sensors, step lengths prime to each other: boundaries only meet
+    // on common multiples
+    timeline_init(&timelines, channels, events, 2);
+    timeline_append(&timelines, 0, 80.0f, false, 7);
+    timeline_append(&timelines, 0, 20.0f, false, 13);
+    timeline_append(&timelines, 1, 60.0f, false, 5);
+    timeline_append(&timelines, 1, 0.0f, false, 11);
+    timeline_append(&timelines, 1, 40.0f, true, 3);
+    play(0, 2, false, 0);
+    play(0, 2, true, 0);
+
+    for(run = 1; run <= nb_runs; run++) {
+        nb_channels = 1 + rand() % MAX_CHANNELS;
+        timeline_init(&timelines, channels, events, nb_channels);
+        for(i = 0; i < nb_channels; i++) {
+            make_timeline(i, 1 + rand() % MAX_TICKS);
+        }
+        play(run, nb_channels, rand() % 2, rand() % 4 == 0 ? 1 + rand() % 100 : 0);
+    }
+    fprintf(stderr, "%lu run(s), %lu error(s)\n", nb_runs + 1, nb_errors);
+    return nb_errors != 0;
+}
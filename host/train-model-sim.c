@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Runs the train model of the firmware (train-model.c) faster than real time
+ * through a driving scenario and checks its energy balance:
+ * motor work - brake, resistance and slip losses must match kinetic energy gained
+ *
+ * Scenario lines: "{duration_s},{notch},{brake}[,{adhesion}]", adhesion as a ratio
+ *  (e.g. 0.05 for leaves on rails), lines not starting with a digit are skipped
+ *  a built-in scenario (slips on leaves, then slides when braking) is run otherwise
+ * With -c, a CSV line is written every 100 ms of simulated time
+ * Exit status is 1 if the energy balance is off by more than 0.1 % of motor work
+ *
+ * Build: cc -O2 -I.. -o train-model-sim train-model-sim.c ../train-model.c
+ * Usage: train-model-sim [-c] [scenario_file]
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "train-model.h"
+
+#define MAX_PHASES 64
+#define CSV_PERIOD_TICKS (TRAIN_MODEL_RATE_HZ / 10)
+#define TOLERANCE 0.001
+
+typedef struct {
+    double duration_s;
+    int notch;
+    int brake;
+    double adhesion; // 0: unchanged
+} phase_t;
+
+static const phase_t default_scenario[] = {
+    {60.0, 6, 0, 0.0},
+    {30.0, 8, 0, 0.0}, // power limited: sticks
+    {10.0, 8, 0, 0.05}, // leaves on rails: slips
+    {60.0, 4, 0, 0.33},
+    {30.0, 0, 0, 0.0}, // coasting
+    {20.0, 0, 8, 0.05}, // full brake on leaves: slides
+    {60.0, 0, 8, 0.2}
+};
+
+static double q16_to_double(int64_t value) {
+    return (double)value / 65536.0;
+}
+
+static double fine_to_double(int64_t value) {
+    return (double)value / 4294967296.0;
+}
+
+static double get_kinetic_energy(const train_model_t* p_model) {
+    double energy = 0.5 * p_model->params.mass_kg * fine_to_double(p_model->fine_speed) * fine_to_double(p_model->fine_speed);
+    int i;
+    for(i = 0; i < TRAIN_MODEL_NB_AXLES; i++) {
+        energy += 0.5 * p_model->params.rotating_mass_kg *
+                  fine_to_double(p_model->fine_wheel_speed[i]) * fine_to_double(p_model->fine_wheel_speed[i]);
+    }
+    return energy;
+}
+
+static int read_scenario(FILE* in, phase_t* phases) {
+    char line[256];
+    int nb_phases = 0;
+    phase_t* p;
+    while(nb_phases < MAX_PHASES && fgets(line, sizeof(line), in) != NULL) {
+        if(!isdigit((unsigned char)line[0])) {
+            continue;
+        }
+        p = &phases[nb_phases];
+        p->adhesion = 0.0;
+        if(sscanf(line, "%lf,%d,%d,%lf", &p->duration_s, &p->notch, &p->brake, &p->adhesion) < 3 ||
+           p->notch < 0 || p->notch > TRAIN_MODEL_NB_NOTCHES || p->brake < 0 || p->brake > TRAIN_MODEL_NB_BRAKE_STEPS) {
+            fprintf(stderr, "bad scenario line: %s", line);
+            continue;
+        }
+        nb_phases++;
+    }
+    return nb_phases;
+}
+
+int main(int argc, char* argv[]) {
+    static train_model_t model;
+    phase_t phases[MAX_PHASES];
+    const phase_t* p_phases = default_scenario;
+    int nb_phases = sizeof(default_scenario) / sizeof(default_scenario[0]);
+    int csv = 0, argi = 1, i, axle;
+    uint32_t tick, nb_ticks, slip_ticks = 0;
+    double initial_energy, motor, losses, gained, error, simulated_s = 0.0;
+    clock_t start;
+    FILE* in;
+
+    if(argi < argc && strcmp(argv[argi], "-c") == 0) {
+        csv = 1;
+        argi++;
+    }
+    if(argi < argc) {
+        if((in = fopen(argv[argi], "r")) == NULL) {
+            perror(argv[argi]);
+            return 1;
+        }
+        nb_phases = read_scenario(in, phases);
+        fclose(in);
+        p_phases = phases;
+    }
+
+    train_model_init(&model, &train_default_params);
+    initial_energy = get_kinetic_energy(&model);
+    if(csv) {
+        printf("time_s,notch,brake,adhesion,speed_kmh,wheel1_kmh,wheel2_kmh,slip1,slip2\n");
+    }
+    start = clock();
+    for(i = 0; i < nb_phases; i++) {
+        model.notch = p_phases[i].notch;
+        model.brake = p_phases[i].brake;
+        if(p_phases[i].adhesion > 0.0) {
+            model.peak_adhesion = (int32_t)(p_phases[i].adhesion * TRAIN_MODEL_Q16_ONE);
+        }
+        nb_ticks = (uint32_t)(p_phases[i].duration_s * TRAIN_MODEL_RATE_HZ);
+        for(tick = 0; tick < nb_ticks; tick++) {
+            train_model_step(&model);
+            for(axle = 0; axle < TRAIN_MODEL_NB_AXLES; axle++) {
+                if(model.slip_sign[axle] != 0) {
+                    slip_ticks++;
+                    break;
+                }
+            }
+            if(csv && model.ticks % CSV_PERIOD_TICKS == 0) {
+                printf("%.1f,%u,%u,%.3f,%.3f,%.3f,%.3f,%d,%d\n", (double)model.ticks / TRAIN_MODEL_RATE_HZ,
+                       model.notch, model.brake, q16_to_double(model.peak_adhesion),
+                       3.6 * q16_to_double(model.speed),
+                       3.6 * q16_to_double(model.wheel_speed[0]), 3.6 * q16_to_double(model.wheel_speed[1]),
+                       model.slip_sign[0], model.slip_sign[1]);
+            }
+        }
+        simulated_s += p_phases[i].duration_s;
+    }
+
+    motor = q16_to_double(model.energy.motor);
+    losses = q16_to_double(model.energy.brake + model.energy.resistance + model.energy.slip);
+    gained = get_kinetic_energy(&model) - initial_energy;
+    error = motor - losses - gained;
+    fprintf(stderr, "%.0f s simulated in %.3f s, final speed %.2f km/h, slip or slide during %.1f s\n",
+            simulated_s, (double)(clock() - start) / CLOCKS_PER_SEC,
+            3.6 * q16_to_double(model.speed), (double)slip_ticks / TRAIN_MODEL_RATE_HZ);
+    fprintf(stderr, "energy (kJ): motor %.1f, brake %.1f, resistance %.1f, slip %.1f, kinetic gained %.1f, error %.3f\n",
+            motor / 1000.0, q16_to_double(model.energy.brake) / 1000.0,
+            q16_to_double(model.energy.resistance) / 1000.0, q16_to_double(model.energy.slip) / 1000.0,
+            gained / 1000.0, error / 1000.0);
+    if(error > TOLERANCE * motor || error < -TOLERANCE * motor) {
+        fprintf(stderr, "energy balance off by more than %.1f %% of motor work\n", 100.0 * TOLERANCE);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Feeds trigger input edges to the bounce filter of the firmware (trigger-filter.h)
+ *
+ * Without capture file, simulates {count} triggers at random intervals, each
+ * followed by random contact bounce, with µs timer wrapping around during the run,
+ * and checks every trigger is accepted once, at its first edge
+ * With a capture file (CSV lines "time_s,level" as exported by logic analyzers,
+ * lines not starting with a digit are skipped), prints accepted triggers
+ * Exit status is 1 if simulated triggers are not accepted as expected
+ *
+ * Build: cc -O2 -I.. -o trigger-sim trigger-sim.c
+ * Usage: trigger-sim [-n {count}] [-s {seed}] [capture_file]
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trigger-filter.h"
+
+// bounce lasts less than hold off, triggers are further apart
+#define MAX_BOUNCE_US (TRIGGER_HOLDOFF_US * 3 / 4)
+#define MAX_BOUNCES 8
+#define MIN_INTERVAL_US (TRIGGER_HOLDOFF_US + MAX_BOUNCE_US)
+#define MAX_INTERVAL_US 500000
+
+static int run_capture(FILE* in) {
+    trigger_filter_t filter = {0, false};
+    char line[256];
+    double time_s;
+    int level, last_level = -1;
+    unsigned long nb_edges = 0, nb_triggers = 0;
+    while(fgets(line, sizeof(line), in) != NULL) {
+        if(!isdigit((unsigned char)line[0]) || sscanf(line, "%lf,%d", &time_s, &level) != 2) {
+            continue;
+        }
+        if(last_level == 0 && level != 0) {
+            nb_edges++;
+            if(trigger_filter_feed(&filter, (uint32_t)(uint64_t)(time_s * 1e6))) {
+                nb_triggers++;
+                printf("%.6f\n", time_s);
+            }
+        }
+        last_level = level != 0;
+    }
+    fprintf(stderr, "%lu rising edge(s), %lu trigger(s)\n", nb_edges, nb_triggers);
+    return 0;
+}
+
+static int run_simulation(unsigned long count) {
+    trigger_filter_t filter = {0, false};
+    uint32_t time_us = 0xFFFFFFFFu - 10u * MAX_INTERVAL_US; // wraps around early
+    uint32_t trigger_time, bounce_time;
+    unsigned long i, nb_edges = 0, nb_errors = 0;
+    int j, nb_bounces;
+    for(i = 0; i < count; i++) {
+        time_us += MIN_INTERVAL_US + rand() % (MAX_INTERVAL_US - MIN_INTERVAL_US);
+        trigger_time = time_us;
+        nb_edges++;
+        if(!trigger_filter_feed(&filter, trigger_time)) {
+            fprintf(stderr, "trigger %lu at %" PRIu32 " us rejected\n", i, trigger_time);
+            nb_errors++;
+        }
+        nb_bounces = rand() % (MAX_BOUNCES + 1);
+        bounce_time = trigger_time;
+        for(j = 0; j < nb_bounces; j++) {
+            bounce_time += 1 + rand() % (MAX_BOUNCE_US / MAX_BOUNCES);
+            nb_edges++;
+            if(trigger_filter_feed(&filter, bounce_time)) {
+                fprintf(stderr, "bounce %d of trigger %lu accepted\n", j, i);
+                nb_errors++;
+            }
+        }
+        time_us = bounce_time;
+    }
+    fprintf(stderr, "%lu trigger(s), %lu rising edge(s), %lu error(s)\n", count, nb_edges, nb_errors);
+    return nb_errors != 0;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long count = 10000;
+    int argi = 1;
+    FILE* in;
+    srand(1);
+    while(argi + 1 < argc && argv[argi][0] == '-') {
+        if(strcmp(argv[argi], "-n") == 0) {
+            count = strtoul(argv[argi + 1], NULL, 10);
+        } else if(strcmp(argv[argi], "-s") == 0) {
+            srand(atoi(argv[argi + 1]));
+        } else {
+            break;
+        }
+        argi += 2;
+    }
+    if(argi < argc) {
+        if((in = fopen(argv[argi], "r")) == NULL) {
+            perror(argv[argi]);
+            return 1;
+        }
+        argi = run_capture(in);
+        fclose(in);
+        return argi;
+    }
+    return run_simulation(count);
+}
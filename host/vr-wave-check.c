@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Checks sine of simulated VR sensors (vr-wave.h) on sample traces
+ * of PWM levels, as output by VR backend interrupt
+ *
+ * For frequencies from 10 Hz to MAX_FREQUENCY, fits a sine at known frequency
+ * to the trace and checks:
+ *  - amplitude tracking: fitted amplitude follows frequency (up to full scale)
+ *  - spectral purity: residual of fit (noise and distortion) is close to
+ *    quantization noise of PWM levels, and no harmonic stands out
+ *  - one edge per quarter of sine
+ * With -t, prints trace of given quarter period (µs) as CSV instead
+ * Exit status is 1 if any check fails
+ *
+ * Build: cc -O2 -I.. -o vr-wave-check vr-wave-check.c ../vr-wave.c -lm
+ * Usage: vr-wave-check [-t {max_count}]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vr-wave.h"
+
+#define PI 3.14159265358979323846
+// quarter periods (µs) checked: 7353 Hz (close to MAX_FREQUENCY) down to 10 Hz
+static const uint32_t max_counts[] = {34, 50, 100, 250, 400, 1000, 2500, 25000};
+#define NB_PERIODS 16
+#define MIN_SAMPLES 65536
+#define NB_HARMONICS 9
+// amplitude tracking (PWM levels), residual over quantization noise, harmonic level
+#define MAX_AMPLITUDE_ERROR 1.0
+#define MAX_RESIDUAL_RATIO 1.5
+#define MAX_HARMONIC_DBC -50.0
+
+typedef struct {
+    double* levels;
+    uint32_t nb_samples;
+    uint32_t nb_edges;
+    double omega; // radians per sample
+} trace_t;
+
+// samples as VR backend interrupt computes them
+static void make_trace(trace_t* p_trace, uint32_t max_count, int reverse) {
+    uint32_t step = vr_wave_get_phase_step(max_count);
+    const int32_t amplitude = vr_wave_get_amplitude(max_count);
+    uint32_t i, phase = 0, previous_phase;
+    if(reverse) {
+        step = -step;
+    }
+    p_trace->omega = 2.0 * PI * (double)vr_wave_get_phase_step(max_count) / 4294967296.0;
+    p_trace->nb_samples = NB_PERIODS * max_count < MIN_SAMPLES ? MIN_SAMPLES : NB_PERIODS * max_count;
+    p_trace->levels = malloc(p_trace->nb_samples * sizeof(double));
+    p_trace->nb_edges = 0;
+    for(i = 0; i < p_trace->nb_samples; i++) {
+        previous_phase = phase;
+        phase += step;
+        p_trace->levels[i] = vr_wave_get_level(phase, amplitude);
+        if((phase ^ previous_phase) & 0xC0000000u) {
+            p_trace->nb_edges++;
+        }
+    }
+}
+
+// least squares fit of a.sin + b.cos + c at known frequency
+// out: amplitude, and rms of residual
+static void fit_sine(const trace_t* p_trace, double* p_amplitude, double* p_residual) {
+    double ss = 0, sc = 0, s1 = 0, cc = 0, c1 = 0, n = p_trace->nb_samples;
+    double ys = 0, yc = 0, y1 = 0, det, a, b, c, s, co, r, rr = 0;
+    uint32_t i;
+    for(i = 0; i < p_trace->nb_samples; i++) {
+        s = sin(p_trace->omega * i);
+        co = cos(p_trace->omega * i);
+        ss += s * s; sc += s * co; s1 += s; cc += co * co; c1 += co;
+        ys += p_trace->levels[i] * s; yc += p_trace->levels[i] * co; y1 += p_trace->levels[i];
+    }
+    // Cramer's rule on normal equations
+    det = ss * (cc * n - c1 * c1) - sc * (sc * n - c1 * s1) + s1 * (sc * c1 - cc * s1);
+    a = (ys * (cc * n - c1 * c1) - sc * (yc * n - c1 * y1) + s1 * (yc * c1 - cc * y1)) / det;
+    b = (ss * (yc * n - c1 * y1) - ys * (sc * n - c1 * s1) + s1 * (sc * y1 - yc * s1)) / det;
+    c = (ss * (cc * y1 - c1 * yc) - sc * (sc * y1 - c1 * ys) + s1 * (sc * yc - cc * ys)) / det;
+    for(i = 0; i < p_trace->nb_samples; i++) {
+        r = p_trace->levels[i] - (a * sin(p_trace->omega * i) + b * cos(p_trace->omega * i) + c);
+        rr += r * r;
+    }
+    *p_amplitude = sqrt(a * a + b * b);
+    *p_residual = sqrt(rr / n);
+}
+
+// amplitude of component at omega (Hann window)
+static double get_component(const trace_t* p_trace, double omega) {
+    double re = 0, im = 0, w, sum_w = 0;
+    uint32_t i;
+    for(i = 0; i < p_trace->nb_samples; i++) {
+        w = 0.5 - 0.5 * cos(2.0 * PI * i / p_trace->nb_samples);
+        re += w * p_trace->levels[i] * cos(omega * i);
+        im += w * p_trace->levels[i] * sin(omega * i);
+        sum_w += w;
+    }
+    return 2.0 * sqrt(re * re + im * im) / sum_w;
+}
+
+// worst harmonic below Nyquist frequency, in dB relative to fundamental
+static double get_worst_harmonic(const trace_t* p_trace) {
+    const double fundamental = get_component(p_trace, p_trace->omega);
+    double worst = 0.0, h;
+    int k;
+    for(k = 2; k <= NB_HARMONICS && k * p_trace->omega < PI; k++) {
+        h = get_component(p_trace, k * p_trace->omega);
+        if(h > worst) {
+            worst = h;
+        }
+    }
+    return worst == 0.0 ? -200.0 : 20.0 * log10(worst / fundamental);
+}
+
+static int check(uint32_t max_count, int reverse) {
+    const double frequency = 1e6 / (4.0 * max_count);
+    // ideal VR pickup: amplitude proportional to frequency, clamped
+    const double expected = (VR_WAVE_MID_LEVEL - 1) * fmin(1.0, frequency / VR_WAVE_FULL_SCALE_HZ);
+    // uniform rounding to PWM levels
+    const double quantization = 1.0 / sqrt(12.0);
+    double amplitude, residual, sinad, harmonic;
+    uint32_t expected_edges;
+    trace_t trace;
+    int errors = 0;
+
+    make_trace(&trace, max_count, reverse);
+    fit_sine(&trace, &amplitude, &residual);
+    harmonic = get_worst_harmonic(&trace);
+    sinad = 20.0 * log10(amplitude / sqrt(2.0) / residual);
+    expected_edges = (uint32_t)((double)trace.nb_samples * 4 / max_count);
+    printf("%7.1f Hz%s: amplitude %6.2f (expected %6.2f), residual %.3f, SINAD %.1f dB, worst harmonic %.1f dBc, %u edges\n",
+           frequency, reverse ? " rev" : "    ", amplitude, expected, residual, sinad, harmonic, trace.nb_edges);
+    if(fabs(amplitude - expected) > MAX_AMPLITUDE_ERROR) {
+        printf("  amplitude does not track frequency\n");
+        errors++;
+    }
+    if(residual > MAX_RESIDUAL_RATIO * quantization) {
+        printf("  residual over %.1f times quantization noise\n", MAX_RESIDUAL_RATIO);
+        errors++;
+    }
+    // relative to full scale so that quantization of small amplitudes is not held against them
+    if(harmonic + 20.0 * log10(amplitude / (VR_WAVE_MID_LEVEL - 1)) > MAX_HARMONIC_DBC) {
+        printf("  harmonic over %.0f dB of full scale\n", MAX_HARMONIC_DBC);
+        errors++;
+    }
+    if(trace.nb_edges + 1 < expected_edges || trace.nb_edges > expected_edges + 1) {
+        printf("  %u edges expected\n", expected_edges);
+        errors++;
+    }
+    free(trace.levels);
+    return errors;
+}
+
+int main(int argc, char* argv[]) {
+    trace_t trace;
+    uint32_t i;
+    int errors = 0;
+
+    vr_wave_init();
+    if(argc == 3 && strcmp(argv[1], "-t") == 0) {
+        make_trace(&trace, strtoul(argv[2], NULL, 10), 0);
+        printf("sample,level\n");
+        for(i = 0; i < trace.nb_samples; i++) {
+            printf("%u,%.0f\n", i, trace.levels[i]);
+        }
+        free(trace.levels);
+        return 0;
+    }
+    for(i = 0; i < sizeof(max_counts) / sizeof(max_counts[0]); i++) {
+        errors += check(max_counts[i], 0);
+    }
+    errors += check(max_counts[0], 1);
+    fprintf(stderr, "%d error(s)\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Event journal surviving soft resets
+ */
+
+#include "journal.h"
+
+#include <stdio.h>
+
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include "speed-sensor-util.h"
+
+// "JRN" and layout version: anything else in RAM (power on) clears journal
+#define JOURNAL_MAGIC 0x4A524E02
+
+#if e_nb_journal_events > JOURNAL_TYPE_MASK + 1
+#error "journal events do not fit in JOURNAL_TYPE_BITS"
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t ring_size; // layout of a previous firmware is not kept either
+    uint32_t boot;
+    // records reserved by each core since cleared, record of index i
+    // is records[core][i % JOURNAL_RING_SIZE]
+    volatile uint32_t reserved[2];
+    journal_record_t records[2][JOURNAL_RING_SIZE];
+} journal_t;
+
+// not cleared by C runtime at boot
+static journal_t __uninitialized_ram(journal);
+
+static const char* const event_names[e_nb_journal_events] = {
+    "boot", "command", "live command", "^C", "step", "sent", "applied", "trigger", "target", "underrun"
+};
+
+static const char* const underrun_names[] = {"core1 mailbox full", "trigger mailbox full", "telemetry frame dropped"};
+
+void journal_clear() {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    journal.boot = 0;
+    journal.reserved[0] = journal.reserved[1] = 0;
+    journal.ring_size = JOURNAL_RING_SIZE;
+    journal.magic = JOURNAL_MAGIC;
+    restore_interrupts(interrupts);
+}
+
+void journal_init() {
+    if(journal.magic == JOURNAL_MAGIC && journal.ring_size == JOURNAL_RING_SIZE) {
+        journal.boot++;
+    } else {
+        journal_clear();
+    }
+    journal_log(e_journal_boot, 0, journal.boot);
+}
+
+// type of record of index, with its lap
+static uint8_t get_record_type(journal_event_e event, uint32_t index) {
+    return event | (index / JOURNAL_RING_SIZE) << JOURNAL_TYPE_BITS;
+}
+
+void __not_in_flash_func(journal_log)(journal_event_e event, uint16_t info, uint32_t value) {
+    const uint core = get_core_num();
+    journal_record_t* p_record;
+    uint32_t index, timestamp_us;
+    // reservation: a preempting writer gets the next record
+    const uint32_t interrupts = save_and_disable_interrupts();
+    index = journal.reserved[core]++;
+    timestamp_us = time_us_32();
+    restore_interrupts(interrupts);
+    p_record = &journal.records[core][index & (JOURNAL_RING_SIZE - 1)];
+    p_record->timestamp_us = timestamp_us;
+    p_record->boot = (uint8_t)journal.boot;
+    p_record->info = info;
+    p_record->value = value;
+    // record is complete before readers see its type
+    __dmb();
+    p_record->type = get_record_type(event, index);
+}
+
+uint32_t journal_pack_text(const char* str) {
+    uint32_t value = 0;
+    uint8_t i;
+    for(i = 0; i < 4 && str[i] != '\0'; i++) {
+        value |= (uint32_t)(uint8_t)str[i] << (8 * i);
+    }
+    return value;
+}
+
+// copies record of index from ring of core, type without its lap
+// out: false if it is not written yet, or may have been overwritten meanwhile
+static bool read_record(uint8_t core, uint32_t index, journal_record_t* p_record) {
+    *p_record = journal.records[core][index & (JOURNAL_RING_SIZE - 1)];
+    __dmb();
+    if((p_record->type ^ get_record_type(0, index)) >> JOURNAL_TYPE_BITS != 0 ||
+       journal.reserved[core] - index > JOURNAL_RING_SIZE) {
+        return false;
+    }
+    p_record->type &= JOURNAL_TYPE_MASK;
+    return true;
+}
+
+// out: true if record a was written before record b (older boot, or earlier in same boot)
+static bool is_before(const journal_record_t* p_a, const journal_record_t* p_b) {
+    // boots back from current one
+    const uint8_t age_a = (uint8_t)journal.boot - p_a->boot;
+    const uint8_t age_b = (uint8_t)journal.boot - p_b->boot;
+    if(age_a != age_b) {
+        return age_a > age_b;
+    }
+    return (int32_t)(p_a->timestamp_us - p_b->timestamp_us) < 0;
+}
+
+static void print_record(uint8_t core, const journal_record_t* p_record) {
+    char text[5], buf[16];
+    uint8_t i;
+    printf("[%hu] %lu.%06lu c%hu ", p_record->boot, p_record->timestamp_us / 1000000,
+           p_record->timestamp_us % 1000000, core);
+    if(p_record->type >= e_nb_journal_events) {
+        printf("? %hu %u %lu\n", p_record->type, p_record->info, p_record->value);
+        return;
+    }
+    printf("%s", event_names[p_record->type]);
+    switch(p_record->type) {
+        case e_journal_boot:
+            printf(" #%lu\n", p_record->value);
+            break;
+        case e_journal_command:
+        case e_journal_live_command:
+            for(i = 0; i < 4; i++) {
+                text[i] = (char)(p_record->value >> (8 * i));
+            }
+            text[4] = '\0';
+            printf(" %u \"%s\"\n", p_record->info, text);
+            break;
+        case e_journal_step:
+            printf(" %lu%s\n", p_record->value, p_record->info == e_step_ramp ? "" : " (move)");
+            break;
+        case e_journal_params_sent:
+        case e_journal_params_applied:
+            // 1/4 period (µs) to frequency
+            printf(" sensor %u: %s Hz%s\n", p_record->info & 0xFF,
+                   _unsafe_format_float(p_record->value == 0 ? 0.0f : 250000.0f / p_record->value, buf),
+                   (p_record->info & JOURNAL_REVERSE) ? " reverse" : "");
+            break;
+        case e_journal_trigger:
+            printf("%s\n", p_record->info ? " (armed values applied)" : "");
+            break;
+        case e_journal_target:
+            printf(": sensor %u stopped\n", p_record->info);
+            break;
+        case e_journal_underrun:
+            printf(": %s (%lu)\n", p_record->info < sizeof(underrun_names) / sizeof(underrun_names[0]) ?
+                                   underrun_names[p_record->info] : "?", p_record->value);
+            break;
+        default:
+            printf("\n");
+            break;
+    }
+}
+
+void journal_print() {
+    journal_record_t records[2];
+    uint32_t indexes[2], ends[2], nb_lost = 0;
+    uint8_t core;
+    // records written from now on are not dumped
+    for(core = 0; core < 2; core++) {
+        ends[core] = journal.reserved[core];
+        indexes[core] = ends[core] > JOURNAL_RING_SIZE - 1 ? ends[core] - (JOURNAL_RING_SIZE - 1) : 0;
+    }
+    printf("Journal: boot %lu, %lu record(s) of core0, %lu of core1\n", journal.boot,
+           ends[0] - indexes[0], ends[1] - indexes[1]);
+    while(true) {
+        for(core = 0; core < 2; core++) {
+            // skips records not written yet, or overwritten while dumping
+            while(indexes[core] != ends[core] && !read_record(core, indexes[core], &records[core])) {
+                indexes[core]++;
+                nb_lost++;
+            }
+        }
+        if(indexes[0] == ends[0] && indexes[1] == ends[1]) {
+            break;
+        }
+        core = indexes[0] == ends[0] ? 1 :
+               indexes[1] == ends[1] ? 0 : is_before(&records[1], &records[0]) ? 1 : 0;
+        print_record(core, &records[core]);
+        indexes[core]++;
+        run_background_tasks();
+    }
+    if(nb_lost != 0) {
+        printf("%lu record(s) unfinished or overwritten while dumped\n", nb_lost);
+    }
+}
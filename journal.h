@@ -0,0 +1,72 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// journal of events of both cores and their interrupts: compact binary records
+// time stamped in µs, kept in RAM which is not cleared on a soft reset (watchdog,
+// debugger, RUN pin with power kept), so that what led to a failure can be dumped
+// afterwards, whatever console output was lost
+//
+// each core writes its own ring, oldest records being overwritten, so that no lock is
+// taken between cores. Foreground and interrupts of a core (which preempt each other)
+// reserve a record by incrementing the reservation index of the ring, then write it
+// with interrupts enabled, type last: cortex-M0+ has no atomic read-modify-write (nor
+// exclusive load/store), so the increment alone (with the time stamp, so that records
+// of a ring stay in time order) masks interrupts, for a few cycles
+// type of a record carries the lap of the ring it was written on: a reader rejects a
+// record of another lap (not written yet) and checks after copying it that no writer
+// reserved its slot again meanwhile
+// rings are merged by boot then time stamp when dumped
+
+// records per core (power of 2)
+#define JOURNAL_RING_SIZE 512
+
+typedef enum {
+    e_journal_boot, // value: boots since journal was cleared
+    e_journal_command, // info: command_e, value: first characters typed
+    e_journal_live_command, // info: live_command_e, value: first characters typed
+    e_journal_ctrl_c,
+    e_journal_step, // info: step_type_e, value: step number (from 1)
+    e_journal_params_sent, // core0: info: sensor, JOURNAL_REVERSE, value: 1/4 period (µs)
+    e_journal_params_applied, // core1: same, once applied to outputs
+    e_journal_trigger, // trigger interrupt, info: 1 if it applied armed values
+    e_journal_target, // output interrupt stopped sensor (info) on its target edge
+    e_journal_underrun, // info: journal_underrun_e, value: count
+    e_nb_journal_events
+} journal_event_e;
+
+// info bit of params records
+#define JOURNAL_REVERSE 0x100
+
+typedef enum {
+    e_underrun_mailbox, // core1 still had previous params: core0 waits
+    e_underrun_trigger_mailbox, // trigger interrupt could not hand values to core1
+    e_underrun_telemetry // telemetry frame dropped
+} journal_underrun_e;
+
+// type of records: journal_event_e, and lap (low bits of index / JOURNAL_RING_SIZE)
+#define JOURNAL_TYPE_BITS 4
+#define JOURNAL_TYPE_MASK ((1 << JOURNAL_TYPE_BITS) - 1)
+
+typedef struct {
+    uint32_t timestamp_us; // since boot
+    uint8_t type; // journal_event_e, lap << JOURNAL_TYPE_BITS
+    uint8_t boot; // low byte of boot count
+    uint16_t info;
+    uint32_t value;
+} journal_record_t;
+
+// keeps journal left by a soft reset, clears it if RAM holds anything else
+// to be called by core0 before core1 starts or any interrupt logs
+void journal_init();
+void journal_clear();
+// appends a record to ring of calling core, from foreground or interrupt
+void journal_log(journal_event_e event, uint16_t info, uint32_t value);
+// first characters of a command, as value of command records
+uint32_t journal_pack_text(const char* str);
+// decodes journal on console, oldest record first
+void journal_print();
+
+#endif
@@ -16,10 +16,13 @@ uint16_t pulse_out_sequence2[4] = {
     1 << FOURTH_OUT_PULSE 
 };
 
-uint8_t pulse_seq_index1 = 0;
+// outputs start low (step 0 of sequence): first edge is step 1
+uint8_t pulse_seq_index1 = 1;
 bool reverse1 = false;
-uint8_t pulse_seq_index2 = 0;
+int8_t direction1 = 1;
+uint8_t pulse_seq_index2 = 1;
 bool reverse2 = false;
+int8_t direction2 = 1;
 
 static void init_gpio_as_output(uint8_t num) {
     gpio_set_function(num, GPIO_FUNC_SIO);
@@ -29,6 +32,8 @@ static void init_gpio_as_output(uint8_t num) {
 void init_out_gpios() {
     init_gpio_as_output(FIRST_OUT_PULSE);
     init_gpio_as_output(SECOND_OUT_PULSE);
+#if OUTPUT_NB_SENSORS > 1
     init_gpio_as_output(THIRD_OUT_PULSE);
     init_gpio_as_output(FOURTH_OUT_PULSE);
+#endif
 }
\ No newline at end of file
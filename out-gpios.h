@@ -3,33 +3,49 @@
 
 #include "pico/stdlib.h"
 
-// outputs GPIO numbers for sensor 1, channels A and B and sensor 2, channels A and B 
-#define FIRST_OUT_PULSE  1
-#define SECOND_OUT_PULSE 0
-#define THIRD_OUT_PULSE  4
-#define FOURTH_OUT_PULSE 3
+// outputs GPIO numbers (FIRST_OUT_PULSE...) are defined at build time
+#include "output-config.h"
+
+#define SENSOR1_OUT_MASK (1 << FIRST_OUT_PULSE | 1 << SECOND_OUT_PULSE)
+#define SENSOR2_OUT_MASK (1 << THIRD_OUT_PULSE | 1 << FOURTH_OUT_PULSE)
 
 // whether signal should be reversed for sensors 1 and 2
 extern bool reverse1;
 extern bool reverse2;
 
+// step of sensor outputs in their sequence: +1 forward, -1 reversed
+// keeps direction test out of output interrupts
+extern int8_t direction1;
+extern int8_t direction2;
+
+// reverses sensor 1 between two edges so that next edge goes back to previous step
+// (pulse_seq_index1 already points to the step after the one output)
+#define TURN_BACK_1 {\
+  reverse1 = !reverse1; \
+  direction1 = -direction1; \
+  pulse_seq_index1 = (pulse_seq_index1 + 2 * direction1) & 3; }
+
+// same for sensor 2
+#define TURN_BACK_2 {\
+  reverse2 = !reverse2; \
+  direction2 = -direction2; \
+  pulse_seq_index2 = (pulse_seq_index2 + 2 * direction2) & 3; }
+
+// sets direction of sensor 1 (or 2): a change turns back, so that each edge counted
+// is one step of outputs (a mere flip of direction would output the step just left
+// again, then skip one: 2 edges counted the wrong way per reversal)
+#define SET_REVERSE_1(r) { if((r) != reverse1) TURN_BACK_1 }
+#define SET_REVERSE_2(r) { if((r) != reverse2) TURN_BACK_2 }
+
 // makes sensor 1 output progress one step (4 steps = 1 cycle)
 #define SET_OUTPUT_PULSE_1 {\
-  gpio_put_masked(1<<FIRST_OUT_PULSE | 1 << SECOND_OUT_PULSE, pulse_out_sequence1[pulse_seq_index1]); \
-  if(reverse1) { \
-        pulse_seq_index1 = (pulse_seq_index1-1) & 3; \
-    } else { \
-        pulse_seq_index1 = (pulse_seq_index1+1) & 3; \
-    }}
+  gpio_put_masked(SENSOR1_OUT_MASK, pulse_out_sequence1[pulse_seq_index1]); \
+  pulse_seq_index1 = (pulse_seq_index1 + direction1) & 3; }
 
 // makes sensor 2 output progress one step (4 steps = 1 cycle)
 #define SET_OUTPUT_PULSE_2 {\
-  gpio_put_masked(1<<THIRD_OUT_PULSE | 1 << FOURTH_OUT_PULSE, pulse_out_sequence2[pulse_seq_index2]); \
-  if(reverse2) { \
-        pulse_seq_index2 = (pulse_seq_index2-1) & 3; \
-    } else { \
-        pulse_seq_index2 = (pulse_seq_index2+1) & 3; \
-    }}
+  gpio_put_masked(SENSOR2_OUT_MASK, pulse_out_sequence2[pulse_seq_index2]); \
+  pulse_seq_index2 = (pulse_seq_index2 + direction2) & 3; }
 
 // used by macros above (shouldn't be accessed elsewhere)
 extern uint16_t pulse_out_sequence1[4];
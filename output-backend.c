@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Core1 side of output generation, common to all backends
+ */
+
+#include "output-backend.h"
+
+#include "hardware/regs/m0plus.h"
+#include "hardware/structs/systick.h"
+#include "pico/multicore.h"
+
+volatile uint32_t max_cycle_count1 = 0; // initially stopped
+volatile uint32_t max_cycle_count2 = 0;
+
+volatile int64_t edge_count1 = 0;
+volatile int64_t edge_count2 = 0;
+
+volatile int64_t target_edge1 = TARGET_NONE;
+volatile int64_t target_edge2 = TARGET_NONE;
+
+volatile bool edge_probe_armed = false;
+volatile uint32_t edge_probe_time;
+
+volatile uint32_t isr_busy_cycles = 0;
+
+#if OUTPUT_SWEEP
+sweep_t output_sweep;
+volatile bool output_sweep_armed = false;
+#endif
+
+#if OUTPUT_STANDSTILL
+standstill_t output_standstill1;
+standstill_t output_standstill2;
+volatile bool output_standstill_armed1 = false;
+volatile bool output_standstill_armed2 = false;
+#endif
+
+static const output_backend_t* const backends[e_nb_backends] = {
+    &pwm_output_backend,
+    &timer_output_backend,
+    &vr_output_backend
+};
+
+const char* get_backend_name(uint8_t backend) {
+    return backend < e_nb_backends ? backends[backend]->name : NULL;
+}
+
+int64_t get_edge_count(uint8_t sensor) {
+    volatile int64_t* p_count = sensor == 1 ? &edge_count1 : &edge_count2;
+    int64_t count;
+    // 64-bit access is not atomic: read again if interrupt updated it meanwhile
+    do {
+        count = *p_count;
+    } while(count != *p_count);
+    return count;
+}
+
+bool apply_target(uint8_t sensor, const channel_params_t* p_params) {
+    volatile int64_t* const p_target_edge = sensor == 1 ? &target_edge1 : &target_edge2;
+    if(!p_params->targeted) {
+        *p_target_edge = TARGET_NONE;
+        return true;
+    }
+    if((sensor == 1 ? edge_count1 : edge_count2) == p_params->target) {
+        *p_target_edge = TARGET_NONE;
+        return false;
+    }
+    *p_target_edge = p_params->target;
+    return true;
+}
+
+#if OUTPUT_STANDSTILL
+// a stopped sensor (1 or 2) runs standstill model instead, except VR sine
+// model carries on if it already runs with same params
+// must be called with interrupts disabled on core1
+// out: false if sensor parameters are to be left as they are
+static bool apply_standstill(uint8_t sensor, channel_params_t* p_params,
+                             const standstill_params_t* p_standstill, uint8_t backend) {
+    standstill_t* const p_state = sensor == 1 ? &output_standstill1 : &output_standstill2;
+    volatile bool* const p_armed = sensor == 1 ? &output_standstill_armed1 : &output_standstill_armed2;
+    const bool was_armed = *p_armed;
+    *p_armed = p_params->max_count == 0 && p_standstill->amplitude != 0 && backend != e_backend_vr;
+    if(!*p_armed) {
+        return true;
+    }
+    if(was_armed && p_state->params.amplitude == p_standstill->amplitude &&
+       p_state->params.min_interval_us == p_standstill->min_interval_us &&
+       p_state->params.interval_span_us == p_standstill->interval_span_us &&
+       p_state->params.creep == p_standstill->creep) {
+        return false;
+    }
+    p_params->max_count = standstill_start(p_state, p_standstill, time_us_32() ^ sensor);
+    return true;
+}
+#endif
+
+void start_load_measurement() {
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+void core1_main() {
+    const output_backend_t* p_backend = backends[OUTPUT_BACKEND];
+    uint8_t backend = OUTPUT_BACKEND;
+    intercore_data_t inter_core_data;
+    channel_params_t params;
+    uint32_t interrupts;
+    // core0 may pause this core while writing to flash
+    multicore_lockout_victim_init();
+    start_load_measurement();
+    init_out_gpios();
+#if OUTPUT_SWEEP
+    gpio_init(SWEEP_MARKER_GPIO);
+    gpio_set_dir(SWEEP_MARKER_GPIO, GPIO_OUT);
+#endif
+    p_backend->init();
+    while (true) {
+        queue_remove_blocking(&call_queue, &inter_core_data);
+        if(inter_core_data.backend != backend && inter_core_data.backend < e_nb_backends) {
+            // new backend starts stopped and gets parameters below
+            p_backend->shutdown();
+#if OUTPUT_STANDSTILL
+            output_standstill_armed1 = output_standstill_armed2 = false;
+#endif
+            backend = inter_core_data.backend;
+            p_backend = backends[backend];
+            p_backend->init();
+        }
+        params.max_count = inter_core_data.max_count1;
+        params.reverse = inter_core_data.invert1;
+        params.targeted = inter_core_data.targeted1;
+        params.target = inter_core_data.target1;
+        interrupts = save_and_disable_interrupts();
+        if(!apply_target(1, &params)) {
+            params.max_count = 0;
+        }
+#if OUTPUT_STANDSTILL
+        if(apply_standstill(1, &params, &inter_core_data.standstill, backend))
+#endif
+        p_backend->set_channel_params(1, &params);
+#if OUTPUT_SWEEP
+        // VR sine is not derived from max_cycle_count1 in interrupt
+        output_sweep_armed = inter_core_data.sweep && backend != e_backend_vr;
+        if(!output_sweep_armed) {
+            gpio_put(SWEEP_MARKER_GPIO, false);
+        }
+#endif
+        restore_interrupts(interrupts);
+        journal_log(e_journal_params_applied, params.reverse ? 1 | JOURNAL_REVERSE : 1, params.max_count);
+#if CORE1_SENSOR2
+        params.max_count = inter_core_data.max_count2;
+        params.reverse = inter_core_data.invert2;
+        params.targeted = inter_core_data.targeted2;
+        params.target = inter_core_data.target2;
+        interrupts = save_and_disable_interrupts();
+        if(!apply_target(2, &params)) {
+            params.max_count = 0;
+        }
+#if OUTPUT_STANDSTILL
+        if(apply_standstill(2, &params, &inter_core_data.standstill, backend))
+#endif
+        p_backend->set_channel_params(2, &params);
+        restore_interrupts(interrupts);
+        journal_log(e_journal_params_applied, params.reverse ? 2 | JOURNAL_REVERSE : 2, params.max_count);
+#endif
+    }
+}
@@ -0,0 +1,225 @@
+#ifndef OUTPUT_BACKEND_H
+#define OUTPUT_BACKEND_H
+
+#include "pico/stdlib.h"
+#include "pico/util/queue.h"
+
+#include "journal.h"
+#include "out-gpios.h"
+#include "standstill.h"
+#if OUTPUT_SWEEP
+#include "sweep.h"
+#endif
+
+// output backends: strategies generating sensor edges on core1
+// selected at build time (OUTPUT_BACKEND) and changed at run time through call_queue
+typedef enum {
+    e_backend_pwm, // PWM wrap interrupt every µs counting down periods (pwm-managed.c)
+    e_backend_timer, // one repeating timer per sensor (timer-managed.c)
+    e_backend_vr, // PWM sine of variable reluctance sensors (vr-managed.c)
+    e_nb_backends
+} backend_e;
+
+// OUTPUT_BACKEND, SPLIT_CORES and output features are defined in output-config.h
+
+#if OUTPUT_TARGETS && !OUTPUT_EDGE_COUNTERS
+#error "OUTPUT_TARGETS requires OUTPUT_EDGE_COUNTERS"
+#endif
+#if SPLIT_CORES && OUTPUT_NB_SENSORS < 2
+#error "SPLIT_CORES requires two sensors"
+#endif
+
+// sensor 2 is generated by core1 backends
+#define CORE1_SENSOR2 (OUTPUT_NB_SENSORS > 1 && !SPLIT_CORES)
+
+typedef struct {
+    // 1/4 of sensor period in µs, 0 to stop
+    uint32_t max_count;
+    bool reverse;
+    // when true, sensor stops by itself as soon as its edge count reaches target
+    bool targeted;
+    int64_t target;
+} channel_params_t;
+
+typedef struct {
+    const char* name;
+    // starts generation (outputs are stopped)
+    void (*init)();
+    // applies new parameters of sensor (1 or 2), called with interrupts disabled
+    void (*set_channel_params)(uint8_t sensor, const channel_params_t* p_params);
+    // edge count of sensor (1 or 2)
+    int64_t (*read_counters)(uint8_t sensor);
+    // stops generation and releases hardware
+    void (*shutdown)();
+} output_backend_t;
+
+extern const output_backend_t pwm_output_backend;
+extern const output_backend_t timer_output_backend;
+extern const output_backend_t vr_output_backend;
+
+typedef struct {
+    uint32_t max_count1;
+    uint32_t max_count2;
+    bool invert1;
+    bool invert2;
+    // see channel_params_t
+    bool targeted1;
+    bool targeted2;
+    int64_t target1;
+    int64_t target2;
+    uint8_t backend; // see backend_e
+    // sensor 1 frequency follows output_sweep edge by edge from max_count1 on
+    // (sensor 2 follows sensor 1 when generated by core1)
+    bool sweep;
+    // model of stopped sensors (max_count 0) generated by core1, unless amplitude is 0
+    standstill_params_t standstill;
+} intercore_data_t;
+
+extern queue_t call_queue;
+
+// name of a backend, NULL if out of range
+const char* get_backend_name(uint8_t backend);
+
+// core1 entry: applies intercore data to selected backend
+void core1_main();
+
+/*
+ * Those counts directly influence sensor outputs
+ *  1 and 2 refer to sensors 1 and 2 
+ *  unit of this counter is 1 µS
+ *  max_cycle_count represents 1/4 of sensor cycle period
+ */
+extern volatile uint32_t max_cycle_count1;
+extern volatile uint32_t max_cycle_count2;
+
+// number of edges output by sensors 1 and 2
+// counting down when sensor is reversed
+extern volatile int64_t edge_count1;
+extern volatile int64_t edge_count2;
+
+// edge counts on which sensors stop, TARGET_NONE when disarmed
+// (an edge count which is never reached saves a test in interrupts)
+#define TARGET_NONE INT64_MIN
+extern volatile int64_t target_edge1;
+extern volatile int64_t target_edge2;
+
+// armed to get time (µs, see time_us_32) of next output edge of any sensor
+extern volatile bool edge_probe_armed;
+extern volatile uint32_t edge_probe_time;
+
+// system clock cycles spent in core1 output interrupts (wraps around)
+// time of interrupt entry and exit is not accounted
+extern volatile uint32_t isr_busy_cycles;
+
+// arms or disarms stop of sensor (1 or 2) on target edge count
+// must be called with interrupts disabled on the core generating sensor
+// out: false if target is already reached (so sensor should remain stopped)
+bool apply_target(uint8_t sensor, const channel_params_t* p_params);
+
+// safe read of edge_count1 (sensor = 1) or edge_count2 (sensor = 2) from any core
+int64_t get_edge_count(uint8_t sensor);
+
+#if OUTPUT_SWEEP
+// sweep run by sensor 1 edges, set up by core0 before it is armed through intercore data
+extern sweep_t output_sweep;
+extern volatile bool output_sweep_armed;
+#endif
+
+#if OUTPUT_STANDSTILL
+// standstill models of stopped sensors 1 and 2, started by core1 from intercore data
+extern standstill_t output_standstill1;
+extern standstill_t output_standstill2;
+extern volatile bool output_standstill_armed1;
+extern volatile bool output_standstill_armed2;
+#endif
+
+// SysTick of each core counts down at system clock: start and end of interrupt load measurement
+// cycles are accumulated into counter
+#define ISR_LOAD_START const uint32_t entry_tick = systick_hw->cvr;
+#define ISR_LOAD_END(counter) counter += (entry_tick - systick_hw->cvr) & 0x00FFFFFF;
+
+// starts SysTick of calling core as a free running 24-bit counter
+void start_load_measurement();
+
+#if OUTPUT_EDGE_COUNTERS
+#define COUNT_EDGE_1 edge_count1 += direction1;
+#define COUNT_EDGE_2 edge_count2 += direction2;
+#else
+#define COUNT_EDGE_1
+#define COUNT_EDGE_2
+#endif
+
+#if OUTPUT_EDGE_PROBE
+#define PROBE_EDGE if(edge_probe_armed) { edge_probe_time = time_us_32(); edge_probe_armed = false; }
+#else
+#define PROBE_EDGE
+#endif
+
+#if OUTPUT_TARGETS
+#define STOP_ON_TARGET_1 if(edge_count1 == target_edge1) { max_cycle_count1 = 0; target_edge1 = TARGET_NONE; \
+                                                           journal_log(e_journal_target, 1, 0); }
+#define STOP_ON_TARGET_2 if(edge_count2 == target_edge2) { max_cycle_count2 = 0; target_edge2 = TARGET_NONE; \
+                                                           journal_log(e_journal_target, 2, 0); }
+#else
+#define STOP_ON_TARGET_1
+#define STOP_ON_TARGET_2
+#endif
+
+#if OUTPUT_SWEEP
+// next quarter period of sensor 1 from the one just elapsed, marker on decades
+#define SWEEP_EDGE_1 if(output_sweep_armed) {\
+  max_cycle_count1 = sweep_next_edge(&output_sweep, max_cycle_count1); \
+  gpio_put(SWEEP_MARKER_GPIO, output_sweep.marker_edge); }
+#else
+#define SWEEP_EDGE_1
+#endif
+
+#if OUTPUT_SWEEP && CORE1_SENSOR2
+// sensor 2 takes period of sensor 1 on its own edges
+// (its period never changes in the middle of an edge)
+#define SWEEP_EDGE_2 if(output_sweep_armed) { max_cycle_count2 = max_cycle_count1; }
+#else
+#define SWEEP_EDGE_2
+#endif
+
+#if OUTPUT_STANDSTILL
+// random interval to next edge of stopped sensor 1, which may turn back
+#define STANDSTILL_EDGE_1 if(output_standstill_armed1) {\
+  uint32_t interval; \
+  if(standstill_next_edge(&output_standstill1, direction1, max_cycle_count1, &interval) != direction1) TURN_BACK_1 \
+  max_cycle_count1 = interval; }
+#else
+#define STANDSTILL_EDGE_1
+#endif
+
+#if OUTPUT_STANDSTILL && CORE1_SENSOR2
+#define STANDSTILL_EDGE_2 if(output_standstill_armed2) {\
+  uint32_t interval; \
+  if(standstill_next_edge(&output_standstill2, direction2, max_cycle_count2, &interval) != direction2) TURN_BACK_2 \
+  max_cycle_count2 = interval; }
+#else
+#define STANDSTILL_EDGE_2
+#endif
+
+// makes sensor 1 output progress one edge, counts it, stops sensor
+// (max_cycle_count1 = 0) on target and sets period of next edge when sweeping
+// or at standstill
+// only features enabled in output-config.h are compiled in
+#define OUTPUT_EDGE_1 {\
+  SET_OUTPUT_PULSE_1 \
+  PROBE_EDGE \
+  COUNT_EDGE_1 \
+  STOP_ON_TARGET_1 \
+  SWEEP_EDGE_1 \
+  STANDSTILL_EDGE_1 }
+
+// same for sensor 2
+#define OUTPUT_EDGE_2 {\
+  SET_OUTPUT_PULSE_2 \
+  PROBE_EDGE \
+  COUNT_EDGE_2 \
+  STOP_ON_TARGET_2 \
+  SWEEP_EDGE_2 \
+  STANDSTILL_EDGE_2 }
+
+#endif
@@ -6,43 +6,46 @@
 
 #include "hardware/irq.h"
 #include "hardware/pwm.h"
-#include "pico/critical_section.h"
-
-#include "out-gpios.h"
+#include "hardware/structs/systick.h"
 
 #define SLICE_NUM 0
 
 uint32_t cycle_count1 = 1;
-uint32_t max_cycle_count1 = 0; // initially stopped
 uint32_t cycle_count2 = 1;
-uint32_t max_cycle_count2 = 0;
 
-static void on_pwm_wrap() {
+// runs every µs: kept in RAM, out of XIP cache misses
+void __not_in_flash_func(on_pwm_wrap)() {
+    ISR_LOAD_START
     // Clear the interrupt flag that brought us here
     pwm_clear_irq(SLICE_NUM);
     if(max_cycle_count1) {
         if(cycle_count1 == max_cycle_count1) {
             cycle_count1 = 1;
-            SET_OUTPUT_PULSE_1
+            OUTPUT_EDGE_1
         } else {
             cycle_count1++;
         }
     }
+#if CORE1_SENSOR2
     if(max_cycle_count2) {
         if(cycle_count2 == max_cycle_count2) {
             cycle_count2 = 1;
-            SET_OUTPUT_PULSE_2
+            OUTPUT_EDGE_2
         } else {
             cycle_count2++;
         }
     }
+#endif
+    ISR_LOAD_END(isr_busy_cycles)
 }
 
-static critical_section_t critical_section;
-
-void start_pwm() {
+static void start_pwm() {
     // Get some sensible defaults for the slice configuration. By default, the
     pwm_config config = pwm_get_default_config();
+    max_cycle_count1 = 0;
+#if CORE1_SENSOR2
+    max_cycle_count2 = 0;
+#endif
     // Mask slice's IRQ output into the PWM block's single interrupt line,
     // and register our interrupt handler
     pwm_clear_irq(SLICE_NUM);
@@ -54,8 +57,6 @@ void start_pwm() {
     // Load the configuration into our PWM slice, and set it running.
     pwm_init(SLICE_NUM, &config, true);
 
-    critical_section_init(&critical_section);
-
     // Set period
     uint16_t wrap_count = 124; // sysclock supposed at 125 MHz
     pwm_set_wrap(SLICE_NUM, wrap_count);
@@ -65,39 +66,37 @@ void start_pwm() {
     pwm_set_enabled(SLICE_NUM, true);
 }
 
-void core1_main() {
-    uint32_t shadow_max_count;
-    bool shadow_invert;    
-    intercore_data_t inter_core_data;
-    init_out_gpios();
-    start_pwm();
-    while (true) {
-        queue_remove_blocking(&call_queue, &inter_core_data);
-        shadow_invert = inter_core_data.invert1;
-        shadow_max_count = inter_core_data.max_count1;
-        critical_section_enter_blocking(&critical_section);
-        if(shadow_invert != reverse1) {
-            reverse1 = shadow_invert;
-        }
-        if(shadow_max_count != max_cycle_count1) {
-            if(shadow_max_count < cycle_count1) {
-                cycle_count1 = shadow_max_count;
+static void stop_pwm() {
+    pwm_set_enabled(SLICE_NUM, false);
+    irq_set_enabled(PWM_IRQ_WRAP, false);
+    pwm_set_irq_enabled(SLICE_NUM, false);
+    irq_remove_handler(PWM_IRQ_WRAP, on_pwm_wrap);
+}
+
+static void set_pwm_channel_params(uint8_t sensor, const channel_params_t* p_params) {
+    if(sensor == 1) {
+        SET_REVERSE_1(p_params->reverse)
+        if(p_params->max_count != max_cycle_count1) {
+            if(p_params->max_count < cycle_count1) {
+                cycle_count1 = p_params->max_count;
             }
-            max_cycle_count1 = shadow_max_count;
+            max_cycle_count1 = p_params->max_count;
         }
-        critical_section_exit(&critical_section);
-        shadow_invert = inter_core_data.invert2;
-        shadow_max_count = inter_core_data.max_count2;
-        critical_section_enter_blocking(&critical_section);
-        if(shadow_invert != reverse2) {
-            reverse2 = shadow_invert;
-        }
-        if(shadow_max_count != max_cycle_count2) {
-            if(shadow_max_count < cycle_count2) {
-                cycle_count2 = shadow_max_count;
+    } else {
+        SET_REVERSE_2(p_params->reverse)
+        if(p_params->max_count != max_cycle_count2) {
+            if(p_params->max_count < cycle_count2) {
+                cycle_count2 = p_params->max_count;
             }
-            max_cycle_count2 = shadow_max_count;
+            max_cycle_count2 = p_params->max_count;
         }
-        critical_section_exit(&critical_section);
     }
 }
+
+const output_backend_t pwm_output_backend = {
+    "pwm",
+    start_pwm,
+    set_pwm_channel_params,
+    get_edge_count,
+    stop_pwm
+};
@@ -0,0 +1,390 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Compact delta-encoded storage of sequence steps
+ */
+
+#include "sequence-store.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// header byte
+#define HDR_TYPE_MASK      0x03 // step_type_e
+#define HDR_DIRECTIONS     0x04 // direction byte follows
+#define HDR_DELAY          0x08 // delay follows
+#define HDR_FIRST          0x10 // first value delta follows
+#define HDR_SECOND_SHARED  0x20 // second value equals first value
+#define HDR_SECOND         0x40 // second value delta follows
+#define HDR_DECELERATION   0x80 // moves: deceleration follows (default otherwise)
+
+// direction byte
+#define DIR_FIRST_REVERSE  0x01
+#define DIR_SECOND_REVERSE 0x02
+
+// longest encoded step: header, direction, 3 bytes delay, 3 varints of 5 bytes
+// (values, deceleration bits) and a 64-bit one of 10 bytes (target)
+#define MAX_STEP_SIZE (1 + 1 + 3 + 3 * 5 + 10)
+
+// set by linker script: top of heap
+extern char __StackLimit;
+
+typedef struct {
+    uint32_t base; // offset of first step in arena
+    uint32_t size; // available from base
+    uint32_t used;
+    uint32_t count;
+    // last step appended, as encoding reference of next one
+    sequence_cursor_t tail;
+    sequence_preflight_t preflight;
+} slot_t;
+
+static uint8_t* arena = NULL;
+static uint32_t arena_size = 0;
+static slot_t slots[2];
+static uint8_t active_slot = 0;
+#define RECORDING_SLOT (1 - active_slot)
+static volatile sequence_swap_e pending_swap = e_swap_none;
+
+static int32_t quantize(float value) {
+    return lroundf(value * SEQUENCE_STORE_QUANTA);
+}
+
+static float unquantize(int32_t value) {
+    return (float)value / SEQUENCE_STORE_QUANTA;
+}
+
+// distances are stored as the bits of their double, byte reversed: exact whatever
+// the distance, and short for round ones (their low mantissa bytes are zero)
+static uint64_t encode_distance(double distance) {
+    uint64_t bits;
+    memcpy(&bits, &distance, sizeof(bits));
+    return __builtin_bswap64(bits);
+}
+
+static double decode_distance(uint64_t value) {
+    const uint64_t bits = __builtin_bswap64(value);
+    double distance;
+    memcpy(&distance, &bits, sizeof(distance));
+    return distance;
+}
+
+// decelerations likewise as the bits of their float: a small one (e.g. 0.004) would
+// quantize to 0, which stands for the default deceleration
+static uint32_t encode_deceleration(float deceleration) {
+    uint32_t bits;
+    memcpy(&bits, &deceleration, sizeof(bits));
+    return __builtin_bswap32(bits);
+}
+
+static float decode_deceleration(uint32_t value) {
+    const uint32_t bits = __builtin_bswap32(value);
+    float deceleration;
+    memcpy(&deceleration, &bits, sizeof(deceleration));
+    return deceleration;
+}
+
+static uint8_t* put_varint(uint8_t* p, uint32_t value) {
+    while(value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+static const uint8_t* get_varint(const uint8_t* p, uint32_t* p_value) {
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    do {
+        value |= (uint32_t)(*p & 0x7F) << shift;
+        shift += 7;
+    } while(*p++ & 0x80);
+    *p_value = value;
+    return p;
+}
+
+static uint8_t* put_varint64(uint8_t* p, uint64_t value) {
+    while(value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+static const uint8_t* get_varint64(const uint8_t* p, uint64_t* p_value) {
+    uint64_t value = 0;
+    uint8_t shift = 0;
+    do {
+        value |= (uint64_t)(*p & 0x7F) << shift;
+        shift += 7;
+    } while(*p++ & 0x80);
+    *p_value = value;
+    return p;
+}
+
+// zigzag encoding keeps small negative deltas short
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+void sequence_store_init() {
+    uint32_t free_sram = (uint32_t)(&__StackLimit - (char*)sbrk(0));
+    uint32_t size = free_sram > SEQUENCE_STORE_HEAP_RESERVE ? free_sram - SEQUENCE_STORE_HEAP_RESERVE : 0;
+    uint8_t* buffer = malloc(size);
+    sequence_store_init_arena(buffer, buffer == NULL ? 0 : size);
+}
+
+void sequence_store_init_arena(uint8_t* buffer, uint32_t size) {
+    arena = buffer;
+    arena_size = size;
+    memset(slots, 0, sizeof(slots));
+    active_slot = 0;
+    pending_swap = e_swap_none;
+    sequence_store_record();
+}
+
+void sequence_store_record() {
+    const slot_t* p_active = &slots[active_slot];
+    slot_t* p_recording = &slots[RECORDING_SLOT];
+    const uint32_t active_end = p_active->base + p_active->used;
+    if(p_active->count == 0) {
+        p_recording->base = 0;
+        p_recording->size = arena_size;
+    } else if(arena_size - active_end >= p_active->base) {
+        p_recording->base = active_end;
+        p_recording->size = arena_size - active_end;
+    } else {
+        p_recording->base = 0;
+        p_recording->size = p_active->base;
+    }
+    p_recording->used = 0;
+    p_recording->count = 0;
+    sequence_cursor_start(&p_recording->tail);
+    memset(&p_recording->preflight, 0, sizeof(sequence_preflight_t));
+}
+
+void sequence_store_swap() {
+    active_slot = RECORDING_SLOT;
+    pending_swap = e_swap_none;
+    // previous sequence is dropped
+    slots[RECORDING_SLOT].count = 0;
+    slots[RECORDING_SLOT].used = 0;
+    memset(&slots[RECORDING_SLOT].preflight, 0, sizeof(sequence_preflight_t));
+}
+
+bool sequence_store_request_swap(sequence_swap_e when) {
+    if(when != e_swap_none && slots[RECORDING_SLOT].count == 0) {
+        return false;
+    }
+    pending_swap = when;
+    return true;
+}
+
+sequence_swap_e sequence_store_get_pending_swap() {
+    return pending_swap;
+}
+
+// accounts for a step in pre-flight analysis of its slot
+// in: step number (from 1), values as stored, directions of step and of previous one
+static void preflight_add(sequence_preflight_t* p_preflight, uint32_t step, const sequence_values_t* p_values,
+                          const float* values, uint8_t directions, uint8_t previous_directions) {
+    static const uint8_t reverse_bits[2] = {DIR_FIRST_REVERSE, DIR_SECOND_REVERSE};
+    float acceleration;
+    uint8_t i;
+    if(p_values->type != e_step_ramp) {
+        p_preflight->nb_moves++;
+        if(p_values->type == e_step_move_edges) {
+            p_preflight->move_edges += p_values->target_edges;
+        } else {
+            p_preflight->move_distance += p_values->target_distance;
+        }
+        p_preflight->end_values[0] = p_preflight->end_values[1] = 0.0f;
+        return;
+    }
+    if(p_values->delay == 0 &&
+       (values[0] != p_preflight->end_values[0] || values[1] != p_preflight->end_values[1])) {
+        p_preflight->nb_jumps++;
+    }
+    p_preflight->duration += p_values->delay;
+    for(i = 0; i < 2; i++) {
+        if(p_values->delay != 0) {
+            p_preflight->areas[i] += (p_preflight->end_values[i] + values[i]) / 2.0f * p_values->delay;
+            acceleration = fabsf(values[i] - p_preflight->end_values[i]) / p_values->delay;
+            if(acceleration > p_preflight->peak_accelerations[i]) {
+                p_preflight->peak_accelerations[i] = acceleration;
+                p_preflight->peak_steps[i] = step;
+            }
+        }
+        // direction changes once step values are reached
+        if(((directions ^ previous_directions) & reverse_bits[i]) != 0 && values[i] != 0.0f) {
+            p_preflight->nb_reversals++;
+        }
+        if(values[i] != 0.0f && (p_preflight->min_steps[i] == 0 || values[i] < p_preflight->min_values[i])) {
+            p_preflight->min_values[i] = values[i];
+            p_preflight->min_steps[i] = step;
+        }
+        if(p_preflight->max_steps[i] == 0 || values[i] > p_preflight->max_values[i]) {
+            p_preflight->max_values[i] = values[i];
+            p_preflight->max_steps[i] = step;
+        }
+        p_preflight->end_values[i] = values[i];
+    }
+}
+
+bool sequence_store_append(const sequence_values_t* p_values) {
+    slot_t* const p_slot = &slots[RECORDING_SLOT];
+    sequence_cursor_t* const p_tail = &p_slot->tail;
+    uint8_t* p;
+    uint8_t header = p_values->type & HDR_TYPE_MASK;
+    const uint8_t directions = (p_values->firstReverse ? DIR_FIRST_REVERSE : 0) |
+                               (p_values->secondReverse ? DIR_SECOND_REVERSE : 0);
+    const int32_t first = quantize(p_values->firstValue);
+    const int32_t second = quantize(p_values->secondValue);
+    float stored_values[2];
+    if(p_slot->size - p_slot->used < MAX_STEP_SIZE) {
+        return false;
+    }
+    p = arena + p_slot->base + p_slot->used + 1;
+    if(directions != p_tail->directions) {
+        header |= HDR_DIRECTIONS;
+        *p++ = directions;
+    }
+    if(p_values->delay != p_tail->delay) {
+        header |= HDR_DELAY;
+        p = put_varint(p, p_values->delay);
+    }
+    if(first != p_tail->first) {
+        header |= HDR_FIRST;
+        p = put_varint(p, zigzag(first - p_tail->first));
+    }
+    if(second == first) {
+        header |= HDR_SECOND_SHARED;
+    } else if(second != p_tail->second) {
+        header |= HDR_SECOND;
+        p = put_varint(p, zigzag(second - p_tail->second));
+    }
+    if(p_values->type != e_step_ramp) {
+        p = put_varint64(p, p_values->type == e_step_move_edges ? (uint64_t)p_values->target_edges :
+                            encode_distance(p_values->target_distance));
+        if(p_values->deceleration != 0.0f) {
+            header |= HDR_DECELERATION;
+            p = put_varint(p, encode_deceleration(p_values->deceleration));
+        }
+    }
+    arena[p_slot->base + p_slot->used] = header;
+    stored_values[0] = unquantize(first);
+    stored_values[1] = unquantize(second);
+    preflight_add(&p_slot->preflight, p_slot->count + 1, p_values, stored_values, directions, p_tail->directions);
+    p_tail->directions = directions;
+    p_tail->delay = p_values->delay;
+    p_tail->first = first;
+    p_tail->second = second;
+    p_slot->used = p - (arena + p_slot->base);
+    p_slot->count++;
+    return true;
+}
+
+uint32_t sequence_store_count() {
+    return slots[active_slot].count;
+}
+
+uint32_t sequence_store_recorded_count() {
+    return slots[RECORDING_SLOT].count;
+}
+
+uint32_t sequence_store_used() {
+    return slots[active_slot].used;
+}
+
+uint32_t sequence_store_capacity() {
+    return arena_size;
+}
+
+const sequence_preflight_t* sequence_store_get_preflight() {
+    return &slots[active_slot].preflight;
+}
+
+const sequence_preflight_t* sequence_store_get_recorded_preflight() {
+    return &slots[RECORDING_SLOT].preflight;
+}
+
+void sequence_cursor_start(sequence_cursor_t* p_cursor) {
+    p_cursor->slot = active_slot;
+    p_cursor->swapped = false;
+    p_cursor->offset = 0;
+    p_cursor->index = 0;
+    p_cursor->first = 0;
+    p_cursor->second = 0;
+    p_cursor->directions = 0;
+    p_cursor->delay = 0;
+}
+
+bool sequence_cursor_next(sequence_cursor_t* p_cursor, sequence_values_t* p_values) {
+    const uint8_t* p;
+    uint8_t header;
+    uint32_t value;
+    uint64_t target;
+    bool swapped = false;
+    if(p_cursor->slot == active_slot &&
+       (pending_swap == e_swap_at_step ||
+        (pending_swap == e_swap_at_loop && p_cursor->index >= slots[active_slot].count))) {
+        sequence_store_swap();
+        sequence_cursor_start(p_cursor);
+        swapped = true;
+    }
+    p_cursor->swapped = swapped;
+    if(p_cursor->index >= slots[p_cursor->slot].count) {
+        return false;
+    }
+    p = arena + slots[p_cursor->slot].base + p_cursor->offset;
+    header = *p++;
+    if(header & HDR_DIRECTIONS) {
+        p_cursor->directions = *p++;
+    }
+    if(header & HDR_DELAY) {
+        p = get_varint(p, &value);
+        p_cursor->delay = (uint16_t)value;
+    }
+    if(header & HDR_FIRST) {
+        p = get_varint(p, &value);
+        p_cursor->first += unzigzag(value);
+    }
+    if(header & HDR_SECOND_SHARED) {
+        p_cursor->second = p_cursor->first;
+    } else if(header & HDR_SECOND) {
+        p = get_varint(p, &value);
+        p_cursor->second += unzigzag(value);
+    }
+    p_values->type = header & HDR_TYPE_MASK;
+    p_values->target_edges = 0;
+    p_values->target_distance = 0.0;
+    p_values->deceleration = 0.0f;
+    if(p_values->type != e_step_ramp) {
+        p = get_varint64(p, &target);
+        if(p_values->type == e_step_move_edges) {
+            p_values->target_edges = (int64_t)target;
+        } else {
+            p_values->target_distance = decode_distance(target);
+        }
+        if(header & HDR_DECELERATION) {
+            p = get_varint(p, &value);
+            p_values->deceleration = decode_deceleration(value);
+        }
+    }
+    p_values->firstValue = unquantize(p_cursor->first);
+    p_values->secondValue = unquantize(p_cursor->second);
+    p_values->firstReverse = (p_cursor->directions & DIR_FIRST_REVERSE) != 0;
+    p_values->secondReverse = (p_cursor->directions & DIR_SECOND_REVERSE) != 0;
+    p_values->delay = p_cursor->delay;
+    p_cursor->offset = p - (arena + slots[p_cursor->slot].base);
+    p_cursor->index++;
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef SEQUENCE_STORE_H
+#define SEQUENCE_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "speed-sensor.h"
+
+// compact storage of sequence steps in an arena taken from free SRAM
+// each step is a header byte followed by variable length fields,
+// values are stored as deltas from previous step, quantized to 1/SEQUENCE_STORE_QUANTA,
+// move targets as 64-bit varints, not quantized: edge counts as such, distances as
+// the bits of their double, and move decelerations as the bits of their float
+// and fields unchanged from previous step (directions, delay...) are omitted
+//
+// arena holds two slots: steps are read from the active one while a new sequence
+// is recorded into the other one, placed in the largest part of arena left free,
+// then slots are swapped, possibly by a running cursor at a step or loop boundary
+
+#define SEQUENCE_STORE_QUANTA 100
+// SRAM kept free for heap after arena allocation
+#define SEQUENCE_STORE_HEAP_RESERVE (16 * 1024)
+
+typedef enum {
+    e_swap_none,
+    e_swap_at_step, // before next step
+    e_swap_at_loop // once last step is over
+} sequence_swap_e;
+
+// pre-flight analysis of a sequence, updated in O(1) by each step appended
+// values are those typed (speeds or frequencies): converted when reported,
+// with speed definitions then in use
+// ramps of first step start from standstill, moves end at standstill
+typedef struct {
+    uint32_t nb_moves;
+    uint32_t nb_jumps; // steps changing values at once (no delay)
+    uint32_t nb_reversals; // direction changes of a sensor not at standstill
+    uint32_t duration; // of ramps (s)
+    double move_distance; // m, of moves in meters
+    int64_t move_edges; // of moves in edges
+    // per sensor
+    float end_values[2]; // reached by last step
+    float areas[2]; // values integrated over ramps (value x s): distance
+    float peak_accelerations[2]; // steepest ramp (value per s)
+    uint32_t peak_steps[2]; // of steepest ramp (from 1, 0 if none)
+    float min_values[2]; // lowest non zero value reached by a step
+    uint32_t min_steps[2]; // step reaching it (from 1, 0 if none)
+    float max_values[2]; // highest value reached by a step
+    uint32_t max_steps[2];
+} sequence_preflight_t;
+
+// reads steps one after the other without decoding whole sequence
+typedef struct {
+    uint8_t slot;
+    bool swapped; // last step read is first one of a newly swapped sequence
+    uint32_t offset; // in arena of next step
+    uint32_t index; // of next step
+    // previous step as stored
+    int32_t first;
+    int32_t second;
+    uint8_t directions;
+    uint16_t delay;
+} sequence_cursor_t;
+
+// allocates arena, to be called once before any other function
+void sequence_store_init();
+// same with a given arena (host tests)
+void sequence_store_init_arena(uint8_t* buffer, uint32_t size);
+// empties recording slot
+void sequence_store_record();
+// encodes a step at end of recording slot, returns false if it is full
+bool sequence_store_append(const sequence_values_t* p_values);
+// recording slot becomes active one, previous active one is dropped
+void sequence_store_swap();
+// swap done by cursors reading active slot, returns false if nothing was recorded
+bool sequence_store_request_swap(sequence_swap_e when);
+sequence_swap_e sequence_store_get_pending_swap();
+// number of steps of active slot and of recording slot
+uint32_t sequence_store_count();
+uint32_t sequence_store_recorded_count();
+// bytes used by active slot and size of arena
+uint32_t sequence_store_used();
+uint32_t sequence_store_capacity();
+// pre-flight analysis of active slot and of recording slot (no decoding)
+const sequence_preflight_t* sequence_store_get_preflight();
+const sequence_preflight_t* sequence_store_get_recorded_preflight();
+
+// positions cursor before first step
+void sequence_cursor_start(sequence_cursor_t* p_cursor);
+// decodes next step into p_values, returns false when there is no more step
+// performs pending swap when due and carries on with first step of new sequence
+bool sequence_cursor_next(sequence_cursor_t* p_cursor, sequence_values_t* p_values);
+
+#endif
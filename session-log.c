@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Compact log of console sessions
+ */
+
+#include "session-log.h"
+
+#include <string.h>
+
+// largest varint
+#define MAX_VARINT_SIZE 5
+
+static uint8_t* put_varint(uint8_t* p, uint32_t value) {
+    while(value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+// out: NULL if varint goes beyond end
+static const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint32_t* p_value) {
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    do {
+        if(p >= end || shift > 28) {
+            return NULL;
+        }
+        value |= (uint32_t)(*p & 0x7F) << shift;
+        shift += 7;
+    } while(*p++ & 0x80);
+    *p_value = value;
+    return p;
+}
+
+void session_log_init(session_log_t* p_log, uint8_t* buffer, uint32_t size) {
+    p_log->buffer = buffer;
+    p_log->size = size;
+    p_log->used = 0;
+    p_log->last_tick = 0;
+    p_log->text_length_offset = 0;
+    p_log->full = false;
+}
+
+// starts a record, if room is left for payload_size
+// out: where payload goes, NULL if log is full
+static uint8_t* put_header(session_log_t* p_log, session_record_e type, uint32_t tick, uint32_t payload_size) {
+    uint8_t* p = p_log->buffer + p_log->used;
+    if(p_log->full || p_log->size - p_log->used < 1 + MAX_VARINT_SIZE + payload_size) {
+        p_log->full = true;
+        return NULL;
+    }
+    p_log->text_length_offset = 0;
+    *p++ = type;
+    p = put_varint(p, p_log->used == 0 ? 0 : tick - p_log->last_tick);
+    p_log->last_tick = tick;
+    return p;
+}
+
+void session_log_put_state(session_log_t* p_log, uint32_t tick, const void* p_state, uint32_t length) {
+    uint8_t* p = put_header(p_log, e_session_state, tick, MAX_VARINT_SIZE + length);
+    if(p == NULL) {
+        return;
+    }
+    p = put_varint(p, length);
+    memcpy(p, p_state, length);
+    p_log->used = p + length - p_log->buffer;
+}
+
+void session_log_put_text(session_log_t* p_log, session_record_e type, uint32_t tick,
+                          const uint8_t* p_chars, uint32_t length) {
+    uint8_t* p;
+    uint32_t chunk;
+    while(length != 0) {
+        p = p_log->buffer + p_log->text_length_offset;
+        if(p_log->text_length_offset == 0 || p_log->text_type != type || tick != p_log->last_tick ||
+           *p == SESSION_MAX_TEXT_LENGTH) {
+            p = put_header(p_log, type, tick, 2);
+            if(p == NULL) {
+                return;
+            }
+            p_log->text_length_offset = p - p_log->buffer;
+            p_log->text_type = type;
+            *p = 0;
+            p_log->used = p_log->text_length_offset + 1;
+        }
+        chunk = SESSION_MAX_TEXT_LENGTH - *p;
+        if(chunk > length) {
+            chunk = length;
+        }
+        if(chunk > p_log->size - p_log->used) {
+            p_log->full = true;
+            chunk = p_log->size - p_log->used;
+        }
+        memcpy(p_log->buffer + p_log->used, p_chars, chunk);
+        *p += chunk;
+        p_log->used += chunk;
+        p_chars += chunk;
+        length -= chunk;
+        if(p_log->full) {
+            return;
+        }
+    }
+}
+
+void session_log_put_edges(session_log_t* p_log, uint32_t tick,
+                           uint32_t max_count1, uint32_t max_count2, uint8_t flags) {
+    uint8_t* p = put_header(p_log, e_session_edges, tick, 2 * MAX_VARINT_SIZE + 1);
+    if(p == NULL) {
+        return;
+    }
+    p = put_varint(p, max_count1);
+    p = put_varint(p, max_count2);
+    *p++ = flags;
+    p_log->used = p - p_log->buffer;
+}
+
+uint32_t session_log_get(const uint8_t* log, uint32_t size, uint32_t offset, session_record_t* p_record) {
+    const uint8_t* end = log + size;
+    const uint8_t* p = log + offset;
+    if(offset >= size || *p > e_session_edges) {
+        return 0;
+    }
+    memset(p_record, 0, sizeof(session_record_t));
+    p_record->type = *p++;
+    p = get_varint(p, end, &p_record->ticks);
+    if(p == NULL) {
+        return 0;
+    }
+    switch(p_record->type) {
+        case e_session_state:
+            p = get_varint(p, end, &p_record->length);
+            break;
+        case e_session_edges:
+            p = get_varint(p, end, &p_record->max_count1);
+            if(p != NULL) {
+                p = get_varint(p, end, &p_record->max_count2);
+            }
+            if(p == NULL || p >= end) {
+                return 0;
+            }
+            p_record->flags = *p++;
+            return p - log;
+        default:
+            p_record->length = p < end ? *p++ : 0;
+            break;
+    }
+    if(p == NULL || p_record->length > (uint32_t)(end - p)) {
+        return 0;
+    }
+    p_record->data = p;
+    return p + p_record->length - log;
+}
@@ -0,0 +1,76 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// log of a console session: what goes through console and what output engine is given,
+// time stamped in sequence scheduler ticks (see session.h)
+// shared by firmware (session.c) and host diff (host/session-diff.c)
+// so it must not depend on any pico header
+//
+// a log is a sequence of records: type byte, ticks since previous record (varint), then
+//  - state: length (varint) and firmware state at start of log (opaque)
+//  - input, prompt input, output: length (one byte) and characters
+//    (characters of a same tick are appended to the last record, up to 255)
+//  - edges: 1/4 period of sensor 1 and 2 in µs (varints, 0 when stopped) and flags byte
+//
+// a log is dumped on console as: SESSION_SYNC1, SESSION_SYNC2, SESSION_VERSION,
+// size (32 bits, little endian), log, then checksum such as sum of bytes after sync bytes is zero
+
+#define SESSION_SYNC1 0xC3
+#define SESSION_SYNC2 0x3C
+#define SESSION_VERSION 1
+
+typedef enum {
+    e_session_state,
+    e_session_input, // typed while a sequence (or any other command) runs
+    e_session_prompt_input, // typed at prompt, replayed without waiting
+    e_session_output,
+    e_session_edges
+} session_record_e;
+
+// edges flags
+#define SESSION_EDGES_REVERSE1 0x01
+#define SESSION_EDGES_REVERSE2 0x02
+#define SESSION_EDGES_TARGETED1 0x04
+#define SESSION_EDGES_TARGETED2 0x08
+#define SESSION_EDGES_BACKEND_SHIFT 4
+
+#define SESSION_MAX_TEXT_LENGTH 255
+
+typedef struct {
+    uint8_t* buffer;
+    uint32_t size;
+    uint32_t used;
+    uint32_t last_tick; // tick of last record
+    // length byte of last record if text (characters of same tick are appended), else 0
+    uint32_t text_length_offset;
+    uint8_t text_type;
+    bool full;
+} session_log_t;
+
+typedef struct {
+    session_record_e type;
+    uint32_t ticks; // since previous record
+    // state, input and output
+    const uint8_t* data;
+    uint32_t length;
+    // edges
+    uint32_t max_count1;
+    uint32_t max_count2;
+    uint8_t flags;
+} session_record_t;
+
+void session_log_init(session_log_t* p_log, uint8_t* buffer, uint32_t size);
+// records are dropped once log is full (p_log->full is set)
+void session_log_put_state(session_log_t* p_log, uint32_t tick, const void* p_state, uint32_t length);
+void session_log_put_text(session_log_t* p_log, session_record_e type, uint32_t tick,
+                          const uint8_t* p_chars, uint32_t length);
+void session_log_put_edges(session_log_t* p_log, uint32_t tick,
+                           uint32_t max_count1, uint32_t max_count2, uint8_t flags);
+// decodes record at offset of log
+// out: offset of next record, 0 if none (end of log or truncated record)
+uint32_t session_log_get(const uint8_t* log, uint32_t size, uint32_t offset, session_record_t* p_record);
+
+#endif
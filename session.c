@@ -0,0 +1,244 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Record and replay of console sessions
+ */
+
+#include "session.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdio/driver.h"
+#include "pico/stdio_usb.h"
+#include "pico/stdlib.h"
+
+#include "session-log.h"
+#include "sync.h"
+
+static int session_in_chars(char* buf, int length);
+static void session_out_chars(const char* buf, int length);
+
+static stdio_driver_t session_driver = {
+    .out_chars = session_out_chars,
+    .in_chars = session_in_chars,
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    .crlf_enabled = PICO_STDIO_DEFAULT_CRLF
+#endif
+};
+
+static uint8_t recorded_buffer[SESSION_LOG_SIZE];
+static uint8_t replayed_buffer[SESSION_LOG_SIZE];
+static session_log_t recorded_log = {recorded_buffer, SESSION_LOG_SIZE, 0, 0, 0, 0, false};
+static session_log_t replayed_log = {replayed_buffer, SESSION_LOG_SIZE, 0, 0, 0, 0, false};
+
+static volatile session_mode_e mode = e_session_idle;
+// log written by recording or replay
+static session_log_t* p_log = &recorded_log;
+static uint16_t time_scale = 1;
+static bool prompt = false;
+
+// replay: next input record of recorded log, and characters of it already fed
+static uint32_t replay_offset;
+static session_record_t replay_record;
+static uint32_t replay_fed;
+// tick replay_record is due on, replayed timebase
+static uint32_t replay_tick;
+static bool replay_over;
+
+static void session_out_chars(const char* buf, int length) {
+    stdio_usb.out_chars(buf, length);
+    session_log_put_text(p_log, e_session_output, sync_get_tick(), (const uint8_t*)buf, length);
+}
+
+// next input of recorded log, ticks of records skipped are accounted for
+// out: false if none left
+static bool next_replay_input() {
+    uint32_t next;
+    while((next = session_log_get(recorded_log.buffer, recorded_log.used, replay_offset, &replay_record)) != 0) {
+        replay_offset = next;
+        replay_tick += replay_record.ticks;
+        if(replay_record.type == e_session_input || replay_record.type == e_session_prompt_input) {
+            replay_fed = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int feed_replay_input(char* buf, int length) {
+    const uint32_t tick = sync_get_tick();
+    uint32_t nb_chars;
+    if(replay_over) {
+        return PICO_ERROR_NO_DATA;
+    }
+    while(replay_fed == replay_record.length) {
+        if(!next_replay_input()) {
+            replay_over = true;
+            return PICO_ERROR_NO_DATA;
+        }
+    }
+    if(replay_record.type == e_session_prompt_input) {
+        if(!prompt) {
+            return PICO_ERROR_NO_DATA;
+        }
+        replay_tick = tick; // whatever time was spent at prompt
+    } else if((int32_t)(tick - replay_tick) < 0) {
+        return PICO_ERROR_NO_DATA;
+    }
+    nb_chars = replay_record.length - replay_fed;
+    if(nb_chars > (uint32_t)length) {
+        nb_chars = length;
+    }
+    memcpy(buf, replay_record.data + replay_fed, nb_chars);
+    replay_fed += nb_chars;
+    session_log_put_text(p_log, replay_record.type, tick, (const uint8_t*)buf, nb_chars);
+    return nb_chars;
+}
+
+static int session_in_chars(char* buf, int length) {
+    const int nb_chars = stdio_usb.in_chars(buf, length);
+    if(mode == e_session_recording) {
+        if(nb_chars > 0) {
+            session_log_put_text(p_log, prompt ? e_session_prompt_input : e_session_input, sync_get_tick(),
+                                 (const uint8_t*)buf, nb_chars);
+        }
+        return nb_chars;
+    }
+    if(nb_chars > 0) { // anything typed during replay ends it (^c cancels what runs)
+        replay_over = true;
+        return nb_chars;
+    }
+    return feed_replay_input(buf, length);
+}
+
+// console goes through session driver
+static void start(session_mode_e new_mode, session_log_t* p_new_log, uint16_t new_time_scale) {
+    p_log = p_new_log;
+    time_scale = new_time_scale;
+    replay_over = false;
+    stdio_set_driver_enabled(&session_driver, true);
+    stdio_set_driver_enabled(&stdio_usb, false);
+    mode = new_mode;
+}
+
+void session_record(const void* p_state, uint32_t state_size) {
+    session_stop();
+    session_log_init(&recorded_log, recorded_buffer, SESSION_LOG_SIZE);
+    session_log_init(&replayed_log, replayed_buffer, SESSION_LOG_SIZE);
+    session_log_put_state(&recorded_log, sync_get_tick(), p_state, state_size);
+    start(e_session_recording, &recorded_log, 1);
+}
+
+void session_stop() {
+    if(mode == e_session_idle) {
+        return;
+    }
+    mode = e_session_idle;
+    time_scale = 1;
+    stdio_set_driver_enabled(&stdio_usb, true);
+    stdio_set_driver_enabled(&session_driver, false);
+}
+
+bool session_get_recorded_state(void* p_state, uint32_t state_size) {
+    session_record_t state;
+    if(session_log_get(recorded_log.buffer, recorded_log.used, 0, &state) == 0 ||
+       state.type != e_session_state || state.length != state_size) {
+        return false;
+    }
+    memcpy(p_state, state.data, state_size);
+    return true;
+}
+
+bool session_load_recorded(const uint8_t* log, uint32_t size) {
+    session_record_t state;
+    if(mode != e_session_idle || size > SESSION_LOG_SIZE ||
+       session_log_get(log, size, 0, &state) == 0 || state.type != e_session_state) {
+        return false;
+    }
+    session_log_init(&recorded_log, recorded_buffer, SESSION_LOG_SIZE);
+    memcpy(recorded_buffer, log, size);
+    recorded_log.used = size;
+    return true;
+}
+
+void session_replay(uint16_t new_time_scale) {
+    session_record_t state;
+    session_stop();
+    replay_offset = session_log_get(recorded_log.buffer, recorded_log.used, 0, &state);
+    session_log_init(&replayed_log, replayed_buffer, SESSION_LOG_SIZE);
+    session_log_put_state(&replayed_log, sync_get_tick(), state.data, state.length);
+    replay_tick = sync_get_tick();
+    replay_record.length = 0;
+    replay_fed = 0;
+    start(e_session_replaying, &replayed_log, new_time_scale);
+}
+
+session_mode_e session_get_mode() {
+    return mode;
+}
+
+uint16_t session_get_time_scale() {
+    return time_scale;
+}
+
+void session_set_prompt(bool at_prompt) {
+    prompt = at_prompt;
+}
+
+void session_log_edges(const intercore_data_t* p_data) {
+    if(mode == e_session_idle) {
+        return;
+    }
+    session_log_put_edges(p_log, sync_get_tick(), p_data->max_count1, p_data->max_count2,
+                          (p_data->invert1 ? SESSION_EDGES_REVERSE1 : 0) |
+                          (p_data->invert2 ? SESSION_EDGES_REVERSE2 : 0) |
+                          (p_data->targeted1 ? SESSION_EDGES_TARGETED1 : 0) |
+                          (p_data->targeted2 ? SESSION_EDGES_TARGETED2 : 0) |
+                          p_data->backend << SESSION_EDGES_BACKEND_SHIFT);
+}
+
+void session_poll() {
+    if(mode == e_session_recording && recorded_log.full) {
+        session_stop();
+        printf("\nSession log full, recording stopped\n");
+    } else if(mode == e_session_replaying && (replay_over || replayed_log.full)) {
+        session_stop();
+        printf("\nReplay over, r> dumps logs\n");
+    }
+}
+
+void session_print_status() {
+    static const char* mode_names[] = {"idle", "recording", "replaying"};
+    printf("Session: %s", mode_names[mode]);
+    if(mode == e_session_replaying) {
+        printf(" %hux", time_scale);
+    }
+    printf(", recorded %lu bytes%s, replayed %lu bytes%s (of %u)\n",
+           recorded_log.used, recorded_log.full ? " (full)" : "",
+           replayed_log.used, replayed_log.full ? " (full)" : "", SESSION_LOG_SIZE);
+}
+
+static void dump_log(const session_log_t* p_dumped) {
+    const uint8_t header[] = {SESSION_VERSION, p_dumped->used, p_dumped->used >> 8,
+                              p_dumped->used >> 16, p_dumped->used >> 24};
+    uint8_t checksum = 0;
+    uint32_t i;
+    putchar_raw(SESSION_SYNC1);
+    putchar_raw(SESSION_SYNC2);
+    for(i = 0; i < sizeof(header); i++) {
+        checksum += header[i];
+        putchar_raw(header[i]);
+    }
+    for(i = 0; i < p_dumped->used; i++) {
+        checksum += p_dumped->buffer[i];
+        putchar_raw(p_dumped->buffer[i]);
+    }
+    putchar_raw(-checksum);
+}
+
+void session_dump() {
+    dump_log(&recorded_log);
+    dump_log(&replayed_log);
+    printf("\n");
+}
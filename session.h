@@ -0,0 +1,60 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "output-backend.h"
+
+// record and replay of console sessions, for regression of firmware behavior
+//
+// while recording, a stdio driver stands in for the USB one: it passes characters through
+// and logs console input and output, along with parameters given to output engine
+// (edge periods and directions), time stamped in sequence scheduler ticks (see session-log.h)
+// replay starts from recorded state and feeds recorded input again: input typed at prompt
+// at once (idle time is skipped), other input on its tick, while sequence scheduler runs
+// time_scale times faster; replayed session is logged the same way
+// both logs are dumped on console and compared on host (host/session-diff.c)
+//
+// on target, time scale is bounded by the scheduler tick it divides (down to 100 µs, with
+// a step and console processing on each); the host replays in simulated time with no
+// such bound (host/session-replay.c)
+
+#define SESSION_LOG_SIZE (16 * 1024)
+#define SESSION_DEFAULT_TIME_SCALE 100
+// scheduler tick down to 100 µs
+#define SESSION_MAX_TIME_SCALE 1000
+
+typedef enum {
+    e_session_idle,
+    e_session_recording,
+    e_session_replaying
+} session_mode_e;
+
+// starts recording, state_size bytes of p_state are the firmware state replay starts from
+void session_record(const void* p_state, uint32_t state_size);
+// ends recording or replay
+void session_stop();
+// state recorded session started from, to be restored before replay
+// out: false if nothing was recorded
+bool session_get_recorded_state(void* p_state, uint32_t state_size);
+// recorded log taken from a dump (as is, without header nor checksum), e.g. by host replay
+// out: false if a session is running, or log does not fit or does not start with a state
+bool session_load_recorded(const uint8_t* log, uint32_t size);
+// starts replay of recorded session
+void session_replay(uint16_t time_scale);
+session_mode_e session_get_mode();
+// divider of sequence scheduler period, 1 unless replaying
+uint16_t session_get_time_scale();
+// tells if console waits for a command at prompt
+void session_set_prompt(bool at_prompt);
+// logs parameters given to output engine
+void session_log_edges(const intercore_data_t* p_data);
+// ends recording once log is full and replay once recorded input is over
+// to be run as a background task
+void session_poll();
+void session_print_status();
+// dumps recorded and replayed logs on console
+void session_dump();
+
+#endif
@@ -0,0 +1,408 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Benchmarks of hot paths, run on target in system clock cycles (SysTick):
+ * output interrupt, conversions, parsing, formatting, journal and full sequence runs
+ * Results are printed as JSON on the USB console each time it connects,
+ * to be compared with a baseline by host/bench-compare.c
+ * A benchmark may name a reference one: its delta to it (min cycles) is printed too
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware/clocks.h"
+#include "hardware/pwm.h"
+#include "hardware/structs/systick.h"
+#include "hardware/sync.h"
+#include "pico/stdio_usb.h"
+#include "pico/stdlib.h"
+
+#include "journal.h"
+#include "pwm-managed.h"
+#include "sequence-store.h"
+#include "speed-sensor-util.h"
+#include "standstill.h"
+#include "sweep.h"
+#include "timeline.h"
+
+// what firmware modules expect from speed-sensor.c
+sequence_values_t next_values = {0, 0, false, false, 0};
+speed_definition_t speed_definitions[NB_SPEED_DEFINITIONS];
+queue_t call_queue;
+
+void run_background_tasks() {
+}
+
+// timed batches of each benchmark, results are the mean and the best batch
+#define BENCH_NB_BATCHES 16
+
+typedef struct {
+    const char* name;
+    void (*setup)(); // NULL if none
+    void (*run)(uint32_t nb_iterations);
+    // iterations per timed batch, well below 2^24 cycles (SysTick wraps)
+    uint32_t batch;
+    // name of an earlier benchmark this one is compared to, NULL if none
+    const char* reference;
+} bench_t;
+
+// keeps results alive so that benchmarked code is not optimized out
+static volatile uint32_t sink;
+
+// output interrupt: counting down a long period (most interrupts)
+static void setup_isr_count() {
+    const channel_params_t params = {1000000, false, false, 0};
+    pwm_output_backend.set_channel_params(1, &params);
+    pwm_output_backend.set_channel_params(2, &params);
+}
+
+// output interrupt: an edge of each sensor on every interrupt (worst case)
+static void setup_isr_edge() {
+    const channel_params_t params = {1, false, false, 0};
+    pwm_output_backend.set_channel_params(1, &params);
+    pwm_output_backend.set_channel_params(2, &params);
+}
+
+static void run_isr(uint32_t nb_iterations) {
+    while(nb_iterations-- != 0) {
+        on_pwm_wrap();
+    }
+}
+
+// generic body of the same interrupt, as output interrupts were before output-config.h:
+// number of sensors, GPIO masks and features are read at run time, and direction and
+// target arming are tested on each edge (in RAM too, so that only bodies differ)
+typedef struct {
+    uint32_t max_count;
+    uint32_t count;
+    uint32_t mask;
+    const uint16_t* sequence;
+    uint8_t index;
+    bool reverse;
+    int64_t edge_count;
+    bool target_armed;
+    int64_t target;
+} generic_channel_t;
+
+typedef struct {
+    uint8_t nb_sensors;
+    bool edge_counters;
+    bool targets;
+    bool edge_probe;
+} generic_features_t;
+
+static generic_channel_t generic_channels[2];
+// volatile: not folded into code, as build options would be
+static volatile generic_features_t generic_features;
+
+static void __not_in_flash_func(on_generic_wrap)() {
+    ISR_LOAD_START
+    generic_channel_t* p_channel;
+    uint8_t i;
+    pwm_clear_irq(0);
+    for(i = 0; i < generic_features.nb_sensors; i++) {
+        p_channel = &generic_channels[i];
+        if(p_channel->max_count == 0) {
+            continue;
+        }
+        if(p_channel->count != p_channel->max_count) {
+            p_channel->count++;
+            continue;
+        }
+        p_channel->count = 1;
+        gpio_put_masked(p_channel->mask, p_channel->sequence[p_channel->index]);
+        if(p_channel->reverse) {
+            p_channel->index = (p_channel->index - 1) & 3;
+        } else {
+            p_channel->index = (p_channel->index + 1) & 3;
+        }
+        if(generic_features.edge_probe && edge_probe_armed) {
+            edge_probe_time = time_us_32();
+            edge_probe_armed = false;
+        }
+        if(generic_features.edge_counters) {
+            p_channel->edge_count += p_channel->reverse ? -1 : 1;
+            if(generic_features.targets && p_channel->target_armed && p_channel->edge_count == p_channel->target) {
+                p_channel->max_count = 0;
+                p_channel->target_armed = false;
+                journal_log(e_journal_target, i + 1, 0);
+            }
+        }
+    }
+    ISR_LOAD_END(isr_busy_cycles)
+}
+
+// same features as the specialized interrupt is built with, period of both sensors
+static void setup_generic(uint32_t max_count) {
+    uint8_t i;
+    generic_features.nb_sensors = CORE1_SENSOR2 ? 2 : 1;
+    generic_features.edge_counters = OUTPUT_EDGE_COUNTERS;
+    generic_features.targets = OUTPUT_TARGETS;
+    generic_features.edge_probe = OUTPUT_EDGE_PROBE;
+    for(i = 0; i < 2; i++) {
+        memset(&generic_channels[i], 0, sizeof(generic_channel_t));
+        generic_channels[i].max_count = max_count;
+        generic_channels[i].count = 1;
+    }
+    generic_channels[0].mask = SENSOR1_OUT_MASK;
+    generic_channels[0].sequence = pulse_out_sequence1;
+    generic_channels[1].mask = SENSOR2_OUT_MASK;
+    generic_channels[1].sequence = pulse_out_sequence2;
+}
+
+static void setup_generic_count() {
+    setup_generic(1000000);
+}
+
+static void setup_generic_edge() {
+    setup_generic(1);
+}
+
+static void run_generic_isr(uint32_t nb_iterations) {
+    while(nb_iterations-- != 0) {
+        on_generic_wrap();
+    }
+}
+
+static sweep_t bench_sweep;
+static uint32_t bench_period;
+
+static void setup_sweep() {
+    sweep_init(&bench_sweep, e_sweep_log, MIN_FREQUENCY, MAX_FREQUENCY, SWEEP_MAX_DURATION, 0);
+    bench_period = sweep_get_first_period(&bench_sweep);
+}
+
+static void run_sweep_edge(uint32_t nb_iterations) {
+    while(nb_iterations-- != 0) {
+        bench_period = sweep_next_edge(&bench_sweep, bench_period);
+    }
+}
+
+static standstill_t bench_standstill;
+
+static void setup_standstill() {
+    standstill_params_t params;
+    standstill_init_params(&params, 4, 100, 0.05f);
+    bench_period = standstill_start(&bench_standstill, &params, 1);
+}
+
+static void run_standstill_edge(uint32_t nb_iterations) {
+    int8_t direction = 1;
+    while(nb_iterations-- != 0) {
+        direction = standstill_next_edge(&bench_standstill, direction, bench_period, &bench_period);
+    }
+}
+
+// speed (or frequency) to quarter period, as sent to outputs on each tick
+static void run_get_period(uint32_t nb_iterations) {
+    uint32_t period = 0;
+    while(nb_iterations-- != 0) {
+        period += get_period(get_frequency(1, (float)(nb_iterations & 0x3FF) * 0.37f));
+    }
+    sink = period;
+}
+
+// cost of one journal event, as logged by interrupts and foreground
+static void run_journal_log(uint32_t nb_iterations) {
+    while(nb_iterations-- != 0) {
+        journal_log(e_journal_params_applied, 1 | JOURNAL_REVERSE, nb_iterations);
+    }
+}
+
+static const char* const bench_inputs[] = {
+    "120",
+    "60:80-+",
+    "5\">80:60-",
+    "@200e,50",
+    "wl1,100,10",
+    "ws0.5,2000,60,5",
+    "c2,1.5,40-",
+    "z3,50,0.05",
+    "t10",
+    "s",
+};
+#define NB_BENCH_INPUTS (sizeof(bench_inputs) / sizeof(bench_inputs[0]))
+
+static void run_process_input(uint32_t nb_iterations) {
+    uint32_t commands = 0;
+    while(nb_iterations-- != 0) {
+        commands += process_input(bench_inputs[nb_iterations % NB_BENCH_INPUTS]);
+    }
+    sink = commands;
+}
+
+static void run_format_float(uint32_t nb_iterations) {
+    static const float values[] = {0.1234f, 42.5f, 512.25f, 7300.0f};
+    char buffer[16];
+    while(nb_iterations-- != 0) {
+        _unsafe_format_float(values[nb_iterations & 3], buffer);
+    }
+    sink = buffer[0];
+}
+
+// sequence of BENCH_SEQUENCE_STEPS ramps up and down, 1 s each
+#define BENCH_SEQUENCE_STEPS 32
+
+static void setup_sequence() {
+    sequence_values_t values;
+    uint32_t i;
+    memset(&values, 0, sizeof(values));
+    sequence_store_record();
+    for(i = 0; i < BENCH_SEQUENCE_STEPS; i++) {
+        values.firstValue = (float)(i % 8) * 25.0f;
+        values.secondValue = (float)(i % 5) * 40.0f;
+        values.firstReverse = i % 8 == 7;
+        values.delay = 1;
+        sequence_store_append(&values);
+    }
+    sequence_store_swap();
+}
+
+// one whole sequence as the scheduler plays it, without waiting for ticks:
+// steps decoded from store, ramps and periods of both sensors on each tick
+static void run_sequence(uint32_t nb_iterations) {
+    sequence_cursor_t cursor;
+    sequence_values_t step;
+    float first = 0.0f, second = 0.0f, first_step, second_step;
+    uint32_t period = 0;
+    uint16_t i, nb_ticks;
+    while(nb_iterations-- != 0) {
+        sequence_cursor_start(&cursor);
+        while(sequence_cursor_next(&cursor, &step)) {
+            nb_ticks = STEPS_PER_SECOND * step.delay;
+            first_step = (step.firstValue - first) / nb_ticks;
+            second_step = (step.secondValue - second) / nb_ticks;
+            for(i = 1; i < nb_ticks; i++) {
+                first += first_step;
+                second += second_step;
+                period += get_period(get_frequency(1, first)) + get_period(get_frequency(2, second));
+            }
+            first = step.firstValue;
+            second = step.secondValue;
+            period += get_period(get_frequency(1, first)) + get_period(get_frequency(2, second));
+        }
+    }
+    sink = period;
+}
+
+static timeline_channel_t bench_channels[NB_SPEED_DEFINITIONS];
+static timeline_event_t bench_events[NB_SPEED_DEFINITIONS];
+static timelines_t bench_timelines;
+
+// timelines of both sensors with mismatched step lengths
+static void setup_timelines() {
+    uint32_t i;
+    timeline_init(&bench_timelines, bench_channels, bench_events, NB_SPEED_DEFINITIONS);
+    for(i = 0; i < BENCH_SEQUENCE_STEPS; i++) {
+        timeline_append(&bench_timelines, 0, (float)(i % 8) * 25.0f, false, 7 + i % 3);
+        timeline_append(&bench_timelines, 1, (float)(i % 5) * 40.0f, false, 11 - i % 4);
+    }
+}
+
+// whole timelines as the scheduler plays them, one poll and two periods per tick
+static void run_timelines(uint32_t nb_iterations) {
+    static const float values[NB_SPEED_DEFINITIONS] = {0.0f, 0.0f};
+    static const bool reverses[NB_SPEED_DEFINITIONS] = {false, false};
+    uint32_t tick, period = 0;
+    while(nb_iterations-- != 0) {
+        timeline_start(&bench_timelines, 0, values, reverses, false);
+        for(tick = 0; timeline_poll(&bench_timelines, tick); tick++) {
+            period += get_period(get_frequency(1, timeline_get_value(&bench_timelines, 0, tick))) +
+                      get_period(get_frequency(2, timeline_get_value(&bench_timelines, 1, tick)));
+        }
+    }
+    sink = period;
+}
+
+static const bench_t benchmarks[] = {
+    {"isr_pwm_count", setup_isr_count, run_isr, 1000, NULL},
+    {"isr_pwm_edge", setup_isr_edge, run_isr, 1000, NULL},
+    {"isr_generic_count", setup_generic_count, run_generic_isr, 1000, "isr_pwm_count"},
+    {"isr_generic_edge", setup_generic_edge, run_generic_isr, 1000, "isr_pwm_edge"},
+    {"sweep_log_edge", setup_sweep, run_sweep_edge, 1000, NULL},
+    {"standstill_edge", setup_standstill, run_standstill_edge, 1000, NULL},
+    {"get_period", NULL, run_get_period, 1000, NULL},
+    {"process_input", NULL, run_process_input, 100, NULL},
+    {"format_float", NULL, run_format_float, 100, NULL},
+    {"journal_log", journal_clear, run_journal_log, 1000, NULL},
+    {"sequence_run", setup_sequence, run_sequence, 1, NULL},
+    {"timeline_run", setup_timelines, run_timelines, 1, NULL},
+};
+#define NB_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+// cycles of a batch, interrupts disabled so that USB does not get in
+static uint32_t time_batch(const bench_t* p_bench) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    const uint32_t start_tick = systick_hw->cvr;
+    uint32_t cycles;
+    p_bench->run(p_bench->batch);
+    cycles = (start_tick - systick_hw->cvr) & 0x00FFFFFF;
+    restore_interrupts(interrupts);
+    return cycles;
+}
+
+// best batch of each benchmark (cycles per iteration), for deltas to references
+static double min_cycles_per_iteration[NB_BENCHMARKS];
+
+static void print_delta(const bench_t* p_bench, uint32_t index) {
+    uint32_t i;
+    for(i = 0; i < index; i++) {
+        if(strcmp(benchmarks[i].name, p_bench->reference) == 0) {
+            printf(",\"reference\":\"%s\",\"delta_min_cycles\":%.1f", p_bench->reference,
+                   min_cycles_per_iteration[index] - min_cycles_per_iteration[i]);
+            return;
+        }
+    }
+}
+
+static void run_benchmarks() {
+    const bench_t* p_bench;
+    uint64_t total;
+    uint32_t i, j, cycles, min_cycles;
+    printf("{\"bench\":\"speed_sensor_bench\",\"clock_hz\":%lu,\"batches\":%d,\"results\":[\n",
+           clock_get_hz(clk_sys), BENCH_NB_BATCHES);
+    for(i = 0; i < NB_BENCHMARKS; i++) {
+        p_bench = &benchmarks[i];
+        if(p_bench->setup != NULL) {
+            p_bench->setup();
+        }
+        time_batch(p_bench); // warms up XIP cache
+        total = 0;
+        min_cycles = UINT32_MAX;
+        for(j = 0; j < BENCH_NB_BATCHES; j++) {
+            cycles = time_batch(p_bench);
+            total += cycles;
+            if(cycles < min_cycles) {
+                min_cycles = cycles;
+            }
+        }
+        // cycles per iteration
+        min_cycles_per_iteration[i] = (double)min_cycles / p_bench->batch;
+        printf(" {\"name\":\"%s\",\"iterations\":%lu,\"cycles\":%.1f,\"min_cycles\":%.1f",
+               p_bench->name, p_bench->batch * BENCH_NB_BATCHES,
+               (double)total / (p_bench->batch * BENCH_NB_BATCHES), min_cycles_per_iteration[i]);
+        if(p_bench->reference != NULL) {
+            print_delta(p_bench, i);
+        }
+        printf("}%s\n", i + 1 < NB_BENCHMARKS ? "," : "");
+    }
+    printf("]}\n");
+}
+
+int main() {
+    stdio_init_all();
+    journal_init();
+    sequence_store_init();
+    start_load_measurement();
+    while(true) {
+        while(!stdio_usb_connected()) {
+            sleep_ms(100);
+        }
+        sleep_ms(500); // host terminal gets ready
+        run_benchmarks();
+        while(stdio_usb_connected()) {
+            sleep_ms(100);
+        }
+    }
+}
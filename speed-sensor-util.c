@@ -1,38 +1,53 @@
 #include <ctype.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "pico/stdlib.h"
 
 #include "float_equality_ulp.h"
+#include "journal.h"
+#include "output-backend.h"
+#include "session.h"
 #include "speed-sensor.h"
+#include "standstill.h"
+#include "sweep.h"
+#include "sync.h"
+#include "telemetry.h"
+#include "timeline.h"
+#include "train-model.h"
 
 #include "speed-sensor-util.h"
 
 #define NO_REVSERSE_DEFINED "=="
 
-static bool test_reverse(const char* str) {
+// polling period of stdin when waiting for a line
+#define BACKGROUND_POLL_US 100
+
+command_argument_t command_argument;
+
+static bool test_reverse(const char* str, sequence_values_t* p_values) {
     if(are_strings_equal(str, NO_REVSERSE_DEFINED)) // very likey case nothing was found in input
      return true;
     if(are_strings_equal(str, "+") || are_strings_equal(str, "++")) {
-        next_values.firstReverse = false;
-        next_values.secondReverse = false;
+        p_values->firstReverse = false;
+        p_values->secondReverse = false;
         return true;
     }
     if(are_strings_equal(str, "+-")) {
-        next_values.firstReverse = false;
-        next_values.secondReverse = true;
+        p_values->firstReverse = false;
+        p_values->secondReverse = true;
         return true;
     }
     if(are_strings_equal(str, "-+")) {
-        next_values.firstReverse = true;
-        next_values.secondReverse = false;
+        p_values->firstReverse = true;
+        p_values->secondReverse = false;
         return true;
     }
     if(are_strings_equal(str, "-") || are_strings_equal(str, "--")) {
-        next_values.firstReverse = true;
-        next_values.secondReverse = true;
+        p_values->firstReverse = true;
+        p_values->secondReverse = true;
         return true;
     }
     return false;
@@ -52,12 +67,31 @@ char* _unsafe_format_float(float value, char* buffer) {
     return buffer;
 }
 
-float get_frequency(float speed) {
+void set_speed_definition(uint8_t sensor, uint16_t n_teeth, uint16_t diameter_mm, float gear_ratio) {
+    speed_definition_t* const p_definition = &speed_definitions[sensor - 1];
+    p_definition->n_teeth = n_teeth;
+    p_definition->diameter_mm = diameter_mm;
+    p_definition->gear_ratio = gear_ratio;
+    if(n_teeth == 0 || diameter_mm == 0) {
+        p_definition->hz_per_kmh = 0.0f;
+        return;
+    }
+    p_definition->hz_per_kmh = gear_ratio * n_teeth / (PI * 3.6f / 1000.0f * diameter_mm);
+}
+
+float get_frequency(uint8_t sensor, float speed) {
     speed = fabsf(speed);
     if(!value_is_speed()) {
         return speed;
     }
-    return speed * speed_definition.gear_ratio * speed_definition.n_teeth / (PI * 3.6f / 1000.0f * speed_definition.diameter_mm);
+    return speed * speed_definitions[sensor - 1].hz_per_kmh;
+}
+
+float get_value(uint8_t sensor, float frequency) {
+    if(!value_is_speed()) {
+        return frequency;
+    }
+    return frequency / speed_definitions[sensor - 1].hz_per_kmh;
 }
 
 uint32_t get_period(float freq) {
@@ -72,18 +106,30 @@ uint32_t get_period(float freq) {
     return round((1000000.0f/4.0f) / (float)freq);
 }
 
-float get_corrected_value(uint32_t period) {
+float get_corrected_value(uint8_t sensor, uint32_t period) {
     if(period==0) {
         return 0;
     }
+    return get_value(sensor, (1000000.0f/4.0f) / (float)period);
+}
+
+double get_distance(uint8_t sensor, int64_t edges) {
     if(!value_is_speed()) {
-        return (1000000.0f/4.0f) / (float)period; 
+        return 0.0;
     }
-    return PI * 3.6 * 1000000.0f / 4.0f / 1000.0f * speed_definition.diameter_mm /  (speed_definition.n_teeth * speed_definition.gear_ratio * (float)period);
+    // one sensor cycle (four edges) per tooth: 3.6 km/h is 1 m/s
+    // double: float would lose single edges past 2^24 of them (a few km)
+    return (double)edges / (4.0 * 3.6 * speed_definitions[sensor - 1].hz_per_kmh);
 }
 
 bool value_is_speed() {
-    return speed_definition.diameter_mm != 0 && speed_definition.n_teeth != 0;
+    return speed_definitions[0].hz_per_kmh != 0.0f && speed_definitions[1].hz_per_kmh != 0.0f;
+}
+
+bool are_speed_definitions_equal() {
+    return speed_definitions[0].n_teeth == speed_definitions[1].n_teeth &&
+           speed_definitions[0].diameter_mm == speed_definitions[1].diameter_mm &&
+           are_floats_equal_ulp(speed_definitions[0].gear_ratio, speed_definitions[1].gear_ratio);
 }
 
 bool are_sensors_equal(const sequence_values_t* pSeq) {
@@ -122,11 +168,26 @@ void print_help(bool extended) {
     const char* short_help_txt =    " {value1}[:{value2}][{rev_defs}] define immediate values\n"
      " {rev_defs} defines moving directions (forward/reverse)\n"
      " {delay}\"[>{value1}[:{value2}][{revDefs}]] new sequence item\n"
+     " @{distance}[e][,{decel}] move item: travel then stop\n"
      " ( start sequence\n"
      " ) end sequence\n"
      " ![!] execute sequence, infinite loop\n"
-     " !? print sequence\n"
+     " !? print sequence and its pre-flight analysis\n"
+     " !^[^] execute sequence on trigger [trigger advances steps]\n"
      " {n_teeth},{dia_mm}[,{ratio}] define speed to frequency parameters\n"
+     " {sensor}#{n_teeth},{dia_mm}[,{ratio}] same for one sensor only\n"
+     " t{rate} binary telemetry at {rate} Hz, t0 to stop\n"
+     " d[0] display odometer, reset odometer\n"
+     " b[{n}] list output backends [select backend {n}]\n"
+     " m train model drives outputs (notch/brake commands)\n"
+     " s[l|f|0] sync status [leader, follower, off]\n"
+     " r[+|-] session status [record, stop], r!{scale} replay, r> dump logs\n"
+     " w[l|s]{f1},{f2},{s}[,{n}] log sweep of sensor 1 [linear, stepped]\n"
+     " z[{a},{ms}[,{creep}]] standstill status [chatter at zero speed], z0 off\n"
+     " c{sensor},{delay},{value}[-] timeline step of one sensor, c list, c0 clear\n"
+     " c![!] run timelines of each sensor independently, infinite loop\n"
+     " j[0] dump event journal (kept over soft resets), clear it\n"
+     " k keep output state in flash now (restored at boot)\n"
      " ?[?] help, extended help\n";
 
     if(!extended) {
@@ -138,62 +199,340 @@ void print_help(bool extended) {
      "%s"
      "  with {value1}, {value2} define speed (or frequency)\n"
      "       If only one defined, define both as equal\n"
+     "        (same vehicle speed, at frequency of each sensor)\n"
      "       {rev_defs} + (both forward), -+ (first reverse only),\n"
      "        +- (second reverse only), - (both reversed)\n"
      "       {delay} timer value in seconds\n"
+     "       {distance} in meters, or in edges if followed by e\n"
+     "        travelled at current speed (at least %.1f Hz),\n"
+     "        then braking at {decel}, m/s2 (defaults to %.1f)\n"
+     "        or Hz/s (defaults to %.0f) if no speed definition\n"
      "       {n_teeth} number of teeth [%d, %d], 0 to disable frequency\n"
      "       Calculations done according to speed:\n"
      "        {diam_mm} diameter in millimeters [%d mm, %d mm]\n"
      "        {ratio} gear ratio [%.4f, %.1f], defaults to 1.0\n"
+     "       {sensor} 1 or 2, e.g. when wheels have different worn diameters\n"
+     "       {rate} telemetry frames per second [0, %d]\n"
+     "       {scale} replay speed-up of sequences [1, %d], defaults to %d\n"
+     "       {f1}, {f2} start and end frequencies of sweep, Hz (either way)\n"
+     "       {s} sweep duration in seconds [%.0f, %.0f]\n"
+     "       {n} steps per decade of stepped sweep [1, %d], defaults to %d\n"
+     "       {a} standstill chatter amplitude in edges [1, %d]\n"
+     "       {ms} longest interval between chatter edges [%d, %d]\n"
+     "       {creep} creep frequency, Hz (negative: reverse), below %.1f\n"
+     "       {delay} of timeline steps in seconds, by tenths\n"
      "Notes:\n"
      " no limit on values imposed, frequencies are clamped to [%.1f Hz, %.0f Hz]\n"
      " value of zero always indicates frequency and speed are null\n"
      " when speeds are considered, they are in km/h (and frequencies are in Hz)\n"
      " ^c: cancels current sequence, ^e: toggles character echo,\n"
+     " while a sequence runs: p pause/resume, n next step,\n"
+     "  o{value} speed (or frequency) offset (o alone to cancel),\n"
+     "  ( sequence items ) records next sequence, x swaps to it at next step,\n"
+     "  xx at end of sequence (output carries on without interruption),\n"
+     "  empty command: status\n"
+     " rising edge on trigger input (GPIO %d) starts a sequence armed\n"
+     "  with !^ or !^^ (then each edge advances to next step)\n"
+     " while train model runs: n{notch} [0, %d], b{brake} [0, %d],\n"
+     "  a{adhesion} peak adhesion (e.g. 0.33 dry, 0.05 leaves), ^c to leave\n"
+     " sweep: sensor 2 follows sensor 1 (same core), not on VR backend,\n"
+     "  marker on GPIO %d at each decade, ^c to stop (holds frequency)\n"
+     " standstill: stopped sensors generated by core1 chatter, not on VR backend\n"
+     " timelines: each sensor ramps through its own steps (up to %d), direction\n"
+     "  applies from start of step, looping timelines drift apart, ^c to stop\n"
+     " journal: last %d events of each core (commands, steps, params sent to\n"
+     "  and applied by core1, ^c, trigger, targets, underruns), time in s since boot\n"
      " empty command: details of current state\n",
-     short_help_txt, MIN_N_TEETH, MAX_N_TEETH, MIN_DIA_MM, MAX_DIA_MM, MIN_RATIO, MAX_RATIO, MIN_FREQUENCY, MAX_FREQUENCY);
+     short_help_txt, MOVE_CRAWL_FREQUENCY, MOVE_DEFAULT_DECELERATION, MOVE_DEFAULT_FREQUENCY_DECELERATION, MIN_N_TEETH, MAX_N_TEETH, MIN_DIA_MM, MAX_DIA_MM, MIN_RATIO, MAX_RATIO, TELEMETRY_MAX_RATE, SESSION_MAX_TIME_SCALE, SESSION_DEFAULT_TIME_SCALE,
+     SWEEP_MIN_DURATION, SWEEP_MAX_DURATION, SWEEP_MAX_STEPS_PER_DECADE, SWEEP_DEFAULT_STEPS_PER_DECADE,
+     STANDSTILL_MAX_AMPLITUDE, STANDSTILL_MIN_INTERVAL_MS, STANDSTILL_MAX_INTERVAL_MS, MIN_FREQUENCY, MIN_FREQUENCY, MAX_FREQUENCY,
+     TRIGGER_GPIO, TRAIN_MODEL_NB_NOTCHES, TRAIN_MODEL_NB_BRAKE_STEPS, SWEEP_MARKER_GPIO, TIMELINE_MAX_STEPS,
+     JOURNAL_RING_SIZE - 1);
 }
 
-command_e process_input(const char * input) {
+// parses a move: {target}[e][,{deceleration}]
+static command_e process_move(const char* input, sequence_values_t* p_values) {
+    char* end;
+    double distance;
+    long long edges = 0;
+    float deceleration = 0.0f;
+    uint8_t type = e_step_move_distance;
+#if !OUTPUT_TARGETS
+    return e_range_error; // output interrupts built without stop on target
+#endif
+    distance = strtod(input, &end);
+    if(end == input) {
+        return e_syntax_error;
+    }
+    if(*end == 'e') { // a whole number of edges
+        type = e_step_move_edges;
+        edges = strtoll(input, &end, 10);
+        if(*end != 'e') {
+            return e_syntax_error;
+        }
+        distance = 0.0;
+        end++;
+    }
+    if(*end == ',') {
+        input = end + 1;
+        deceleration = strtof(input, &end);
+        if(end == input) {
+            return e_syntax_error;
+        }
+        // NaN would pass a mere comparison
+        if(!isfinite(deceleration) || deceleration <= 0.0f) {
+            return e_range_error;
+        }
+    }
+    if(*end != '\0') {
+        return e_syntax_error;
+    }
+    if(!isfinite(distance) || distance < 0.0 || edges < 0 || edges > MAX_MOVE_EDGES ||
+       (type == e_step_move_distance && !value_is_speed())) {
+        return e_range_error;
+    }
+    // distance in edges of each sensor (strtoll saturates, so edges are checked above)
+    if(type == e_step_move_distance && (distance / get_distance(1, 1) > MAX_MOVE_EDGES ||
+                                        distance / get_distance(2, 1) > MAX_MOVE_EDGES)) {
+        return e_range_error;
+    }
+    p_values->type = type;
+    p_values->target_edges = edges;
+    p_values->target_distance = distance;
+    p_values->deceleration = deceleration;
+    p_values->delay = 0;
+    return e_new_record;
+}
+
+// parses a sweep: [l|s]{start},{end},{duration}[,{steps_per_decade}]
+static command_e process_sweep(const char* input) {
+    float start, end, duration;
+    int steps = SWEEP_DEFAULT_STEPS_PER_DECADE;
+    char str[8];
+    uint8_t mode = e_sweep_log;
+#if !OUTPUT_SWEEP
+    return e_range_error; // output interrupts built without sweep
+#endif
+    if(*input == 'l') {
+        mode = e_sweep_linear;
+        input++;
+    } else if(*input == 's') {
+        mode = e_sweep_stepped;
+        input++;
+    }
+    if(mode == e_sweep_stepped && sscanf(input, "%f,%f,%f,%d%7s", &start, &end, &duration, &steps, str) == 4) {
+        if(steps < 1 || steps > SWEEP_MAX_STEPS_PER_DECADE) {
+            return e_range_error;
+        }
+    } else if(sscanf(input, "%f,%f,%f%7s", &start, &end, &duration, str) != 3) {
+        return e_syntax_error;
+    }
+    if(start < MIN_FREQUENCY || start > MAX_FREQUENCY || end < MIN_FREQUENCY || end > MAX_FREQUENCY ||
+       start == end || duration < SWEEP_MIN_DURATION || duration > SWEEP_MAX_DURATION) {
+        return e_range_error;
+    }
+    command_argument.sweep_mode = mode;
+    command_argument.start_frequency = start;
+    command_argument.end_frequency = end;
+    command_argument.value = duration;
+    command_argument.integer = steps;
+    return e_sweep;
+}
+
+// parses a standstill model: [{amplitude},{max_interval_ms}[,{creep_frequency}]]
+static command_e process_standstill(const char* input) {
+    int amplitude, interval_ms;
+    float creep = 0.0f;
+    char str[8];
+#if !OUTPUT_STANDSTILL
+    return e_range_error; // output interrupts built without standstill model
+#endif
+    if(*input == '\0') {
+        command_argument.integer = -1;
+        return e_standstill;
+    }
+    if(are_strings_equal(input, "0")) {
+        amplitude = 0;
+        interval_ms = STANDSTILL_MAX_INTERVAL_MS;
+    } else if(sscanf(input, "%d,%d,%f%7s", &amplitude, &interval_ms, &creep, str) != 3 &&
+              sscanf(input, "%d,%d%7s", &amplitude, &interval_ms, str) != 2) {
+        return e_syntax_error;
+    }
+    if(amplitude < 0 || amplitude > STANDSTILL_MAX_AMPLITUDE ||
+       interval_ms < STANDSTILL_MIN_INTERVAL_MS || interval_ms > STANDSTILL_MAX_INTERVAL_MS ||
+       fabsf(creep) >= MIN_FREQUENCY) {
+        return e_range_error;
+    }
+    command_argument.integer = amplitude;
+    command_argument.interval_ms = interval_ms;
+    command_argument.value = creep;
+    return e_standstill;
+}
+
+// parses a timeline command: [{sensor},{delay},{value}[-|+]], 0 or ![!]
+static command_e process_timeline(const char* input) {
+    int sensor;
+    float delay, value;
+    char str[8];
+    if(*input == '\0') {
+        return e_timeline;
+    }
+    if(are_strings_equal(input, "0")) {
+        return e_clear_timelines;
+    }
+    if(are_strings_equal(input, "!") || are_strings_equal(input, "!!")) {
+        command_argument.integer = input[1] == '!';
+        return e_run_timelines;
+    }
+    strcpy(str, "+");
+    if(sscanf(input, "%d,%f,%f%7s", &sensor, &delay, &value, str) < 3) {
+        return e_syntax_error;
+    }
+    if(!are_strings_equal(str, "+") && !are_strings_equal(str, "-")) {
+        return e_syntax_error;
+    }
+    if(sensor < 1 || sensor > NB_SPEED_DEFINITIONS || delay < 0.0f || delay > UINT16_MAX || value < 0.0f) {
+        return e_range_error;
+    }
+    command_argument.integer = sensor;
+    command_argument.delay = delay;
+    command_argument.value = value;
+    command_argument.reverse = str[0] == '-';
+    return e_timeline_step;
+}
+
+live_command_e process_live_input(const char* input) {
+    char* end;
+    if(strlen(input) == 0) {
+        return e_live_status;
+    }
+    if(are_strings_equal(input, "p")) {
+        return e_live_pause;
+    }
+    if(are_strings_equal(input, "n")) {
+        return e_live_skip;
+    }
+    if(are_strings_equal(input, "(")) {
+        return e_live_record;
+    }
+    if(are_strings_equal(input, ")")) {
+        return e_live_close;
+    }
+    if(are_strings_equal(input, "x")) {
+        return e_live_swap_step;
+    }
+    if(are_strings_equal(input, "xx")) {
+        return e_live_swap_loop;
+    }
+    if(*input == 'o') {
+        if(input[1] == '\0') {
+            command_argument.value = 0.0f;
+            return e_live_offset;
+        }
+        command_argument.value = strtof(input + 1, &end);
+        if(end != input + 1 && *end == '\0') {
+            return e_live_offset;
+        }
+    }
+    return e_live_unknown;
+}
+
+static bool is_speed_definition_in_range(int n_teeth, int diameter_mm, float gear_ratio) {
+    return n_teeth >= MIN_N_TEETH && n_teeth <= MAX_N_TEETH &&
+           diameter_mm >= MIN_DIA_MM && diameter_mm <= MAX_DIA_MM &&
+           gear_ratio >= MIN_RATIO && gear_ratio <= MAX_RATIO;
+}
+
+model_command_e process_model_input(const char* input) {
+    int d;
+    float f;
+    char str[8];
+    if(strlen(input) == 0) {
+        return e_model_status;
+    }
+    if(sscanf(input, "n%d%7s", &d, str) == 1 && d >= 0 && d <= TRAIN_MODEL_NB_NOTCHES) {
+        command_argument.integer = d;
+        return e_model_notch;
+    }
+    if(sscanf(input, "b%d%7s", &d, str) == 1 && d >= 0 && d <= TRAIN_MODEL_NB_BRAKE_STEPS) {
+        command_argument.integer = d;
+        return e_model_brake;
+    }
+    if(sscanf(input, "a%f%7s", &f, str) == 1 && f > 0.0f && f <= MAX_ADHESION) {
+        command_argument.value = f;
+        return e_model_adhesion;
+    }
+    return e_model_unknown;
+}
+
+command_e process_sequence_item(const char* input, sequence_values_t* p_values) {
  float f1, f2;
- int d1, d2;
+ int d1;
  char str[256] = NO_REVSERSE_DEFINED;
- if(strlen(input) == 0)  {
-    return e_empty;
- }
  if(sscanf(input, "%d\">%f:%f%s", &d1, &f1, &f2, str)>=3) {
-    if(!test_reverse(str)) {
+    if(!test_reverse(str, p_values)) {
      return e_syntax_error;
     }
-    next_values.firstValue = f1;
-    next_values.secondValue = f2;
-    next_values.delay = d1;
+    p_values->firstValue = f1;
+    p_values->secondValue = f2;
+    p_values->delay = d1;
+    p_values->type = e_step_ramp;
     return e_new_record;
  }
  strcpy(str, NO_REVSERSE_DEFINED);
  if(sscanf(input, "%d\">%f%s", &d1, &f1, str)>=2) {
-    if(!test_reverse(str)) {
+    if(!test_reverse(str, p_values)) {
      return e_syntax_error;
     }
-    next_values.firstValue = f1;
-    next_values.secondValue = f1;
-    next_values.delay = d1;
+    p_values->firstValue = f1;
+    p_values->secondValue = f1;
+    p_values->delay = d1;
+    p_values->type = e_step_ramp;
     return e_new_record;
  }
  strcpy(str, NO_REVSERSE_DEFINED);
  if(sscanf(input, "%d\">%s", &d1, str)==2) {
-    if(!test_reverse(str)) {
+    if(!test_reverse(str, p_values)) {
      return e_syntax_error;
     }
-    next_values.delay = d1;
+    p_values->delay = d1;
+    p_values->type = e_step_ramp;
     return e_new_record;
  }
  strcpy(str, NO_REVSERSE_DEFINED);
  if(sscanf(input, "%d%s", &d1, str)==2 && 
     (are_strings_equal(str, "\"") || are_strings_equal(str, "\">"))) {
-    next_values.delay = d1;
+    p_values->delay = d1;
+    p_values->type = e_step_ramp;
     return e_new_record;
  }
+ if(*input == '@') {
+    return process_move(input + 1, p_values);
+ }
+ return e_empty;
+}
+
+command_e process_input(const char * input) {
+ float f1, f2;
+ int d1, d2, sensor;
+ char str[256] = NO_REVSERSE_DEFINED;
+ command_e r;
+ if(strlen(input) == 0)  {
+    return e_empty;
+ }
+ r = process_sequence_item(input, &next_values);
+ if(r != e_empty) {
+    return r;
+ }
+ if(*input == 'w') {
+    return process_sweep(input + 1);
+ }
+ if(*input == 'z') {
+    return process_standstill(input + 1);
+ }
+ if(*input == 'c') {
+    return process_timeline(input + 1);
+ }
  if(are_strings_equal(input, "(")) {
     return e_init_list;
  }
@@ -209,87 +548,225 @@ command_e process_input(const char * input) {
  if(are_strings_equal(input, "!?")) {
     return e_print_list;
  }
+ if(are_strings_equal(input, "!^")) {
+    return e_trigger_list;
+ }
+ if(are_strings_equal(input, "!^^")) {
+    return e_trigger_steps_list;
+ }
  if(are_strings_equal(input, "?")) {
     return e_help;
  }
  if(are_strings_equal(input, "??")) {
     return e_extended_help;
  }
+ if(are_strings_equal(input, "b")) {
+    command_argument.integer = -1;
+    return e_backend;
+ }
+ if(sscanf(input, "b%d%s", &d1, str) == 1) {
+    if(d1 < 0 || d1 >= e_nb_backends) {
+        return e_range_error;
+    }
+    command_argument.integer = d1;
+    return e_backend;
+ }
+ if(are_strings_equal(input, "d")) {
+    return e_odometer;
+ }
+ if(are_strings_equal(input, "m")) {
+    return e_train_model;
+ }
+ if(are_strings_equal(input, "j")) {
+    return e_journal;
+ }
+ if(are_strings_equal(input, "j0")) {
+    return e_clear_journal;
+ }
+ if(are_strings_equal(input, "k")) {
+    return e_save_state;
+ }
+ if(are_strings_equal(input, "d0")) {
+    return e_reset_odometer;
+ }
+ if(are_strings_equal(input, "r")) {
+    return e_session;
+ }
+ if(are_strings_equal(input, "r+")) {
+    return e_record_session;
+ }
+ if(are_strings_equal(input, "r-")) {
+    return e_stop_session;
+ }
+ if(are_strings_equal(input, "r>")) {
+    return e_dump_session;
+ }
+ if(are_strings_equal(input, "r!")) {
+    command_argument.integer = SESSION_DEFAULT_TIME_SCALE;
+    return e_replay_session;
+ }
+ if(sscanf(input, "r!%d%s", &d1, str) == 1) {
+    if(d1 < 1 || d1 > SESSION_MAX_TIME_SCALE) {
+        return e_range_error;
+    }
+    command_argument.integer = d1;
+    return e_replay_session;
+ }
+ if(*input == 's' && strlen(input) <= 2) {
+    switch(input[1]) {
+        case '\0': command_argument.integer = -1; break;
+        case 'l': command_argument.integer = e_sync_leader; break;
+        case 'f': command_argument.integer = e_sync_follower; break;
+        case '0': command_argument.integer = e_sync_off; break;
+        default: return e_syntax_error;
+    }
+    return e_sync;
+ }
+ if(sscanf(input, "t%d%s", &d1, str) == 1) {
+    if(d1 < 0 || d1 > TELEMETRY_MAX_RATE) {
+        return e_range_error;
+    }
+    command_argument.integer = d1;
+    return e_telemetry;
+ }
+ f1 = 1.0;
+ if(sscanf(input, "%d#%d,%d,%f", &sensor, &d1, &d2, &f1)>=3) {
+    if(sensor < 1 || sensor > NB_SPEED_DEFINITIONS) {
+        return e_range_error;
+    }
+    if(d1 != 0 && d2 != 0) {
+        if(!is_speed_definition_in_range(d1, d2, f1)) {
+            return e_range_error;
+        }
+    } else { // cancels definition of that sensor
+        d1 = d2 = 0;
+        f1 = 1.0;
+    }
+    set_speed_definition(sensor, d1, d2, f1);
+    command_argument.integer = sensor;
+    return e_new_sensor_speed_definition;
+ }
  f1 = 1.0;
  if(sscanf(input, "%d,%d,%f", &d1, &d2, &f1)>=2) {
     if(d1 != 0 && d2 != 0) {
-        if(d1 < MIN_N_TEETH || d1 > MAX_N_TEETH ||
-           d2 < MIN_DIA_MM || d2 > MAX_DIA_MM ||
-           f1 < MIN_RATIO  || f1 > MAX_RATIO) {
+        if(!is_speed_definition_in_range(d1, d2, f1)) {
             return e_range_error;
         }
     } else {
         d1 = d2 = 0;
         f1 = 1.0;
     }
-    speed_definition.n_teeth = d1;
-    speed_definition.diameter_mm = d2;
-    speed_definition.gear_ratio = f1;
+    for(sensor = 1; sensor <= NB_SPEED_DEFINITIONS; sensor++) {
+        set_speed_definition(sensor, d1, d2, f1);
+    }
     return e_new_speed_definition;
  }
  strcpy(str, NO_REVSERSE_DEFINED);
  if(sscanf(input, "%f:%f%s", &f1, &f2, str)>=2) {
-    if(!test_reverse(str)) {
+    if(!test_reverse(str, &next_values)) {
      return e_syntax_error;
     }
     next_values.firstValue = f1;
     next_values.secondValue = f2;
+    next_values.type = e_step_ramp;
     return e_new_value;
  }
  strcpy(str, NO_REVSERSE_DEFINED);
  if(sscanf(input, "%f%s", &f1, str)>=1) {
-    if(!test_reverse(str)) {
+    if(!test_reverse(str, &next_values)) {
      return e_syntax_error;
     }
     next_values.firstValue = f1;
     next_values.secondValue = f1;
+    next_values.type = e_step_ramp;
     return e_new_value;
  }
- if(test_reverse(input)) {
+ if(test_reverse(input, &next_values)) {
+    next_values.type = e_step_ramp;
     return e_new_value;
  }
  return e_syntax_error;
 }
 
-bool get_input(char* buffer, uint16_t buffer_size) {
-    static bool echo = true;
-    uint16_t index = 0;
+// shared by all line editors
+static bool echo = true;
+// lf of a cr/lf terminated line may be read by another editor than the one the line
+// was typed in (e.g. by the prompt once a live command ended a run)
+static bool skip_lf = false;
+
+void line_editor_init(line_editor_t* p_editor, char* buffer, uint16_t buffer_size) {
+    p_editor->buffer = buffer;
+    p_editor->size = buffer_size;
+    p_editor->index = 0;
+    buffer[0] = '\0';
+}
+
+line_status_e line_editor_poll(line_editor_t* p_editor) {
     int ch;
-    if(buffer_size<1) {
-        return false;
-    }
-    while(index < buffer_size-2) {
-        ch = getchar();
-        if(ch == CTRL_E_ASCII) {
-          echo = !echo;
+    while((ch = getchar_timeout_us(0)) >= 0) {
+        if(skip_lf) { // cr/lf counts as one line termination
+            skip_lf = false;
+            if(ch == '\n') {
+                continue;
+            }
+        }
+        if(ch == CTRL_C_ASCII) {
+            journal_log(e_journal_ctrl_c, 0, 0);
+            p_editor->index = 0;
+            p_editor->buffer[0] = '\0';
+            return e_line_interrupt;
+        } else if(ch == CTRL_E_ASCII) {
+            echo = !echo;
         } else if(ch == BACK_SPACE_ASCII) {
-            if(index>0) {
-                index--;
+            if(p_editor->index>0) {
+                p_editor->index--;
                 printf("%c %c", BACK_SPACE_ASCII, BACK_SPACE_ASCII);
             }
         } else if (ch == '\r' || ch == '\n') {
-            buffer[index] = '\0';
-            if(ch == '\r') {
-                ch = getchar_timeout_us(200000);
-                if(ch >=0 && ch != '\n') {
-                    ungetc(ch, stdin);
-                }
-            }
-            return true;
+            p_editor->buffer[p_editor->index] = '\0';
+            skip_lf = ch == '\r';
+            p_editor->index = 0;
+            return e_line_complete;
         } else {
-            buffer[index++] = ch;
+            p_editor->buffer[p_editor->index++] = ch;
             if(echo) {
                 putchar(ch);
             }
+            if(p_editor->index >= p_editor->size-2) {
+                p_editor->buffer[p_editor->index] = '\0';
+                p_editor->index = 0;
+                return e_line_overflow;
+            }
+        }
+    }
+    return e_line_pending;
+}
+
+bool get_input(char* buffer, uint16_t buffer_size) {
+    // lf of a cr/lf terminated line may arrive after previous call returned, it
+    // must not be taken as a void command (see skip_lf)
+    static line_editor_t editor = {NULL, 0, 0};
+    line_status_e status;
+    if(buffer_size<3) {
+        return false;
+    }
+    editor.buffer = buffer;
+    editor.size = buffer_size;
+    editor.index = 0;
+    buffer[0] = '\0';
+    while(true) {
+        status = line_editor_poll(&editor);
+        if(status == e_line_complete) {
+            return true;
+        } else if(status == e_line_overflow) {
+            return false;
+        } else if(status == e_line_interrupt) {
+            printf(" ^C\n>"); // line cancelled
+        } else {
+            run_background_tasks();
+            sleep_us(BACKGROUND_POLL_US);
         }
     }
-    buffer[index] = '\0';
-    return false;
 }
 
 static const char* _reverse_description_[] = {"+", "-", "+-", "-+"};
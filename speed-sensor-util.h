@@ -12,12 +12,35 @@ typedef enum {
     e_extended_help,
     e_execute_list,
     e_loop_list,
+    e_trigger_list,
+    e_trigger_steps_list,
     e_new_value,
     e_new_record,
     e_init_list,
     e_print_list,
     e_close_list,
     e_new_speed_definition,
+    e_new_sensor_speed_definition,
+    e_telemetry,
+    e_backend,
+    e_odometer,
+    e_reset_odometer,
+    e_train_model,
+    e_sync,
+    e_session,
+    e_record_session,
+    e_stop_session,
+    e_replay_session,
+    e_dump_session,
+    e_sweep,
+    e_standstill,
+    e_timeline,
+    e_timeline_step,
+    e_clear_timelines,
+    e_run_timelines,
+    e_journal,
+    e_clear_journal,
+    e_save_state,
     e_range_error,
     e_empty
 } command_e;
@@ -28,24 +51,79 @@ typedef enum {
 #define MAX_DIA_MM 1500
 #define MIN_RATIO 0.001f
 #define MAX_RATIO 4.0f
+#define MAX_ADHESION 1.0f
 
 #define PI 3.141592653589793f
 
+// commands accepted while a sequence is running
+typedef enum {
+    e_live_unknown,
+    e_live_status,
+    e_live_pause,
+    e_live_skip,
+    e_live_offset,
+    e_live_record, // starts recording next sequence
+    e_live_close, // ends it
+    e_live_swap_step, // swaps to it at next step
+    e_live_swap_loop // swaps to it at end of sequence
+} live_command_e;
+
+// commands accepted while train model drives outputs
+typedef enum {
+    e_model_unknown,
+    e_model_status,
+    e_model_notch,
+    e_model_brake,
+    e_model_adhesion
+} model_command_e;
+
+// arguments of commands which alter neither next_values nor speed_definitions
+typedef struct {
+    int32_t integer;
+    float value;
+    // sweep: start and end frequencies (Hz) and mode (see sweep_mode_e),
+    // duration in value, steps per decade in integer
+    float start_frequency;
+    float end_frequency;
+    uint8_t sweep_mode;
+    // standstill: amplitude in integer (-1: status only), creep frequency in value
+    uint16_t interval_ms;
+    // timeline step: sensor in integer, value, delay (s) and direction
+    // (run: loop in integer)
+    float delay;
+    bool reverse;
+} command_argument_t;
+
+extern command_argument_t command_argument;
+
+#define CTRL_C_ASCII  3
 #define CTRL_E_ASCII  5
 #define BACK_SPACE_ASCII 8
 
-// given a speed in km/h, returns frequency in Hz
-// resource (read only): speed_definition
-float get_frequency(float speed);
+// sets speed definition of a sensor (1 or 2) and caches its conversion factor
+// a zero n_teeth or diameter_mm cancels the definition
+// resource: speed_definitions
+void set_speed_definition(uint8_t sensor, uint16_t n_teeth, uint16_t diameter_mm, float gear_ratio);
+// given a speed in km/h, returns frequency in Hz of a sensor (1 or 2)
+// resource (read only): speed_definitions
+float get_frequency(uint8_t sensor, float speed);
+// given a frequency in Hz of a sensor, returns speed in km/h (or frequency if speed not defined)
+// resource (read only): speed_definitions
+float get_value(uint8_t sensor, float frequency);
 // given a frequency in Hz, returns period (in µs)
 // note: this period is four times shorter than 1/freq
 uint32_t get_period(float freq);
-// given a period as defined above, return either
+// given a period as defined above of a sensor, return either
 // speed in km/h (if function value_is_speed return true) or frequency in Hz
-float get_corrected_value(uint32_t period);
-// tells if speed_definition is correct so values are defined
+float get_corrected_value(uint8_t sensor, uint32_t period);
+// given a number of edges of a sensor, returns travelled distance in meters
+// resource (read only): speed_definitions
+double get_distance(uint8_t sensor, int64_t edges);
+// tells if speed_definitions of both sensors are correct so values are defined
 // in the realm of speed (km/h) instead of frequency (in Hz)
 bool value_is_speed();
+// tells if both sensors share the same speed definition
+bool are_speed_definitions_equal();
 // tells if definitions for both sensors are equal
 bool are_sensors_equal(const sequence_values_t*);
 // call printf to output syntax of commands
@@ -56,8 +134,17 @@ const char* get_reverse_description(const sequence_values_t* seq);
 // takes an input from user
 // scans it and returns what scan brought
 // depending on correct command found
-// possibly alters external variable cur_values or speed_definition
+// possibly alters external variable cur_values or speed_definitions
 command_e process_input(const char * input);
+// parses sequence items only (ramps with a delay, moves) into *p_values, which holds
+// previous item (its values and directions are kept when not typed), without any other
+// side effect: returns e_new_record, e_syntax_error or e_range_error, e_empty when
+// input is not a sequence item
+command_e process_sequence_item(const char* input, sequence_values_t* p_values);
+// same as process_input for commands accepted while a sequence is running
+live_command_e process_live_input(const char* input);
+// same as process_input for commands accepted while train model runs
+model_command_e process_model_input(const char* input);
 
 // return true if both strings have same contents
 bool are_strings_equal(const char* s1, const char* s2);
@@ -69,8 +156,29 @@ char* _unsafe_format_float(float value, char* buffer);
 // returns str address
 char* str_trim(char *str);
 
+typedef enum {
+    e_line_pending, // line not terminated yet
+    e_line_complete,
+    e_line_overflow, // line truncated to buffer size
+    e_line_interrupt // ^c: line cancelled
+} line_status_e;
+
+// non-blocking line editor state
+typedef struct {
+    char* buffer;
+    uint16_t size;
+    uint16_t index;
+} line_editor_t;
+
+void line_editor_init(line_editor_t* p_editor, char* buffer, uint16_t buffer_size);
+// processes characters available on stdin without waiting
+// back space character is managed, cr/lf terminated (excluded)
+// buffer holds the line when status returned is e_line_complete or e_line_overflow
+line_status_e line_editor_poll(line_editor_t* p_editor);
+
 // get a string from stdin, cr/lf terminated (excluded)
 // back space character is managed
+// background tasks are run while waiting for characters
 // return false in case of buffer overflow
 bool get_input(char* buffer, uint16_t buffer_size);
 
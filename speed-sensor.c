@@ -10,11 +10,22 @@
 
 #include "hardware/clocks.h"
 #include "pico/multicore.h"
+#include "pico/stdio_usb.h"
 #include "pico/stdlib.h"
 
+#include "core0-output.h"
 #include "float_equality_ulp.h"
-#include "pwm-managed.h"
+#include "journal.h"
+#include "output-backend.h"
+#include "sequence-store.h"
+#include "session.h"
 #include "speed-sensor-util.h"
+#include "state-snapshot.h"
+#include "sync.h"
+#include "telemetry.h"
+#include "timeline.h"
+#include "train-model.h"
+#include "trigger.h"
 
 #include "speed-sensor.h"
 
@@ -36,12 +47,35 @@ enum_as_str_ele cmd_result_as_str_map[] = {
     {e_help, "help"},
     {e_extended_help, "extended_help"},
     {e_execute_list, "execute_list"},
+    {e_trigger_list, "trigger_list"},
+    {e_trigger_steps_list, "trigger_steps_list"},
     {e_print_list, "print_list"},
     {e_new_value, "new_value"},
     {e_new_record, "new_record"},
     {e_init_list, "init_list"},
     {e_close_list, "close_list"},
     {e_new_speed_definition, "speed_definition"},
+    {e_new_sensor_speed_definition, "sensor_speed_definition"},
+    {e_telemetry, "telemetry"},
+    {e_backend, "backend"},
+    {e_odometer, "odometer"},
+    {e_reset_odometer, "reset_odometer"},
+    {e_train_model, "train_model"},
+    {e_sync, "sync"},
+    {e_session, "session"},
+    {e_record_session, "record_session"},
+    {e_stop_session, "stop_session"},
+    {e_replay_session, "replay_session"},
+    {e_dump_session, "dump_session"},
+    {e_sweep, "sweep"},
+    {e_standstill, "standstill"},
+    {e_timeline, "timeline"},
+    {e_timeline_step, "timeline_step"},
+    {e_clear_timelines, "clear_timelines"},
+    {e_run_timelines, "run_timelines"},
+    {e_journal, "journal"},
+    {e_clear_journal, "clear_journal"},
+    {e_save_state, "save_state"},
     {e_syntax_error, "syntax_error"},
     {e_range_error, "range_error"},
     {e_empty, "empty_command"},
@@ -79,14 +113,16 @@ const char* truthness_as_str(bool v) {
 static sequence_values_t current_values;
 sequence_values_t next_values = {0, 0, false, false, 0}; // starts at 0 Hz, forward
 
-speed_definition_t speed_definition =
-   {0, 0, 1.0}; // init with no definition of speed which is not managed (frequency instead)
+speed_definition_t speed_definitions[NB_SPEED_DEFINITIONS] =
+   {{0, 0, 1.0, 0.0}, {0, 0, 1.0, 0.0}}; // init with no definition of speed which is not managed (frequency instead)
+
+// edge counts when odometer was reset
+static int64_t odometer_origin1 = 0;
+static int64_t odometer_origin2 = 0;
 
 // inter-core queue
 queue_t call_queue;
 
-static sequence_values_t sequence_array[SEQUENCE_VALUE_ARRAY_SIZE];
-static uint8_t sequence_index = 0;
 
 // LED cycle
 static volatile uint8_t max_led_repeat = 10;
@@ -99,6 +135,9 @@ static const uint LED_PIN = PICO_DEFAULT_LED_PIN;
 static bool timer_callback(repeating_timer_t *rt) {
     static uint8_t repeat_for_led = 0;
     uint8_t i;
+    // next tick as scheduled by sync PLL (nominal period unless following a leader),
+    // faster while a session is replayed
+    rt->delay_us = -(int64_t)(sync_tick() / session_get_time_scale());
     for(i = 0; i < NB_ARMED_COUNTS; i++) {
         if(timer_armed_counts[i] != 0) {
             timer_armed_counts[i]--;
@@ -148,97 +187,560 @@ static void set_led_repeat(float frequency) {
     } 
 }
 
+// true while main loop waits for a command (no sequence running)
+static bool at_prompt = false;
+static bool banner_printed = false;
+
+static void print_banner() {
+    printf("\nSpeed sensor simulator\n");
+    printf("Hardware clock: %lu Hz\n", clock_get_hz(clk_sys));
+    print_help(false);
+}
+
+void run_background_tasks() {
+    telemetry_flush();
+    sync_poll();
+    session_poll();
+    // USB is enumerated while outputs already run
+    if(!banner_printed && stdio_usb_connected()) {
+        banner_printed = true;
+        print_banner();
+        if(at_prompt) {
+            printf(">");
+        }
+    }
+    if(at_prompt) {
+        state_snapshot_poll(&current_values, speed_definitions);
+    }
+}
+
 // index of timer which manages sequences
 #define TIMER_SEQ_ID 0
 
-static intercore_data_t inter_core_data = {0, 0, false, false};
+#define TIMER_COUNT_PER_SECOND (STEPS_PER_SECOND * TIMER_COUNT_PER_STEP)
+
+static intercore_data_t inter_core_data = {0, 0, false, false, false, false, 0, 0, OUTPUT_BACKEND, false, {0, 0, 0, 0}};
+
+typedef enum {
+    e_step_carry_on,
+    e_step_interrupt,
+    e_step_skip
+} step_action_e;
+
+// live commands while a step runs
+static char live_str[32];
+static line_editor_t live_editor;
+static bool sequence_paused = false;
+static float live_offset = 0.0f;
+// next sequence recorded while running, from values of its last step
+static bool live_recording = false;
+static sequence_values_t live_record_values;
+
+// external trigger use by running sequence
+typedef enum {
+    e_trigger_off,
+    e_trigger_start, // trigger starts sequence
+    e_trigger_steps // trigger starts sequence and advances steps
+} trigger_mode_e;
+
+static trigger_mode_e trigger_mode = e_trigger_off;
+// what trigger interrupt applies to outputs, if any
+static bool trigger_data_armed = false;
+static intercore_data_t trigger_data;
+
+// times steps of sequences
+static repeating_timer_t sequence_timer;
+
+// synchronized sequences: leader announces start this many ticks ahead
+// (one to send it, one for followers to get it)
+#define SYNC_START_DELAY_TICKS 2
+// step running on a follower (0 if none), steps skipped to catch up with leader
+static uint16_t sync_running_step = 0;
+static uint32_t sync_catch_ups = 0;
+
+// independent timelines of each sensor (c commands), values as in sequences
+static timeline_channel_t timeline_channels[NB_SPEED_DEFINITIONS];
+static timeline_event_t timeline_events[NB_SPEED_DEFINITIONS];
+static timelines_t timelines;
+
+// edge counts on which sensors have to stop during a move step
+static bool move_in_progress = false;
+static int64_t move_target1;
+static int64_t move_target2;
+
+#if SPLIT_CORES
+// sensor 2 part of inter_core_data goes to core0 output
+static void send_core0_output_data() {
+    channel_params_t params;
+    params.max_count = inter_core_data.max_count2;
+    params.reverse = inter_core_data.invert2;
+    params.targeted = inter_core_data.targeted2;
+    params.target = inter_core_data.target2;
+    core0_output_set_channel_params(&params);
+}
+#endif
+
+// hands inter_core_data to core1, journal tells when core1 is late
+static void post_intercore_data() {
+    if(queue_is_full(&call_queue)) {
+        journal_log(e_journal_underrun, e_underrun_mailbox, queue_get_level(&call_queue));
+    }
+    queue_add_blocking(&call_queue, &inter_core_data);
+    journal_log(e_journal_params_sent, inter_core_data.invert1 ? 1 | JOURNAL_REVERSE : 1, inter_core_data.max_count1);
+    journal_log(e_journal_params_sent, inter_core_data.invert2 ? 2 | JOURNAL_REVERSE : 2, inter_core_data.max_count2);
+}
 
 // update delays and forward/reverse ways
 // only done if required
 static void send_intercore_data(intercore_data_t* p_new_intercore_data) {
     if(p_new_intercore_data == NULL) {
-        queue_add_blocking(&call_queue, &inter_core_data);
+        post_intercore_data();
+#if SPLIT_CORES
+        send_core0_output_data();
+#endif
         return;
     }
     if(p_new_intercore_data == NULL ||
        p_new_intercore_data->max_count1 != inter_core_data.max_count1 ||
        p_new_intercore_data->max_count2 != inter_core_data.max_count2 ||
        p_new_intercore_data->invert1 != inter_core_data.invert1 ||
-       p_new_intercore_data->invert2 != inter_core_data.invert2) {
+       p_new_intercore_data->invert2 != inter_core_data.invert2 ||
+       p_new_intercore_data->targeted1 != inter_core_data.targeted1 ||
+       p_new_intercore_data->targeted2 != inter_core_data.targeted2 ||
+       p_new_intercore_data->target1 != inter_core_data.target1 ||
+       p_new_intercore_data->target2 != inter_core_data.target2 ||
+       p_new_intercore_data->backend != inter_core_data.backend ||
+       p_new_intercore_data->sweep != inter_core_data.sweep ||
+       p_new_intercore_data->standstill.amplitude != inter_core_data.standstill.amplitude ||
+       p_new_intercore_data->standstill.min_interval_us != inter_core_data.standstill.min_interval_us ||
+       p_new_intercore_data->standstill.creep != inter_core_data.standstill.creep) {
         inter_core_data = *p_new_intercore_data;
-        queue_add_blocking(&call_queue, &inter_core_data);
+        post_intercore_data();
+        session_log_edges(&inter_core_data);
+#if SPLIT_CORES
+        send_core0_output_data();
+#endif
     }
 }
 
-// manages a new step: update actual state of frequency
-// and display step information (if required)
+// prints actual values as sent to core1
 // in: 
-//  display_information => 0: none, 1: only one speed/frequency, 2: both
+//  display_information => 1: only one speed/frequency, 2: both
 //  delay_elpased: current delay
-// out: false if interrupt required
-static bool __timer_controlled_sequence_step_actions(uint8_t display_information, int16_t delay_elapsed) {
+static void print_actual_values(uint8_t display_information, int64_t delay_elapsed) {
     float f1, f2;
-    intercore_data_t temp_intercore_data;
     char buf1[16], buf2[16];
-    int ch;
-
-    f1 = get_frequency(current_values.firstValue);
-    f2 = get_frequency(current_values.secondValue);
-    set_led_repeat(fmaxf(f1, f2));
-    temp_intercore_data.invert1 = current_values.firstReverse;
-    temp_intercore_data.invert2 = current_values.secondReverse;
-    temp_intercore_data.max_count1 = get_period(f1);
-    temp_intercore_data.max_count2 = get_period(f2);
-    send_intercore_data(&temp_intercore_data);
-    ch = getchar_timeout_us(0);
-    if(ch == 3) { // Ctrl-C
-        return false;
-    } else if (ch >= 0) {
-        ungetc(ch, NULL);
-    } 
-    if(display_information == 0) {
-        return true;
-    }
     if(delay_elapsed >= 0) {
-        printf("\r%ld\" - ", delay_elapsed);
+        printf("\r%lld\" - ", delay_elapsed);
     } else {
         printf("\r");
     }
     if(value_is_speed()) {
-        f1 = get_corrected_value(temp_intercore_data.max_count1);
-        f2 = get_frequency(f1);
+        f1 = get_corrected_value(1, inter_core_data.max_count1);
+        f2 = get_frequency(1, f1);
         printf("Actual speed %c%s km/h (%s Hz)",
-               temp_intercore_data.invert1?'-':'+',
+               inter_core_data.invert1?'-':'+',
                _unsafe_format_float(f1, buf1),
                _unsafe_format_float(f2, buf2));
         if(display_information == 2) {
-            f1 = get_corrected_value(temp_intercore_data.max_count2);
-            f2 = get_frequency(f1);
+            f1 = get_corrected_value(2, inter_core_data.max_count2);
+            f2 = get_frequency(2, f1);
             printf(" : %c%s km/h (%s Hz)",
-               temp_intercore_data.invert2?'-':'+',
+               inter_core_data.invert2?'-':'+',
                _unsafe_format_float(f1, buf1),
                _unsafe_format_float(f2, buf2));
         }
     } else {
-       f1 = get_corrected_value(temp_intercore_data.max_count1);
+       f1 = get_corrected_value(1, inter_core_data.max_count1);
        printf("Actual frequency %c%s Hz",
-               temp_intercore_data.invert1?'-':'+',
+               inter_core_data.invert1?'-':'+',
                _unsafe_format_float(f1, buf1));
        if(display_information == 2) {
-            f1 = get_corrected_value(temp_intercore_data.max_count2);
+            f1 = get_corrected_value(2, inter_core_data.max_count2);
             printf(" : %c%s Hz",
-               temp_intercore_data.invert2?'-':'+',
+               inter_core_data.invert2?'-':'+',
                _unsafe_format_float(f1, buf1));
         }
     }
     printf("     ");
+}
+
+// records a sequence item typed while running: only items are parsed, so that running
+// step values and any other state are left untouched
+// out: false if input is not a sequence item
+static bool record_live_step(const char* input) {
+    sequence_values_t values = live_record_values;
+    switch(process_sequence_item(input, &values)) {
+        case e_new_record:
+            if(sequence_store_append(&values)) {
+                live_record_values = values;
+                printf("Recorded item %lu of next sequence\n", sequence_store_recorded_count());
+            } else {
+                printf("Error: recording array is full!\n");
+            }
+            return true;
+        case e_syntax_error:
+            printf("Error: invalid item, not recorded\n");
+            return true;
+        case e_range_error:
+            printf("Error: item out of range, not recorded\n");
+            return true;
+        default:
+            return false;
+    }
+}
+
+// polls console while a step runs and applies live commands
+// out: what step in progress should do
+static step_action_e process_live_commands() {
+    char buf[16];
+    live_command_e r;
+    switch(line_editor_poll(&live_editor)) {
+        case e_line_interrupt:
+            return e_step_interrupt;
+        case e_line_complete:
+        case e_line_overflow:
+            break;
+        default:
+            return e_step_carry_on;
+    }
+    str_trim(live_str);
+    printf("\n");
+    r = process_live_input(live_str);
+    journal_log(e_journal_live_command, r, journal_pack_text(live_str));
+    switch(r) {
+        case e_live_status:
+            print_actual_values(2, -1);
+            printf("\n%s, offset %s %s\n", sequence_paused ? "Paused" : "Running",
+                   _unsafe_format_float(live_offset, buf), value_is_speed() ? "km/h" : "Hz");
+            break;
+        case e_live_pause:
+            sequence_paused = !sequence_paused;
+            printf(sequence_paused ? "Paused\n" : "Resumed\n");
+            break;
+        case e_live_skip:
+            printf("Skipped to next step\n");
+            return e_step_skip;
+        case e_live_offset:
+            live_offset = command_argument.value;
+            printf("Offset: %s %s\n", _unsafe_format_float(live_offset, buf), value_is_speed() ? "km/h" : "Hz");
+            break;
+        case e_live_record:
+            sequence_store_request_swap(e_swap_none);
+            sequence_store_record();
+            live_record_values = next_values;
+            live_recording = true;
+            printf("Recording next sequence\n");
+            break;
+        case e_live_close:
+            live_recording = false;
+            printf("Next sequence: %lu item(s)\n", sequence_store_recorded_count());
+            break;
+        case e_live_swap_step:
+        case e_live_swap_loop:
+            if(live_recording) {
+                printf("Error: close next sequence first\n");
+            } else if(!sequence_store_request_swap(r == e_live_swap_step ? e_swap_at_step : e_swap_at_loop)) {
+                printf("Error: no next sequence recorded\n");
+            } else {
+                printf(r == e_live_swap_step ? "Swap at next step\n" : "Swap at end of sequence\n");
+            }
+            break;
+        case e_live_unknown:
+            if(live_recording && record_live_step(live_str)) {
+                break;
+            }
+            printf("While running: p (pause/resume), n (next step), o{value} (offset),\n"
+                   " ( items ) next sequence, x[x] swap to it, ^c (cancel)\n");
+            break;
+    }
+    return e_step_carry_on;
+}
+
+// live offset applies to moving sensors only (zero always means stopped)
+static float apply_live_offset(float value) {
+    if(value == 0.0f) {
+        return 0.0f;
+    }
+    value += live_offset;
+    return value > 0.0f ? value : 0.0f;
+}
+
+// output parameters matching values (with live offset)
+static void get_intercore_data(const sequence_values_t* p_values, intercore_data_t* p_data) {
+    const float f1 = get_frequency(1, apply_live_offset(p_values->firstValue));
+    const float f2 = get_frequency(2, apply_live_offset(p_values->secondValue));
+    p_data->invert1 = p_values->firstReverse;
+    p_data->invert2 = p_values->secondReverse;
+    p_data->max_count1 = get_period(f1);
+    p_data->max_count2 = get_period(f2);
+    p_data->targeted1 = move_in_progress;
+    p_data->targeted2 = move_in_progress;
+    p_data->target1 = move_target1;
+    p_data->target2 = move_target2;
+    p_data->backend = inter_core_data.backend;
+    p_data->sweep = false;
+    p_data->standstill = inter_core_data.standstill;
+}
+
+// sends current_values (with live offset) to outputs
+static void send_current_values() {
+    intercore_data_t temp_intercore_data;
+
+    set_led_repeat(fmaxf(get_frequency(1, apply_live_offset(current_values.firstValue)),
+                         get_frequency(2, apply_live_offset(current_values.secondValue))));
+    get_intercore_data(&current_values, &temp_intercore_data);
+    send_intercore_data(&temp_intercore_data);
+}
+
+// arms trigger so that its interrupt applies p_values (if not NULL) to outputs
+static void arm_trigger(const sequence_values_t* p_values) {
+    trigger_data_armed = p_values != NULL;
+    if(trigger_data_armed) {
+        get_intercore_data(p_values, &trigger_data);
+    }
+    trigger_arm(trigger_data_armed ? &trigger_data : NULL);
+}
+
+// checks if trigger fired, then takes into account what its interrupt already applied
+static bool has_trigger_fired() {
+    uint32_t time_us;
+    if(!trigger_fired(&time_us)) {
+        return false;
+    }
+    if(trigger_data_armed) {
+        inter_core_data = trigger_data;
+        trigger_data_armed = false;
+    }
+    return true;
+}
+
+static void start_sequence_timer() {
+    // first tick one period from now, next ones from previous one (see timer_callback)
+    sync_restart(time_us_64() + SYNC_PLL_NOMINAL_PERIOD_US);
+    add_repeating_timer_us(-SYNC_PLL_NOMINAL_PERIOD_US, timer_callback, NULL, &sequence_timer);
+}
+
+// follower: checks if leader already started a later step, then catches up
+static bool is_behind_leader() {
+    uint16_t step;
+    uint32_t step_tick;
+    if(sync_get_role() != e_sync_follower || sync_running_step == 0 ||
+       !sync_get_leader_step(&step, &step_tick)) {
+        return false;
+    }
+    if(step <= sync_running_step || (int32_t)(sync_get_tick() - step_tick) < 0) {
+        return false;
+    }
+    sync_running_step = step; // once per step skipped
+    sync_catch_ups++;
+    return true;
+}
+
+// starts a sequence on same tick as other boards
+// leader announces a start tick, followers wait for it (or join a sequence already running)
+// returns once tick before start fired, so that resync of first step lands on start
+// out: false if cancelled
+static bool sync_sequence_start() {
+    uint16_t step;
+    uint32_t start_tick;
+    if(sync_get_role() == e_sync_leader) {
+        start_tick = sync_get_tick() + SYNC_START_DELAY_TICKS;
+        sync_announce_start(start_tick);
+    } else {
+        printf("Waiting for leader (^c to cancel)\n");
+        do {
+            run_background_tasks();
+            if(line_editor_poll(&live_editor) == e_line_interrupt) {
+                return false;
+            }
+        } while(!sync_get_leader_step(&step, &start_tick) || step == 0);
+        if(step != 1 || (int32_t)(start_tick - sync_get_tick()) <= 0) {
+            printf("Joining leader at step %hu\n", step);
+            return true; // steps behind are skipped (see is_behind_leader)
+        }
+    }
+    while((int32_t)(start_tick - 1 - sync_get_tick()) > 0) {
+        run_background_tasks();
+    }
+    return true;
+}
+
+// prints synchronization status
+static void print_sync() {
+    static const char* role_names[] = {"off", "leader", "follower"};
+    const sync_pll_t* p_pll = sync_get_pll();
+    printf("Sync: %s, tick %lu\n", role_names[sync_get_role()], sync_get_tick());
+    if(sync_get_role() != e_sync_follower) {
+        return;
+    }
+    printf("PLL %s, leader clock %+ld ppm\n",
+           sync_pll_is_locked(p_pll) ? "locked" : p_pll->acquired ? "acquired" : "waiting for leader",
+           sync_pll_get_ppm(p_pll));
+    printf("Phase error: last %ld us, max %ld us, rms %lu us\n",
+           p_pll->last_error, p_pll->max_error, sync_pll_get_rms_error(p_pll));
+    printf("%lu acquisition(s), %lu link error(s), %lu step(s) caught up\n",
+           p_pll->nb_acquisitions, sync_get_link_errors(), sync_catch_ups);
+}
+
+// manages a new step: update actual state of frequency
+// and display step information (if required)
+// in: 
+//  display_information => 0: none, 1: only one speed/frequency, 2: both
+//  delay_elpased: current delay
+// out: what step in progress should do
+static step_action_e __timer_controlled_sequence_step_actions(uint8_t display_information, int64_t delay_elapsed) {
+    step_action_e action;
+
+    // trigger already applied end of step: catches up before sending anything else
+    // (values sent in between are overwritten by next step within one tick)
+    if(trigger_mode == e_trigger_steps && has_trigger_fired()) {
+        printf("\nTriggered: next step\n");
+        return e_step_skip;
+    }
+    if(is_behind_leader()) {
+        printf("\nBehind leader: next step\n");
+        return e_step_skip;
+    }
+    send_current_values();
+    action = process_live_commands();
+    if(action == e_step_interrupt || display_information == 0) {
+        return action;
+    }
+    print_actual_values(display_information, delay_elapsed);
+    return action;
+}
+
+// holds current values as long as sequence is paused
+// out: false if sequence interruption required
+static bool hold_while_paused() {
+    while(sequence_paused) {
+        if(__timer_controlled_sequence_step_actions(0, -1) == e_step_interrupt) {
+            return false;
+        }
+        WAIT_FOR_FLAG(TIMER_SEQ_ID, 1)
+    }
     return true;
 }
 
+// commanded frequency of one sensor during a move step
+// in: edges to go, frequency at start of move and deceleration (in Hz/s)
+static float get_move_frequency(int64_t remaining, float cruise_frequency, float deceleration) {
+    float f;
+    if(remaining <= 0) {
+        return 0.0f;
+    }
+    // braking from f to 0 at constant deceleration outputs 2.f^2/deceleration edges
+    f = sqrtf(deceleration * (float)remaining / 2.0f);
+    if(f > cruise_frequency) {
+        f = cruise_frequency;
+    }
+    // the very last edge is stopped on by output interrupt itself
+    return f < MOVE_CRAWL_FREQUENCY ? MOVE_CRAWL_FREQUENCY : f;
+}
+
+// prints target of a move step (edges or meters)
+static void print_move_target(const sequence_values_t* p_values) {
+    if(p_values->type == e_step_move_edges) {
+        printf("%lld edges", p_values->target_edges);
+    } else {
+        printf("%.2f m", p_values->target_distance);
+    }
+}
+
+// move step: travels next_values target from current_values speeds, then stops
+// in: resync, see timer_controlled_sequence_step
+// out: false if sequence interruption required
+static bool timer_controlled_move_step(bool resync) {
+    const uint8_t display_nb_sensors = are_sensors_equal(&current_values) ? 1 : 2;
+    int64_t nb_edges1, nb_edges2;
+    const float cruise1 = get_frequency(1, current_values.firstValue);
+    const float cruise2 = get_frequency(2, current_values.secondValue);
+    float deceleration = next_values.deceleration;
+    float deceleration1, deceleration2;
+    int64_t remaining1, remaining2;
+    // ticks of move: as many as a move of MAX_MOVE_EDGES at crawl frequency takes
+    uint64_t i;
+    bool interrupted = false;
+    step_action_e action;
+
+    if(next_values.type == e_step_move_edges) {
+        nb_edges1 = nb_edges2 = next_values.target_edges;
+    } else if(value_is_speed()) {
+        // same distance for both sensors, whatever their wheels
+        nb_edges1 = llround(next_values.target_distance / get_distance(1, 1));
+        nb_edges2 = llround(next_values.target_distance / get_distance(2, 1));
+    } else {
+        printf("Error: move in meters without speed definition skipped\n");
+        return true;
+    }
+    // definitions may have changed since the move was recorded
+    if(nb_edges1 > MAX_MOVE_EDGES || nb_edges2 > MAX_MOVE_EDGES) {
+        printf("Error: move of more than %lld edges skipped\n", MAX_MOVE_EDGES);
+        return true;
+    }
+    if(deceleration == 0.0f) {
+        deceleration = value_is_speed() ? MOVE_DEFAULT_DECELERATION : MOVE_DEFAULT_FREQUENCY_DECELERATION;
+    }
+    deceleration1 = deceleration2 = deceleration;
+    if(value_is_speed()) { // m/s2 => Hz/s
+        deceleration1 = get_frequency(1, deceleration * 3.6f);
+        deceleration2 = get_frequency(2, deceleration * 3.6f);
+    }
+    if(resync) {
+         WAIT_FOR_FLAG(TIMER_SEQ_ID, 1)
+    }
+    move_target1 = get_edge_count(1) + (current_values.firstReverse ? -nb_edges1 : nb_edges1);
+    move_target2 = get_edge_count(2) + (current_values.secondReverse ? -nb_edges2 : nb_edges2);
+    move_in_progress = true;
+    for(i = 0; ; i++) {
+        remaining1 = move_target1 - get_edge_count(1);
+        remaining2 = move_target2 - get_edge_count(2);
+        if(current_values.firstReverse) {
+            remaining1 = -remaining1;
+        }
+        if(current_values.secondReverse) {
+            remaining2 = -remaining2;
+        }
+        if(remaining1 <= 0 && remaining2 <= 0) {
+            break;
+        }
+        current_values.firstValue = get_value(1, get_move_frequency(remaining1, cruise1, deceleration1));
+        current_values.secondValue = get_value(2, get_move_frequency(remaining2, cruise2, deceleration2));
+        action = __timer_controlled_sequence_step_actions(
+                     i % TIMER_COUNT_PER_SECOND == 0 ? display_nb_sensors : 0,
+                     i / TIMER_COUNT_PER_SECOND);
+        if(action == e_step_interrupt) {
+            interrupted = true;
+            break;
+        }
+        if(action == e_step_skip) { // stops where it is
+            break;
+        }
+        WAIT_FOR_FLAG(TIMER_SEQ_ID, 1)
+    }
+    move_in_progress = false;
+    if(!interrupted) {
+        current_values.firstValue = 0.0f;
+        current_values.secondValue = 0.0f;
+        next_values.firstValue = 0.0f;
+        next_values.secondValue = 0.0f;
+    }
+    // disarms targets (if interrupted, keeps on at current speed)
+    if(__timer_controlled_sequence_step_actions(display_nb_sensors, i / TIMER_COUNT_PER_SECOND) == e_step_interrupt) {
+        interrupted = true;
+    }
+    printf("\n");
+    return !interrupted && hold_while_paused();
+}
+
 // one sequence step from current_values to next_values
 // in: resync, should be true only at the start of a new full sequence to ensure best timer synchronization 
 // out: false if sequence interruption required
 static bool timer_controlled_sequence_step(bool resync) {
+    if(next_values.type != e_step_ramp) {
+        return timer_controlled_move_step(resync);
+    }
     // displays one sensor value if one is consistent throughout the entire step
     const uint8_t display_nb_sensors =
                 are_sensors_equal(&current_values) && are_sensors_equal(&next_values) ? 1 : 2; 
@@ -250,93 +752,546 @@ static bool timer_controlled_sequence_step(bool resync) {
         // linear progression
         const float f1_step = (next_values.firstValue - current_values.firstValue) / nb_steps;
         const float f2_step = (next_values.secondValue - current_values.secondValue) / nb_steps;
+        step_action_e action;
         nb_steps--; // last step is skipped and managed out of loop
-        for(i = 0; i < nb_steps; i++) {
-            if(!__timer_controlled_sequence_step_actions(
-                    i % STEPS_PER_SECOND == 0 ? display_nb_sensors : 0,
-                    i / STEPS_PER_SECOND)) {
+        for(i = 0; i < nb_steps; ) {
+            action = __timer_controlled_sequence_step_actions(
+                    i % STEPS_PER_SECOND == 0 && !sequence_paused ? display_nb_sensors : 0,
+                    i / STEPS_PER_SECOND);
+            if(action == e_step_interrupt) {
                 printf("\n");
                 return false;
             }
-            current_values.firstValue += f1_step;
-            current_values.secondValue += f2_step;
+            if(action == e_step_skip) {
+                break;
+            }
+            if(!sequence_paused) { // progression frozen while paused, timing kept
+                current_values.firstValue += f1_step;
+                current_values.secondValue += f2_step;
+                i++;
+            }
             WAIT_FOR_FLAG(TIMER_SEQ_ID, TIMER_COUNT_PER_STEP)
         }
     }
     // makes sure last step lands accuratley at next_values
     current_values = next_values;
-    __timer_controlled_sequence_step_actions(display_nb_sensors,
-                                             next_values.delay ? next_values.delay : -1);
+    if(__timer_controlled_sequence_step_actions(display_nb_sensors,
+                                                next_values.delay ? next_values.delay : -1) == e_step_interrupt) {
+        printf("\n");
+        return false;
+    }
+    printf("\n");
+    return hold_while_paused();
+}
+
+// firmware state a console session starts from (see session.h)
+typedef struct {
+    sequence_values_t values;
+    speed_definition_t speed_definitions[NB_SPEED_DEFINITIONS];
+    uint8_t backend;
+} session_state_t;
+
+static void get_session_state(session_state_t* p_state) {
+    memset(p_state, 0, sizeof(session_state_t)); // padding is logged too
+    p_state->values = current_values;
+    memcpy(p_state->speed_definitions, speed_definitions, sizeof(speed_definitions));
+    p_state->backend = inter_core_data.backend;
+}
+
+// restores state, with an empty sequence list
+static void apply_session_state(const session_state_t* p_state) {
+    intercore_data_t temp_intercore_data = inter_core_data;
+    memcpy(speed_definitions, p_state->speed_definitions, sizeof(speed_definitions));
+    temp_intercore_data.backend = p_state->backend;
+    send_intercore_data(&temp_intercore_data);
+    current_values = next_values = p_state->values;
+    send_current_values();
+    sequence_store_record();
+    sequence_store_swap();
+    state_machine = es_default;
+}
+
+// lists backends and measures output interrupt load of active one
+static void print_backends() {
+    uint8_t i;
+    uint32_t busy_cycles, core0_busy_cycles, timestamp;
+    float cycles;
+    for(i = 0; i < e_nb_backends; i++) {
+        printf("%hu- %s%s\n", i, get_backend_name(i), i == inter_core_data.backend ? " (active)" : "");
+    }
+    WAIT_FOR_FLAG(TIMER_SEQ_ID, 1)
+    busy_cycles = isr_busy_cycles;
+    core0_busy_cycles = core0_isr_busy_cycles;
+    timestamp = time_us_32();
+    WAIT_FOR_FLAG(TIMER_SEQ_ID, TIMER_COUNT_PER_SECOND)
+    busy_cycles = isr_busy_cycles - busy_cycles;
+    core0_busy_cycles = core0_isr_busy_cycles - core0_busy_cycles;
+    cycles = (float)(time_us_32() - timestamp) * (clock_get_hz(clk_sys) / 1000000);
+    printf("Output interrupt load: core1 %.2f %%", 100.0f * busy_cycles / cycles);
+#if SPLIT_CORES
+    printf(" (sensor 1), core0 %.2f %% (sensor 2)", 100.0f * core0_busy_cycles / cycles);
+#endif
     printf("\n");
+}
+
+// waits for trigger to start a sequence
+// a first step with no delay is applied to outputs by trigger interrupt
+// in: p_first first step
+// out: false if cancelled
+static bool wait_for_trigger(const sequence_values_t* p_first) {
+    arm_trigger(p_first->type == e_step_ramp && p_first->delay == 0 ? p_first : NULL);
+    printf("Waiting for trigger on GPIO %d (^c to cancel)\n", TRIGGER_GPIO);
+    while(!has_trigger_fired()) {
+        run_background_tasks();
+        if(line_editor_poll(&live_editor) == e_line_interrupt) {
+            trigger_disarm();
+            return false;
+        }
+    }
+    // steps are timed from trigger
+    cancel_repeating_timer(&sequence_timer);
+    start_sequence_timer();
+    printf("Triggered\n");
     return true;
 }
 
+// prints latency from trigger to first output edge, once it is known
+static void print_trigger_latency() {
+    const int32_t latency = trigger_get_latency_us();
+    if(latency >= 0) {
+        printf("Trigger to first output edge: %ld us\n", latency);
+    }
+}
+
+// cancels live overrides once a sequence is over
+static void end_live_overrides() {
+    sequence_paused = false;
+    sequence_store_request_swap(e_swap_none);
+    if(live_recording) { // goes on at prompt
+        live_recording = false;
+        next_values = live_record_values;
+        state_machine = es_recording;
+        printf("Still recording next sequence\n");
+    }
+    if(live_offset != 0.0f) {
+        live_offset = 0.0f;
+        __timer_controlled_sequence_step_actions(0, -1);
+    }
+}
+
+// prints speed definition of both sensors, or once if they are equal
+static void print_speed_definitions() {
+    char buf[32];
+    uint8_t sensor;
+    const speed_definition_t* p_definition;
+    for(sensor = 1; sensor <= NB_SPEED_DEFINITIONS; sensor++) {
+        p_definition = &speed_definitions[sensor - 1];
+        if(!are_speed_definitions_equal()) {
+            printf("Sensor %hu: ", sensor);
+        }
+        if(p_definition->hz_per_kmh == 0.0f) {
+            printf("no speed definition\n");
+            continue;
+        }
+        *buf = '\0';
+        if(!are_floats_equal_ulp(p_definition->gear_ratio, 1.0)) {
+            sprintf(buf, ", gear ratio: %f", p_definition->gear_ratio);
+        }
+        printf("%hu teeth, wheel diameter: %hu mm%s\n", p_definition->n_teeth, p_definition->diameter_mm, buf);
+        if(are_speed_definitions_equal()) {
+            break;
+        }
+    }
+}
+
+static void print_odometer() {
+    char buf[16];
+    uint8_t sensor;
+    int64_t edges;
+    for(sensor = 1; sensor <= 2; sensor++) {
+        edges = get_edge_count(sensor) - (sensor == 1 ? odometer_origin1 : odometer_origin2);
+        printf("Sensor %hu: %lld edges", sensor, edges);
+        if(value_is_speed()) {
+            printf(", %s m", _unsafe_format_float(get_distance(sensor, edges), buf));
+        }
+        printf("\n");
+    }
+}
+
+// train model integrated on core0 at TRAIN_MODEL_RATE_HZ when it drives outputs
+static train_model_t train_model;
+
+static bool train_model_callback(repeating_timer_t *rt) {
+    train_model_step(&train_model);
+    return true;
+}
+
+// Q16 m/s => km/h
+static float get_model_speed(int32_t speed) {
+    return (float)speed * (3.6f / TRAIN_MODEL_Q16_ONE);
+}
+
+static void print_train_model_state(uint32_t elapsed) {
+    char buf1[16], buf2[16], buf3[16];
+    printf("\r%lu\" - n%hu b%hu: %s km/h, wheels %s%s : %s%s km/h     ", elapsed,
+           train_model.notch, train_model.brake,
+           _unsafe_format_float(get_model_speed(train_model.speed), buf1),
+           _unsafe_format_float(get_model_speed(train_model.wheel_speed[0]), buf2),
+           train_model.slip_sign[0] > 0 ? " (slip)" : train_model.slip_sign[0] < 0 ? " (slide)" : "",
+           _unsafe_format_float(get_model_speed(train_model.wheel_speed[1]), buf3),
+           train_model.slip_sign[1] > 0 ? " (slip)" : train_model.slip_sign[1] < 0 ? " (slide)" : "");
+}
+
+// outputs follow wheel speeds of train model until ^c
+// model starts from current speed of sensor 1, directions are unchanged
+static void run_train_model() {
+    repeating_timer_t timer;
+    uint32_t ticks = 0, seconds = 0;
+    char buf[16];
+    train_model_init(&train_model, &train_default_params);
+    train_model_set_speed(&train_model, (int32_t)(current_values.firstValue * (TRAIN_MODEL_Q16_ONE / 3.6f)));
+    add_repeating_timer_us(-1000000 / TRAIN_MODEL_RATE_HZ, train_model_callback, NULL, &timer);
+    printf("Train model: n{notch} [0, %d], b{brake} [0, %d], a{adhesion}, ^c to leave\n",
+           TRAIN_MODEL_NB_NOTCHES, TRAIN_MODEL_NB_BRAKE_STEPS);
+    while(true) {
+        if(train_model.ticks != ticks) {
+            ticks = train_model.ticks;
+            current_values.firstValue = get_model_speed(train_model.wheel_speed[0]);
+            current_values.secondValue = get_model_speed(train_model.wheel_speed[1]);
+            send_current_values();
+            if(ticks / TRAIN_MODEL_RATE_HZ != seconds) { // foreground may miss ticks
+                seconds = ticks / TRAIN_MODEL_RATE_HZ;
+                print_train_model_state(seconds);
+            }
+        }
+        run_background_tasks();
+        switch(line_editor_poll(&live_editor)) {
+            case e_line_interrupt:
+                cancel_repeating_timer(&timer);
+                // outputs keep on at last wheel speeds
+                next_values = current_values;
+                next_values.type = e_step_ramp;
+                printf("\nTrain model stopped\n");
+                return;
+            case e_line_complete:
+            case e_line_overflow:
+                break;
+            default:
+                continue;
+        }
+        str_trim(live_str);
+        printf("\n");
+        switch(process_model_input(live_str)) {
+            case e_model_status:
+                print_train_model_state(ticks / TRAIN_MODEL_RATE_HZ);
+                printf("\nPeak adhesion %s\n", _unsafe_format_float((float)train_model.peak_adhesion / TRAIN_MODEL_Q16_ONE, buf));
+                break;
+            case e_model_notch:
+                train_model.notch = command_argument.integer;
+                if(command_argument.integer != 0) {
+                    train_model.brake = 0;
+                }
+                break;
+            case e_model_brake:
+                train_model.brake = command_argument.integer;
+                if(command_argument.integer != 0) {
+                    train_model.notch = 0;
+                }
+                break;
+            case e_model_adhesion:
+                train_model.peak_adhesion = command_argument.value * TRAIN_MODEL_Q16_ONE;
+                break;
+            case e_model_unknown:
+                printf("While train model runs: n{notch}, b{brake}, a{adhesion}, ^c (leave)\n");
+                break;
+        }
+    }
+}
+
+#if OUTPUT_SWEEP
+// frequency swept by core1 (64-bit access is not atomic: read again if interrupt updated it meanwhile)
+static float get_sweep_frequency() {
+    const volatile sweep_t* p_sweep = &output_sweep;
+    int64_t value;
+    do {
+        value = p_sweep->value;
+    } while(value != p_sweep->value);
+    return sweep_get_frequency(p_sweep->mode, value);
+}
+
+// sensor 1 (and sensor 2 generated by core1) sweeps frequency edge by edge
+// as parsed in command_argument, until over or ^c, then holds frequency reached
+// directions are unchanged
+static void run_sweep() {
+    static const char* mode_names[e_nb_sweep_modes] = {"Linear", "Log", "Stepped"};
+    const volatile sweep_t* p_sweep = &output_sweep;
+    intercore_data_t data = inter_core_data;
+    uint32_t i;
+    float f;
+    char buf1[16], buf2[16], buf3[16];
+
+    sweep_init(&output_sweep, command_argument.sweep_mode, command_argument.start_frequency,
+               command_argument.end_frequency, command_argument.value, command_argument.integer);
+    data.max_count1 = sweep_get_first_period(&output_sweep);
+#if CORE1_SENSOR2
+    data.max_count2 = data.max_count1;
+#endif
+    data.targeted1 = data.targeted2 = false;
+    data.sweep = true;
+    send_intercore_data(&data);
+    printf("%s sweep %s Hz to %s Hz in %s s, decade markers on GPIO %d (^c to stop)\n",
+           mode_names[command_argument.sweep_mode],
+           _unsafe_format_float(command_argument.start_frequency, buf1),
+           _unsafe_format_float(command_argument.end_frequency, buf2),
+           _unsafe_format_float(command_argument.value, buf3), SWEEP_MARKER_GPIO);
+    for(i = 0; !p_sweep->done; i++) {
+        if(i % TIMER_COUNT_PER_SECOND == 0) {
+            printf("\r%lu\" - %s Hz     ", i / TIMER_COUNT_PER_SECOND, _unsafe_format_float(get_sweep_frequency(), buf1));
+        }
+        if(line_editor_poll(&live_editor) == e_line_interrupt) {
+            printf("\nSweep stopped");
+            break;
+        }
+        WAIT_FOR_FLAG(TIMER_SEQ_ID, 1)
+    }
+    // disarms sweep, outputs keep on at frequency reached
+    f = get_sweep_frequency();
+    printf("\n%s Hz held\n", _unsafe_format_float(f, buf1));
+    current_values.firstValue = get_value(1, f);
+#if CORE1_SENSOR2
+    current_values.secondValue = get_value(2, f);
+#endif
+    next_values = current_values;
+    next_values.type = e_step_ramp;
+    send_current_values();
+}
+#endif
+
+// pre-flight analysis of a sequence (see sequence-store.h), with speed definitions in use
+// in: warnings_only => only steps clamped and direction changes at speed
+static void print_preflight(const sequence_preflight_t* p_preflight, bool warnings_only) {
+    const bool is_speed = value_is_speed();
+    char buf1[16], buf2[16], buf3[16];
+    float f;
+    uint8_t i;
+    if(!warnings_only) {
+        printf("Pre-flight: %lu\" of ramps", p_preflight->duration);
+        if(p_preflight->nb_moves != 0) {
+            printf(", %lu move(s) (%.2f m, %lld edges)", p_preflight->nb_moves,
+                   p_preflight->move_distance, p_preflight->move_edges);
+        }
+        printf(", %lu jump(s)\n", p_preflight->nb_jumps);
+        for(i = 0; i < NB_SPEED_DEFINITIONS; i++) {
+            // km/h x s => m, km/h/s => m/s2 (frequencies: cycles, Hz/s)
+            printf(" sensor %hu: %s %s, peak %s %s", i + 1,
+                   _unsafe_format_float(is_speed ? p_preflight->areas[i] / 3.6f : p_preflight->areas[i], buf1),
+                   is_speed ? "m" : "cycles",
+                   _unsafe_format_float(is_speed ? p_preflight->peak_accelerations[i] / 3.6f
+                                                 : p_preflight->peak_accelerations[i], buf2),
+                   is_speed ? "m/s2" : "Hz/s");
+            if(p_preflight->peak_steps[i] != 0) {
+                printf(" at step %lu", p_preflight->peak_steps[i]);
+            }
+            if(p_preflight->min_steps[i] != 0) {
+                printf(", %s to %s %s", _unsafe_format_float(p_preflight->min_values[i], buf1),
+                       _unsafe_format_float(p_preflight->max_values[i], buf2), is_speed ? "km/h" : "Hz");
+            }
+            printf("\n");
+        }
+    }
+    // output clamps frequencies (see get_period)
+    for(i = 0; i < NB_SPEED_DEFINITIONS; i++) {
+        f = get_frequency(i + 1, p_preflight->min_values[i]);
+        if(p_preflight->min_steps[i] != 0 && f < MIN_FREQUENCY) {
+            printf("Warning: sensor %hu at %s Hz on step %lu, raised to %s Hz\n", i + 1,
+                   _unsafe_format_float(f, buf1), p_preflight->min_steps[i], _unsafe_format_float(MIN_FREQUENCY, buf2));
+        }
+        f = get_frequency(i + 1, p_preflight->max_values[i]);
+        if(p_preflight->max_steps[i] != 0 && f > MAX_FREQUENCY) {
+            printf("Warning: sensor %hu at %s Hz on step %lu, clamped to %s Hz\n", i + 1,
+                   _unsafe_format_float(f, buf1), p_preflight->max_steps[i], _unsafe_format_float(MAX_FREQUENCY, buf3));
+        }
+    }
+    if(p_preflight->nb_reversals != 0) {
+        printf("Warning: %lu direction change(s) at speed\n", p_preflight->nb_reversals);
+    }
+}
+
+// lists steps of timeline of each sensor
+static void print_timelines() {
+    const timeline_channel_t* p_channel;
+    char buf1[16], buf2[16];
+    uint8_t i;
+    uint16_t j;
+    for(i = 0; i < NB_SPEED_DEFINITIONS; i++) {
+        p_channel = &timelines.channels[i];
+        printf("Sensor %hu: %hu step(s), %s s\n", i + 1, p_channel->count,
+               _unsafe_format_float((float)timeline_get_duration(&timelines, i) / TIMER_COUNT_PER_SECOND, buf1));
+        for(j = 0; j < p_channel->count; j++) {
+            printf(" %hu- %s\" > %c%s\n", j + 1,
+                   _unsafe_format_float((float)p_channel->steps[j].ticks / TIMER_COUNT_PER_SECOND, buf1),
+                   p_channel->steps[j].reverse ? '-' : '+', _unsafe_format_float(p_channel->steps[j].value, buf2));
+        }
+    }
+}
+
+// runs timeline of each sensor from current values, each one on its own steps,
+// once or in loop (each timeline starting over on its own), until over or ^c
+// live commands apply as in sequences (n ends steps in progress of both sensors)
+static void run_timelines(bool loop) {
+    const float values[NB_SPEED_DEFINITIONS] = {current_values.firstValue, current_values.secondValue};
+    const bool reverses[NB_SPEED_DEFINITIONS] = {current_values.firstReverse, current_values.secondReverse};
+    uint32_t tick = 0;
+    bool running;
+    step_action_e action;
+
+    printf("Running timelines%s (^c to stop)\n", loop ? " in loop" : "");
+    sequence_paused = false;
+    WAIT_FOR_FLAG(TIMER_SEQ_ID, 1)
+    timeline_start(&timelines, tick, values, reverses, loop);
+    while(true) {
+        running = timeline_poll(&timelines, tick);
+        current_values.firstValue = timeline_get_value(&timelines, 0, tick);
+        current_values.secondValue = timeline_get_value(&timelines, 1, tick);
+        current_values.firstReverse = timeline_get_reverse(&timelines, 0);
+        current_values.secondReverse = timeline_get_reverse(&timelines, 1);
+        action = __timer_controlled_sequence_step_actions(
+                     (tick % TIMER_COUNT_PER_SECOND == 0 && !sequence_paused) || !running ? 2 : 0,
+                     tick / TIMER_COUNT_PER_SECOND);
+        if(action == e_step_interrupt) {
+            printf("\n");
+            printf(msg_sequence_interrupted);
+            break;
+        }
+        if(action == e_step_skip) {
+            timeline_skip(&timelines, tick);
+            continue;
+        }
+        if(!running) {
+            printf("\n");
+            break;
+        }
+        if(!sequence_paused) { // timelines frozen while paused
+            tick++;
+        }
+        WAIT_FOR_FLAG(TIMER_SEQ_ID, 1)
+    }
+    // outputs keep on at values reached
+    next_values = current_values;
+    next_values.type = e_step_ramp;
+    end_live_overrides();
+}
+
+#if OUTPUT_STANDSTILL
+// standstill model in use, and where stopped sensors generated by core1 chatter
+static void print_standstill() {
+    const standstill_params_t* p_params = &inter_core_data.standstill;
+    char buf1[16];
+    if(p_params->amplitude == 0) {
+        printf("Standstill: off (stopped sensors freeze)\n");
+        return;
+    }
+    // 4 edges per cycle, creep in edges per µs Q40
+    printf("Standstill: +/-%hu edges, %lu to %lu ms between edges, creep %s Hz\n",
+           p_params->amplitude, p_params->min_interval_us / 1000,
+           (p_params->min_interval_us + p_params->interval_span_us) / 1000,
+           _unsafe_format_float(p_params->creep * 1e6f / 4.0f / (float)(1LL << STANDSTILL_REST_SHIFT), buf1));
+    if(output_standstill_armed1) {
+        printf(" sensor 1 at %ld edges from where it stopped\n", output_standstill1.position);
+    }
+    if(output_standstill_armed2) {
+        printf(" sensor 2 at %ld edges from where it stopped\n", output_standstill2.position);
+    }
+}
+#endif
+
 int main() {
-    static repeating_timer_t timer;
     static char str[80], buf1[16], buf2[16];
+    sequence_cursor_t cursor;
+    sequence_values_t step;
+    intercore_data_t temp_intercore_data;
+    session_state_t session_state;
     int i, looping;
     float f;
   
-    gpio_init(LED_PIN);
-    gpio_set_dir(LED_PIN, GPIO_OUT);
-
-    add_repeating_timer_ms(-100, timer_callback, NULL, &timer);
-
-    stdio_init_all();
-    sleep_ms(4000); // better to ensure virtual serial port is properly set
-
-    printf("Speed sensor simulator\n");
-    printf("Hardware clock: %lu Hz\n", clock_get_hz(clk_sys));
-    print_help(false);
-   
+    // before anything logs: keeps events which led to a soft reset
+    journal_init();
+    // outputs first: device under test should not see them dead after a reset
     queue_init(&call_queue, sizeof(intercore_data_t), 2);
+    line_editor_init(&live_editor, live_str, sizeof(live_str));
+    state_snapshot_restore(&next_values, speed_definitions);
 
     multicore_launch_core1(core1_main);
+#if SPLIT_CORES
+    core0_output_init();
+#endif
 
     send_intercore_data(NULL); // init inter-core data
     current_values = next_values;
-    timer_controlled_sequence_step(true); // set to whatever values current_values is initalized with
+    __timer_controlled_sequence_step_actions(0, -1); // set to whatever values current_values is initalized with
+
+    gpio_init(LED_PIN);
+    gpio_set_dir(LED_PIN, GPIO_OUT);
+
+    sync_init(time_us_64() + SYNC_PLL_NOMINAL_PERIOD_US);
+    start_sequence_timer();
+
+    sequence_store_init();
+    timeline_init(&timelines, timeline_channels, timeline_events, NB_SPEED_DEFINITIONS);
+    trigger_init();
+    // virtual serial port gets ready in background (see run_background_tasks)
+    stdio_init_all();
 
      while (true) {
         printf(">");
+        at_prompt = true;
+        session_set_prompt(true);
         get_input(str, sizeof(str));
+        session_set_prompt(false);
+        at_prompt = false;
+        // a run starts with an empty live line
+        line_editor_init(&live_editor, live_str, sizeof(live_str));
         str_trim(str);
         if(strlen(str) == 0) { // void command: display current values
              bool are_sensors_equal = inter_core_data.invert1 == inter_core_data.invert2 &&
                                       inter_core_data.max_count1 == inter_core_data.max_count2;
             if(value_is_speed()) {
-                *buf1 = '\0';
-                if(!are_floats_equal_ulp(speed_definition.gear_ratio, 1.0)) {
-                    sprintf(buf1, ", gear ratio: %f", speed_definition.gear_ratio);
-                }
-                printf("%hu teeth, wheel diameter: %hu mm%s\n", speed_definition.n_teeth, speed_definition.diameter_mm, buf1);
-                f = get_corrected_value(inter_core_data.max_count1);
+                print_speed_definitions();
+                f = get_corrected_value(1, inter_core_data.max_count1);
                 printf("%c%s km/h (%s Hz)", inter_core_data.invert1 ? '-' : '+',
                                             _unsafe_format_float(f, buf1),
-                                            _unsafe_format_float(get_frequency(f), buf2));
+                                            _unsafe_format_float(get_frequency(1, f), buf2));
                 if(!are_sensors_equal) {
-                    f = get_corrected_value(inter_core_data.max_count2);
+                    f = get_corrected_value(2, inter_core_data.max_count2);
                     printf(" : %c%s km/h (%s Hz)", inter_core_data.invert2 ? '-' : '+',
                                                 _unsafe_format_float(f, buf1),
-                                                _unsafe_format_float(get_frequency(f), buf2));
+                                                _unsafe_format_float(get_frequency(2, f), buf2));
                 }
                 printf("\n");
             } else {
                 printf("No speed defined: only deals with frequencies\n");
-                f = get_corrected_value(inter_core_data.max_count1);
+                if(speed_definitions[0].hz_per_kmh != 0.0f || speed_definitions[1].hz_per_kmh != 0.0f) {
+                    print_speed_definitions(); // one sensor defined, the other one is missing
+                }
+                f = get_corrected_value(1, inter_core_data.max_count1);
                 printf("%s Hz, %s", _unsafe_format_float(f, buf1),
                                     inter_core_data.invert1 ? "reversed" : "forward");
                 if(!are_sensors_equal) {
-                    f  = get_corrected_value(inter_core_data.max_count2);
+                    f  = get_corrected_value(2, inter_core_data.max_count2);
                      printf(" : %s Hz, %s", _unsafe_format_float(f, buf1),
                                     inter_core_data.invert2 ? "reversed" : "forward");
                 }
                 printf("\n");
             }
+            if(telemetry_get_rate() != 0) {
+                printf("Telemetry at %hu Hz, %lu frame(s) dropped\n",
+                       telemetry_get_rate(), telemetry_get_dropped_frames());
+            }
             continue;
         }
         printf("\n");
         command_e r = process_input(str);
+        journal_log(e_journal_command, r, journal_pack_text(str));
     #ifdef DEBUG_STUFF
         printf("result: %s, state: %s\n", cmd_result_as_str(r, cmd_result_as_str_map),
                                           cmd_result_as_str(state_machine, state_machine_as_str_map));
@@ -347,10 +1302,9 @@ int main() {
             case e_new_record:
                if(state_machine != es_recording) {
                     goto _immediate_value;
-               } else if(sequence_index == SEQUENCE_VALUE_ARRAY_SIZE){
+               } else if(!sequence_store_append(&next_values)) {
                     printf("Error: recording array is full!\n");
                } else {
-                    sequence_array[sequence_index++] = next_values;
     #ifdef DEBUG_STUFF
                     printf("%.2f%s:%.2f%s %hd\"\n", next_values.firstValue, next_values.firstReverse ? " rev" : "",
                             next_values.secondValue, next_values.secondReverse ? " rev" : "", next_values.delay);
@@ -365,36 +1319,222 @@ int main() {
                 printf("%.2f%s:%.2f%s %hd\"\n", next_values.firstValue, next_values.firstReverse ? " rev" : "",
                     next_values.secondValue, next_values.secondReverse ? " rev" : "", next_values.delay);
     #endif
+                sequence_paused = false;
                 if(!timer_controlled_sequence_step(true)) {
                     printf(msg_sequence_interrupted);
                 }
+                end_live_overrides();
                 flush_stdin();
                 break;
             case e_new_speed_definition:
-                if(speed_definition.n_teeth==0 || speed_definition.diameter_mm==0) {
+                if(!value_is_speed()) {
                     printf("Speed definition cancelled (only deals with frequencies)\n");
                 } else {
-                    printf("New speed definition: %hd teeth, diameter= %hd mm, r=%f\n", speed_definition.n_teeth, speed_definition.diameter_mm, speed_definition.gear_ratio);
+                    printf("New speed definition: %hd teeth, diameter= %hd mm, r=%f\n", speed_definitions[0].n_teeth, speed_definitions[0].diameter_mm, speed_definitions[0].gear_ratio);
+                }
+                break;
+            case e_new_sensor_speed_definition:
+                if(speed_definitions[command_argument.integer - 1].hz_per_kmh == 0.0f) {
+                    printf("Speed definition of sensor %ld cancelled (only deals with frequencies)\n",
+                           command_argument.integer);
+                    break;
+                }
+                printf("New speed definition of sensor %ld: %hd teeth, diameter= %hd mm, r=%f\n", command_argument.integer,
+                       speed_definitions[command_argument.integer - 1].n_teeth,
+                       speed_definitions[command_argument.integer - 1].diameter_mm,
+                       speed_definitions[command_argument.integer - 1].gear_ratio);
+                if(!value_is_speed()) {
+                    printf("Speed definition of other sensor missing (only deals with frequencies)\n");
+                }
+                break;
+            case e_telemetry:
+                telemetry_set_rate(command_argument.integer);
+                if(command_argument.integer == 0) {
+                    printf("Telemetry stopped\n");
+                } else {
+                    printf("Telemetry started at %ld Hz\n", command_argument.integer);
+                }
+                break;
+            case e_backend:
+                if(command_argument.integer >= 0) {
+                    temp_intercore_data = inter_core_data;
+                    temp_intercore_data.backend = command_argument.integer;
+                    send_intercore_data(&temp_intercore_data);
+                }
+                print_backends();
+                break;
+            case e_odometer:
+                print_odometer();
+                break;
+            case e_session:
+                session_print_status();
+                break;
+            case e_record_session:
+                printf("Recording session (r- to stop), sequence list emptied\n");
+                get_session_state(&session_state);
+                apply_session_state(&session_state);
+                session_record(&session_state, sizeof(session_state));
+                break;
+            case e_stop_session:
+                session_stop();
+                session_print_status();
+                break;
+            case e_replay_session:
+                if(sync_get_role() != e_sync_off) {
+                    printf("Error: replay not available while synchronized\n");
+                    break;
+                }
+                if(!session_get_recorded_state(&session_state, sizeof(session_state))) {
+                    printf("Error: no session recorded\n");
+                    break;
+                }
+                printf("Replaying session %ldx faster (any key to stop)\n", command_argument.integer);
+                apply_session_state(&session_state);
+                session_replay(command_argument.integer);
+                break;
+            case e_dump_session:
+                session_stop();
+                session_dump();
+                break;
+            case e_sync:
+                if(command_argument.integer >= 0) {
+                    sync_set_role(command_argument.integer);
+                }
+                print_sync();
+                break;
+            case e_train_model:
+                if(!value_is_speed()) {
+                    printf("Error: train model requires a speed definition\n");
+                    break;
+                }
+                run_train_model();
+                flush_stdin();
+                break;
+            case e_sweep:
+#if OUTPUT_SWEEP
+                if(inter_core_data.backend == e_backend_vr) {
+                    printf("Error: sweep not available on VR backend\n");
+                    break;
                 }
+                run_sweep();
+                flush_stdin();
+#endif
+                break;
+            case e_standstill:
+#if OUTPUT_STANDSTILL
+                if(command_argument.integer >= 0) {
+                    temp_intercore_data = inter_core_data;
+                    standstill_init_params(&temp_intercore_data.standstill, command_argument.integer,
+                                           command_argument.interval_ms, command_argument.value);
+                    send_intercore_data(&temp_intercore_data);
+                }
+                print_standstill();
+#endif
+                break;
+            case e_timeline:
+                print_timelines();
+                break;
+            case e_timeline_step:
+                if(!timeline_append(&timelines, command_argument.integer - 1, command_argument.value,
+                                    command_argument.reverse,
+                                    lroundf(command_argument.delay * TIMER_COUNT_PER_SECOND))) {
+                    printf("Error: timeline of sensor %ld is full!\n", command_argument.integer);
+                }
+                break;
+            case e_clear_timelines:
+                timeline_clear(&timelines, 0);
+                timeline_clear(&timelines, 1);
+                printf("Timelines cleared\n");
+                break;
+            case e_run_timelines:
+                if(timelines.channels[0].count == 0 && timelines.channels[1].count == 0) {
+                    printf("Error: no timeline step defined\n");
+                    break;
+                }
+                run_timelines(command_argument.integer);
+                flush_stdin();
+                break;
+            case e_journal:
+                journal_print();
+                break;
+            case e_clear_journal:
+                journal_clear();
+                printf("Journal cleared\n");
+                break;
+            case e_save_state:
+                printf(state_snapshot_save(&current_values, speed_definitions) ?
+                       "Output state saved, restored at boot\n" : "Output state already saved\n");
+                break;
+            case e_reset_odometer:
+                odometer_origin1 = get_edge_count(1);
+                odometer_origin2 = get_edge_count(2);
+                printf("Odometer reset\n");
                 break;
             case e_syntax_error:
             case e_range_error:
                 break;
             case e_init_list:
-                sequence_index = 0;
+                sequence_store_record();
                 state_machine = es_recording;
                 break;
             case e_close_list:
+                if(state_machine == es_recording) {
+                    sequence_store_swap();
+                }
                 state_machine = es_default; 
                 break;
             case e_execute_list:
             case e_loop_list:
+            case e_trigger_list:
+            case e_trigger_steps_list:
+                if(r != e_execute_list && r != e_loop_list && sync_get_role() != e_sync_off) {
+                    printf("Error: trigger not available while synchronized\n");
+                    break;
+                }
+                if(state_machine == es_recording) {
+                    sequence_store_swap();
+                }
                 state_machine = es_default;
+                print_preflight(sequence_store_get_preflight(), true);
                 looping = (r == e_loop_list);
+                trigger_mode = r == e_trigger_list ? e_trigger_start :
+                               r == e_trigger_steps_list ? e_trigger_steps : e_trigger_off;
+                sequence_paused = false;
                 do {
-                    for(i=0; i<sequence_index; i++) {
-                        next_values = sequence_array[i];
-                        printf("Step %d", i+1);
+                    sequence_cursor_start(&cursor);
+                    for(i=0; sequence_cursor_next(&cursor, &next_values); i++) {
+                        if(i == 0 && trigger_mode != e_trigger_off && !wait_for_trigger(&next_values)) {
+                            printf(msg_sequence_interrupted);
+                            break;
+                        }
+                        if(i == 0 && sync_get_role() != e_sync_off && !sync_sequence_start()) {
+                            printf(msg_sequence_interrupted);
+                            looping = false;
+                            break;
+                        }
+                        if(i != 0 && sync_get_role() == e_sync_leader) { // step starts on next tick
+                            sync_set_step(cursor.index, sync_get_tick() + 1);
+                        }
+                        sync_running_step = cursor.index;
+                        if(trigger_mode == e_trigger_steps) { // next edge jumps to end of step
+                            arm_trigger(next_values.type == e_step_ramp ? &next_values : NULL);
+                        }
+                        if(cursor.swapped) { // carries on from current values
+                            printf("Swapped to next sequence\n");
+                        }
+                        journal_log(e_journal_step, next_values.type, cursor.index);
+                        printf("Step %lu", cursor.index);
+                        if(next_values.type != e_step_ramp) {
+                            printf(" move ");
+                            print_move_target(&next_values);
+                            printf(" %s\n", get_reverse_description(&current_values));
+                            if(!timer_controlled_sequence_step(i == 0 && trigger_mode == e_trigger_off)) {
+                                printf(msg_sequence_interrupted);
+                                looping = false;
+                                break;
+                            }
+                            continue;
+                        }
                         if(next_values.delay) {
                             printf(" %hd\"", next_values.delay);
                         }
@@ -434,28 +1574,48 @@ int main() {
                             printf( " > %s", pNextDesc);
                         }
                         printf("\n");
-                        if(!timer_controlled_sequence_step(i == 0)) {
+                        if(!timer_controlled_sequence_step(i == 0 && trigger_mode == e_trigger_off)) {
                             printf(msg_sequence_interrupted);
                             looping = false;
                             break;
                         }
                     }
                 } while(looping);
+                if(trigger_mode != e_trigger_off) {
+                    trigger_disarm();
+                    trigger_mode = e_trigger_off;
+                    print_trigger_latency();
+                }
+                if(sync_get_role() == e_sync_leader) {
+                    sync_set_step(0, sync_get_tick());
+                }
+                sync_running_step = 0;
+                end_live_overrides();
                 break;
             case e_print_list:
-                for(i=0; i<sequence_index; i++) {
+                sequence_cursor_start(&cursor);
+                for(i=0; sequence_cursor_next(&cursor, &step); i++) {
+                    if(step.type != e_step_ramp) {
+                        printf("%i- @", i+1);
+                        print_move_target(&step);
+                        printf("\n");
+                        continue;
+                    }
                     printf("%i- %hu\"> %c%s : %c%s\n",
-                           i+1, sequence_array[i].delay,
-                           sequence_array[i].secondReverse?'-':'+',
-                           _unsafe_format_float(sequence_array[i].firstValue, buf1),
-                           sequence_array[i].secondReverse?'-':'+',
-                           _unsafe_format_float(sequence_array[i].secondValue, buf2)
+                           i+1, step.delay,
+                           step.firstReverse?'-':'+',
+                           _unsafe_format_float(step.firstValue, buf1),
+                           step.secondReverse?'-':'+',
+                           _unsafe_format_float(step.secondValue, buf2)
                            );
                 }
-                if(sequence_index == 0) {
+                if(sequence_store_count() == 0) {
                     printf("Sequence list is empty\n");
                 } else {
                     printf("Values are in %s\n", value_is_speed() ? "km/h" : "Hz");
+                    printf("%lu steps, %lu of %lu bytes used\n", sequence_store_count(),
+                           sequence_store_used(), sequence_store_capacity());
+                    print_preflight(sequence_store_get_preflight(), false);
                 }
                 break;
             case e_help:
@@ -465,6 +1625,8 @@ int main() {
                 print_help(true);
                 break;
         }
+        // a live line left partial when a run ended is dropped
+        line_editor_init(&live_editor, live_str, sizeof(live_str));
     }
 }
 
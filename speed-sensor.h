@@ -4,8 +4,6 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-#define SEQUENCE_VALUE_ARRAY_SIZE 64
-
 #define STEPS_PER_SECOND 5
 #define TIMER_COUNT_PER_STEP 2
 
@@ -13,7 +11,17 @@
 
 extern volatile uint8_t timer_armed_counts[NB_ARMED_COUNTS];
 
-#define WAIT_FOR_FLAG(n, v) { timer_armed_counts[n]=v; while(timer_armed_counts[n]!=0){} }
+#define WAIT_FOR_FLAG(n, v) { timer_armed_counts[n]=v; while(timer_armed_counts[n]!=0){ run_background_tasks(); tight_loop_contents(); } }
+
+// tasks which should keep running whatever core0 is waiting for
+// (like telemetry output)
+void run_background_tasks();
+
+typedef enum {
+    e_step_ramp, // linear progression to values within delay
+    e_step_move_distance, // travel target meters then stop
+    e_step_move_edges // output target edges then stop
+} step_type_e;
 
 typedef struct {
     float firstValue;
@@ -21,18 +29,37 @@ typedef struct {
     bool firstReverse;
     bool secondReverse;
     uint16_t delay;
+    uint8_t type; // see step_type_e
+    // moves only: exact number of edges (e_step_move_edges) or distance (e_step_move_distance, m),
+    // float would round counts past 2^24 edges and distances past a few km to the cm
+    int64_t target_edges;
+    double target_distance;
+    float deceleration; // moves only: m/s2 or Hz/s, 0 for default
 } sequence_values_t;
 
 typedef struct {
     uint16_t n_teeth;
     uint16_t diameter_mm;
     float gear_ratio;
+    float hz_per_kmh; // cached at definition time: frequency at 1 km/h, 0 when not defined
 } speed_definition_t;
 
+// one speed definition per sensor (wheels may have different worn diameters)
+#define NB_SPEED_DEFINITIONS 2
+
 #define MIN_FREQUENCY 0.1f
 #define MAX_FREQUENCY 7300.0f
 
+// moves: default decelerations when speed is defined (m/s2) or not (Hz/s)
+#define MOVE_DEFAULT_DECELERATION 1.0f
+#define MOVE_DEFAULT_FREQUENCY_DECELERATION 100.0f
+// moves: approach frequency of last edges (and start frequency if stopped)
+#define MOVE_CRAWL_FREQUENCY 2.0f
+// moves: longest one in edges (2^53, held exactly by a double), so that edge count plus
+// move target cannot overflow (edge counts would take millions of years to get near)
+#define MAX_MOVE_EDGES 9007199254740992LL
+
 extern sequence_values_t next_values;
-extern speed_definition_t speed_definition;
+extern speed_definition_t speed_definitions[NB_SPEED_DEFINITIONS];
 
 #endif
\ No newline at end of file
@@ -0,0 +1,27 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Standstill model of sensor outputs: vibration and creep around zero speed
+ */
+
+#include "standstill.h"
+
+#include <math.h>
+
+void standstill_init_params(standstill_params_t* p_params, uint8_t amplitude,
+                            uint16_t max_interval_ms, float creep_frequency) {
+    const uint32_t max_interval_us = max_interval_ms * 1000;
+    p_params->amplitude = amplitude;
+    p_params->min_interval_us = max_interval_us / STANDSTILL_INTERVAL_RATIO;
+    p_params->interval_span_us = max_interval_us - p_params->min_interval_us;
+    // 4 edges per cycle
+    p_params->creep = (int32_t)lround(creep_frequency * 4.0 / 1e6 * (double)(1LL << STANDSTILL_REST_SHIFT));
+}
+
+uint32_t standstill_start(standstill_t* p_standstill, const standstill_params_t* p_params, uint32_t seed) {
+    p_standstill->params = *p_params;
+    p_standstill->position = 0;
+    p_standstill->rest = 0;
+    p_standstill->random = seed != 0 ? seed : 0x9E3779B9;
+    return standstill_interval(p_standstill);
+}
@@ -0,0 +1,81 @@
+#ifndef STANDSTILL_H
+#define STANDSTILL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// standstill model: instead of freezing at zero speed, a sensor chatters back and forth
+// across tooth edges like a real one on a vibrating vehicle, optionally creeping below
+// MIN_FREQUENCY, edge by edge in output interrupt (integer only, xorshift PRNG)
+// shared by firmware (output-backend.h) and host check (host/standstill-check.c)
+// so it must not depend on any pico header
+//
+// each edge moves position one edge forward or back, at random intervals:
+// position stays within amplitude edges of a rest point, which moves at creep speed,
+// so that net displacement is bounded (creep apart) and direction toggles at creep speeds
+
+#define STANDSTILL_MAX_AMPLITUDE 8
+#define STANDSTILL_MIN_INTERVAL_MS 1
+#define STANDSTILL_MAX_INTERVAL_MS 1000
+// intervals between edges are drawn from [max / STANDSTILL_INTERVAL_RATIO, max]
+#define STANDSTILL_INTERVAL_RATIO 16
+// rest point is in edges Q40: creep below MIN_FREQUENCY is then exact within 1e-5
+// and rest point lasts months before overflowing
+#define STANDSTILL_REST_SHIFT 40
+
+typedef struct {
+    uint8_t amplitude; // edges around rest point, 0: sensor freezes at zero speed
+    uint32_t min_interval_us;
+    uint32_t interval_span_us; // max - min
+    int32_t creep; // speed of rest point, edges per µs Q40 (negative: reverse)
+} standstill_params_t;
+
+typedef struct {
+    standstill_params_t params;
+    int32_t position; // edges output, relative to where standstill started
+    int64_t rest; // rest point, edges Q40
+    uint32_t random; // xorshift32 state, never 0
+} standstill_t;
+
+// params of a standstill model, from max interval between edges (ms) and creep speed
+// (frequency in Hz, below MIN_FREQUENCY, negative to creep in reverse)
+void standstill_init_params(standstill_params_t* p_params, uint8_t amplitude,
+                            uint16_t max_interval_ms, float creep_frequency);
+// starts standstill model from where sensor is, seed is any value
+// out: interval to first edge (µs)
+uint32_t standstill_start(standstill_t* p_standstill, const standstill_params_t* p_params, uint32_t seed);
+
+static inline uint32_t standstill_random(standstill_t* p_standstill) {
+    uint32_t x = p_standstill->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    p_standstill->random = x;
+    return x;
+}
+
+// interval to next edge (µs), random within params
+static inline uint32_t standstill_interval(standstill_t* p_standstill) {
+    return p_standstill->params.min_interval_us +
+           (uint32_t)(((uint64_t)standstill_random(p_standstill) * p_standstill->params.interval_span_us) >> 32);
+}
+
+// accounts for an edge output in direction (+1/-1), which lasted elapsed_us
+// out: direction of next edge, p_interval: interval to it (µs)
+static inline int8_t standstill_next_edge(standstill_t* p_standstill, int8_t direction,
+                                          uint32_t elapsed_us, uint32_t* p_interval) {
+    int32_t deviation;
+    p_standstill->position += direction;
+    p_standstill->rest += (int64_t)p_standstill->params.creep * elapsed_us;
+    deviation = p_standstill->position - (int32_t)(p_standstill->rest >> STANDSTILL_REST_SHIFT);
+    *p_interval = standstill_interval(p_standstill);
+    if(deviation >= p_standstill->params.amplitude) {
+        return -1;
+    }
+    if(deviation <= -p_standstill->params.amplitude) {
+        return 1;
+    }
+    return (standstill_random(p_standstill) & 1) ? 1 : -1;
+}
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Output state snapshot in flash
+ */
+
+#include "state-snapshot.h"
+
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+
+#define SNAPSHOT_MAGIC 0x53534E32 // "SSN2": one speed definition per sensor
+#define SNAPSHOT_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define SNAPSHOT_NB_SLOTS (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t serial; // most recent valid slot has the highest serial
+    float firstValue;
+    float secondValue;
+    bool firstReverse;
+    bool secondReverse;
+    speed_definition_t speed_definitions[NB_SPEED_DEFINITIONS];
+    uint32_t checksum;
+} snapshot_t;
+
+static const snapshot_t* const flash_slots = (const snapshot_t*)(XIP_BASE + SNAPSHOT_FLASH_OFFSET);
+
+// slot to be written next and serial of last one
+static int8_t next_slot = -1;
+static uint32_t last_serial = 0;
+// what is saved, or about to be once it's stable
+static snapshot_t saved;
+static snapshot_t pending;
+static uint32_t pending_since_ms;
+
+static uint32_t get_checksum(const snapshot_t* p_snapshot) {
+    const uint8_t* p_byte = (const uint8_t*)p_snapshot;
+    uint32_t sum = 0;
+    while(p_byte < (const uint8_t*)&p_snapshot->checksum) {
+        sum = (sum << 1 | sum >> 31) + *p_byte++;
+    }
+    return ~sum;
+}
+
+static const snapshot_t* get_slot(uint8_t index) {
+    return (const snapshot_t*)((const uint8_t*)flash_slots + index * FLASH_PAGE_SIZE);
+}
+
+static void fill_snapshot(snapshot_t* p_snapshot, const sequence_values_t* p_values,
+                          const speed_definition_t* p_speed_definitions) {
+    memset(p_snapshot, 0, sizeof(snapshot_t)); // padding is part of checksum
+    p_snapshot->magic = SNAPSHOT_MAGIC;
+    p_snapshot->firstValue = p_values->firstValue;
+    p_snapshot->secondValue = p_values->secondValue;
+    p_snapshot->firstReverse = p_values->firstReverse;
+    p_snapshot->secondReverse = p_values->secondReverse;
+    memcpy(p_snapshot->speed_definitions, p_speed_definitions, sizeof(p_snapshot->speed_definitions));
+}
+
+// same state, whatever serial and checksum
+static bool is_same_state(const snapshot_t* p1, const snapshot_t* p2) {
+    return memcmp(&p1->firstValue, &p2->firstValue,
+                  (const uint8_t*)&p1->checksum - (const uint8_t*)&p1->firstValue) == 0;
+}
+
+bool state_snapshot_restore(sequence_values_t* p_values, speed_definition_t* p_speed_definitions) {
+    const snapshot_t* p_last = NULL;
+    const snapshot_t* p_slot;
+    uint8_t i;
+    next_slot = 0;
+    for(i = 0; i < SNAPSHOT_NB_SLOTS; i++) {
+        p_slot = get_slot(i);
+        if(p_slot->magic == 0xFFFFFFFF) { // erased: slots are written in order
+            next_slot = i;
+            break;
+        }
+        next_slot = -1; // no free slot (unless an erased one is found further)
+        if(p_slot->magic == SNAPSHOT_MAGIC && p_slot->checksum == get_checksum(p_slot) &&
+           (p_last == NULL || p_slot->serial > p_last->serial)) {
+            p_last = p_slot;
+        }
+    }
+    if(p_last == NULL) {
+        return false;
+    }
+    saved = *p_last;
+    last_serial = saved.serial;
+    pending = saved;
+    p_values->firstValue = saved.firstValue;
+    p_values->secondValue = saved.secondValue;
+    p_values->firstReverse = saved.firstReverse;
+    p_values->secondReverse = saved.secondReverse;
+    p_values->delay = 0;
+    p_values->type = e_step_ramp;
+    memcpy(p_speed_definitions, saved.speed_definitions, sizeof(saved.speed_definitions));
+    return true;
+}
+
+static void write_snapshot(const snapshot_t* p_snapshot) {
+    static uint8_t page[FLASH_PAGE_SIZE];
+    uint32_t interrupts;
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, p_snapshot, sizeof(snapshot_t));
+    // core1 runs output interrupt from flash: parks it in RAM while XIP is off
+    multicore_lockout_start_blocking();
+    interrupts = save_and_disable_interrupts();
+    if(next_slot < 0) {
+        flash_range_erase(SNAPSHOT_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+        next_slot = 0;
+    }
+    flash_range_program(SNAPSHOT_FLASH_OFFSET + next_slot * FLASH_PAGE_SIZE, page, FLASH_PAGE_SIZE);
+    restore_interrupts(interrupts);
+    multicore_lockout_end_blocking();
+    if(++next_slot >= SNAPSHOT_NB_SLOTS) {
+        next_slot = -1;
+    }
+}
+
+static void save_pending() {
+    pending.serial = ++last_serial;
+    pending.checksum = get_checksum(&pending);
+    write_snapshot(&pending);
+    saved = pending;
+}
+
+void state_snapshot_poll(const sequence_values_t* p_values, const speed_definition_t* p_speed_definitions) {
+    snapshot_t current;
+    const uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    fill_snapshot(&current, p_values, p_speed_definitions);
+    if(!is_same_state(&current, &pending)) {
+        pending = current;
+        pending_since_ms = now_ms;
+        return;
+    }
+    // running outputs are left alone (see state_snapshot_save)
+    if(pending.firstValue != 0.0f || pending.secondValue != 0.0f) {
+        return;
+    }
+    if(is_same_state(&pending, &saved) || now_ms - pending_since_ms < SNAPSHOT_DELAY_MS) {
+        return;
+    }
+    save_pending();
+}
+
+bool state_snapshot_save(const sequence_values_t* p_values, const speed_definition_t* p_speed_definitions) {
+    fill_snapshot(&pending, p_values, p_speed_definitions);
+    pending_since_ms = to_ms_since_boot(get_absolute_time());
+    if(is_same_state(&pending, &saved)) {
+        return false;
+    }
+    save_pending();
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "speed-sensor.h"
+
+// snapshot of output state kept in last flash sector,
+// restored at boot so outputs resume within milliseconds of a reset
+// sector is written one page (slot) after the other and only erased when full
+
+// output state has to be stable for that long before being saved by state_snapshot_poll
+#define SNAPSHOT_DELAY_MS 2000
+
+// restores last saved values and speed definitions (one per sensor, conversion factors included)
+// returns false (and leaves them untouched) if no valid snapshot is found
+bool state_snapshot_restore(sequence_values_t* p_values, speed_definition_t* p_speed_definitions);
+
+// core1 and interrupts are paused during flash programming (about 1 ms, 50 ms when sector
+// is erased): outputs freeze meanwhile
+
+// saves values and speed definitions once they have not changed for SNAPSHOT_DELAY_MS,
+// at standstill only (both values null), so that running outputs are never frozen
+// to be called regularly, only when no sequence is running
+void state_snapshot_poll(const sequence_values_t* p_values, const speed_definition_t* p_speed_definitions);
+
+// saves values and speed definitions at once, whatever they are (explicit command)
+// returns false if they were already saved (nothing written)
+bool state_snapshot_save(const sequence_values_t* p_values, const speed_definition_t* p_speed_definitions);
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Frequency sweep of sensor outputs
+ */
+
+#include "sweep.h"
+
+#include <math.h>
+
+// in RAM, read by output interrupt
+uint32_t sweep_exp2_lut[SWEEP_EXP2_SIZE + 1];
+
+static void init_exp2_lut() {
+    int i;
+    if(sweep_exp2_lut[0] != 0) {
+        return;
+    }
+    for(i = 0; i <= SWEEP_EXP2_SIZE; i++) {
+        sweep_exp2_lut[i] = (uint32_t)lround(exp2((double)i / SWEEP_EXP2_SIZE) * (1 << 30));
+    }
+}
+
+// value of frequency (Hz), linear: Hz Q32, others: log2 of quarter period (µs) Q40
+static int64_t get_value(sweep_mode_e mode, double frequency) {
+    if(mode == e_sweep_linear) {
+        return llround(frequency * 4294967296.0);
+    }
+    return llround(log2(250000.0 / frequency) * (double)(1LL << SWEEP_LOG2_SHIFT));
+}
+
+// fractional bits of increments of continuous sweeps, limited so that increment
+// times longest edge (0.1 Hz, below 2^22 µs) fits 62 bits
+#define SWEEP_MAX_INCREMENT_SHIFT 31
+
+void sweep_init(sweep_t* p_sweep, sweep_mode_e mode, float start_frequency, float end_frequency,
+                float duration, uint16_t steps_per_decade) {
+    const double duration_us = duration * 1e6;
+    const bool rising = end_frequency > start_frequency;
+    // first decade crossed
+    const double decade = rising ? pow(10.0, floor(log10(start_frequency)) + 1)
+                                 : pow(10.0, ceil(log10(start_frequency)) - 1);
+    int64_t span, guard;
+    double rate;
+
+    init_exp2_lut();
+    p_sweep->mode = mode;
+    p_sweep->value = get_value(mode, start_frequency);
+    p_sweep->end_value = get_value(mode, end_frequency);
+    p_sweep->increasing = p_sweep->end_value > p_sweep->value;
+    // markers are about a millionth ahead of decades, so that a decade which is also
+    // end of sweep is crossed whatever rounding of frequencies (float) and markers
+    p_sweep->marker = get_value(mode, decade);
+    guard = mode == e_sweep_linear ? p_sweep->marker >> 20 : 1LL << (SWEEP_LOG2_SHIFT - 20);
+    p_sweep->marker += p_sweep->increasing ? -guard : guard;
+    p_sweep->marker_edge = false;
+    p_sweep->done = false;
+    p_sweep->fraction = 0;
+    p_sweep->increment_carry = 0;
+    p_sweep->start_value = p_sweep->value;
+    p_sweep->step = 0;
+    p_sweep->dwell_elapsed = 0;
+    span = p_sweep->end_value - p_sweep->value;
+    if(mode == e_sweep_stepped) {
+        p_sweep->nb_steps = (uint32_t)ceil(fabs(log10((double)end_frequency / start_frequency)) * steps_per_decade);
+        if(p_sweep->nb_steps == 0) {
+            p_sweep->nb_steps = 1;
+        }
+        p_sweep->increment = span / p_sweep->nb_steps;
+        p_sweep->increment_shift = 0;
+        // start and end frequencies are held too
+        p_sweep->dwell_us = (uint64_t)(duration_us / (p_sweep->nb_steps + 1));
+    } else {
+        p_sweep->nb_steps = 0;
+        p_sweep->dwell_us = 0;
+        // as many fractional bits as edges up to 0.1 Hz allow, so that rounding
+        // does not build up over sweep
+        rate = fabs((double)span / duration_us);
+        p_sweep->increment_shift = rate < 1.0 ? SWEEP_MAX_INCREMENT_SHIFT : (uint8_t)fmin(SWEEP_MAX_INCREMENT_SHIFT, 40 - ceil(log2(rate)));
+        p_sweep->increment = llround((double)span * (1LL << p_sweep->increment_shift) / duration_us);
+    }
+}
+
+float sweep_get_frequency(sweep_mode_e mode, int64_t value) {
+    if(mode == e_sweep_linear) {
+        return value / 4294967296.0;
+    }
+    return 250000.0 / exp2((double)value / (1LL << SWEEP_LOG2_SHIFT));
+}
+
+uint32_t sweep_get_first_period(sweep_t* p_sweep) {
+    uint32_t period = sweep_get_period_q8(p_sweep);
+    p_sweep->fraction = period & 0xFF;
+    period >>= 8;
+    return period == 0 ? 1 : period;
+}
@@ -0,0 +1,145 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// frequency sweep (chirp) of sensor outputs, computed edge by edge in output interrupt
+// to characterize input filters of devices under test
+// shared by firmware (output-backend.h) and host check (host/sweep-check.c)
+// so it must not depend on any pico header
+//
+// sweep laws:
+//  - linear: frequency linear in time, raised on each edge by rate times edge duration
+//  - logarithmic: frequency exponential in time (same time for each decade),
+//    log2 of period lowered on each edge by a precomputed increment times edge duration,
+//    period being 2^log2 (table of 2^(i/256) interpolated)
+//  - stepped: log spaced frequencies, each held for a dwell time
+// quarter periods are whole µs: fraction of each one is carried over to next one,
+// so that sweep law is followed on average, even at high frequencies
+// a marker is raised for one edge on each decade crossed (1 Hz, 10 Hz...)
+
+typedef enum {
+    e_sweep_linear,
+    e_sweep_log,
+    e_sweep_stepped,
+    e_nb_sweep_modes
+} sweep_mode_e;
+
+#define SWEEP_MIN_DURATION 1.0f
+#define SWEEP_MAX_DURATION 36000.0f
+#define SWEEP_DEFAULT_STEPS_PER_DECADE 10
+#define SWEEP_MAX_STEPS_PER_DECADE 100
+
+#define SWEEP_EXP2_SIZE 256
+// 2^(i / SWEEP_EXP2_SIZE) in Q30, one more entry for interpolation
+extern uint32_t sweep_exp2_lut[SWEEP_EXP2_SIZE + 1];
+
+// log2 of quarter period (µs) is in Q40
+#define SWEEP_LOG2_SHIFT 40
+// log2(10) in Q40, decade step of markers
+#define SWEEP_LOG2_10 3652498566964LL
+
+typedef struct {
+    sweep_mode_e mode;
+    // linear: frequency in Hz Q32, others: log2 of quarter period (µs) Q40
+    int64_t value;
+    int64_t end_value;
+    bool increasing; // value goes up
+    // linear and logarithmic: per µs, increment_shift more fractional bits than value
+    // (carried over), stepped: per step
+    int64_t increment;
+    uint8_t increment_shift;
+    uint32_t increment_carry;
+    // stepped: steps from start frequency, last one is end frequency
+    int64_t start_value;
+    uint32_t step;
+    uint32_t nb_steps;
+    uint64_t dwell_us;
+    uint64_t dwell_elapsed;
+    uint32_t fraction; // of quarter period carried over, µs Q8
+    int64_t marker; // next decade, same unit as value
+    bool marker_edge; // decade crossed on last edge
+    bool done; // end frequency reached (and held)
+} sweep_t;
+
+// prepares a sweep from start to end frequency (Hz, either way) lasting duration (s)
+// steps_per_decade only applies to stepped sweeps
+void sweep_init(sweep_t* p_sweep, sweep_mode_e mode, float start_frequency, float end_frequency,
+                float duration, uint16_t steps_per_decade);
+// frequency (Hz) of a sweep value
+float sweep_get_frequency(sweep_mode_e mode, int64_t value);
+// quarter period (µs) of first edge
+uint32_t sweep_get_first_period(sweep_t* p_sweep);
+
+// quarter period in µs Q8 from 2^log2_period (Q40)
+// fraction of log2 is kept to 24 bits: table index and interpolation weight (16 bits)
+static inline uint32_t sweep_exp2(int64_t log2_period) {
+    const uint32_t integer = (uint32_t)(log2_period >> SWEEP_LOG2_SHIFT);
+    const uint32_t fraction = (uint32_t)(log2_period >> (SWEEP_LOG2_SHIFT - 24)) & 0xFFFFFF;
+    const uint32_t index = fraction >> 16;
+    const uint32_t weight = fraction & 0xFFFF;
+    const uint32_t base = sweep_exp2_lut[index];
+    // table steps are below 2^23: product fits 32 bits
+    const uint32_t mantissa = base + ((((sweep_exp2_lut[index + 1] - base) >> 7) * weight) >> 9);
+    // Q30 to Q8
+    return integer >= 22 ? mantissa << (integer - 22) : mantissa >> (22 - integer);
+}
+
+// quarter period of current value, in µs Q8
+static inline uint32_t sweep_get_period_q8(const sweep_t* p_sweep) {
+    if(p_sweep->mode == e_sweep_linear) {
+        // 250000 / f, f in Q32
+        return (uint32_t)((250000ULL << (32 + 8)) / (uint64_t)p_sweep->value);
+    }
+    return sweep_exp2(p_sweep->value);
+}
+
+// advances sweep by one edge, which lasted elapsed_us (quarter period it was given)
+// out: quarter period of next edge (µs)
+static inline uint32_t sweep_next_edge(sweep_t* p_sweep, uint32_t elapsed_us) {
+    uint32_t period;
+    p_sweep->marker_edge = false;
+    if(!p_sweep->done) {
+        if(p_sweep->mode != e_sweep_stepped) {
+            const int64_t increment = p_sweep->increment * elapsed_us + p_sweep->increment_carry;
+            p_sweep->value += increment >> p_sweep->increment_shift;
+            p_sweep->increment_carry = increment & ((1u << p_sweep->increment_shift) - 1);
+            if(p_sweep->increasing ? p_sweep->value >= p_sweep->end_value : p_sweep->value <= p_sweep->end_value) {
+                p_sweep->value = p_sweep->end_value;
+                p_sweep->done = true;
+            }
+        } else {
+            p_sweep->dwell_elapsed += elapsed_us;
+            if(p_sweep->dwell_elapsed >= p_sweep->dwell_us) {
+                // an edge may last several steps (nb_steps + 1 dwells in all)
+                do {
+                    p_sweep->dwell_elapsed -= p_sweep->dwell_us;
+                    p_sweep->step++;
+                } while(p_sweep->dwell_elapsed >= p_sweep->dwell_us);
+                if(p_sweep->step >= p_sweep->nb_steps) {
+                    p_sweep->value = p_sweep->end_value;
+                    // end frequency is held for a dwell time too
+                    p_sweep->done = p_sweep->step > p_sweep->nb_steps;
+                } else {
+                    p_sweep->value = p_sweep->start_value + p_sweep->increment * p_sweep->step;
+                }
+            }
+        }
+    }
+    // one decade per edge: an edge may cross several ones (even after end)
+    if(p_sweep->increasing ? p_sweep->value >= p_sweep->marker : p_sweep->value <= p_sweep->marker) {
+        p_sweep->marker_edge = true;
+        if(p_sweep->mode == e_sweep_linear) {
+            p_sweep->marker = p_sweep->increasing ? p_sweep->marker * 10 : p_sweep->marker / 10;
+        } else {
+            p_sweep->marker += p_sweep->increasing ? SWEEP_LOG2_10 : -SWEEP_LOG2_10;
+        }
+    }
+    period = sweep_get_period_q8(p_sweep) + p_sweep->fraction;
+    p_sweep->fraction = period & 0xFF;
+    period >>= 8;
+    return period == 0 ? 1 : period;
+}
+
+#endif
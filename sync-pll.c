@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Software PLL of sequence scheduler ticks
+ */
+
+#include <string.h>
+
+#include "sync-pll.h"
+
+#define NOMINAL_PERIOD ((int64_t)SYNC_PLL_NOMINAL_PERIOD_US << 16)
+#define MAX_TRIM (NOMINAL_PERIOD / 1000000 * SYNC_PLL_MAX_PPM)
+
+void sync_pll_init(sync_pll_t* p_pll, uint64_t first_tick_time) {
+    memset(p_pll, 0, sizeof(sync_pll_t));
+    p_pll->period = NOMINAL_PERIOD;
+    sync_pll_restart(p_pll, first_tick_time);
+}
+
+void sync_pll_restart(sync_pll_t* p_pll, uint64_t first_tick_time) {
+    p_pll->next_time = (int64_t)first_tick_time << 16;
+    p_pll->last_time = p_pll->next_time - p_pll->period;
+    p_pll->pending_phase = 0;
+}
+
+void sync_pll_unlock(sync_pll_t* p_pll) {
+    p_pll->period = NOMINAL_PERIOD;
+    p_pll->acquired = false;
+    p_pll->lock_count = 0;
+}
+
+uint32_t sync_pll_tick(sync_pll_t* p_pll) {
+    p_pll->last_time = p_pll->next_time;
+    p_pll->next_time += p_pll->period + p_pll->pending_phase;
+    p_pll->pending_phase = 0;
+    p_pll->next_tick++;
+    // alarms are set in whole µs
+    return (uint32_t)((p_pll->next_time >> 16) - (p_pll->last_time >> 16));
+}
+
+uint32_t sync_pll_get_tick(const sync_pll_t* p_pll) {
+    return p_pll->next_tick - 1;
+}
+
+// time of local tick (µs Q16) from its number, past or future
+static int64_t get_tick_time(const sync_pll_t* p_pll, uint32_t tick) {
+    const int32_t from_next = (int32_t)(tick - p_pll->next_tick);
+    if(from_next < 0) {
+        return p_pll->last_time + (int64_t)(from_next + 1) * p_pll->period;
+    }
+    return p_pll->next_time + (int64_t)from_next * p_pll->period + (from_next > 0 ? p_pll->pending_phase : 0);
+}
+
+static void acquire(sync_pll_t* p_pll, int64_t pulse, uint32_t pulse_tick) {
+    const int64_t since_next = pulse - p_pll->next_time;
+    // local tick closest to pulse gets its number
+    const int32_t offset = (int32_t)((since_next + (since_next < 0 ? -p_pll->period : p_pll->period) / 2) / p_pll->period);
+    p_pll->next_tick = pulse_tick - offset;
+    p_pll->pending_phase = pulse - get_tick_time(p_pll, pulse_tick);
+    p_pll->acquired = true;
+    p_pll->lock_count = 0;
+    p_pll->last_error = p_pll->pending_phase >> 16;
+    p_pll->max_error = 0;
+    p_pll->sum_square_errors = 0;
+    p_pll->nb_errors = 0;
+    p_pll->nb_acquisitions++;
+}
+
+void sync_pll_feed(sync_pll_t* p_pll, uint64_t pulse_time, uint32_t pulse_tick) {
+    const int64_t pulse = (int64_t)pulse_time << 16;
+    int64_t error;
+    int32_t nb_ticks, error_us;
+    if(!p_pll->acquired) {
+        acquire(p_pll, pulse, pulse_tick);
+        p_pll->last_pulse_tick = pulse_tick;
+        return;
+    }
+    // compared with whole µs tick actually fired
+    error = pulse - (get_tick_time(p_pll, pulse_tick) & ~0xFFFFLL);
+    error_us = (int32_t)(error >> 16);
+    if(error_us > SYNC_PLL_ACQUIRE_US || error_us < -SYNC_PLL_ACQUIRE_US) {
+        acquire(p_pll, pulse, pulse_tick);
+        p_pll->last_pulse_tick = pulse_tick;
+        return;
+    }
+    nb_ticks = (int32_t)(pulse_tick - p_pll->last_pulse_tick);
+    p_pll->last_pulse_tick = pulse_tick;
+    if(nb_ticks <= 0) { // same pulse again
+        return;
+    }
+    p_pll->pending_phase += (error * SYNC_PLL_PHASE_GAIN_Q16) >> 16;
+    p_pll->period += ((error * SYNC_PLL_FREQUENCY_GAIN_Q16) >> 16) / nb_ticks;
+    if(p_pll->period > NOMINAL_PERIOD + MAX_TRIM) {
+        p_pll->period = NOMINAL_PERIOD + MAX_TRIM;
+    } else if(p_pll->period < NOMINAL_PERIOD - MAX_TRIM) {
+        p_pll->period = NOMINAL_PERIOD - MAX_TRIM;
+    }
+    p_pll->last_error = error_us;
+    if(error_us < SYNC_PLL_LOCK_US && error_us > -SYNC_PLL_LOCK_US) {
+        if(p_pll->lock_count < SYNC_PLL_LOCK_COUNT) {
+            p_pll->lock_count++;
+        }
+    } else {
+        p_pll->lock_count = 0;
+    }
+    if(sync_pll_is_locked(p_pll)) {
+        if(error_us > p_pll->max_error || -error_us > p_pll->max_error) {
+            p_pll->max_error = error_us < 0 ? -error_us : error_us;
+        }
+        p_pll->sum_square_errors += (int64_t)error_us * error_us;
+        p_pll->nb_errors++;
+    }
+}
+
+bool sync_pll_is_locked(const sync_pll_t* p_pll) {
+    return p_pll->acquired && p_pll->lock_count >= SYNC_PLL_LOCK_COUNT;
+}
+
+int32_t sync_pll_get_ppm(const sync_pll_t* p_pll) {
+    // leader ticks longer on local clock: leader clock is slower
+    return (int32_t)(-(p_pll->period - NOMINAL_PERIOD) * 1000000 / NOMINAL_PERIOD);
+}
+
+uint32_t sync_pll_get_rms_error(const sync_pll_t* p_pll) {
+    uint64_t mean_square, root = 0, bit = 1ULL << 62;
+    if(p_pll->nb_errors == 0) {
+        return 0;
+    }
+    mean_square = p_pll->sum_square_errors / p_pll->nb_errors;
+    // integer square root
+    while(bit > mean_square) {
+        bit >>= 2;
+    }
+    while(bit != 0) {
+        if(mean_square >= root + bit) {
+            mean_square -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
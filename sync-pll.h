@@ -0,0 +1,68 @@
+#ifndef SYNC_PLL_H
+#define SYNC_PLL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// software PLL disciplining sequence scheduler ticks of a follower board
+// to sync pulses of a leader board (see sync.h)
+// shared by firmware and host simulator (host/sync-sim.c)
+// so it must not depend on any pico header
+//
+// ticks are scheduled by a numerically controlled oscillator: time of next tick
+// in µs Q16.16 (local clock), advanced by a period which is trimmed to leader clock
+// each sync pulse is time stamped and compared with time of local tick of same number:
+// phase error is corrected over next tick, and integrated into period (type 2 loop,
+// no steady phase error whatever the difference between crystals)
+
+#define SYNC_PLL_NOMINAL_PERIOD_US 100000
+#define SYNC_PLL_Q16_ONE 65536
+// loop gains, per sync pulse: share of phase error corrected, share integrated into period
+#define SYNC_PLL_PHASE_GAIN_Q16 (SYNC_PLL_Q16_ONE / 2)
+#define SYNC_PLL_FREQUENCY_GAIN_Q16 (SYNC_PLL_Q16_ONE / 8)
+// period trim range, crystals are much closer than that
+#define SYNC_PLL_MAX_PPM 1000
+// phase error beyond which loop acquires again: jumps to leader phase and tick number
+#define SYNC_PLL_ACQUIRE_US 5000
+// lock: phase error below SYNC_PLL_LOCK_US for SYNC_PLL_LOCK_COUNT pulses in a row
+#define SYNC_PLL_LOCK_US 100
+#define SYNC_PLL_LOCK_COUNT 4
+
+typedef struct {
+    int64_t period; // µs Q16
+    int64_t last_time; // of last tick, µs Q16 on local clock
+    int64_t next_time; // of next tick
+    uint32_t next_tick; // number of next tick (leader numbering once acquired)
+    int64_t pending_phase; // µs Q16, correction applied to next tick
+    bool acquired;
+    uint8_t lock_count;
+    uint32_t last_pulse_tick;
+    // phase errors since acquisition (µs): last, worst since lock and rms since lock
+    int32_t last_error;
+    int32_t max_error;
+    uint64_t sum_square_errors;
+    uint32_t nb_errors;
+    uint32_t nb_acquisitions;
+} sync_pll_t;
+
+// free running at nominal period, first tick at first_tick_time (µs)
+void sync_pll_init(sync_pll_t* p_pll, uint64_t first_tick_time);
+// scheduler restarted: next tick at first_tick_time (µs), tick numbering goes on
+void sync_pll_restart(sync_pll_t* p_pll, uint64_t first_tick_time);
+// back to nominal period, next pulse acquires again (scheduling goes on)
+void sync_pll_unlock(sync_pll_t* p_pll);
+// to be called on each tick: advances to next one
+// out: delay from this tick to next one (µs)
+uint32_t sync_pll_tick(sync_pll_t* p_pll);
+// number of last tick
+uint32_t sync_pll_get_tick(const sync_pll_t* p_pll);
+// leader tick pulse_tick was seen at pulse_time (µs, local clock)
+// must not be interrupted by sync_pll_tick
+void sync_pll_feed(sync_pll_t* p_pll, uint64_t pulse_time, uint32_t pulse_tick);
+bool sync_pll_is_locked(const sync_pll_t* p_pll);
+// leader clock relative to local one, in ppm
+int32_t sync_pll_get_ppm(const sync_pll_t* p_pll);
+// rms of phase errors since lock (µs)
+uint32_t sync_pll_get_rms_error(const sync_pll_t* p_pll);
+
+#endif
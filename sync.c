@@ -0,0 +1,214 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Leader/follower synchronization of sequence schedulers
+ */
+
+#include "sync.h"
+
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/uart.h"
+#include "pico/stdlib.h"
+
+#include "output-config.h"
+
+#define SYNC_UART uart1
+// start byte, tick, step, step tick, checksum
+#define FRAME_SIZE (1 + 4 + 2 + 4 + 1)
+
+static sync_pll_t pll;
+static sync_role_e role = e_sync_off;
+
+// leader
+static volatile bool announce_pending = false;
+static uint16_t step = 0;
+static uint32_t step_tick = 0;
+
+// follower
+static volatile bool pulse_pending = false;
+static volatile uint64_t pulse_time;
+static uint8_t frame[FRAME_SIZE];
+static uint8_t frame_index = 0;
+static bool leader_step_valid = false;
+static uint16_t leader_step;
+static uint32_t leader_step_tick;
+static uint32_t link_errors = 0;
+
+static void put_uint32(uint8_t* p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static uint32_t get_uint32(const uint8_t* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint8_t get_checksum(const uint8_t* p) {
+    uint8_t checksum = 0, i;
+    for(i = 1; i < FRAME_SIZE - 1; i++) {
+        checksum ^= p[i];
+    }
+    return checksum;
+}
+
+// time stamps leader pulse (raw handler: GPIO callback belongs to trigger)
+static void __not_in_flash_func(on_sync_pulse)() {
+    if(gpio_get_irq_event_mask(SYNC_GPIO) & GPIO_IRQ_EDGE_RISE) {
+        gpio_acknowledge_irq(SYNC_GPIO, GPIO_IRQ_EDGE_RISE);
+        pulse_time = time_us_64();
+        pulse_pending = true;
+    }
+}
+
+void sync_init(uint64_t first_tick_time) {
+    sync_pll_init(&pll, first_tick_time);
+}
+
+void sync_restart(uint64_t first_tick_time) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    sync_pll_restart(&pll, first_tick_time);
+    restore_interrupts(interrupts);
+}
+
+static void release_pins() {
+    if(role == e_sync_follower) {
+        gpio_set_irq_enabled(SYNC_GPIO, GPIO_IRQ_EDGE_RISE, false);
+        gpio_remove_raw_irq_handler(SYNC_GPIO, on_sync_pulse);
+    }
+    if(role != e_sync_off) {
+        uart_deinit(SYNC_UART);
+    }
+    gpio_init(SYNC_GPIO);
+    gpio_init(SYNC_TX_GPIO);
+    gpio_init(SYNC_RX_GPIO);
+}
+
+void sync_set_role(sync_role_e new_role) {
+    uint32_t interrupts;
+    if(new_role == role) {
+        return;
+    }
+    release_pins();
+    interrupts = save_and_disable_interrupts();
+    role = e_sync_off;
+    sync_pll_unlock(&pll);
+    restore_interrupts(interrupts);
+    pulse_pending = false;
+    leader_step_valid = false;
+    step = 0;
+    frame_index = 0;
+    link_errors = 0;
+    if(new_role == e_sync_off) {
+        return;
+    }
+    uart_init(SYNC_UART, SYNC_BAUD_RATE);
+    if(new_role == e_sync_leader) {
+        gpio_set_dir(SYNC_GPIO, GPIO_OUT);
+        gpio_put(SYNC_GPIO, 0);
+        gpio_set_function(SYNC_TX_GPIO, GPIO_FUNC_UART);
+    } else {
+        gpio_set_dir(SYNC_GPIO, GPIO_IN);
+        gpio_pull_down(SYNC_GPIO);
+        gpio_set_function(SYNC_RX_GPIO, GPIO_FUNC_UART);
+        gpio_add_raw_irq_handler(SYNC_GPIO, on_sync_pulse);
+        gpio_set_irq_enabled(SYNC_GPIO, GPIO_IRQ_EDGE_RISE, true);
+    }
+    role = new_role;
+}
+
+sync_role_e sync_get_role() {
+    return role;
+}
+
+// frame fits in UART FIFO: does not wait
+static void send_frame(uint32_t tick) {
+    uint8_t buffer[FRAME_SIZE];
+    buffer[0] = SYNC_FRAME_START;
+    put_uint32(buffer + 1, tick);
+    buffer[5] = step;
+    buffer[6] = step >> 8;
+    put_uint32(buffer + 7, step_tick);
+    buffer[FRAME_SIZE - 1] = get_checksum(buffer);
+    uart_write_blocking(SYNC_UART, buffer, FRAME_SIZE);
+}
+
+uint32_t __not_in_flash_func(sync_tick)() {
+    const uint32_t tick = pll.next_tick;
+    uint32_t delay;
+    bool pulse = false;
+    if(role == e_sync_leader) {
+        // pulse first: its latency is the same on every tick
+        pulse = tick % SYNC_PERIOD_TICKS == 0 || announce_pending;
+        gpio_put(SYNC_GPIO, pulse); // lasts one tick
+    }
+    delay = sync_pll_tick(&pll);
+    if(pulse) {
+        announce_pending = false;
+        send_frame(tick);
+    }
+    return delay;
+}
+
+uint32_t sync_get_tick() {
+    return sync_pll_get_tick(&pll);
+}
+
+void sync_set_step(uint16_t new_step, uint32_t new_step_tick) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    step = new_step;
+    step_tick = new_step_tick;
+    restore_interrupts(interrupts);
+}
+
+void sync_announce_start(uint32_t start_tick) {
+    sync_set_step(1, start_tick);
+    announce_pending = true;
+}
+
+void sync_poll() {
+    uint32_t interrupts;
+    uint8_t c;
+    if(role != e_sync_follower) {
+        return;
+    }
+    while(uart_is_readable(SYNC_UART)) {
+        c = uart_getc(SYNC_UART);
+        if(frame_index == 0 && c != SYNC_FRAME_START) {
+            continue;
+        }
+        frame[frame_index++] = c;
+        if(frame_index < FRAME_SIZE) {
+            continue;
+        }
+        frame_index = 0;
+        if(get_checksum(frame) != frame[FRAME_SIZE - 1] || !pulse_pending) {
+            pulse_pending = false;
+            link_errors++;
+            continue;
+        }
+        pulse_pending = false;
+        interrupts = save_and_disable_interrupts();
+        sync_pll_feed(&pll, pulse_time, get_uint32(frame + 1));
+        restore_interrupts(interrupts);
+        leader_step = frame[5] | frame[6] << 8;
+        leader_step_tick = get_uint32(frame + 7);
+        leader_step_valid = true;
+    }
+}
+
+bool sync_get_leader_step(uint16_t* p_step, uint32_t* p_step_tick) {
+    *p_step = leader_step;
+    *p_step_tick = leader_step_tick;
+    return leader_step_valid;
+}
+
+const sync_pll_t* sync_get_pll() {
+    return &pll;
+}
+
+uint32_t sync_get_link_errors() {
+    return link_errors;
+}
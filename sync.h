@@ -0,0 +1,52 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sync-pll.h"
+
+// leader/follower synchronization of sequence schedulers of several boards
+// (a rig with more axles than one board can drive)
+//
+// leader outputs a pulse on SYNC_GPIO on a scheduler tick every SYNC_PERIOD_TICKS
+// (and when it announces a sequence start), followed by a sync frame on SYNC_TX_GPIO
+// (uart1): number of that tick, running step and tick it started on
+// followers time stamp pulses (GPIO interrupt) and, once their frame is received,
+// feed them to the software PLL scheduling their ticks (sync-pll.h)
+// both lines are wired from leader to every follower (SYNC_RX_GPIO on followers)
+
+typedef enum {
+    e_sync_off,
+    e_sync_leader,
+    e_sync_follower
+} sync_role_e;
+
+#define SYNC_PERIOD_TICKS 10
+#define SYNC_BAUD_RATE 115200
+#define SYNC_FRAME_START 0xA5
+
+// free running scheduler, first tick at first_tick_time (µs, see time_us_64)
+void sync_init(uint64_t first_tick_time);
+// scheduler restarted (e.g. on external trigger), tick numbering goes on
+void sync_restart(uint64_t first_tick_time);
+void sync_set_role(sync_role_e role);
+sync_role_e sync_get_role();
+// to be called by scheduler tick interrupt, leader outputs pulse and frame if due
+// out: delay to next tick (µs)
+uint32_t sync_tick();
+// number of last scheduler tick (same as leader one on locked followers)
+uint32_t sync_get_tick();
+// leader: step running (1 based, 0 when idle) since step_tick, sent with next frame
+void sync_set_step(uint16_t step, uint32_t step_tick);
+// leader: same for a sequence starting on a future tick, sent on next tick
+void sync_announce_start(uint32_t start_tick);
+// follower: receives frames and feeds PLL, to be run as a background task
+void sync_poll();
+// follower: last step sent by leader, false if none received yet
+bool sync_get_leader_step(uint16_t* p_step, uint32_t* p_step_tick);
+// follower: PLL state and link errors (pulses without frame and bad frames)
+const sync_pll_t* sync_get_pll();
+uint32_t sync_get_link_errors();
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Binary telemetry of live generator state
+ * Frames are sampled by a repeating timer into a ring buffer
+ * and sent by core0 main loop when it's idle
+ */
+
+#include "telemetry.h"
+
+#include "hardware/clocks.h"
+#include "pico/stdlib.h"
+
+#include "core0-output.h"
+#include "journal.h"
+#include "out-gpios.h"
+#include "output-backend.h"
+
+static telemetry_frame_t ring[TELEMETRY_RING_SIZE];
+// ring_head only written by sampling interrupt, ring_tail only by telemetry_flush
+static volatile uint8_t ring_head = 0;
+static volatile uint8_t ring_tail = 0;
+
+static repeating_timer_t telemetry_timer;
+static uint16_t telemetry_rate = 0;
+static volatile uint32_t dropped_frames = 0;
+static uint8_t frame_sequence;
+static uint32_t cycles_per_us;
+static uint32_t last_timestamp;
+static uint32_t last_busy_cycles;
+static uint32_t last_core0_busy_cycles;
+
+// part of elapsed cycles spent busy, in 1/10000
+static uint16_t get_load(uint32_t busy_cycles, uint32_t elapsed_cycles) {
+    return elapsed_cycles == 0 ? 0 : (uint16_t)((uint64_t)busy_cycles * 10000u / elapsed_cycles);
+}
+
+static bool telemetry_callback(repeating_timer_t *rt) {
+    const uint32_t timestamp = time_us_32();
+    const uint32_t busy_cycles = isr_busy_cycles;
+    const uint32_t core0_busy_cycles = core0_isr_busy_cycles;
+    const uint32_t elapsed_cycles = (timestamp - last_timestamp) * cycles_per_us;
+    const uint8_t next_head = (ring_head + 1) & (TELEMETRY_RING_SIZE - 1);
+    telemetry_frame_t* p_frame;
+    uint8_t* p_byte;
+    uint8_t sum = 0;
+
+    if(next_head == ring_tail) { // full: drop this frame, sequence gap tells the decoder
+        dropped_frames++;
+        frame_sequence++;
+        journal_log(e_journal_underrun, e_underrun_telemetry, dropped_frames);
+        return true;
+    }
+    p_frame = ring + ring_head;
+    p_frame->sync1 = TELEMETRY_SYNC1;
+    p_frame->sync2 = TELEMETRY_SYNC2;
+    p_frame->version = TELEMETRY_VERSION;
+    p_frame->sequence = frame_sequence++;
+    p_frame->timestamp_us = timestamp;
+    p_frame->period1 = max_cycle_count1;
+    p_frame->period2 = max_cycle_count2;
+    p_frame->edges1 = get_edge_count(1);
+    p_frame->edges2 = get_edge_count(2);
+    p_frame->isr_load = get_load(busy_cycles - last_busy_cycles, elapsed_cycles);
+    p_frame->core0_isr_load = get_load(core0_busy_cycles - last_core0_busy_cycles, elapsed_cycles);
+    p_frame->flags = (reverse1 ? TELEMETRY_FLAG_REVERSE1 : 0) | (reverse2 ? TELEMETRY_FLAG_REVERSE2 : 0);
+    for(p_byte = (uint8_t*)p_frame; p_byte < &p_frame->checksum; p_byte++) {
+        sum += *p_byte;
+    }
+    p_frame->checksum = -sum;
+    last_timestamp = timestamp;
+    last_busy_cycles = busy_cycles;
+    last_core0_busy_cycles = core0_busy_cycles;
+    ring_head = next_head;
+    return true; // keep repeating
+}
+
+bool telemetry_set_rate(uint16_t rate) {
+    if(rate > TELEMETRY_MAX_RATE) {
+        return false;
+    }
+    if(telemetry_rate != 0) {
+        cancel_repeating_timer(&telemetry_timer);
+    }
+    telemetry_rate = rate;
+    if(rate == 0) {
+        return true;
+    }
+    cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+    last_timestamp = time_us_32();
+    last_busy_cycles = isr_busy_cycles;
+    last_core0_busy_cycles = core0_isr_busy_cycles;
+    dropped_frames = 0;
+    add_repeating_timer_us(-1000000L / rate, telemetry_callback, NULL, &telemetry_timer);
+    return true;
+}
+
+uint16_t telemetry_get_rate() {
+    return telemetry_rate;
+}
+
+uint32_t telemetry_get_dropped_frames() {
+    return dropped_frames;
+}
+
+void telemetry_flush() {
+    const uint8_t* p_byte;
+    uint8_t i;
+    while(ring_tail != ring_head) {
+        p_byte = (const uint8_t*)(ring + ring_tail);
+        // raw output: no LF to CR/LF translation
+        for(i = 0; i < sizeof(telemetry_frame_t); i++) {
+            putchar_raw(p_byte[i]);
+        }
+        ring_tail = (ring_tail + 1) & (TELEMETRY_RING_SIZE - 1);
+    }
+}
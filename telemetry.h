@@ -0,0 +1,52 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// shared by firmware and host decoder (host/telemetry-decode.c)
+// so it must not depend on any pico header
+
+#define TELEMETRY_MAX_RATE 1000
+// number of frames buffered between sampling interrupt and USB output (power of 2)
+#define TELEMETRY_RING_SIZE 32
+
+#define TELEMETRY_SYNC1 0xA5
+#define TELEMETRY_SYNC2 0x5A
+#define TELEMETRY_VERSION 3
+
+// bits of telemetry_frame_t.flags
+#define TELEMETRY_FLAG_REVERSE1 1
+#define TELEMETRY_FLAG_REVERSE2 2
+
+// one frame as emitted on the USB serial link (little endian)
+// text output of the console may be found between frames:
+// decoders should look for sync bytes and check checksum
+typedef struct __attribute__((packed)) {
+    uint8_t sync1;
+    uint8_t sync2;
+    uint8_t version;
+    uint8_t sequence; // rolling frame counter: a gap means dropped frames
+    uint32_t timestamp_us;
+    uint32_t period1; // 1/4 of sensor 1 period in µs, 0 when stopped
+    uint32_t period2; // same for sensor 2
+    int64_t edges1; // edges output by sensor 1, counting down in reverse
+    int64_t edges2; // same for sensor 2
+    uint16_t isr_load; // part of core1 time spent in output interrupts, in 1/10000
+    uint16_t core0_isr_load; // same for core0 (only sensor 2 output with SPLIT_CORES)
+    uint8_t flags; // see TELEMETRY_FLAG_xxx
+    uint8_t checksum; // such as sum of all bytes of frame is zero (modulo 256)
+} telemetry_frame_t;
+
+// starts (rate in Hz), changes or stops (rate = 0) telemetry
+// returns false if rate is out of range
+bool telemetry_set_rate(uint16_t rate);
+// actual telemetry rate in Hz (0 if stopped)
+uint16_t telemetry_get_rate();
+// number of frames dropped because output could not keep up
+uint32_t telemetry_get_dropped_frames();
+// sends buffered frames through stdio, never blocks frame sampling
+// to be called regularly from core0 main loop
+void telemetry_flush();
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Independent per-channel sequence timelines merged by an event queue
+ */
+
+#include "timeline.h"
+
+#include <string.h>
+
+// heap order: deadline, then channel so that simultaneous events are processed
+// in the same order whatever the history of the heap
+static bool is_before(const timeline_event_t* p_a, const timeline_event_t* p_b) {
+    return p_a->deadline != p_b->deadline ? (int32_t)(p_a->deadline - p_b->deadline) < 0
+                                          : p_a->channel < p_b->channel;
+}
+
+static void swap_events(timeline_event_t* p_a, timeline_event_t* p_b) {
+    const timeline_event_t event = *p_a;
+    *p_a = *p_b;
+    *p_b = event;
+}
+
+static void sift_down(timelines_t* p_timelines, uint8_t i) {
+    timeline_event_t* const events = p_timelines->events;
+    uint8_t child;
+    while((child = 2 * i + 1) < p_timelines->nb_events) {
+        if(child + 1 < p_timelines->nb_events && is_before(&events[child + 1], &events[child])) {
+            child++;
+        }
+        if(!is_before(&events[child], &events[i])) {
+            return;
+        }
+        swap_events(&events[i], &events[child]);
+        i = child;
+    }
+}
+
+void timeline_queue_push(timelines_t* p_timelines, uint32_t deadline, uint8_t channel) {
+    timeline_event_t* const events = p_timelines->events;
+    uint8_t i = p_timelines->nb_events++;
+    events[i].deadline = deadline;
+    events[i].channel = channel;
+    while(i > 0 && is_before(&events[i], &events[(i - 1) / 2])) {
+        swap_events(&events[i], &events[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+}
+
+bool timeline_queue_pop(timelines_t* p_timelines, timeline_event_t* p_event) {
+    if(p_timelines->nb_events == 0) {
+        return false;
+    }
+    *p_event = p_timelines->events[0];
+    p_timelines->events[0] = p_timelines->events[--p_timelines->nb_events];
+    sift_down(p_timelines, 0);
+    return true;
+}
+
+void timeline_init(timelines_t* p_timelines, timeline_channel_t* channels, timeline_event_t* events,
+                   uint8_t nb_channels) {
+    p_timelines->channels = channels;
+    p_timelines->nb_channels = nb_channels;
+    p_timelines->events = events;
+    p_timelines->nb_events = 0;
+    p_timelines->nb_processed = 0;
+    memset(channels, 0, nb_channels * sizeof(timeline_channel_t));
+}
+
+void timeline_clear(timelines_t* p_timelines, uint8_t channel) {
+    p_timelines->channels[channel].count = 0;
+}
+
+bool timeline_append(timelines_t* p_timelines, uint8_t channel, float value, bool reverse, uint32_t ticks) {
+    timeline_channel_t* const p_channel = &p_timelines->channels[channel];
+    timeline_step_t* p_step;
+    if(p_channel->count == TIMELINE_MAX_STEPS) {
+        return false;
+    }
+    p_step = &p_channel->steps[p_channel->count++];
+    p_step->value = value;
+    p_step->reverse = reverse;
+    p_step->ticks = ticks;
+    return true;
+}
+
+uint32_t timeline_get_duration(const timelines_t* p_timelines, uint8_t channel) {
+    const timeline_channel_t* const p_channel = &p_timelines->channels[channel];
+    uint32_t duration = 0;
+    uint16_t i;
+    for(i = 0; i < p_channel->count; i++) {
+        duration += p_channel->steps[i].ticks;
+    }
+    return duration;
+}
+
+void timeline_start(timelines_t* p_timelines, uint32_t tick, const float* values, const bool* reverses, bool loop) {
+    timeline_channel_t* p_channel;
+    uint8_t i;
+    p_timelines->nb_events = 0;
+    p_timelines->nb_processed = 0;
+    for(i = 0; i < p_timelines->nb_channels; i++) {
+        p_channel = &p_timelines->channels[i];
+        // a looping timeline lasting no tick would never let the scheduler go
+        p_channel->loop = loop && timeline_get_duration(p_timelines, i) != 0;
+        p_channel->index = 0;
+        p_channel->loops = 0;
+        p_channel->start_value = p_channel->end_value = values[i];
+        p_channel->reverse = reverses[i];
+        p_channel->start_tick = p_channel->end_tick = tick;
+        if(p_channel->count != 0) {
+            timeline_queue_push(p_timelines, tick, i);
+        }
+    }
+}
+
+// step in progress of a channel is over on deadline: starts next one, if any
+static void next_step(timelines_t* p_timelines, uint8_t channel, uint32_t deadline) {
+    timeline_channel_t* const p_channel = &p_timelines->channels[channel];
+    const timeline_step_t* p_step;
+    if(p_channel->index == p_channel->count) {
+        p_channel->loops++;
+        if(!p_channel->loop) {
+            return; // over, value of last step is held
+        }
+        p_channel->index = 0;
+    }
+    p_step = &p_channel->steps[p_channel->index++];
+    p_channel->start_value = p_channel->end_value;
+    p_channel->end_value = p_step->value;
+    p_channel->reverse = p_step->reverse;
+    p_channel->start_tick = deadline;
+    p_channel->end_tick = deadline + p_step->ticks;
+    timeline_queue_push(p_timelines, p_channel->end_tick, channel);
+}
+
+bool timeline_poll(timelines_t* p_timelines, uint32_t tick) {
+    timeline_event_t event;
+    while(p_timelines->nb_events != 0 && (int32_t)(p_timelines->events[0].deadline - tick) <= 0) {
+        timeline_queue_pop(p_timelines, &event);
+        p_timelines->nb_processed++;
+        next_step(p_timelines, event.channel, event.deadline);
+    }
+    return p_timelines->nb_events != 0;
+}
+
+void timeline_skip(timelines_t* p_timelines, uint32_t tick) {
+    uint8_t i;
+    // same deadline for all: heap is then ordered by channel
+    for(i = 0; i < p_timelines->nb_events; i++) {
+        p_timelines->events[i].deadline = tick;
+        p_timelines->channels[p_timelines->events[i].channel].end_tick = tick;
+    }
+    for(i = p_timelines->nb_events / 2; i-- > 0; ) {
+        sift_down(p_timelines, i);
+    }
+}
+
+float timeline_get_value(const timelines_t* p_timelines, uint8_t channel, uint32_t tick) {
+    const timeline_channel_t* const p_channel = &p_timelines->channels[channel];
+    const int32_t elapsed = (int32_t)(tick - p_channel->start_tick);
+    const int32_t duration = (int32_t)(p_channel->end_tick - p_channel->start_tick);
+    if(elapsed >= duration) {
+        return p_channel->end_value;
+    }
+    if(elapsed <= 0) {
+        return p_channel->start_value;
+    }
+    return p_channel->start_value + (p_channel->end_value - p_channel->start_value) * elapsed / duration;
+}
+
+bool timeline_get_reverse(const timelines_t* p_timelines, uint8_t channel) {
+    return p_timelines->channels[channel].reverse;
+}
@@ -0,0 +1,81 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// independent timelines of sequence steps, one per channel (sensor): each channel
+// runs its own ramps with its own step boundaries and cursor, and a single event
+// queue (binary min-heap) ordered by next deadline merges them for the scheduler,
+// so that each event costs O(log n) whatever the number of channels
+// shared by firmware (speed-sensor.c) and host check (host/timeline-check.c)
+// so it must not depend on any pico header
+//
+// times are scheduler ticks: a step ends on its deadline, next one of the same
+// channel starts on it (not on the tick it was processed on), so that channels
+// never drift from their own step lengths
+
+#define TIMELINE_MAX_STEPS 64
+
+typedef struct {
+    float value; // reached at end of step, linear ramp from previous one
+    bool reverse; // direction, applied from start of step
+    uint32_t ticks; // duration, 0: value applied at once
+} timeline_step_t;
+
+typedef struct {
+    timeline_step_t steps[TIMELINE_MAX_STEPS];
+    uint16_t count;
+    // running
+    bool loop; // starts over once last step is over
+    uint16_t index; // of step in progress
+    uint32_t loops; // times last step was over
+    float start_value;
+    float end_value;
+    bool reverse;
+    uint32_t start_tick;
+    uint32_t end_tick;
+} timeline_channel_t;
+
+// next deadline of a channel
+typedef struct {
+    uint32_t deadline;
+    uint8_t channel;
+} timeline_event_t;
+
+typedef struct {
+    timeline_channel_t* channels;
+    uint8_t nb_channels;
+    // heap: events[0] is the earliest, at most one event per channel
+    timeline_event_t* events;
+    uint8_t nb_events;
+    uint32_t nb_processed; // events processed since start
+} timelines_t;
+
+// empty timelines of nb_channels, channels and events arrays hold nb_channels each
+void timeline_init(timelines_t* p_timelines, timeline_channel_t* channels, timeline_event_t* events,
+                   uint8_t nb_channels);
+// empties timeline of a channel
+void timeline_clear(timelines_t* p_timelines, uint8_t channel);
+// adds a step at end of timeline of a channel, returns false if it is full
+bool timeline_append(timelines_t* p_timelines, uint8_t channel, float value, bool reverse, uint32_t ticks);
+// duration of timeline of a channel (ticks)
+uint32_t timeline_get_duration(const timelines_t* p_timelines, uint8_t channel);
+// starts every timeline on tick, from values and directions of each channel
+// looping timelines start over once over, unless they last no tick at all
+void timeline_start(timelines_t* p_timelines, uint32_t tick, const float* values, const bool* reverses, bool loop);
+// processes every event due on tick (steps over and next steps started)
+// out: false once every timeline is over
+bool timeline_poll(timelines_t* p_timelines, uint32_t tick);
+// ends steps in progress on tick, next ones start from their end values
+void timeline_skip(timelines_t* p_timelines, uint32_t tick);
+// value and direction of a channel on tick (after timeline_poll of that tick)
+float timeline_get_value(const timelines_t* p_timelines, uint8_t channel, uint32_t tick);
+bool timeline_get_reverse(const timelines_t* p_timelines, uint8_t channel);
+
+// event queue, O(log n)
+void timeline_queue_push(timelines_t* p_timelines, uint32_t deadline, uint8_t channel);
+// removes earliest event into p_event, returns false if queue is empty
+bool timeline_queue_pop(timelines_t* p_timelines, timeline_event_t* p_event);
+
+#endif
@@ -1,40 +1,90 @@
 /**
  * Copyright (c) 2024 Gerard Gauthier
  * 
- * Preleminary tests
- * Just kept for reference:
- *  because this method cannot have a fine-grained control over
- *  frequency shifts (i.e. change behavior whithin a 1/4 signal period)
+ * Repeating timer method (first approach of this project)
+ *  a period change only applies from next edge on
+ *  (whereas PWM method can change it within 1/4 signal period)
  */
 
 #include "timer-managed.h"
 
-#include "out-gpios.h"
+#include "hardware/structs/systick.h"
 
-// dHz
-uint32_t freq1 = 70000;
-uint32_t freq2 = 30000;
+static alarm_pool_t* alarm_pool = NULL;
+static repeating_timer_t timer1;
+static repeating_timer_t timer2;
+static bool running1 = false;
+static bool running2 = false;
 
-static bool timer1_callback(repeating_timer_t *rt) {
-    SET_OUTPUT_PULSE_1
-    return true; // keep repeating
+static bool __not_in_flash_func(timer1_callback)(repeating_timer_t *rt) {
+    ISR_LOAD_START
+    OUTPUT_EDGE_1
+    // period of next edge (or stop on target)
+    rt->delay_us = -(int64_t)max_cycle_count1;
+    running1 = max_cycle_count1 != 0;
+    ISR_LOAD_END(isr_busy_cycles)
+    return running1;
 }
 
-static bool timer2_callback(repeating_timer_t *rt) {
-    SET_OUTPUT_PULSE_2
-    return true;
+static bool __not_in_flash_func(timer2_callback)(repeating_timer_t *rt) {
+    ISR_LOAD_START
+    OUTPUT_EDGE_2
+    rt->delay_us = -(int64_t)max_cycle_count2;
+    running2 = max_cycle_count2 != 0;
+    ISR_LOAD_END(isr_busy_cycles)
+    return running2;
 }
 
-void setTimer(uint8_t num, uint32_t freq) {
-    static bool is_init[2] = {false, false};
-    static repeating_timer_t timer[2];
-    int32_t delay = -10000000L/((int32_t)freq*4L);
+static void start_timers() {
+    max_cycle_count1 = 0;
+#if CORE1_SENSOR2
+    max_cycle_count2 = 0;
+#endif
+    // created from core1 so its interrupt is serviced by core1
+    alarm_pool = alarm_pool_create(TIMER_BACKEND_ALARM, 2);
+}
+
+static void stop_timers() {
+    if(running1) {
+        cancel_repeating_timer(&timer1);
+        running1 = false;
+    }
+    if(running2) {
+        cancel_repeating_timer(&timer2);
+        running2 = false;
+    }
+    alarm_pool_destroy(alarm_pool);
+    alarm_pool = NULL;
+}
 
-    num = num & 1;
-    if(is_init[num]) {
-        cancel_repeating_timer(timer+num);
+// starts or stops timer of one sensor according to its new period
+static void update_timer(uint32_t max_count, bool* p_running, repeating_timer_t* p_timer,
+                         repeating_timer_callback_t callback) {
+    if(max_count != 0 && !*p_running) {
+        *p_running = alarm_pool_add_repeating_timer_us(alarm_pool, -(int64_t)max_count,
+                                                       callback, NULL, p_timer);
+    } else if(max_count == 0 && *p_running) {
+        cancel_repeating_timer(p_timer);
+        *p_running = false;
+    }
+}
+
+static void set_timer_channel_params(uint8_t sensor, const channel_params_t* p_params) {
+    if(sensor == 1) {
+        SET_REVERSE_1(p_params->reverse)
+        max_cycle_count1 = p_params->max_count;
+        update_timer(max_cycle_count1, &running1, &timer1, timer1_callback);
     } else {
-        is_init[num] = true;
+        SET_REVERSE_2(p_params->reverse)
+        max_cycle_count2 = p_params->max_count;
+        update_timer(max_cycle_count2, &running2, &timer2, timer2_callback);
     }
-  add_repeating_timer_us(delay, num==0 ? timer1_callback : timer2_callback, NULL, timer+num);
 }
+
+const output_backend_t timer_output_backend = {
+    "timer",
+    start_timers,
+    set_timer_channel_params,
+    get_edge_count,
+    stop_timers
+};
@@ -1,13 +1,12 @@
 #ifndef TIMER_MANAGED_H
 #define TIMER_MANAGED_H
 
-#include "pico/stdlib.h"
+#include "output-backend.h"
 
-// dHz
-#define MAX_FREQ 70000
-extern uint32_t freq1;
-extern uint32_t freq2;
+// timer backend: one repeating timer per sensor, firing on each edge
+// from an alarm pool owned by core1
 
-void setTimer(uint8_t num, uint32_t freq);
+// hardware alarm of core1 alarm pool (default pool of core0 uses alarm 3)
+#define TIMER_BACKEND_ALARM 2
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,211 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Fixed-point longitudinal train model
+ */
+
+#include <string.h>
+
+#include "train-model.h"
+
+const train_params_t train_default_params = {
+    .mass_kg = 400000,
+    .adhesive_mass_kg = 84000,
+    .rotating_mass_kg = 2000,
+    .max_traction_n = 300000,
+    .max_power_w = 5600000,
+    .max_brake_n = 360000,
+    .davis_a_n = 4000,
+    .davis_b_n_per_m_s = 100,
+    .davis_c_n_per_m2_s2 = 8,
+    .peak_adhesion = 21627, // 0.33
+    .sliding_adhesion = 13107 // 0.2
+};
+
+// Q32 speed => Q16
+#define TO_Q16(fine) ((int32_t)((fine) >> 16))
+
+void train_model_init(train_model_t* p_model, const train_params_t* p_params) {
+    uint8_t i;
+    memset(p_model, 0, sizeof(train_model_t));
+    p_model->params = *p_params;
+    p_model->peak_adhesion = p_params->peak_adhesion;
+    p_model->axle_load_n = (int64_t)p_params->adhesive_mass_kg * TRAIN_MODEL_G_MM_S2 / 1000 / TRAIN_MODEL_NB_AXLES;
+    p_model->axle_brake_share = ((int64_t)p_params->adhesive_mass_kg << 16) / p_params->mass_kg;
+    for(i = 0; i <= TRAIN_MODEL_NB_AXLES; i++) {
+        p_model->train_k[i] = (1LL << 48) /
+            (((int64_t)p_params->mass_kg + i * p_params->rotating_mass_kg) * TRAIN_MODEL_RATE_HZ);
+    }
+    p_model->axle_k = (1LL << 48) / ((int64_t)p_params->rotating_mass_kg * TRAIN_MODEL_RATE_HZ);
+}
+
+void train_model_set_speed(train_model_t* p_model, int32_t speed) {
+    uint8_t i;
+    if(speed < 0) {
+        speed = 0;
+    }
+    p_model->fine_speed = (int64_t)speed << 16;
+    p_model->speed = speed;
+    for(i = 0; i < TRAIN_MODEL_NB_AXLES; i++) {
+        p_model->fine_wheel_speed[i] = p_model->fine_speed;
+        p_model->wheel_speed[i] = speed;
+        p_model->slip_sign[i] = 0;
+    }
+}
+
+// motor force on one axle at wheel speed (Q16): constant force, then constant power
+static int32_t get_motor_force(const train_model_t* p_model, uint8_t notch, int32_t wheel_speed) {
+    int64_t force, power_limited;
+    if(notch == 0) {
+        return 0;
+    }
+    force = (int64_t)p_model->params.max_traction_n * notch / TRAIN_MODEL_NB_NOTCHES;
+    if(wheel_speed > 0) {
+        power_limited = ((int64_t)p_model->params.max_power_w * notch / TRAIN_MODEL_NB_NOTCHES << 16) / wheel_speed;
+        if(power_limited < force) {
+            force = power_limited;
+        }
+    }
+    return force / TRAIN_MODEL_NB_AXLES;
+}
+
+// running resistance at speed (Q16), not including A which is added by caller
+static int32_t get_dynamic_resistance(const train_model_t* p_model, int32_t speed) {
+    const int64_t bv = ((int64_t)p_model->params.davis_b_n_per_m_s * speed) >> 16;
+    const int64_t cv2 = ((((int64_t)p_model->params.davis_c_n_per_m2_s2 * speed) >> 16) * speed) >> 16;
+    return bv + cv2;
+}
+
+// adhesion force transmitted by a slipping axle to the train, signed like slip
+static int32_t get_slip_force(const train_model_t* p_model, uint8_t axle, int32_t peak_adhesion) {
+    int64_t slip = p_model->fine_wheel_speed[axle] - p_model->fine_speed;
+    int32_t sliding_adhesion, adhesion;
+    slip = (slip < 0 ? -slip : slip) >> 16;
+    if(slip > TRAIN_MODEL_SLIP_SPEED) {
+        slip = TRAIN_MODEL_SLIP_SPEED;
+    }
+    // sliding adhesion scales with rail condition
+    sliding_adhesion = (int64_t)p_model->params.sliding_adhesion * peak_adhesion / p_model->params.peak_adhesion;
+    adhesion = peak_adhesion - ((int64_t)(peak_adhesion - sliding_adhesion) * slip) / TRAIN_MODEL_SLIP_SPEED;
+    return p_model->slip_sign[axle] * (int32_t)(((int64_t)adhesion * p_model->axle_load_n) >> 16);
+}
+
+// work of a force at average speed (Q16) during a fraction of step (Q16), in Q16 joules
+static int64_t get_work(int32_t force, int32_t average_speed, int32_t fraction) {
+    return ((int64_t)force * average_speed / TRAIN_MODEL_RATE_HZ * fraction) >> 16;
+}
+
+void train_model_step(train_model_t* p_model) {
+    const uint8_t notch = p_model->notch;
+    const int32_t peak_adhesion = p_model->peak_adhesion;
+    const int32_t speed = TO_Q16(p_model->fine_speed);
+    const bool standstill = p_model->fine_speed == 0;
+    const int32_t adhesion_limit = ((int64_t)peak_adhesion * p_model->axle_load_n) >> 16;
+    int32_t motor[TRAIN_MODEL_NB_AXLES], slip_force[TRAIN_MODEL_NB_AXLES], axle_force[TRAIN_MODEL_NB_AXLES];
+    int32_t brake, axle_brake, body_brake, resistance, push, hold, force, transmitted;
+    int32_t average_speed, fraction, average_wheel_speed, wheel_fraction;
+    int64_t dv, dw, new_speed, new_wheel_speed, slip_energy;
+    uint8_t i, nb_sticking;
+    bool stable;
+
+    brake = (int64_t)p_model->params.max_brake_n * p_model->brake / TRAIN_MODEL_NB_BRAKE_STEPS;
+    axle_brake = (((int64_t)brake * p_model->axle_brake_share) >> 16) / TRAIN_MODEL_NB_AXLES;
+    body_brake = brake - axle_brake * TRAIN_MODEL_NB_AXLES;
+    resistance = p_model->params.davis_a_n + get_dynamic_resistance(p_model, speed);
+    for(i = 0; i < TRAIN_MODEL_NB_AXLES; i++) {
+        motor[i] = get_motor_force(p_model, notch, TO_Q16(p_model->fine_wheel_speed[i]));
+    }
+
+    // train acceleration with sticking axles, then check they can transmit their force:
+    // one more axle breaks away at each pass
+    do {
+        nb_sticking = 0;
+        push = 0;
+        hold = resistance + body_brake;
+        for(i = 0; i < TRAIN_MODEL_NB_AXLES; i++) {
+            if(p_model->slip_sign[i] == 0) {
+                nb_sticking++;
+                axle_force[i] = motor[i] - axle_brake;
+                if(standstill && axle_force[i] < 0) { // brake holds, does not pull backwards
+                    axle_force[i] = 0;
+                }
+                push += axle_force[i];
+            } else {
+                slip_force[i] = get_slip_force(p_model, i, peak_adhesion);
+                push += slip_force[i];
+            }
+        }
+        force = push - hold;
+        if(standstill && force < 0) { // static resistance and brakes hold the train
+            force = 0;
+        }
+        dv = ((int64_t)force * p_model->train_k[nb_sticking]) >> 16;
+        stable = true;
+        for(i = 0; i < TRAIN_MODEL_NB_AXLES && stable; i++) {
+            if(p_model->slip_sign[i] == 0) {
+                // force transmitted to rail: wheel inertia takes its share
+                transmitted = axle_force[i] - (int32_t)(((int64_t)p_model->params.rotating_mass_kg * dv * TRAIN_MODEL_RATE_HZ) >> 32);
+                if(transmitted > adhesion_limit || transmitted < -adhesion_limit) {
+                    p_model->slip_sign[i] = transmitted > 0 ? 1 : -1;
+                    stable = false;
+                }
+            }
+        }
+    } while(!stable);
+
+    // train, does not move backwards
+    new_speed = p_model->fine_speed + dv;
+    fraction = TRAIN_MODEL_Q16_ONE;
+    if(new_speed < 0) {
+        fraction = (p_model->fine_speed << 16) / -dv;
+        new_speed = 0;
+    }
+    // held at standstill: no work as average speed is null
+    average_speed = TO_Q16((p_model->fine_speed + new_speed) / 2);
+    p_model->energy.resistance += get_work(resistance, average_speed, fraction);
+    p_model->energy.brake += get_work(body_brake, average_speed, fraction);
+
+    // axles
+    for(i = 0; i < TRAIN_MODEL_NB_AXLES; i++) {
+        if(p_model->slip_sign[i] == 0) {
+            p_model->energy.motor += get_work(motor[i], average_speed, fraction);
+            // brake force actually applied (less than full when holding at standstill)
+            p_model->energy.brake += get_work(motor[i] - axle_force[i], average_speed, fraction);
+            p_model->fine_wheel_speed[i] = new_speed;
+            continue;
+        }
+        // slipping axle: motor and brake against adhesion
+        force = motor[i] - slip_force[i];
+        if(p_model->fine_wheel_speed[i] == 0 && force <= axle_brake) {
+            dw = 0; // locked by brake
+        } else {
+            dw = ((int64_t)(force - axle_brake) * p_model->axle_k) >> 16;
+        }
+        new_wheel_speed = p_model->fine_wheel_speed[i] + dw;
+        wheel_fraction = TRAIN_MODEL_Q16_ONE;
+        if(new_wheel_speed < 0) { // brake locks wheel during step
+            wheel_fraction = (p_model->fine_wheel_speed[i] << 16) / -dw;
+            new_wheel_speed = 0;
+        }
+        average_wheel_speed = TO_Q16((p_model->fine_wheel_speed[i] + new_wheel_speed) / 2);
+        p_model->energy.motor += get_work(motor[i], average_wheel_speed, wheel_fraction);
+        p_model->energy.brake += get_work(axle_brake, average_wheel_speed, wheel_fraction);
+        p_model->energy.slip += get_work(slip_force[i], average_wheel_speed, wheel_fraction) -
+                                get_work(slip_force[i], average_speed, fraction);
+        p_model->fine_wheel_speed[i] = new_wheel_speed;
+        // sticks again when slip vanishes: speed difference is lost in contact
+        if((new_wheel_speed - new_speed) * p_model->slip_sign[i] <= 0) {
+            slip_energy = ((new_wheel_speed - new_speed) >> 16) * ((new_wheel_speed + new_speed) >> 16) >> 16;
+            p_model->energy.slip += slip_energy * p_model->params.rotating_mass_kg / 2;
+            p_model->fine_wheel_speed[i] = new_speed;
+            p_model->slip_sign[i] = 0;
+        }
+    }
+
+    p_model->fine_speed = new_speed;
+    p_model->speed = TO_Q16(new_speed);
+    for(i = 0; i < TRAIN_MODEL_NB_AXLES; i++) {
+        p_model->wheel_speed[i] = TO_Q16(p_model->fine_wheel_speed[i]);
+    }
+    p_model->ticks++;
+}
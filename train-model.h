@@ -0,0 +1,84 @@
+#ifndef TRAIN_MODEL_H
+#define TRAIN_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// longitudinal train model integrated at a fixed rate in fixed point
+// (no floating point: it runs in a timer interrupt on core0)
+// shared by firmware and host simulator (host/train-model-sim.c)
+// so it must not depend on any pico header
+//
+// sensors are fitted on motored and braked axles of the locomotive,
+// one modelled axle per sensor: each one sticks to the rail as long as
+// adhesion allows, else it slips (traction) or slides (braking)
+// and its wheel speed departs from train speed
+
+#define TRAIN_MODEL_RATE_HZ 1000
+#define TRAIN_MODEL_NB_AXLES 2
+#define TRAIN_MODEL_NB_NOTCHES 8
+#define TRAIN_MODEL_NB_BRAKE_STEPS 8
+
+// speeds are in m/s, adhesion coefficients are ratios, both in Q16.16
+#define TRAIN_MODEL_Q16_ONE 65536
+// slip speed over which adhesion has dropped to its sliding value
+#define TRAIN_MODEL_SLIP_SPEED TRAIN_MODEL_Q16_ONE
+#define TRAIN_MODEL_G_MM_S2 9807
+
+typedef struct {
+    int32_t mass_kg; // whole train
+    int32_t adhesive_mass_kg; // carried by locomotive axles (traction and modelled axles)
+    int32_t rotating_mass_kg; // equivalent at wheel rim of each modelled axle (wheels, gears, motor)
+    int32_t max_traction_n; // at full notch, shared by modelled axles
+    int32_t max_power_w; // at full notch
+    int32_t max_brake_n; // full brake, whole train (modelled axles get adhesive mass share)
+    // running resistance: A + B.v + C.v2
+    int32_t davis_a_n;
+    int32_t davis_b_n_per_m_s;
+    int32_t davis_c_n_per_m2_s2;
+    int32_t peak_adhesion; // Q16: rail condition, 0.33 dry, 0.2 wet, 0.05 leaves
+    int32_t sliding_adhesion; // Q16: reached at TRAIN_MODEL_SLIP_SPEED and over
+} train_params_t;
+
+// work since init in joules, Q16.16
+// motor - brake - resistance - slip equals kinetic energy increase
+typedef struct {
+    int64_t motor;
+    int64_t brake;
+    int64_t resistance;
+    int64_t slip; // at wheel/rail contact
+} train_energy_t;
+
+typedef struct {
+    train_params_t params;
+    // derived from params by train_model_init
+    int32_t axle_load_n;
+    int32_t axle_brake_share; // Q16 of brake force on modelled axles
+    int64_t train_k[TRAIN_MODEL_NB_AXLES + 1]; // speed change (m/s, Q48) per newton and step with n sticking axles
+    int64_t axle_k; // same for a slipping axle
+    // commands (written by foreground, read by interrupt)
+    volatile uint8_t notch; // 0..TRAIN_MODEL_NB_NOTCHES
+    volatile uint8_t brake; // 0..TRAIN_MODEL_NB_BRAKE_STEPS
+    volatile int32_t peak_adhesion; // Q16, initialized from params
+    // state, integrated in Q32 so that rounding does not drift over hours
+    int64_t fine_speed; // train, never negative
+    int64_t fine_wheel_speed[TRAIN_MODEL_NB_AXLES]; // at rim
+    // same as above in Q16 m/s, to be read by foreground (atomic)
+    volatile int32_t speed;
+    volatile int32_t wheel_speed[TRAIN_MODEL_NB_AXLES];
+    int8_t slip_sign[TRAIN_MODEL_NB_AXLES]; // 0 when sticking, else sign of wheel speed - train speed
+    volatile uint32_t ticks;
+    train_energy_t energy;
+} train_model_t;
+
+// sensible defaults: 84 t locomotive hauling 316 t
+extern const train_params_t train_default_params;
+
+// init model from params, at rest
+void train_model_init(train_model_t* p_model, const train_params_t* p_params);
+// sets train and wheel speeds (Q16 m/s, all axles sticking), e.g. when starting from current speed
+void train_model_set_speed(train_model_t* p_model, int32_t speed);
+// integrates one step (1 / TRAIN_MODEL_RATE_HZ)
+void train_model_step(train_model_t* p_model);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef TRIGGER_FILTER_H
+#define TRIGGER_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// rejects contact bounce on external trigger input: a rising edge
+// is a trigger only after TRIGGER_HOLDOFF_US without any edge
+// shared by firmware (trigger.c) and host simulator (host/trigger-sim.c)
+// so it must not depend on any pico header
+
+#define TRIGGER_HOLDOFF_US 2000
+
+typedef struct {
+    uint32_t last_edge_us;
+    bool edge_seen;
+} trigger_filter_t;
+
+// feeds a rising edge (time in µs, wraps around), returns true if it is a trigger
+static inline bool trigger_filter_feed(trigger_filter_t* p_filter, uint32_t time_us) {
+    const bool accepted = !p_filter->edge_seen || time_us - p_filter->last_edge_us >= TRIGGER_HOLDOFF_US;
+    // any edge restarts hold off: a bouncing contact is one trigger
+    p_filter->last_edge_us = time_us;
+    p_filter->edge_seen = true;
+    return accepted;
+}
+
+#endif
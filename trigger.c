@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * External trigger input
+ */
+
+#include "trigger.h"
+
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "pico/stdlib.h"
+
+#include "core0-output.h"
+#include "journal.h"
+#include "trigger-filter.h"
+
+static trigger_filter_t filter;
+static volatile bool armed = false;
+static volatile bool fired = false;
+static volatile uint32_t trigger_time;
+static bool data_armed = false;
+static intercore_data_t armed_data;
+
+static void __not_in_flash_func(on_trigger)(uint gpio, uint32_t events) {
+    const uint32_t now = time_us_32();
+    if(!trigger_filter_feed(&filter, now) || !armed) {
+        return;
+    }
+    armed = false;
+    trigger_time = now;
+    edge_probe_armed = true;
+    if(data_armed) {
+        // core1 applies it as soon as it gets it: queue is empty while waiting for trigger
+        if(!queue_try_add(&call_queue, &armed_data)) {
+            journal_log(e_journal_underrun, e_underrun_trigger_mailbox, 0);
+        }
+#if SPLIT_CORES
+        channel_params_t params;
+        params.max_count = armed_data.max_count2;
+        params.reverse = armed_data.invert2;
+        params.targeted = armed_data.targeted2;
+        params.target = armed_data.target2;
+        core0_output_set_channel_params(&params);
+#endif
+    }
+    fired = true;
+    journal_log(e_journal_trigger, data_armed, 0);
+}
+
+void trigger_init() {
+    gpio_init(TRIGGER_GPIO);
+    gpio_set_dir(TRIGGER_GPIO, GPIO_IN);
+    gpio_pull_down(TRIGGER_GPIO);
+    gpio_set_irq_enabled_with_callback(TRIGGER_GPIO, GPIO_IRQ_EDGE_RISE, true, on_trigger);
+    irq_set_priority(IO_IRQ_BANK0, PICO_HIGHEST_IRQ_PRIORITY);
+}
+
+void trigger_arm(const intercore_data_t* p_data) {
+    armed = false;
+    data_armed = p_data != NULL;
+    if(data_armed) {
+        armed_data = *p_data;
+    }
+    fired = false;
+    armed = true;
+}
+
+void trigger_disarm() {
+    armed = false;
+    fired = false;
+}
+
+bool trigger_fired(uint32_t* p_time_us) {
+    if(!fired) {
+        return false;
+    }
+    fired = false;
+    *p_time_us = trigger_time;
+    return true;
+}
+
+int32_t trigger_get_latency_us() {
+#if OUTPUT_EDGE_PROBE
+    if(edge_probe_armed || trigger_time == 0) {
+        return -1;
+    }
+    return edge_probe_time - trigger_time;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,25 @@
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "output-backend.h"
+
+// external trigger input on TRIGGER_GPIO (see output-config.h), rising edge
+// starts an armed sequence or advances a running one to its next step
+// edge is time stamped by GPIO interrupt, which also hands precomputed
+// output parameters straight to outputs so they react within microseconds
+// sequence scheduler catches up on its next tick
+
+void trigger_init();
+// arms trigger: when it fires, p_data (if not NULL) is applied to outputs from interrupt
+// (data is copied) and first output edge is time stamped
+void trigger_arm(const intercore_data_t* p_data);
+void trigger_disarm();
+// returns true (once) if trigger fired since armed, with its time (µs, see time_us_32)
+bool trigger_fired(uint32_t* p_time_us);
+// time between last trigger and first output edge after it (µs), -1 if no edge yet
+int32_t trigger_get_latency_us();
+
+#endif
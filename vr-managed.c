@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Variable reluctance sensors: sine synthesized by PWM,
+ * sampled at VR_WAVE_SAMPLE_RATE_HZ with a phase accumulator per sensor
+ */
+
+#include "vr-managed.h"
+#include "vr-wave.h"
+
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/structs/systick.h"
+
+// phase step per sample, negative (two's complement) when reversed
+static uint32_t phase_step1 = 0;
+static uint32_t phase_step2 = 0;
+static int32_t amplitude1 = 0;
+static int32_t amplitude2 = 0;
+static uint32_t phase1 = 0;
+static uint32_t phase2 = 0;
+
+// 4 µs between samples: kept in RAM, out of XIP cache misses
+static void __not_in_flash_func(on_vr_wrap)() {
+    ISR_LOAD_START
+    uint32_t previous_phase;
+    pwm_clear_irq(VR_SLICE_NUM);
+    if(max_cycle_count1) {
+        previous_phase = phase1;
+        phase1 += phase_step1;
+        pwm_set_chan_level(VR_SLICE_NUM, PWM_CHAN_A, vr_wave_get_level(phase1, amplitude1));
+        // new quadrant: edge (phase step is at most one quadrant)
+        if((phase1 ^ previous_phase) & 0xC0000000u) {
+            OUTPUT_EDGE_1
+        }
+    } else {
+        pwm_set_chan_level(VR_SLICE_NUM, PWM_CHAN_A, VR_WAVE_MID_LEVEL);
+    }
+#if CORE1_SENSOR2
+    if(max_cycle_count2) {
+        previous_phase = phase2;
+        phase2 += phase_step2;
+        pwm_set_chan_level(VR_SLICE_NUM, PWM_CHAN_B, vr_wave_get_level(phase2, amplitude2));
+        if((phase2 ^ previous_phase) & 0xC0000000u) {
+            OUTPUT_EDGE_2
+        }
+    } else {
+        pwm_set_chan_level(VR_SLICE_NUM, PWM_CHAN_B, VR_WAVE_MID_LEVEL);
+    }
+#endif
+    ISR_LOAD_END(isr_busy_cycles)
+}
+
+static void start_vr() {
+    pwm_config config = pwm_get_default_config();
+    vr_wave_init();
+    max_cycle_count1 = 0;
+#if CORE1_SENSOR2
+    max_cycle_count2 = 0;
+#endif
+    gpio_set_function(VR1_GPIO, GPIO_FUNC_PWM);
+#if CORE1_SENSOR2
+    gpio_set_function(VR2_GPIO, GPIO_FUNC_PWM);
+#endif
+    pwm_clear_irq(VR_SLICE_NUM);
+    pwm_set_irq_enabled(VR_SLICE_NUM, true);
+    irq_set_exclusive_handler(PWM_IRQ_WRAP, on_vr_wrap);
+    irq_set_enabled(PWM_IRQ_WRAP, true);
+    pwm_config_set_clkdiv(&config, 1.f);
+    pwm_config_set_wrap(&config, VR_WAVE_PWM_WRAP);
+    pwm_init(VR_SLICE_NUM, &config, false);
+    pwm_set_both_levels(VR_SLICE_NUM, VR_WAVE_MID_LEVEL, VR_WAVE_MID_LEVEL);
+    pwm_set_enabled(VR_SLICE_NUM, true);
+}
+
+static void stop_vr() {
+    pwm_set_enabled(VR_SLICE_NUM, false);
+    irq_set_enabled(PWM_IRQ_WRAP, false);
+    pwm_set_irq_enabled(VR_SLICE_NUM, false);
+    irq_remove_handler(PWM_IRQ_WRAP, on_vr_wrap);
+    // released as inputs
+    gpio_init(VR1_GPIO);
+#if CORE1_SENSOR2
+    gpio_init(VR2_GPIO);
+#endif
+}
+
+static void set_vr_channel_params(uint8_t sensor, const channel_params_t* p_params) {
+    uint32_t step = 0;
+    int32_t amplitude = 0;
+    if(p_params->max_count != 0) {
+        step = vr_wave_get_phase_step(p_params->max_count);
+        amplitude = vr_wave_get_amplitude(p_params->max_count);
+    }
+    if(p_params->reverse) {
+        step = -step;
+    }
+    // applied from next sample on: phase, hence output, is continuous
+    if(sensor == 1) {
+        SET_REVERSE_1(p_params->reverse)
+        phase_step1 = step;
+        amplitude1 = amplitude;
+        max_cycle_count1 = p_params->max_count;
+    } else {
+        SET_REVERSE_2(p_params->reverse)
+        phase_step2 = step;
+        amplitude2 = amplitude;
+        max_cycle_count2 = p_params->max_count;
+    }
+}
+
+const output_backend_t vr_output_backend = {
+    "vr",
+    start_vr,
+    set_vr_channel_params,
+    get_edge_count,
+    stop_vr
+};
@@ -0,0 +1,21 @@
+#ifndef VR_MANAGED_H
+#define VR_MANAGED_H
+
+#include "output-backend.h"
+
+// VR backend: simulated variable reluctance sensors, for controllers with passive pickups
+// a PWM slice outputs one sine per sensor (see vr-wave.h) on VR1_GPIO and VR2_GPIO,
+// to be smoothed by an RC filter; its wrap interrupt computes samples
+// quadrature outputs and edge counts carry on, one edge per quarter of sine
+
+#define VR_SLICE_NUM ((VR1_GPIO >> 1) & 7)
+
+#if VR_SLICE_NUM != ((VR2_GPIO >> 1) & 7) || VR1_GPIO == VR2_GPIO
+#error "VR1_GPIO and VR2_GPIO must be both channels of a PWM slice"
+#endif
+
+#if VR_SLICE_NUM == 0
+#error "PWM slice 0 is used by PWM backend"
+#endif
+
+#endif
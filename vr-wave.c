@@ -0,0 +1,18 @@
+/**
+ * Copyright (c) 2024 Gerard Gauthier
+ *
+ * Quarter-wave table of simulated VR sensor sine
+ */
+
+#include <math.h>
+
+#include "vr-wave.h"
+
+int16_t vr_wave_lut[VR_WAVE_LUT_SIZE];
+
+void vr_wave_init() {
+    uint32_t i;
+    for(i = 0; i < VR_WAVE_LUT_SIZE; i++) {
+        vr_wave_lut[i] = (int16_t)lroundf(32767.0f * sinf(((float)i + 0.5f) * (3.14159265f / 2.0f) / VR_WAVE_LUT_SIZE));
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef VR_WAVE_H
+#define VR_WAVE_H
+
+#include <stdint.h>
+
+// sine of a simulated variable reluctance (VR) sensor, as PWM levels
+// shared by VR backend (vr-managed.c) and host check (host/vr-wave-check.c)
+// so it must not depend on any pico header
+//
+// a 32-bit phase accumulator steps once per PWM carrier period, its two upper bits
+// are the quadrant (one sensor edge each) and the following VR_WAVE_LUT_BITS
+// index a quarter-wave table, mirrored and negated for other quadrants
+// amplitude grows with frequency like a VR pickup (until it clamps, as inputs do)
+
+// PWM carrier: 125 MHz / (VR_WAVE_PWM_WRAP + 1), one sample per carrier period
+// sample rate is 34 times MAX_FREQUENCY, carrier is easily filtered out by an RC filter
+#define VR_WAVE_PWM_WRAP 499
+#define VR_WAVE_SAMPLE_RATE_HZ 250000
+#define VR_WAVE_MID_LEVEL ((VR_WAVE_PWM_WRAP + 1) / 2)
+
+#define VR_WAVE_LUT_BITS 10
+#define VR_WAVE_LUT_SIZE (1 << VR_WAVE_LUT_BITS)
+
+// frequency over which amplitude is full scale
+#define VR_WAVE_FULL_SCALE_HZ 1000
+
+// quarter-wave sine in Q15, at middle of each table step (so that mirroring is exact)
+extern int16_t vr_wave_lut[VR_WAVE_LUT_SIZE];
+
+// fills vr_wave_lut, to be called once before use
+void vr_wave_init();
+
+// phase step per sample for a quarter period (µs, see max_cycle_count1), not null
+static inline uint32_t vr_wave_get_phase_step(uint32_t max_count) {
+    // frequency is 1e6 / (4 max_count) = VR_WAVE_SAMPLE_RATE_HZ / max_count
+    // i.e. one period every max_count samples
+    return max_count <= 1 ? 0x80000000u : (uint32_t)((1ULL << 32) / max_count);
+}
+
+// peak amplitude in 1/256 of PWM level for a quarter period (µs), not null
+// (low speeds are not stuck to a few whole levels)
+#define VR_WAVE_MAX_AMPLITUDE ((VR_WAVE_MID_LEVEL - 1) << 8)
+static inline int32_t vr_wave_get_amplitude(uint32_t max_count) {
+    const uint64_t amplitude = (uint64_t)VR_WAVE_MAX_AMPLITUDE * (1000000 / 4) / ((uint64_t)max_count * VR_WAVE_FULL_SCALE_HZ);
+    return amplitude > VR_WAVE_MAX_AMPLITUDE ? VR_WAVE_MAX_AMPLITUDE : (int32_t)amplitude;
+}
+
+// PWM level of a sample
+static inline uint32_t vr_wave_get_level(uint32_t phase, int32_t amplitude) {
+    const uint32_t index = (phase >> (30 - VR_WAVE_LUT_BITS)) & (VR_WAVE_LUT_SIZE - 1);
+    const int32_t value = vr_wave_lut[phase & 0x40000000u ? VR_WAVE_LUT_SIZE - 1 - index : index] * amplitude;
+    // Q15 * Q8, rounded to nearest level
+    return VR_WAVE_MID_LEVEL + (((phase & 0x80000000u ? -value : value) + (1 << 22)) >> 23);
+}
+
+#endif